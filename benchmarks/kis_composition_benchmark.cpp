@@ -43,15 +43,22 @@
 #include <KoColorSpace.h>
 #include <KoCompositeOp.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
 
 #include <KoColorSpaceTraits.h>
 #include <KoCompositeOpAlphaDarken.h>
 #include <KoCompositeOpOver.h>
+#include <KoCompositeOpCopy2.h>
+#include <KoCompositeOpGeneric.h>
+#include <KoCompositeOpRegistry.h>
 #include "KoOptimizedCompositeOpFactory.h"
 
 // for posix_memalign()
 #include <stdlib.h>
 
+#include <cmath>
+#include <limits>
+
 #include <kis_debug.h>
 
 #if defined _MSC_VER
@@ -127,6 +134,27 @@ struct RandomGenerator<quint8>
     boost::mt11213b m_rnd;
 };
 
+template <>
+struct RandomGenerator<quint16>
+{
+    RandomGenerator(int seed)
+        : m_smallint(0,65535),
+          m_rnd(seed)
+    {
+    }
+
+    quint16 operator() () {
+        return m_smallint(m_rnd);
+    }
+
+    quint16 unit() {
+        return KoColorSpaceMathsTraits<quint16>::unitValue;
+    }
+
+    boost::uniform_smallint<int> m_smallint;
+    boost::mt11213b m_rnd;
+};
+
 template <>
 struct RandomGenerator<float>
 {
@@ -157,6 +185,25 @@ struct RandomGenerator<double> : RandomGenerator<float>
     }
 };
 
+#ifdef HAVE_OPENEXR
+template <>
+struct RandomGenerator<half> : RandomGenerator<float>
+{
+    RandomGenerator(int seed)
+        : RandomGenerator<float>(seed)
+    {
+    }
+
+    half operator() () {
+        return half(RandomGenerator<float>::operator()());
+    }
+
+    half unit() {
+        return KoColorSpaceMathsTraits<half>::unitValue;
+    }
+};
+#endif
+
 
 template <typename channel_type>
 void generateDataLine(uint seed, int numPixels, quint8 *srcPixels, quint8 *dstPixels, quint8 *mask, AlphaRange srcAlphaRange, AlphaRange dstAlphaRange)
@@ -222,7 +269,8 @@ QVector<Tile> generateTiles(int size,
                             const int dstAlignmentShift,
                             AlphaRange srcAlphaRange,
                             AlphaRange dstAlphaRange,
-                            const quint32 pixelSize)
+                            const quint32 pixelSize,
+                            bool halfFloat = false)
 {
     QVector<Tile> tiles(size);
 
@@ -255,6 +303,12 @@ QVector<Tile> generateTiles(int size,
 
         if (pixelSize == 4) {
             generateDataLine<quint8>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+        } else if (pixelSize == 8 && !halfFloat) {
+            generateDataLine<quint16>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+#ifdef HAVE_OPENEXR
+        } else if (pixelSize == 8 && halfFloat) {
+            generateDataLine<half>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+#endif
         } else if (pixelSize == 16) {
             generateDataLine<float>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else {
@@ -322,23 +376,90 @@ bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec) {
     return true;
 }
 
-bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2)
+/**
+ * Compares the results of the optimized and generic versions of the
+ * generic composite ops (and of the other ops that divide the color
+ * by the resulting alpha).
+ *
+ * The alpha is compared with \p prec tolerance and so are the color
+ * channels, but premultiplied by alpha: the generic op divides the
+ * color by the resulting alpha, which turns a \p prec difference into
+ * prec * unit / alpha difference of the un-premultiplied color.
+ *
+ * For 8-bit colorspaces the optimized ops round the intermediate values
+ * exactly the way the generic ones do, so the only source of difference
+ * is the blending function, which is calculated in float instead of the
+ * integer cfXXX() function. The blended values may differ by one unit.
+ *
+ * For 16-bit colorspaces the optimized ops work in float, while every
+ * intermediate value of the generic ones is rounded to an integer,
+ * which gives an error of a few units.
+ */
+template <typename channel_type>
+bool compareGenericOpsPixels(QVector<Tile> &tiles, qreal prec)
+{
+    const qreal unit = KoColorSpaceMathsTraits<channel_type>::unitValue;
+
+    const channel_type *dst1 = reinterpret_cast<const channel_type*>(tiles[0].dst);
+    const channel_type *dst2 = reinterpret_cast<const channel_type*>(tiles[1].dst);
+
+    for (int i = 0; i < numPixels; i++) {
+        const qreal alpha = qMax(qreal(dst1[3]), qreal(dst2[3]));
+
+        qreal colorPrec = alpha > 0 ? qMax(prec, prec * unit / alpha) : 0;
+        if (std::numeric_limits<channel_type>::is_integer) {
+            colorPrec = std::ceil(colorPrec);
+        }
+
+        bool isEqual = qAbs(qreal(dst1[3]) - qreal(dst2[3])) <= prec;
+
+        for (int ch = 0; ch < 3 && alpha > 0; ch++) {
+            isEqual &= qAbs(qreal(dst1[ch]) - qreal(dst2[ch])) <= colorPrec;
+        }
+
+        if (!isEqual) {
+            const channel_type *src = reinterpret_cast<const channel_type*>(tiles[0].src) + 4 * i;
+
+            dbgKrita << "Wrong result:" << i << "tolerance:" << colorPrec;
+            dbgKrita << "Act: " << qreal(dst1[0]) << qreal(dst1[1]) << qreal(dst1[2]) << qreal(dst1[3]);
+            dbgKrita << "Exp: " << qreal(dst2[0]) << qreal(dst2[1]) << qreal(dst2[2]) << qreal(dst2[3]);
+            dbgKrita << "Src: " << qreal(src[0]) << qreal(src[1]) << qreal(src[2]) << qreal(src[3]);
+            dbgKrita << "Msk: " << tiles[0].mask[i];
+
+            return false;
+        }
+
+        dst1 += 4;
+        dst2 += 4;
+    }
+
+    return true;
+}
+
+/**
+ * Composites the same data with \p op1 and \p op2. The results are
+ * written into the destination of the first and the second tile
+ * respectively.
+ */
+QVector<Tile> compositeTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2,
+                              AlphaRange dstAlphaRange, const QBitArray &channelFlags = QBitArray())
 {
     Q_ASSERT(op1->colorSpace()->pixelSize() == op2->colorSpace()->pixelSize());
     const quint32 pixelSize = op1->colorSpace()->pixelSize();
+    const bool halfFloat = op1->colorSpace()->colorDepthId() == Float16BitsColorDepthID;
     const int alignment = 16;
-    QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, ALPHA_RANDOM, op1->colorSpace()->pixelSize());
+    QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, dstAlphaRange, pixelSize, halfFloat);
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
     // This is a hack as in the old version we get a rounding of opacity to this value
     params.opacity       = float(Arithmetic::scale<quint8>(0.5*1.0f))/255.0;
     params.flow          = 0.3*1.0f;
-    params.channelFlags  = QBitArray();
+    params.channelFlags  = channelFlags;
 
     params.dstRowStart   = tiles[0].dst;
     params.srcRowStart   = tiles[0].src;
@@ -350,10 +471,34 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     params.maskRowStart  = haveMask ? tiles[1].mask : 0;
     op2->composite(params);
 
+    return tiles;
+}
+
+bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2, AlphaRange dstAlphaRange = ALPHA_RANDOM)
+{
+    const quint32 pixelSize = op1->colorSpace()->pixelSize();
+    const bool halfFloat = op1->colorSpace()->colorDepthId() == Float16BitsColorDepthID;
+    const int alignment = 16;
+    QVector<Tile> tiles = compositeTwoOps(haveMask, op1, op2, dstAlphaRange);
+
     bool compareResult = true;
     if (pixelSize == 4) {
         compareResult = compareTwoOpsPixels<quint8>(tiles, 10);
     }
+    else if (pixelSize == 8 && !halfFloat) {
+        /**
+         * The integer version of the ops rounds every intermediate
+         * value, which gives an error of a few dozens of units when
+         * divided by a small alpha. It is still less than one unit
+         * of an 8-bit channel.
+         */
+        compareResult = compareTwoOpsPixels<quint16>(tiles, 257);
+    }
+#ifdef HAVE_OPENEXR
+    else if (pixelSize == 8 && halfFloat) {
+        compareResult = compareTwoOpsPixels<half>(tiles, half(5e-3));
+    }
+#endif
     else if (pixelSize == 16) {
         compareResult = compareTwoOpsPixels<float>(tiles, 2e-7);
     }
@@ -406,14 +551,18 @@ void benchmarkCompositeOp(const KoCompositeOp *op,
 {
     QString testName = getTestName(haveMask, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange);
 
+    const quint32 pixelSize = op->colorSpace()->pixelSize();
+
     QVector<Tile> tiles =
-        generateTiles(numTiles, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange, op->colorSpace()->pixelSize());
+        generateTiles(numTiles, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange,
+                      pixelSize,
+                      op->colorSpace()->colorDepthId() == Float16BitsColorDepthID);
 
-    const int tileOffset = 4 * (processRect.y() * rowStride + processRect.x());
+    const int tileOffset = pixelSize * (processRect.y() * rowStride + processRect.x());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -710,6 +859,247 @@ void KisCompositionBenchmark::compareRgbF32OverOps()
     delete opAct;
 }
 
+void KisCompositionBenchmark::compareRgbU16AlphaDarkenOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createAlphaDarkenOpU16(cs));
+    QScopedPointer<KoCompositeOp> opExp(new KoCompositeOpAlphaDarken<KoBgrU16Traits>(cs));
+
+    QVERIFY(compareTwoOps(true, opAct.data(), opExp.data()));
+    QVERIFY(compareTwoOps(false, opAct.data(), opExp.data()));
+}
+
+void KisCompositionBenchmark::compareRgbU16OverOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createOverOpU16(cs));
+    QScopedPointer<KoCompositeOp> opExp(new KoCompositeOpOver<KoBgrU16Traits>(cs));
+
+    QVERIFY(compareTwoOps(true, opAct.data(), opExp.data()));
+    QVERIFY(compareTwoOps(false, opAct.data(), opExp.data()));
+}
+
+void KisCompositionBenchmark::compareRgbU16CopyOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createCopyOpU16(cs));
+    QScopedPointer<KoCompositeOp> opExp(new KoCompositeOpCopy2<KoBgrU16Traits>(cs));
+
+    QVERIFY(compareTwoOps(true, opAct.data(), opExp.data(), ALPHA_UNIT));
+    QVERIFY(compareTwoOps(false, opAct.data(), opExp.data(), ALPHA_UNIT));
+
+    /**
+     * The integer version divides the blended channels by the
+     * resulting alpha, which amplifies its rounding errors, so
+     * on the translucent destination the colors are compared
+     * premultiplied
+     */
+    Q_FOREACH (bool haveMask, QVector<bool>({true, false})) {
+        QVector<Tile> tiles = compositeTwoOps(haveMask, opAct.data(), opExp.data(), ALPHA_RANDOM);
+        const bool compareResult = compareGenericOpsPixels<quint16>(tiles, 8);
+        freeTiles(tiles, 16, 16);
+
+        QVERIFY(compareResult);
+    }
+}
+
+void KisCompositionBenchmark::compareRgbF16AlphaDarkenOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), "");
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createAlphaDarkenOpF16(cs));
+    QScopedPointer<KoCompositeOp> opExp(new KoCompositeOpAlphaDarken<KoRgbF16Traits>(cs));
+
+    QVERIFY(compareTwoOps(true, opAct.data(), opExp.data()));
+    QVERIFY(compareTwoOps(false, opAct.data(), opExp.data()));
+#endif
+}
+
+void KisCompositionBenchmark::compareRgbF16OverOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), "");
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createOverOpF16(cs));
+    QScopedPointer<KoCompositeOp> opExp(new KoCompositeOpOver<KoRgbF16Traits>(cs));
+
+    QVERIFY(compareTwoOps(true, opAct.data(), opExp.data()));
+    QVERIFY(compareTwoOps(false, opAct.data(), opExp.data()));
+#endif
+}
+
+void KisCompositionBenchmark::compareRgbF16CopyOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), "");
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createCopyOpF16(cs));
+    QScopedPointer<KoCompositeOp> opExp(new KoCompositeOpCopy2<KoRgbF16Traits>(cs));
+
+    QVERIFY(compareTwoOps(true, opAct.data(), opExp.data(), ALPHA_UNIT));
+    QVERIFY(compareTwoOps(false, opAct.data(), opExp.data(), ALPHA_UNIT));
+
+    Q_FOREACH (bool haveMask, QVector<bool>({true, false})) {
+        QVector<Tile> tiles = compositeTwoOps(haveMask, opAct.data(), opExp.data(), ALPHA_RANDOM);
+        const bool compareResult = compareGenericOpsPixels<half>(tiles, 5e-3);
+        freeTiles(tiles, 16, 16);
+
+        QVERIFY(compareResult);
+    }
+#endif
+}
+
+template<class Traits, typename Traits::channels_type compositeFunc(typename Traits::channels_type, typename Traits::channels_type)>
+KoCompositeOp* createGenericOp(const KoColorSpace *cs, const QString &id)
+{
+    return new KoCompositeOpGenericSC<Traits, compositeFunc>(cs, id, id, KoCompositeOp::categoryMix());
+}
+
+template<class Traits, void compositeFunc(float, float, float, float&, float&, float&)>
+KoCompositeOp* createGenericHSLOp(const KoColorSpace *cs, const QString &id)
+{
+    return new KoCompositeOpGenericHSL<Traits, compositeFunc>(cs, id, id, KoCompositeOp::categoryHSY());
+}
+
+template<class Traits>
+KoCompositeOp* createLegacyGenericOp(const KoColorSpace *cs, const QString &id)
+{
+    typedef typename Traits::channels_type T;
+
+    if (id == COMPOSITE_OVERLAY) return createGenericOp<Traits, &cfOverlay<T> >(cs, id);
+    if (id == COMPOSITE_GRAIN_MERGE) return createGenericOp<Traits, &cfGrainMerge<T> >(cs, id);
+    if (id == COMPOSITE_GRAIN_EXTRACT) return createGenericOp<Traits, &cfGrainExtract<T> >(cs, id);
+    if (id == COMPOSITE_HARD_MIX) return createGenericOp<Traits, &cfHardMix<T> >(cs, id);
+    if (id == COMPOSITE_GEOMETRIC_MEAN) return createGenericOp<Traits, &cfGeometricMean<T> >(cs, id);
+    if (id == COMPOSITE_PARALLEL) return createGenericOp<Traits, &cfParallel<T> >(cs, id);
+    if (id == COMPOSITE_ALLANON) return createGenericOp<Traits, &cfAllanon<T> >(cs, id);
+    if (id == COMPOSITE_HARD_OVERLAY) return createGenericOp<Traits, &cfHardOverlay<T> >(cs, id);
+    if (id == COMPOSITE_SCREEN) return createGenericOp<Traits, &cfScreen<T> >(cs, id);
+    if (id == COMPOSITE_DODGE) return createGenericOp<Traits, &cfColorDodge<T> >(cs, id);
+    if (id == COMPOSITE_LINEAR_DODGE) return createGenericOp<Traits, &cfAddition<T> >(cs, id);
+    if (id == COMPOSITE_LIGHTEN) return createGenericOp<Traits, &cfLightenOnly<T> >(cs, id);
+    if (id == COMPOSITE_HARD_LIGHT) return createGenericOp<Traits, &cfHardLight<T> >(cs, id);
+    if (id == COMPOSITE_SOFT_LIGHT_SVG) return createGenericOp<Traits, &cfSoftLightSvg<T> >(cs, id);
+    if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP) return createGenericOp<Traits, &cfSoftLight<T> >(cs, id);
+    if (id == COMPOSITE_VIVID_LIGHT) return createGenericOp<Traits, &cfVividLight<T> >(cs, id);
+    if (id == COMPOSITE_PIN_LIGHT) return createGenericOp<Traits, &cfPinLight<T> >(cs, id);
+    if (id == COMPOSITE_LINEAR_LIGHT) return createGenericOp<Traits, &cfLinearLight<T> >(cs, id);
+    if (id == COMPOSITE_BURN) return createGenericOp<Traits, &cfColorBurn<T> >(cs, id);
+    if (id == COMPOSITE_LINEAR_BURN) return createGenericOp<Traits, &cfLinearBurn<T> >(cs, id);
+    if (id == COMPOSITE_DARKEN) return createGenericOp<Traits, &cfDarkenOnly<T> >(cs, id);
+    if (id == COMPOSITE_ADD) return createGenericOp<Traits, &cfAddition<T> >(cs, id);
+    if (id == COMPOSITE_SUBTRACT) return createGenericOp<Traits, &cfSubtract<T> >(cs, id);
+    if (id == COMPOSITE_INVERSE_SUBTRACT) return createGenericOp<Traits, &cfInverseSubtract<T> >(cs, id);
+    if (id == COMPOSITE_MULT) return createGenericOp<Traits, &cfMultiply<T> >(cs, id);
+    if (id == COMPOSITE_DIVIDE) return createGenericOp<Traits, &cfDivide<T> >(cs, id);
+    if (id == COMPOSITE_DIFF) return createGenericOp<Traits, &cfDifference<T> >(cs, id);
+    if (id == COMPOSITE_EXCLUSION) return createGenericOp<Traits, &cfExclusion<T> >(cs, id);
+    if (id == COMPOSITE_EQUIVALENCE) return createGenericOp<Traits, &cfEquivalence<T> >(cs, id);
+    if (id == COMPOSITE_ADDITIVE_SUBTRACTIVE) return createGenericOp<Traits, &cfAdditiveSubtractive<T> >(cs, id);
+
+    if (id == COMPOSITE_COLOR) return createGenericHSLOp<Traits, &cfColor<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_HUE) return createGenericHSLOp<Traits, &cfHue<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_SATURATION) return createGenericHSLOp<Traits, &cfSaturation<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_INC_SATURATION) return createGenericHSLOp<Traits, &cfIncreaseSaturation<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_DEC_SATURATION) return createGenericHSLOp<Traits, &cfDecreaseSaturation<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_LUMINIZE) return createGenericHSLOp<Traits, &cfLightness<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_INC_LUMINOSITY) return createGenericHSLOp<Traits, &cfIncreaseLightness<HSYType, float> >(cs, id);
+    if (id == COMPOSITE_DEC_LUMINOSITY) return createGenericHSLOp<Traits, &cfDecreaseLightness<HSYType, float> >(cs, id);
+
+    return 0;
+}
+
+template<class Traits>
+void addGenericOpsRows(const KoColorSpace *cs)
+{
+    QTest::addColumn<QString>("id");
+    QTest::addColumn<bool>("haveMask");
+    QTest::addColumn<int>("dstAlphaRange");
+    QTest::addColumn<QBitArray>("channelFlags");
+
+    // the channels are stored in BGRA order
+    QBitArray alphaLocked(4, true);
+    alphaLocked.clearBit(3);
+
+    QBitArray noGreen(4, true);
+    noGreen.clearBit(1);
+
+    QBitArray noGreenAlphaLocked(noGreen);
+    noGreenAlphaLocked.clearBit(3);
+
+    Q_FOREACH (const KoCompositeOp *op, cs->compositeOps()) {
+        QScopedPointer<KoCompositeOp> legacyOp(createLegacyGenericOp<Traits>(cs, op->id()));
+        if (!legacyOp) continue;
+
+        const QString id = op->id();
+
+        QTest::newRow(QString("%1 mask opaque").arg(id).toLatin1()) << id << true << int(ALPHA_UNIT) << QBitArray();
+        QTest::newRow(QString("%1 no mask opaque").arg(id).toLatin1()) << id << false << int(ALPHA_UNIT) << QBitArray();
+        QTest::newRow(QString("%1 mask").arg(id).toLatin1()) << id << true << int(ALPHA_RANDOM) << QBitArray();
+        QTest::newRow(QString("%1 no mask").arg(id).toLatin1()) << id << false << int(ALPHA_RANDOM) << QBitArray();
+        QTest::newRow(QString("%1 alpha locked").arg(id).toLatin1()) << id << true << int(ALPHA_RANDOM) << alphaLocked;
+        QTest::newRow(QString("%1 no green").arg(id).toLatin1()) << id << true << int(ALPHA_RANDOM) << noGreen;
+        QTest::newRow(QString("%1 no green alpha locked").arg(id).toLatin1()) << id << true << int(ALPHA_RANDOM) << noGreenAlphaLocked;
+    }
+}
+
+void KisCompositionBenchmark::compareGenericOps_data()
+{
+    addGenericOpsRows<KoBgrU8Traits>(KoColorSpaceRegistry::instance()->rgb8());
+}
+
+void KisCompositionBenchmark::compareGenericOps()
+{
+    QFETCH(QString, id);
+    QFETCH(bool, haveMask);
+    QFETCH(int, dstAlphaRange);
+    QFETCH(QBitArray, channelFlags);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createGenericOp32(cs, id, id, KoCompositeOp::categoryMix()));
+    QScopedPointer<KoCompositeOp> opExp(createLegacyGenericOp<KoBgrU8Traits>(cs, id));
+
+    if (!opAct) {
+        QSKIP("The vectorized version of the op is not available");
+    }
+
+    QVector<Tile> tiles = compositeTwoOps(haveMask, opAct.data(), opExp.data(),
+                                          AlphaRange(dstAlphaRange), channelFlags);
+
+    const bool compareResult = compareGenericOpsPixels<quint8>(tiles, 1);
+    freeTiles(tiles, 16, 16);
+
+    QVERIFY(compareResult);
+}
+
+void KisCompositionBenchmark::compareRgbU16GenericOps_data()
+{
+    addGenericOpsRows<KoBgrU16Traits>(KoColorSpaceRegistry::instance()->rgb16());
+}
+
+void KisCompositionBenchmark::compareRgbU16GenericOps()
+{
+    QFETCH(QString, id);
+    QFETCH(bool, haveMask);
+    QFETCH(int, dstAlphaRange);
+    QFETCH(QBitArray, channelFlags);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    QScopedPointer<KoCompositeOp> opAct(KoOptimizedCompositeOpFactory::createGenericOpU16(cs, id, id, KoCompositeOp::categoryMix()));
+    QScopedPointer<KoCompositeOp> opExp(createLegacyGenericOp<KoBgrU16Traits>(cs, id));
+
+    if (!opAct) {
+        QSKIP("The vectorized version of the op is not available");
+    }
+
+    QVector<Tile> tiles = compositeTwoOps(haveMask, opAct.data(), opExp.data(),
+                                          AlphaRange(dstAlphaRange), channelFlags);
+
+    // 8 units of a 16-bit channel is 1/32 of a unit of an 8-bit one
+    const bool compareResult = compareGenericOpsPixels<quint16>(tiles, 8);
+    freeTiles(tiles, 16, 16);
+
+    QVERIFY(compareResult);
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenLegacy()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
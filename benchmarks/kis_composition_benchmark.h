@@ -45,6 +45,16 @@ private Q_SLOTS:
     void compareOverOps();
     void compareOverOpsNoMask();
     void compareRgbF32OverOps();
+    void compareRgbU16AlphaDarkenOps();
+    void compareRgbU16OverOps();
+    void compareRgbU16CopyOps();
+    void compareRgbF16AlphaDarkenOps();
+    void compareRgbF16OverOps();
+    void compareRgbF16CopyOps();
+    void compareGenericOps_data();
+    void compareGenericOps();
+    void compareRgbU16GenericOps_data();
+    void compareRgbU16GenericOps();
 
     void testRgb8CompositeAlphaDarkenLegacy();
     void testRgb8CompositeAlphaDarkenOptimized();
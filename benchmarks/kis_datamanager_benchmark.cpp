@@ -21,11 +21,92 @@
 
 #include <QTest>
 #include <kis_datamanager.h>
+#include "tiles3/kis_tile_data_slab_allocator.h"
 
 // RGBA
 #define PIXEL_SIZE 4
 //#define CYCLES 100
 
+#define TILE_SIZE 64
+#define NUM_TILES_PER_ROW 32
+
+namespace {
+
+enum AllocatorMode {
+    HeapAllocator,
+    SlabAllocator,
+    HugePagesSlabAllocator
+};
+
+/**
+ * Allocates the tile buffers the same way KisTileData does
+ * in the corresponding allocator mode
+ */
+class TileBuffers
+{
+public:
+    TileBuffers(AllocatorMode mode, int pixelSize, int numTiles)
+        : m_pixelSize(pixelSize),
+          m_allocator(mode != HeapAllocator ?
+                      new KisTileDataSlabAllocator(TILE_SIZE * TILE_SIZE,
+                                                   mode == HugePagesSlabAllocator) : 0)
+    {
+        m_buffers.reserve(numTiles);
+        for (int i = 0; i < numTiles; i++) {
+            m_buffers.append(allocate());
+        }
+    }
+
+    ~TileBuffers() {
+        Q_FOREACH (quint8 *ptr, m_buffers) {
+            deallocate(ptr);
+        }
+    }
+
+    quint8* allocate() {
+        return m_allocator ?
+            m_allocator->allocate(m_pixelSize) :
+            (quint8*) malloc(m_pixelSize * TILE_SIZE * TILE_SIZE);
+    }
+
+    void deallocate(quint8 *ptr) {
+        if (m_allocator) {
+            m_allocator->deallocate(ptr, m_pixelSize);
+        } else {
+            free(ptr);
+        }
+    }
+
+    QVector<quint8*>& buffers() {
+        return m_buffers;
+    }
+
+private:
+    int m_pixelSize;
+    QScopedPointer<KisTileDataSlabAllocator> m_allocator;
+    QVector<quint8*> m_buffers;
+};
+
+void addAllocatorModes()
+{
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("pixelSize");
+
+    QList<int> pixelSizes;
+    pixelSizes << 4 << 16;
+
+    Q_FOREACH (int pixelSize, pixelSizes) {
+        QTest::newRow(QString("heap, %1 bpp").arg(pixelSize).toLatin1())
+            << int(HeapAllocator) << pixelSize;
+        QTest::newRow(QString("slab, %1 bpp").arg(pixelSize).toLatin1())
+            << int(SlabAllocator) << pixelSize;
+        QTest::newRow(QString("slab + huge pages, %1 bpp").arg(pixelSize).toLatin1())
+            << int(HugePagesSlabAllocator) << pixelSize;
+    }
+}
+
+}
+
 void KisDatamanagerBenchmark::initTestCase()
 {
     // To make sure all the first-time startup costs are done
@@ -198,5 +279,93 @@ void KisDatamanagerBenchmark::benchmarkMemCpy()
     delete[] dst;
 }
 
+void KisDatamanagerBenchmark::benchmarkTileAllocation_data()
+{
+    addAllocatorModes();
+}
+
+void KisDatamanagerBenchmark::benchmarkTileAllocation()
+{
+    QFETCH(int, mode);
+    QFETCH(int, pixelSize);
+
+    const int numTiles = NUM_TILES_PER_ROW * NUM_TILES_PER_ROW;
+
+    // preallocate the slabs, the same way the long-living
+    // allocator of the tile data would have done
+    TileBuffers tiles(AllocatorMode(mode), pixelSize, numTiles);
+    Q_FOREACH (quint8 *ptr, tiles.buffers()) {
+        tiles.deallocate(ptr);
+    }
+    tiles.buffers().clear();
+
+    QBENCHMARK {
+        for (int i = 0; i < numTiles; i++) {
+            quint8 *ptr = tiles.allocate();
+            memset(ptr, 0, pixelSize);
+            tiles.buffers().append(ptr);
+        }
+
+        Q_FOREACH (quint8 *ptr, tiles.buffers()) {
+            tiles.deallocate(ptr);
+        }
+        tiles.buffers().clear();
+    }
+}
+
+void KisDatamanagerBenchmark::benchmarkTileAccess_data()
+{
+    addAllocatorModes();
+}
+
+void KisDatamanagerBenchmark::benchmarkTileAccess()
+{
+    QFETCH(int, mode);
+    QFETCH(int, pixelSize);
+
+    const int numTiles = NUM_TILES_PER_ROW * NUM_TILES_PER_ROW;
+    const int tileBytes = pixelSize * TILE_SIZE * TILE_SIZE;
+    const int rowStride = pixelSize * TILE_SIZE;
+
+    TileBuffers tiles(AllocatorMode(mode), pixelSize, numTiles);
+    Q_FOREACH (quint8 *ptr, tiles.buffers()) {
+        memset(ptr, 128, tileBytes);
+    }
+
+    const QVector<quint8*> &buffers = tiles.buffers();
+    const quint64 numPixels = quint64(numTiles) * TILE_SIZE * TILE_SIZE;
+
+    /**
+     * 64 bits don't wrap even after many runs of the benchmark,
+     * so the sum can be checked exactly
+     */
+    quint64 sum = 0;
+    quint64 numPixelsRead = 0;
+
+    /**
+     * Walk the image column by column the way KisVLineIterator2
+     * does: every pixel access jumps to the next row of the tile
+     * and every 64 pixels to another tile, which is the worst case
+     * for the TLB
+     */
+    QBENCHMARK {
+        for (int x = 0; x < NUM_TILES_PER_ROW * TILE_SIZE; x++) {
+            const int tileCol = x / TILE_SIZE;
+            const int offset = (x % TILE_SIZE) * pixelSize;
+
+            for (int tileRow = 0; tileRow < NUM_TILES_PER_ROW; tileRow++) {
+                const quint8 *ptr = buffers[tileRow * NUM_TILES_PER_ROW + tileCol] + offset;
+
+                for (int y = 0; y < TILE_SIZE; y++, ptr += rowStride) {
+                    sum += *ptr;
+                }
+            }
+        }
+
+        numPixelsRead += numPixels;
+    }
+
+    QCOMPARE(sum, 128 * numPixelsRead);
+}
 
 QTEST_MAIN(KisDatamanagerBenchmark)
@@ -36,6 +36,11 @@ private Q_SLOTS:
     void benchmarkExtent();
     void benchmarkClear();
     void benchmarkMemCpy();
+
+    void benchmarkTileAllocation_data();
+    void benchmarkTileAllocation();
+    void benchmarkTileAccess_data();
+    void benchmarkTileAccess();
 };
 
 #endif
@@ -59,7 +59,8 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
                                               int hardLimitMiB,
                                               int softLimitMiB,
                                               int poolLimitMiB,
-                                              int index)
+                                              int index,
+                                              bool mappedSwapFile)
 {
     KisPaintOpPresetSP preset = new KisPaintOpPreset(QString(FILES_DATA_DIR) + QDir::separator() + presetFileName);
     LOAD_PRESET_OR_RETURN(preset, presetFileName);
@@ -93,11 +94,13 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
     qreal oldHardLimit = config.memoryHardLimitPercent();
     qreal oldSoftLimit = config.memorySoftLimitPercent();
     qreal oldPoolLimit = config.memoryPoolLimitPercent();
+    bool oldMappedSwapFile = config.useMappedSwapFile();
     const qreal _MiB = 100.0 / KisImageConfig::totalRAM();
 
     config.setMemoryHardLimitPercent(hardLimitMiB * _MiB);
     config.setMemorySoftLimitPercent(softLimitMiB * _MiB);
     config.setMemoryPoolLimitPercent(poolLimitMiB * _MiB);
+    config.setUseMappedSwapFile(mappedSwapFile);
 
     KisTileDataStore::instance()->testingRereadConfig();
 
@@ -112,6 +115,10 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
         .arg(poolLimitMiB)
         .arg(index);
 
+    if (mappedSwapFile) {
+        fileName.replace(".txt", "_mmap.txt");
+    }
+
     QFile logFile(fileName);
     logFile.open(QFile::WriteOnly | QFile::Truncate);
     QTextStream logStream(&logFile);
@@ -176,6 +183,7 @@ void KisLowMemoryBenchmark::benchmarkWideArea(const QString presetFileName,
     config.setMemoryHardLimitPercent(oldHardLimit * _MiB);
     config.setMemorySoftLimitPercent(oldSoftLimit * _MiB);
     config.setMemoryPoolLimitPercent(oldPoolLimit * _MiB);
+    config.setUseMappedSwapFile(oldMappedSwapFile);
 
     delete painter;
 }
@@ -228,4 +236,20 @@ void KisLowMemoryBenchmark::memory2000History100Pool500HugeBrush()
                       2000, 600, 500, 0);
 }
 
+/**
+ * The same as memory2000History100Pool500HugeBrush(), but the swap
+ * file is mapped into memory as a whole (see KisMappedSwapSpace).
+ * Compare the "C" lines of the two logs to see the difference.
+ */
+void KisLowMemoryBenchmark::memory2000History100Pool500HugeBrushMappedSwap()
+{
+    QString presetFileName = "BIG_TESTING.kpp";
+    QRectF rect(150,150,7850,7850);
+    qreal step = 250;
+    int numCycles = 10;
+
+    benchmarkWideArea(presetFileName, rect, step, numCycles, true,
+                      2000, 600, 500, 0, true);
+}
+
 QTEST_MAIN(KisLowMemoryBenchmark)
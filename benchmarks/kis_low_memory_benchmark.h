@@ -30,6 +30,7 @@ private Q_SLOTS:
     void unlimitedMemoryHistoryPool50();
 
     void memory2000History100Pool500HugeBrush();
+    void memory2000History100Pool500HugeBrushMappedSwap();
 
 private:
     void benchmarkWideArea(const QString presetFileName,
@@ -39,7 +40,8 @@ private:
                            int hardLimitMiB,
                            int softLimitMiB,
                            int poolLimitMiB,
-                           int index);
+                           int index,
+                           bool mappedSwapFile = false);
 };
 
 #endif /* __KIS_LOW_MEMORY_BENCHMARK_H */
@@ -22,7 +22,10 @@
 
 #include <KoColor.h>
 
+#include <KoColorSpaceRegistry.h>
+
 #include <kis_group_layer.h>
+#include <kis_paint_layer.h>
 #include <kis_paint_device.h>
 #include <KisDocument.h>
 #include <kis_image.h>
@@ -58,5 +61,123 @@ void KisProjectionBenchmark::benchmarkLoading()
     }
 }
 
+void KisProjectionBenchmark::benchmarkProjectionScaling_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    for (int numThreads = 1; numThreads <= 64; numThreads *= 2) {
+        QTest::newRow(QString("%1 threads").arg(numThreads).toLatin1().data()) << numThreads;
+    }
+}
+
+void KisProjectionBenchmark::benchmarkProjectionScaling()
+{
+    QFETCH(int, numThreads);
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->loadNativeFormat(QString(FILES_DATA_DIR) + QDir::separator() + "load_test.kra");
+
+    KisImageSP image = doc->image();
+    image->setWorkingThreadsLimit(numThreads);
+    image->waitForDone();
+
+    QBENCHMARK {
+        image->refreshGraphAsync();
+        image->waitForDone();
+    }
+
+    delete doc;
+}
+
+void KisProjectionBenchmark::benchmarkSmallUpdatesScaling_data()
+{
+    benchmarkProjectionScaling_data();
+}
+
+void KisProjectionBenchmark::benchmarkSmallUpdatesScaling()
+{
+    QFETCH(int, numThreads);
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->loadNativeFormat(QString(FILES_DATA_DIR) + QDir::separator() + "load_test.kra");
+
+    KisImageSP image = doc->image();
+    image->setWorkingThreadsLimit(numThreads);
+    image->waitForDone();
+
+    /**
+     * A lot of small updates, like the ones generated by a brush
+     * stroke, stress the scheduling overhead more than the merging
+     */
+    KisNodeSP node = image->root()->lastChild();
+    QVERIFY(node);
+
+    const QRect bounds = image->bounds();
+    const int patchSize = 64;
+
+    QBENCHMARK {
+        for (int y = bounds.top(); y < bounds.bottom(); y += patchSize) {
+            for (int x = bounds.left(); x < bounds.right(); x += patchSize) {
+                node->setDirty(QRect(x, y, patchSize, patchSize));
+            }
+        }
+        image->waitForDone();
+    }
+
+    delete doc;
+}
+
+void KisProjectionBenchmark::benchmarkLargeGroupUpdates_data()
+{
+    QTest::addColumn<bool>("paintOnTopLayer");
+
+    QTest::newRow("top layer") << true;
+    QTest::newRow("bottom layer") << false;
+}
+
+void KisProjectionBenchmark::benchmarkLargeGroupUpdates()
+{
+    QFETCH(bool, paintOnTopLayer);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 2000, 2000, cs, "benchmark");
+
+    KisGroupLayerSP group = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+    image->addNode(group, image->root());
+
+    /**
+     * When painting on the top layer of a large group, the composition
+     * of the layers below it is taken from the projection cache of the
+     * group. The bottom layer is the worst case, the whole group is
+     * recomposed on every update.
+     */
+    const int numLayers = 200;
+    QVector<KisLayerSP> layers;
+
+    for (int i = 0; i < numLayers; i++) {
+        KisPaintDeviceSP device = new KisPaintDevice(cs);
+        device->fill(QRect(i * 5, i * 5, 1000, 1000),
+                     KoColor(QColor::fromHsv(i % 360, 255, 255), cs));
+
+        KisLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), 128, device);
+        image->addNode(layer, group);
+        layers << layer;
+    }
+
+    image->refreshGraphAsync();
+    image->waitForDone();
+
+    KisNodeSP node = paintOnTopLayer ? layers.last() : layers.first();
+
+    const int patchSize = 64;
+    const QRect strokeRect(500, 500, 1000, patchSize);
+
+    QBENCHMARK {
+        for (int x = strokeRect.left(); x < strokeRect.right(); x += patchSize) {
+            node->setDirty(QRect(x, strokeRect.top(), patchSize, patchSize));
+        }
+        image->waitForDone();
+    }
+}
 
 QTEST_MAIN(KisProjectionBenchmark)
@@ -32,6 +32,15 @@ private Q_SLOTS:
 
     void benchmarkProjection();
     void benchmarkLoading();
+
+    void benchmarkProjectionScaling_data();
+    void benchmarkProjectionScaling();
+
+    void benchmarkSmallUpdatesScaling_data();
+    void benchmarkSmallUpdatesScaling();
+
+    void benchmarkLargeGroupUpdates_data();
+    void benchmarkLargeGroupUpdates();
 };
 
 #endif
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_compression_benchmark.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+#include "tiles3/swap/kis_tile_compressor_2.h"
+#include "tiles3/swap/kis_compression_factory.h"
+
+#include "qimage_test_util.h"
+
+namespace {
+
+struct CompressedTile {
+    KisTileSP tile;
+    QByteArray data;
+};
+
+QVector<KisTileSP> collectTiles(KisPaintDeviceSP dev)
+{
+    QVector<KisTileSP> tiles;
+
+    KisDataManagerSP dm = dev->dataManager();
+    const QRect rc = dm->extent();
+
+    const qint32 firstCol = rc.left() / KisTileData::WIDTH;
+    const qint32 firstRow = rc.top() / KisTileData::HEIGHT;
+    const qint32 lastCol = rc.right() / KisTileData::WIDTH;
+    const qint32 lastRow = rc.bottom() / KisTileData::HEIGHT;
+
+    for (qint32 row = firstRow; row <= lastRow; row++) {
+        for (qint32 col = firstCol; col <= lastCol; col++) {
+            tiles.append(dm->getTile(col, row, false));
+        }
+    }
+
+    return tiles;
+}
+
+void printStatistics(const QString &codec, const KoColorSpace *cs,
+                     qint64 rawBytes, qint64 compressedBytes, qint64 nsecs)
+{
+    const qreal ratio = qreal(compressedBytes) / rawBytes;
+    const qreal mibPerSecond = nsecs > 0 ? qreal(rawBytes) / (1 << 20) / (qreal(nsecs) / 1e9) : 0.0;
+
+    qDebug() << qPrintable(codec) << qPrintable(cs->id())
+             << "ratio:" << ratio
+             << "speed:" << mibPerSecond << "MiB/s";
+}
+
+}
+
+void KisTileCompressionBenchmark::initTestCase()
+{
+    QImage image(TestUtil::fetchDataFileLazy("hakonepa.png"));
+    QVERIFY(!image.isNull());
+
+    KisPaintDeviceSP dev8 = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev8->convertFromQImage(image, 0, 0, 0);
+    m_devices << dev8;
+
+    KisPaintDeviceSP dev16 = new KisPaintDevice(*dev8);
+    dev16->convertTo(KoColorSpaceRegistry::instance()->rgb16());
+    m_devices << dev16;
+}
+
+void KisTileCompressionBenchmark::addCodecRows()
+{
+    QTest::addColumn<QString>("codec");
+    QTest::addColumn<int>("deviceIndex");
+
+    Q_FOREACH (const QString &codec, KisCompressionFactory::availableCodecs()) {
+        for (int i = 0; i < m_devices.size(); i++) {
+            const QString name = QString("%1-%2").arg(codec).arg(m_devices[i]->colorSpace()->id());
+            QTest::newRow(name.toLatin1()) << codec << i;
+        }
+    }
+}
+
+void KisTileCompressionBenchmark::benchmarkCompression_data()
+{
+    addCodecRows();
+}
+
+void KisTileCompressionBenchmark::benchmarkCompression()
+{
+    QFETCH(QString, codec);
+    QFETCH(int, deviceIndex);
+
+    KisPaintDeviceSP dev = m_devices[deviceIndex];
+    QVector<KisTileSP> tiles = collectTiles(dev);
+    QVERIFY(!tiles.isEmpty());
+
+    KisTileCompressor2 compressor(KisCompressionFactory::idFromName(codec));
+
+    const qint32 bufferSize = compressor.tileDataBufferSize(tiles.first()->tileData());
+    QByteArray buffer(bufferSize, 0);
+
+    qint64 rawBytes = 0;
+    qint64 compressedBytes = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Q_FOREACH (KisTileSP tile, tiles) {
+        qint32 bytesWritten = 0;
+        tile->lockForRead();
+        compressor.compressTileData(tile->tileData(), (quint8*)buffer.data(), bufferSize, bytesWritten);
+        tile->unlock();
+
+        rawBytes += bufferSize - 1;
+        compressedBytes += bytesWritten;
+    }
+
+    printStatistics(codec, dev->colorSpace(), rawBytes, compressedBytes, timer.nsecsElapsed());
+
+    QBENCHMARK {
+        Q_FOREACH (KisTileSP tile, tiles) {
+            qint32 bytesWritten = 0;
+            tile->lockForRead();
+            compressor.compressTileData(tile->tileData(), (quint8*)buffer.data(), bufferSize, bytesWritten);
+            tile->unlock();
+        }
+    }
+}
+
+void KisTileCompressionBenchmark::benchmarkDecompression_data()
+{
+    addCodecRows();
+}
+
+void KisTileCompressionBenchmark::benchmarkDecompression()
+{
+    QFETCH(QString, codec);
+    QFETCH(int, deviceIndex);
+
+    KisPaintDeviceSP dev = m_devices[deviceIndex];
+    QVector<KisTileSP> tiles = collectTiles(dev);
+    QVERIFY(!tiles.isEmpty());
+
+    KisTileCompressor2 compressor(KisCompressionFactory::idFromName(codec));
+
+    const qint32 bufferSize = compressor.tileDataBufferSize(tiles.first()->tileData());
+
+    QVector<CompressedTile> compressedTiles;
+    qint64 rawBytes = 0;
+    qint64 compressedBytes = 0;
+
+    Q_FOREACH (KisTileSP tile, tiles) {
+        CompressedTile compressed;
+        compressed.tile = tile;
+        compressed.data.resize(bufferSize);
+
+        qint32 bytesWritten = 0;
+        tile->lockForRead();
+        compressor.compressTileData(tile->tileData(), (quint8*)compressed.data.data(), bufferSize, bytesWritten);
+        tile->unlock();
+        compressed.data.resize(bytesWritten);
+
+        rawBytes += bufferSize - 1;
+        compressedBytes += bytesWritten;
+
+        compressedTiles.append(compressed);
+    }
+
+    /**
+     * Decompress into a standalone device, so that the source
+     * tiles are kept intact for the following rows
+     */
+    KisDataManagerSP dstDm = new KisDataManager(dev->pixelSize(), dev->dataManager()->defaultPixel());
+    KisTileSP dstTile = dstDm->getTile(0, 0, true);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    dstTile->lockForWrite();
+    Q_FOREACH (const CompressedTile &compressed, compressedTiles) {
+        QVERIFY(compressor.decompressTileData((quint8*)compressed.data.data(),
+                                              compressed.data.size(),
+                                              dstTile->tileData()));
+    }
+    dstTile->unlock();
+
+    printStatistics(codec, dev->colorSpace(), rawBytes, compressedBytes, timer.nsecsElapsed());
+
+    QBENCHMARK {
+        dstTile->lockForWrite();
+        Q_FOREACH (const CompressedTile &compressed, compressedTiles) {
+            compressor.decompressTileData((quint8*)compressed.data.data(),
+                                          compressed.data.size(),
+                                          dstTile->tileData());
+        }
+        dstTile->unlock();
+    }
+}
+
+QTEST_MAIN(KisTileCompressionBenchmark)
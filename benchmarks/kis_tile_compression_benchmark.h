@@ -0,0 +1,50 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_COMPRESSION_BENCHMARK_H
+#define __KIS_TILE_COMPRESSION_BENCHMARK_H
+
+#include <QtTest>
+#include <kis_types.h>
+
+/**
+ * Compares the tile compression codecs available for the swap
+ * (see KisCompressionFactory) on the tiles of a real image. For
+ * every codec it reports the compression ratio and the throughput
+ * of compression and decompression in MiB/s.
+ */
+class KisTileCompressionBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchmarkCompression_data();
+    void benchmarkCompression();
+
+    void benchmarkDecompression_data();
+    void benchmarkDecompression();
+
+private:
+    void addCodecRows();
+
+private:
+    QList<KisPaintDeviceSP> m_devices;
+};
+
+#endif /* __KIS_TILE_COMPRESSION_BENCHMARK_H */
@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_hash_table_benchmark.h"
+
+#include <QTest>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/kis_tile.h"
+
+/**
+ * The size of a patch processed by a single thread in tiles
+ */
+#define PATCH_SIZE 16
+#define NUM_ACCESS_CYCLES 50
+#define NUM_ALLOCATION_CYCLES 10
+
+namespace {
+
+QRect patchRect(int index)
+{
+    const int patchSizePx = PATCH_SIZE * KisTileData::WIDTH;
+    return QRect(index * patchSizePx, 0, patchSizePx, patchSizePx);
+}
+
+class TileAccessJob : public QRunnable
+{
+public:
+    TileAccessJob(KisTiledDataManager *dm, int index)
+        : m_dm(dm),
+          m_firstColumn(index * PATCH_SIZE)
+    {
+    }
+
+    void run() override {
+        for (int i = 0; i < NUM_ACCESS_CYCLES; i++) {
+            for (int row = 0; row < PATCH_SIZE; row++) {
+                for (int col = m_firstColumn; col < m_firstColumn + PATCH_SIZE; col++) {
+                    KisTileSP tile = m_dm->getTile(col, row, false);
+                    tile->lockForRead();
+                    tile->unlock();
+                }
+            }
+        }
+    }
+
+private:
+    KisTiledDataManager *m_dm;
+    int m_firstColumn;
+};
+
+class TileAllocationJob : public QRunnable
+{
+public:
+    TileAllocationJob(KisTiledDataManager *dm, int index)
+        : m_dm(dm),
+          m_rect(patchRect(index))
+    {
+    }
+
+    void run() override {
+        QVector<quint8> buffer(m_rect.width() * m_rect.height() * m_dm->pixelSize());
+
+        for (int i = 0; i < NUM_ALLOCATION_CYCLES; i++) {
+            memset(buffer.data(), i + 1, buffer.size());
+
+            // every tile of the patch gets its own data...
+            m_dm->writeBytes(buffer.constData(),
+                             m_rect.x(), m_rect.y(),
+                             m_rect.width(), m_rect.height());
+
+            // ... and frees it on deletion
+            m_dm->clear(m_rect, m_dm->defaultPixel());
+        }
+    }
+
+private:
+    KisTiledDataManager *m_dm;
+    QRect m_rect;
+};
+
+template <class Job>
+void runJobs(KisTiledDataManager *dm, int numThreads)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    for (int i = 0; i < numThreads; i++) {
+        pool.start(new Job(dm, i));
+    }
+    pool.waitForDone();
+}
+
+}
+
+void KisTileHashTableBenchmark::addThreadCounts()
+{
+    QTest::addColumn<int>("numThreads");
+
+    const int maxThreads = QThread::idealThreadCount();
+
+    for (int i = 1; i < maxThreads; i *= 2) {
+        QTest::newRow(QString("%1 threads").arg(i).toLatin1()) << i;
+    }
+    QTest::newRow(QString("%1 threads").arg(maxThreads).toLatin1()) << maxThreads;
+}
+
+void KisTileHashTableBenchmark::benchmarkTileAccess_data()
+{
+    addThreadCounts();
+}
+
+void KisTileHashTableBenchmark::benchmarkTileAccess()
+{
+    QFETCH(int, numThreads);
+
+    quint8 defaultPixel[4] = {0, 0, 0, 0};
+    quint8 fillPixel[4] = {255, 128, 0, 255};
+    KisTiledDataManager dm(4, defaultPixel);
+
+    for (int i = 0; i < numThreads; i++) {
+        dm.clear(patchRect(i), fillPixel);
+    }
+
+    QBENCHMARK {
+        runJobs<TileAccessJob>(&dm, numThreads);
+    }
+}
+
+void KisTileHashTableBenchmark::benchmarkTileAllocation_data()
+{
+    addThreadCounts();
+}
+
+void KisTileHashTableBenchmark::benchmarkTileAllocation()
+{
+    QFETCH(int, numThreads);
+
+    quint8 defaultPixel[4] = {0, 0, 0, 0};
+    KisTiledDataManager dm(4, defaultPixel);
+
+    QBENCHMARK {
+        runJobs<TileAllocationJob>(&dm, numThreads);
+    }
+}
+
+QTEST_MAIN(KisTileHashTableBenchmark)
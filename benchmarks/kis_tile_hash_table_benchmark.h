@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_TILE_HASH_TABLE_BENCHMARK_H
+#define KIS_TILE_HASH_TABLE_BENCHMARK_H
+
+#include <QtTest>
+
+/**
+ * Measures how the tile access and the tile allocation scale when
+ * several threads work on separate patches of the same data manager.
+ * Every thread does the same amount of work, so with the perfect
+ * scaling the time doesn't depend on the number of threads.
+ */
+class KisTileHashTableBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    void addThreadCounts();
+
+private Q_SLOTS:
+    void benchmarkTileAccess_data();
+    void benchmarkTileAccess();
+
+    void benchmarkTileAllocation_data();
+    void benchmarkTileAllocation();
+};
+
+#endif /* KIS_TILE_HASH_TABLE_BENCHMARK_H */
@@ -0,0 +1,260 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_size_benchmark.h"
+#include "kis_benchmark_values.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoCompositeOpRegistry.h>
+
+#include "kis_datamanager.h"
+#include "tiles3/kis_hline_iterator.h"
+#include "tiles3/kis_vline_iterator.h"
+#include "tiles3/kis_random_accessor.h"
+
+#define PROJECTION_IMAGE_SIZE 2048
+#define PROJECTION_NUM_LAYERS 4
+
+namespace {
+
+const KoColorSpace* colorSpaceForDepth(const QString &depthId)
+{
+    return KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depthId, 0);
+}
+
+KisDataManagerSP createFilledDataManager(const KoColorSpace *cs, int tileSize,
+                                         const QRect &rect, const QColor &color)
+{
+    KoColor defaultPixel(Qt::transparent, cs);
+    KoColor fillPixel(color, cs);
+
+    KisDataManagerSP dm = new KisDataManager(cs->pixelSize(), defaultPixel.data(),
+                                             tileSize, tileSize);
+    dm->clear(rect, fillPixel.data());
+    return dm;
+}
+
+/**
+ * Composites \p src over \p dst in the chunks of contiguous
+ * memory, the same way as KisPainter::bitBlt() does
+ */
+void compositeDataManagers(KisDataManager *dst, KisDataManager *src,
+                           const QRect &rect, const KoCompositeOp *op)
+{
+    KisRandomAccessor2 dstIt(dst, rect.x(), rect.y(), 0, 0, true, 0);
+    KisRandomConstAccessorSP srcIt = new KisRandomAccessor2(src, rect.x(), rect.y(), 0, 0, false, 0);
+
+    KoCompositeOp::ParameterInfo params;
+    params.opacity = 0.8f;
+
+    qint32 y = rect.y();
+    qint32 rowsRemaining = rect.height();
+
+    while (rowsRemaining > 0) {
+        qint32 x = rect.x();
+        qint32 columnsRemaining = rect.width();
+
+        qint32 rows = qMin(dstIt.numContiguousRows(y), srcIt->numContiguousRows(y));
+        rows = qMin(rows, rowsRemaining);
+
+        while (columnsRemaining > 0) {
+            qint32 columns = qMin(dstIt.numContiguousColumns(x), srcIt->numContiguousColumns(x));
+            columns = qMin(columns, columnsRemaining);
+
+            dstIt.moveTo(x, y);
+            srcIt->moveTo(x, y);
+
+            params.dstRowStart = dstIt.rawData();
+            params.dstRowStride = dstIt.rowStride(x, y);
+            params.srcRowStart = srcIt->rawDataConst();
+            params.srcRowStride = srcIt->rowStride(x, y);
+            params.maskRowStart = 0;
+            params.maskRowStride = 0;
+            params.rows = rows;
+            params.cols = columns;
+
+            op->composite(params);
+
+            x += columns;
+            columnsRemaining -= columns;
+        }
+
+        y += rows;
+        rowsRemaining -= rows;
+    }
+}
+
+}
+
+void KisTileSizeBenchmark::addTileSizes()
+{
+    QTest::addColumn<int>("tileSize");
+    QTest::addColumn<QString>("depthId");
+
+    QList<int> tileSizes;
+    tileSizes << 64 << 128 << 256;
+
+    Q_FOREACH (int tileSize, tileSizes) {
+        QTest::newRow(QString("%1px U8").arg(tileSize).toLatin1())
+            << tileSize << Integer8BitsColorDepthID.id();
+        QTest::newRow(QString("%1px F32").arg(tileSize).toLatin1())
+            << tileSize << Float32BitsColorDepthID.id();
+    }
+}
+
+void KisTileSizeBenchmark::benchmarkHLineIterator_data()
+{
+    addTileSizes();
+}
+
+void KisTileSizeBenchmark::benchmarkHLineIterator()
+{
+    QFETCH(int, tileSize);
+    QFETCH(QString, depthId);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    const QRect rc(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    KisDataManagerSP dm = createFilledDataManager(cs, tileSize, rc, Qt::red);
+
+    const qint32 pixelSize = cs->pixelSize();
+    QVector<quint8> pixel(pixelSize);
+
+    QBENCHMARK {
+        KisHLineIterator2 it(dm.data(), rc.x(), rc.y(), rc.width(), 0, 0, true, 0);
+
+        for (int j = 0; j < rc.height(); j++) {
+            do {
+                memcpy(pixel.data(), it.rawDataConst(), pixelSize);
+                memcpy(it.rawData(), pixel.data(), pixelSize);
+            } while (it.nextPixel());
+            it.nextRow();
+        }
+    }
+}
+
+void KisTileSizeBenchmark::benchmarkVLineIterator_data()
+{
+    addTileSizes();
+}
+
+void KisTileSizeBenchmark::benchmarkVLineIterator()
+{
+    QFETCH(int, tileSize);
+    QFETCH(QString, depthId);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    const QRect rc(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    KisDataManagerSP dm = createFilledDataManager(cs, tileSize, rc, Qt::red);
+
+    const qint32 pixelSize = cs->pixelSize();
+    QVector<quint8> pixel(pixelSize);
+
+    QBENCHMARK {
+        KisVLineIterator2 it(dm.data(), rc.x(), rc.y(), rc.height(), 0, 0, true, 0);
+
+        for (int i = 0; i < rc.width(); i++) {
+            do {
+                memcpy(pixel.data(), it.rawDataConst(), pixelSize);
+                memcpy(it.rawData(), pixel.data(), pixelSize);
+            } while (it.nextPixel());
+            it.nextColumn();
+        }
+    }
+}
+
+void KisTileSizeBenchmark::benchmarkRandomAccessor_data()
+{
+    addTileSizes();
+}
+
+void KisTileSizeBenchmark::benchmarkRandomAccessor()
+{
+    QFETCH(int, tileSize);
+    QFETCH(QString, depthId);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    const QRect rc(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    KisDataManagerSP dm = createFilledDataManager(cs, tileSize, rc, Qt::red);
+
+    const qint32 pixelSize = cs->pixelSize();
+    QVector<quint8> pixel(pixelSize);
+
+    // a brush-like access pattern: short strokes of dabs
+    const int dabSize = 25;
+    const int dabSpacing = 7;
+
+    QBENCHMARK {
+        KisRandomAccessor2 it(dm.data(), 0, 0, 0, 0, true, 0);
+
+        for (int cy = dabSize; cy < rc.height() - dabSize; cy += 4 * dabSize) {
+            for (int cx = dabSize; cx < rc.width() - dabSize; cx += dabSpacing) {
+                for (int y = cy; y < cy + dabSize; y++) {
+                    for (int x = cx; x < cx + dabSize; x++) {
+                        it.moveTo(x, y);
+                        memcpy(pixel.data(), it.rawDataConst(), pixelSize);
+                        memcpy(it.rawData(), pixel.data(), pixelSize);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void KisTileSizeBenchmark::benchmarkProjection_data()
+{
+    addTileSizes();
+}
+
+void KisTileSizeBenchmark::benchmarkProjection()
+{
+    QFETCH(int, tileSize);
+    QFETCH(QString, depthId);
+
+    const KoColorSpace *cs = colorSpaceForDepth(depthId);
+    const KoCompositeOp *op = cs->compositeOp(COMPOSITE_OVER);
+    const QRect rc(0, 0, PROJECTION_IMAGE_SIZE, PROJECTION_IMAGE_SIZE);
+
+    QVector<KisDataManagerSP> layers;
+    for (int i = 0; i < PROJECTION_NUM_LAYERS; i++) {
+        QColor color(Qt::red);
+        color.setHsv(i * 360 / PROJECTION_NUM_LAYERS, 200, 200, 128);
+
+        layers << createFilledDataManager(cs, tileSize,
+                                          rc.adjusted(i * 100, i * 100, -i * 100, -i * 100),
+                                          color);
+    }
+
+    KoColor defaultPixel(Qt::transparent, cs);
+    KisDataManagerSP projection =
+        new KisDataManager(cs->pixelSize(), defaultPixel.data(), tileSize, tileSize);
+
+    QBENCHMARK {
+        projection->clear(rc, defaultPixel.data());
+
+        Q_FOREACH (KisDataManagerSP layer, layers) {
+            compositeDataManagers(projection.data(), layer.data(), rc, op);
+        }
+    }
+}
+
+QTEST_MAIN(KisTileSizeBenchmark)
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_TILE_SIZE_BENCHMARK_H
+#define KIS_TILE_SIZE_BENCHMARK_H
+
+#include <QtTest>
+
+/**
+ * Compares the throughput of the iterators and of the layer
+ * compositing for the data managers with different tile sizes
+ */
+class KisTileSizeBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    void addTileSizes();
+
+private Q_SLOTS:
+    void benchmarkHLineIterator_data();
+    void benchmarkHLineIterator();
+
+    void benchmarkVLineIterator_data();
+    void benchmarkVLineIterator();
+
+    void benchmarkRandomAccessor_data();
+    void benchmarkRandomAccessor();
+
+    void benchmarkProjection_data();
+    void benchmarkProjection();
+};
+
+#endif /* KIS_TILE_SIZE_BENCHMARK_H */
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_update_queue_benchmark.h"
+
+#include <QTest>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_debug.h"
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+#include "kis_simple_update_queue.h"
+#include "KisTileAlignedRegion.h"
+
+#define IMAGE_SIZE 4000
+#define DAB_SIZE 30
+#define DAB_SPACING 3
+
+namespace {
+
+/**
+ * A zigzag stroke crossing the image, like the one
+ * painted with a small brush with dense spacing
+ */
+QVector<QRect> generateDabs(int numDabs)
+{
+    QVector<QRect> dabs;
+    dabs.reserve(numDabs);
+
+    const int rowLength = (IMAGE_SIZE - DAB_SIZE) / DAB_SPACING;
+
+    for (int i = 0; i < numDabs; i++) {
+        const int row = i / rowLength;
+        const int col = row % 2 ? rowLength - i % rowLength : i % rowLength;
+
+        dabs << QRect(col * DAB_SPACING, row * 2 * DAB_SIZE, DAB_SIZE, DAB_SIZE);
+    }
+
+    return dabs;
+}
+
+}
+
+void KisUpdateQueueBenchmark::benchmarkDenseDabs_data()
+{
+    QTest::addColumn<int>("numDabs");
+    QTest::addColumn<bool>("useRegion");
+
+    QTest::newRow("1000-rects") << 1000 << false;
+    QTest::newRow("1000-region") << 1000 << true;
+    QTest::newRow("5000-rects") << 5000 << false;
+    QTest::newRow("5000-region") << 5000 << true;
+    QTest::newRow("20000-rects") << 20000 << false;
+    QTest::newRow("20000-region") << 20000 << true;
+}
+
+void KisUpdateQueueBenchmark::benchmarkDenseDabs()
+{
+    QFETCH(int, numDabs);
+    QFETCH(bool, useRegion);
+
+    const QRect imageRect(0, 0, IMAGE_SIZE, IMAGE_SIZE);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "benchmark");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    const QVector<QRect> dabs = generateDabs(numDabs);
+    int numWalkers = 0;
+
+    QBENCHMARK {
+        KisTestableSimpleUpdateQueue queue;
+
+        if (useRegion) {
+            KisTileAlignedRegion region;
+
+            Q_FOREACH (const QRect &rc, dabs) {
+                region.addRect(rc);
+            }
+
+            queue.addUpdateJob(paintLayer, region, imageRect, 0);
+        } else {
+            Q_FOREACH (const QRect &rc, dabs) {
+                queue.addUpdateJob(paintLayer, rc, imageRect, 0);
+            }
+        }
+
+        numWalkers = queue.getWalkersList().size();
+    }
+
+    qDebug() << ppVar(numDabs) << ppVar(useRegion) << ppVar(numWalkers);
+}
+
+QTEST_MAIN(KisUpdateQueueBenchmark)
@@ -1,3 +1,4 @@
 /* config-hash-table-implementation.h.  Generated by cmake from config-hash-table-implementation.h.cmake */
 
 #cmakedefine USE_LOCK_FREE_HASH_TABLE 1
+#cmakedefine USE_SHARDED_HASH_TABLE 1
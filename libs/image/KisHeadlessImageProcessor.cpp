@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisHeadlessImageProcessor.h"
+
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QThread>
+
+#include "kis_image.h"
+#include "kis_group_layer.h"
+#include "kis_processing_applicator.h"
+#include "kis_filter_strategy.h"
+#include "processing/KisFilterProcessingVisitor.h"
+#include "kis_assert.h"
+
+
+struct KisHeadlessImageProcessor::Private
+{
+    KisImageSP image;
+    QString errorString;
+};
+
+KisHeadlessImageProcessor::KisHeadlessImageProcessor(KisImageSP image, int numThreads)
+    : m_d(new Private)
+{
+    m_d->image = image;
+    setNumThreads(numThreads);
+
+    /**
+     * The loaders only build the node graph, so the projection
+     * should be regenerated before the processing starts
+     */
+    m_d->image->initialRefreshGraph();
+}
+
+KisHeadlessImageProcessor::~KisHeadlessImageProcessor()
+{
+    waitForDone();
+}
+
+KisImageSP KisHeadlessImageProcessor::image() const
+{
+    return m_d->image;
+}
+
+void KisHeadlessImageProcessor::setNumThreads(int numThreads)
+{
+    m_d->image->setWorkingThreadsLimit(numThreads > 0 ? numThreads : QThread::idealThreadCount());
+}
+
+int KisHeadlessImageProcessor::numThreads() const
+{
+    return m_d->image->workingThreadsLimit();
+}
+
+void KisHeadlessImageProcessor::applyVisitor(KisProcessingVisitorSP visitor, KisNodeSP node, bool recursive)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(visitor);
+
+    if (!node) {
+        node = m_d->image->root();
+    }
+
+    KisProcessingApplicator::ProcessingFlags flags = KisProcessingApplicator::NONE;
+    if (recursive) {
+        flags |= KisProcessingApplicator::RECURSIVE;
+    }
+
+    KisProcessingApplicator applicator(m_d->image, node, flags);
+    applicator.applyVisitor(visitor, KisStrokeJobData::CONCURRENT);
+    applicator.end();
+
+    waitForDone();
+}
+
+void KisHeadlessImageProcessor::applyFilter(KisFilterConfigurationSP config, KisNodeSP node)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(config);
+    applyVisitor(new KisFilterProcessingVisitor(config), node, true);
+}
+
+void KisHeadlessImageProcessor::convertColorSpace(const KoColorSpace *dstColorSpace,
+                                                  KoColorConversionTransformation::Intent renderingIntent,
+                                                  KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    m_d->image->convertImageColorSpace(dstColorSpace, renderingIntent, conversionFlags);
+    waitForDone();
+}
+
+void KisHeadlessImageProcessor::scale(const QSize &size, const QString &filterStrategyId)
+{
+    KisFilterStrategy *filterStrategy = KisFilterStrategyRegistry::instance()->value(filterStrategyId);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(filterStrategy);
+
+    m_d->image->scaleImage(size, m_d->image->xRes(), m_d->image->yRes(), filterStrategy);
+    waitForDone();
+}
+
+void KisHeadlessImageProcessor::flatten()
+{
+    m_d->image->flatten(0);
+    waitForDone();
+}
+
+QImage KisHeadlessImageProcessor::renderProjection(const KoColorProfile *profile)
+{
+    waitForDone();
+    return m_d->image->convertToQImage(m_d->image->bounds(), profile);
+}
+
+bool KisHeadlessImageProcessor::exportImage(const QString &fileName, const QByteArray &format, int quality)
+{
+    const QImage result = renderProjection();
+
+    QImageWriter writer(fileName, !format.isEmpty() ? format : QFileInfo(fileName).suffix().toLatin1());
+    writer.setQuality(quality);
+
+    if (!writer.write(result)) {
+        m_d->errorString = writer.errorString();
+        return false;
+    }
+
+    m_d->errorString.clear();
+    return true;
+}
+
+QString KisHeadlessImageProcessor::errorString() const
+{
+    return m_d->errorString;
+}
+
+void KisHeadlessImageProcessor::waitForDone()
+{
+    m_d->image->waitForDone();
+}
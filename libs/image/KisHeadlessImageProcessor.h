@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_HEADLESS_IMAGE_PROCESSOR_H
+#define __KIS_HEADLESS_IMAGE_PROCESSOR_H
+
+#include "kritaimage_export.h"
+
+#include <QImage>
+#include <QScopedPointer>
+
+#include "kis_types.h"
+#include "KoColorConversionTransformation.h"
+
+class KoColorSpace;
+class KoColorProfile;
+
+
+/**
+ * Processes an image without a document, a canvas or any other
+ * GUI class, e.g. for converting the files in a batch.
+ *
+ * All the actions are run as strokes through KisProcessingApplicator,
+ * exactly like in the GUI, but the processor waits for every action
+ * to complete, so the calls are synchronous. The image is expected to
+ * have no undo store (KisDumbUndoStore is used then), so the processing
+ * doesn't accumulate any history.
+ *
+ * The processor sizes the working threads of the image on its own,
+ * because the global performance settings of the user are meaningless
+ * for a batch process running alongside many others.
+ *
+ * \code
+ * KisHeadlessImageProcessor processor(image, 4);
+ * processor.applyFilter(config);
+ * processor.flatten();
+ * processor.exportImage("result.png");
+ * \endcode
+ */
+class KRITAIMAGE_EXPORT KisHeadlessImageProcessor
+{
+public:
+    /**
+     * Creates a processor for \p image. If \p numThreads is zero
+     * or negative, QThread::idealThreadCount() threads are used.
+     */
+    KisHeadlessImageProcessor(KisImageSP image, int numThreads = 0);
+    ~KisHeadlessImageProcessor();
+
+    KisImageSP image() const;
+
+    void setNumThreads(int numThreads);
+    int numThreads() const;
+
+    /**
+     * Applies \p visitor to \p node (to the root layer, if the node is
+     * null) and, if \p recursive is true, to all its descendants
+     */
+    void applyVisitor(KisProcessingVisitorSP visitor,
+                      KisNodeSP node = KisNodeSP(),
+                      bool recursive = true);
+
+    /**
+     * Applies the filter to all the paint layers under \p node
+     *
+     * \see KisFilterProcessingVisitor
+     */
+    void applyFilter(KisFilterConfigurationSP config, KisNodeSP node = KisNodeSP());
+
+    void convertColorSpace(const KoColorSpace *dstColorSpace,
+                           KoColorConversionTransformation::Intent renderingIntent = KoColorConversionTransformation::internalRenderingIntent(),
+                           KoColorConversionTransformation::ConversionFlags conversionFlags = KoColorConversionTransformation::internalConversionFlags());
+
+    void scale(const QSize &size, const QString &filterStrategyId = "Bicubic");
+
+    void flatten();
+
+    /**
+     * Waits for all the actions to complete and returns the
+     * rendered projection of the image
+     */
+    QImage renderProjection(const KoColorProfile *profile = 0);
+
+    /**
+     * Renders the projection and saves it with QImageWriter. The format
+     * is deduced from the suffix of \p fileName when \p format is empty.
+     *
+     * \return false if the file could not be written, the reason is
+     *         returned by errorString()
+     */
+    bool exportImage(const QString &fileName,
+                     const QByteArray &format = QByteArray(),
+                     int quality = -1);
+
+    QString errorString() const;
+
+    void waitForDone();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_HEADLESS_IMAGE_PROCESSOR_H */
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_STROKE_LATENCY_STATISTICS_H
+#define __KIS_STROKE_LATENCY_STATISTICS_H
+
+#include <QtGlobal>
+
+/**
+ * The latency of the jobs of the interactive strokes, that is the time
+ * between adding a job into the strokes queue and starting it.
+ *
+ * \see KisStrokesQueue::interactiveLatency()
+ */
+struct KisStrokeLatencyStatistics
+{
+    int numJobs = 0;
+    qint64 totalLatencyNs = 0;
+    qint64 maxLatencyNs = 0;
+
+    /**
+     * The number of times a background stroke
+     * yielded to an interactive one
+     */
+    int numPreemptions = 0;
+
+    qreal averageLatencyNs() const {
+        return numJobs ? qreal(totalLatencyNs) / numJobs : 0.0;
+    }
+};
+
+#endif /* __KIS_STROKE_LATENCY_STATISTICS_H */
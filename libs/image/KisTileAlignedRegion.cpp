@@ -0,0 +1,351 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTileAlignedRegion.h"
+
+#include <algorithm>
+
+#include <QPair>
+
+
+const int KisTileAlignedRegion::CellSize;
+const int KisTileAlignedRegion::LargeRectCells;
+const int KisTileAlignedRegion::MaxLargeRects;
+
+namespace {
+
+struct Cell {
+    int col;
+    int row;
+    QRect rect;
+};
+
+inline int cellIndex(int coordinate)
+{
+    return coordinate >= 0 ?
+        coordinate / KisTileAlignedRegion::CellSize :
+        -((-coordinate - 1) / KisTileAlignedRegion::CellSize) - 1;
+}
+
+inline quint64 packCell(int col, int row)
+{
+    return (quint64(quint32(row)) << 32) | quint64(quint32(col));
+}
+
+inline void unpackCell(quint64 key, int *col, int *row)
+{
+    *col = qint32(quint32(key & 0xffffffff));
+    *row = qint32(quint32(key >> 32));
+}
+
+inline QRect cellBounds(int col, int row)
+{
+    return QRect(col * KisTileAlignedRegion::CellSize,
+                 row * KisTileAlignedRegion::CellSize,
+                 KisTileAlignedRegion::CellSize,
+                 KisTileAlignedRegion::CellSize);
+}
+
+/**
+ * The coordinates inside a cell fit into a byte
+ */
+inline quint32 packRect(const QRect &rc)
+{
+    return quint32(rc.left()) |
+        quint32(rc.top()) << 8 |
+        quint32(rc.right()) << 16 |
+        quint32(rc.bottom()) << 24;
+}
+
+inline QRect unpackRect(quint32 value)
+{
+    return QRect(QPoint(value & 0xff, (value >> 8) & 0xff),
+                 QPoint((value >> 16) & 0xff, (value >> 24) & 0xff));
+}
+
+inline qint64 numRectCells(const QRect &rc)
+{
+    return qint64(cellIndex(rc.right()) - cellIndex(rc.left()) + 1) *
+        (cellIndex(rc.bottom()) - cellIndex(rc.top()) + 1);
+}
+
+inline void addCellRect(QHash<quint64, quint32> &cells, int col, int row, const QRect &cellRect)
+{
+    const quint64 key = packCell(col, row);
+    auto it = cells.find(key);
+
+    if (it == cells.end()) {
+        cells.insert(key, packRect(cellRect));
+    } else {
+        *it = packRect(unpackRect(*it) | cellRect);
+    }
+}
+
+void splitRect(QHash<quint64, quint32> &cells, const QRect &rc)
+{
+    const int firstCol = cellIndex(rc.left());
+    const int lastCol = cellIndex(rc.right());
+    const int firstRow = cellIndex(rc.top());
+    const int lastRow = cellIndex(rc.bottom());
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const QRect bounds = cellBounds(col, row);
+            addCellRect(cells, col, row, (rc & bounds).translated(-bounds.topLeft()));
+        }
+    }
+}
+
+}
+
+KisTileAlignedRegion::KisTileAlignedRegion()
+{
+}
+
+KisTileAlignedRegion::KisTileAlignedRegion(const QRect &rect)
+{
+    addRect(rect);
+}
+
+KisTileAlignedRegion::KisTileAlignedRegion(const QVector<QRect> &rects)
+{
+    addRects(rects);
+}
+
+void KisTileAlignedRegion::addRect(const QRect &rect)
+{
+    const QRect rc = rect.normalized();
+    if (rc.isEmpty()) return;
+
+    for (const QRect &largeRect : m_largeRects) {
+        if (largeRect.contains(rc)) return;
+    }
+
+    m_boundingRect |= rc;
+
+    if (numRectCells(rc) > LargeRectCells) {
+        addLargeRect(rc);
+    } else {
+        splitRect(m_cells, rc);
+    }
+}
+
+void KisTileAlignedRegion::addLargeRect(const QRect &rect)
+{
+    auto end = std::remove_if(m_largeRects.begin(), m_largeRects.end(),
+                              [&rect] (const QRect &rc) {
+                                  return rect.contains(rc);
+                              });
+    m_largeRects.erase(end, m_largeRects.end());
+    m_largeRects.append(rect);
+
+    if (m_largeRects.size() > MaxLargeRects) {
+        splitLargeRects();
+    }
+}
+
+void KisTileAlignedRegion::splitLargeRects()
+{
+    for (const QRect &rc : m_largeRects) {
+        splitRect(m_cells, rc);
+    }
+    m_largeRects.clear();
+}
+
+QHash<quint64, quint32> KisTileAlignedRegion::allCells() const
+{
+    QHash<quint64, quint32> cells = m_cells;
+
+    for (const QRect &rc : m_largeRects) {
+        splitRect(cells, rc);
+    }
+
+    return cells;
+}
+
+void KisTileAlignedRegion::addRects(const QVector<QRect> &rects)
+{
+    Q_FOREACH (const QRect &rc, rects) {
+        addRect(rc);
+    }
+}
+
+void KisTileAlignedRegion::addRegion(const KisTileAlignedRegion &region)
+{
+    if (region.isEmpty()) return;
+
+    if (isEmpty()) {
+        *this = region;
+        return;
+    }
+
+    m_boundingRect |= region.m_boundingRect;
+
+    for (auto it = region.m_cells.constBegin(); it != region.m_cells.constEnd(); ++it) {
+        int col = 0;
+        int row = 0;
+        unpackCell(it.key(), &col, &row);
+        addCellRect(m_cells, col, row, unpackRect(it.value()));
+    }
+
+    for (const QRect &rc : region.m_largeRects) {
+        addRect(rc);
+    }
+}
+
+bool KisTileAlignedRegion::isEmpty() const
+{
+    return m_cells.isEmpty() && m_largeRects.isEmpty();
+}
+
+QRect KisTileAlignedRegion::boundingRect() const
+{
+    return m_boundingRect;
+}
+
+bool KisTileAlignedRegion::intersects(const QRect &rect) const
+{
+    const QRect rc = rect.normalized();
+    if (!m_boundingRect.intersects(rc)) return false;
+
+    for (const QRect &largeRect : m_largeRects) {
+        if (largeRect.intersects(rc)) return true;
+    }
+
+    const int firstCol = cellIndex(rc.left());
+    const int lastCol = cellIndex(rc.right());
+    const int firstRow = cellIndex(rc.top());
+    const int lastRow = cellIndex(rc.bottom());
+
+    if (numRectCells(rc) > m_cells.size()) {
+        for (auto it = m_cells.constBegin(); it != m_cells.constEnd(); ++it) {
+            int col = 0;
+            int row = 0;
+            unpackCell(it.key(), &col, &row);
+
+            const QRect dirtyRect =
+                unpackRect(it.value()).translated(cellBounds(col, row).topLeft());
+
+            if (dirtyRect.intersects(rc)) return true;
+        }
+    } else {
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                auto it = m_cells.constFind(packCell(col, row));
+                if (it == m_cells.constEnd()) continue;
+
+                const QRect dirtyRect =
+                    unpackRect(it.value()).translated(cellBounds(col, row).topLeft());
+
+                if (dirtyRect.intersects(rc)) return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int KisTileAlignedRegion::numCells() const
+{
+    return m_largeRects.isEmpty() ? m_cells.size() : allCells().size();
+}
+
+QVector<QRect> KisTileAlignedRegion::rects() const
+{
+    // a whole-layer update needs no splitting at all
+    if (m_cells.isEmpty() && m_largeRects.size() == 1) {
+        return m_largeRects;
+    }
+
+    const QHash<quint64, quint32> cellRects = allCells();
+
+    QVector<Cell> cells;
+    cells.reserve(cellRects.size());
+
+    for (auto it = cellRects.constBegin(); it != cellRects.constEnd(); ++it) {
+        Cell cell;
+        unpackCell(it.key(), &cell.col, &cell.row);
+        cell.rect = unpackRect(it.value()).translated(cellBounds(cell.col, cell.row).topLeft());
+        cells.append(cell);
+    }
+
+    std::sort(cells.begin(), cells.end(),
+              [] (const Cell &lhs, const Cell &rhs) {
+                  return lhs.row < rhs.row || (lhs.row == rhs.row && lhs.col < rhs.col);
+              });
+
+    QVector<QRect> result;
+
+    /**
+     * The rects of the previous row of cells, which can still be
+     * extended downwards, mapped by their horizontal extent
+     */
+    QHash<QPair<int, int>, int> openRects;
+    QHash<QPair<int, int>, int> newOpenRects;
+
+    int i = 0;
+    while (i < cells.size()) {
+        const int row = cells[i].row;
+        newOpenRects.clear();
+
+        while (i < cells.size() && cells[i].row == row) {
+            QRect run = cells[i].rect;
+            int lastCol = cells[i].col;
+            i++;
+
+            // the dirty areas of the neighbouring cells touch each other
+            while (i < cells.size() &&
+                   cells[i].row == row &&
+                   cells[i].col == lastCol + 1 &&
+                   run.right() == cellBounds(lastCol, row).right() &&
+                   cells[i].rect.left() == cellBounds(cells[i].col, row).left()) {
+
+                run |= cells[i].rect;
+                lastCol = cells[i].col;
+                i++;
+            }
+
+            const QPair<int, int> extent(run.left(), run.right());
+            auto it = openRects.constFind(extent);
+
+            if (it != openRects.constEnd() && result[*it].bottom() + 1 == run.top()) {
+                result[*it] |= run;
+                newOpenRects.insert(extent, *it);
+            } else {
+                newOpenRects.insert(extent, result.size());
+                result.append(run);
+            }
+        }
+
+        openRects.swap(newOpenRects);
+    }
+
+    return result;
+}
+
+void KisTileAlignedRegion::clear()
+{
+    m_cells.clear();
+    m_largeRects.clear();
+    m_boundingRect = QRect();
+}
+
+bool KisTileAlignedRegion::operator==(const KisTileAlignedRegion &rhs) const
+{
+    return m_boundingRect == rhs.m_boundingRect && allCells() == rhs.allCells();
+}
@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_ALIGNED_REGION_H
+#define __KIS_TILE_ALIGNED_REGION_H
+
+#include "kritaimage_export.h"
+
+#include <QHash>
+#include <QRect>
+#include <QVector>
+
+/**
+ * A dirty region optimized for accumulating thousands of small
+ * overlapping rects, e.g. the dabs of a brush stroke.
+ *
+ * The plane is split into a grid of 64x64 cells (the default size of
+ * a tile). For every touched cell the region stores the bounding rect
+ * of the dirty area inside this cell. Adding a rect costs a hash lookup
+ * per cell it covers, which is constant for the rects of the size of a
+ * dab, so there is no quadratic merging of the rects like
+ * with QVector<QRect> or QRegion.
+ *
+ * The region is a conservative approximation: inside a single cell the
+ * dirty area is rounded up to its bounding rect.
+ *
+ * Large rects, e.g. the update of a whole layer, are not split into
+ * cells on adding. They are stored as they are and split into cells
+ * only when the cells are really needed, that is by rects(), numCells()
+ * and comparison. A single large rect is returned by rects() without
+ * splitting at all. The rects covered by a stored large rect are
+ * dropped right away.
+ *
+ * rects() converts the region back into a compact set of non-overlapping
+ * rects: the dirty areas of the neighbouring cells are merged into
+ * horizontal runs and the runs of equal width are merged vertically.
+ *
+ * The class is implicitly shared, so it can be passed by value.
+ */
+class KRITAIMAGE_EXPORT KisTileAlignedRegion
+{
+public:
+    static const int CellSize = 64;
+
+    /**
+     * The rects covering more cells than this are stored
+     * as they are, without splitting into cells
+     */
+    static const int LargeRectCells = 256;
+
+    /**
+     * When the number of stored large rects exceeds this value,
+     * they are split into cells to keep addRect() cheap
+     */
+    static const int MaxLargeRects = 8;
+
+public:
+    KisTileAlignedRegion();
+    explicit KisTileAlignedRegion(const QRect &rect);
+    explicit KisTileAlignedRegion(const QVector<QRect> &rects);
+
+    void addRect(const QRect &rect);
+    void addRects(const QVector<QRect> &rects);
+    void addRegion(const KisTileAlignedRegion &region);
+
+    KisTileAlignedRegion& operator+=(const QRect &rect) {
+        addRect(rect);
+        return *this;
+    }
+
+    KisTileAlignedRegion& operator+=(const KisTileAlignedRegion &region) {
+        addRegion(region);
+        return *this;
+    }
+
+    bool isEmpty() const;
+    QRect boundingRect() const;
+
+    /**
+     * Returns true if \p rect intersects the dirty area of
+     * any of the cells of the region
+     */
+    bool intersects(const QRect &rect) const;
+
+    /**
+     * The number of cells touched by the region
+     */
+    int numCells() const;
+
+    /**
+     * Returns a set of non-overlapping rects covering the region
+     */
+    QVector<QRect> rects() const;
+
+    void clear();
+
+    bool operator==(const KisTileAlignedRegion &rhs) const;
+    bool operator!=(const KisTileAlignedRegion &rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    void addLargeRect(const QRect &rect);
+    void splitLargeRects();
+    QHash<quint64, quint32> allCells() const;
+
+private:
+    /**
+     * Maps the packed coordinates of a cell into the packed
+     * bounding rect of the dirty area inside the cell (in the
+     * coordinates relative to the cell)
+     */
+    QHash<quint64, quint32> m_cells;
+
+    /**
+     * Large rects which are not split into cells yet
+     */
+    QVector<QRect> m_largeRects;
+
+    QRect m_boundingRect;
+};
+
+#endif /* __KIS_TILE_ALIGNED_REGION_H */
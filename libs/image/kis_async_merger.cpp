@@ -21,12 +21,18 @@
 
 #include <kis_debug.h>
 #include <QBitArray>
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <QtMath>
 
 #include <KoChannelInfo.h>
+#include <KoColor.h>
 #include <KoCompositeOpRegistry.h>
 
 #include "kis_node_visitor.h"
 #include "kis_painter.h"
+#include "kis_paint_device.h"
 #include "kis_layer.h"
 #include "kis_group_layer.h"
 #include "kis_adjustment_layer.h"
@@ -47,6 +53,83 @@
 
 #include "kis_abstract_projection_plane.h"
 
+namespace {
+
+/**
+ * The size of the patches a single leaf's rect is split into. It is
+ * a multiple of the tile size, so the parallel patches never write
+ * into the same tile.
+ */
+const int mergePatchSize = 256;
+
+/**
+ * The rects smaller than that are not split: the synchronization
+ * costs more than the parallel processing gains
+ */
+const int minimalSplitArea = 4 * mergePatchSize * mergePatchSize;
+
+/**
+ * The composition of fewer layers is cheaper than copying it
+ * into the projection cache of the group
+ */
+const int minimalCachedPrefix = 3;
+
+/**
+ * Copies \p rect of \p src into \p dst. If the devices have the same
+ * color space and offset, the tiles lying inside the rect are not
+ * copied, but shared between the devices in copy-on-write manner.
+ */
+void copyAreaShared(KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &rect)
+{
+    if (dst->fastBitBltPossible(src)) {
+        dst->fastBitBlt(src, rect);
+    } else {
+        KisPainter::copyAreaOptimized(rect.topLeft(), src, dst, rect);
+    }
+}
+
+/**
+ * Processes \p rects with \p func using the threads of \p pool.
+ * The calling thread takes part in the processing as well. Without
+ * a pool the rects are processed sequentially.
+ */
+template <typename Func>
+void processRects(QThreadPool *pool, const QVector<QRect> &rects, Func func)
+{
+    const int numHelpers = pool ? qMin(pool->maxThreadCount(), rects.size()) - 1 : 0;
+
+    if (numHelpers <= 0) {
+        Q_FOREACH (const QRect &rc, rects) {
+            func(rc);
+        }
+        return;
+    }
+
+    QAtomicInt nextRect(0);
+
+    auto processNextRects = [&] () {
+        int i;
+        while ((i = nextRect.fetchAndAddOrdered(1)) < rects.size()) {
+            func(rects[i]);
+        }
+    };
+
+    QVector<QFuture<void>> helpers;
+    helpers.reserve(numHelpers);
+
+    for (int i = 0; i < numHelpers; i++) {
+        helpers << QtConcurrent::run(pool, processNextRects);
+    }
+
+    processNextRects();
+
+    Q_FOREACH (QFuture<void> helper, helpers) {
+        helper.waitForFinished();
+    }
+}
+
+}
+
 
 //#define DEBUG_MERGER
 
@@ -100,7 +183,7 @@ public:
              * filter inside. Then the layer has work as a pass-through
              * node. Just copy the merged data to the layer's original.
              */
-            KisPainter::copyAreaOptimized(applyRect.topLeft(), m_projection, originalDevice, applyRect);
+            copyAreaShared(m_projection, originalDevice, applyRect);
             return true;
         }
 
@@ -207,10 +290,16 @@ private:
 /*                     KisAsyncMerger                                */
 /*********************************************************************/
 
+void KisAsyncMerger::setThreadPool(QThreadPool *pool)
+{
+    m_threadPool = pool;
+}
+
 void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
     KisMergeWalker::LeafStack &leafStack = walker.leafStack();
 
     const bool useTempProjections = walker.needRectVaries();
+    int numCachedLeaves = 0;
 
     while(!leafStack.isEmpty()) {
         KisMergeWalker::JobItem item = leafStack.pop();
@@ -223,7 +312,10 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
         QRect applyRect = item.m_applyRect;
 
         if (currentLeaf->isRoot()) {
-            currentLeaf->projectionPlane()->recalculate(applyRect, walker.startNode());
+            processRects(m_threadPool, splitApplyRect(currentLeaf, applyRect),
+                [&] (const QRect &rc) {
+                    currentLeaf->projectionPlane()->recalculate(rc, walker.startNode());
+                });
             continue;
         }
 
@@ -243,43 +335,92 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 
         if (!m_currentProjection) {
             setupProjection(currentLeaf, applyRect, useTempProjections);
+
+            if (walker.levelOfDetail() == 0) {
+                numCachedLeaves = setupProjectionCache(item, leafStack);
+            }
         }
 
-        KisUpdateOriginalVisitor originalVisitor(applyRect,
-                                                 m_currentProjection,
-                                                 walker.cropRect());
+        /**
+         * The composition of the leaves below the cached prefix
+         * has been fetched from the cache of the group
+         */
+        if (numCachedLeaves > 0) {
+            numCachedLeaves--;
+            continue;
+        }
 
-        if(item.m_position & KisMergeWalker::N_FILTHY) {
-            DEBUG_NODE_ACTION("Updating", "N_FILTHY", currentLeaf, applyRect);
-            if (currentLeaf->visible()) {
-                currentLeaf->accept(originalVisitor);
-                currentLeaf->projectionPlane()->recalculate(applyRect, walker.startNode());
-            }
+        if (m_projectionCacheLeaf == currentLeaf) {
+            m_projectionCacheGroup->storeProjectionCache(currentLeaf->node(), applyRect, m_currentProjection);
+            m_projectionCacheGroup = 0;
+            m_projectionCacheLeaf.clear();
         }
-        else if(item.m_position & KisMergeWalker::N_ABOVE_FILTHY) {
-            DEBUG_NODE_ACTION("Updating", "N_ABOVE_FILTHY", currentLeaf, applyRect);
-            if(currentLeaf->dependsOnLowerNodes()) {
+
+        const QVector<QRect> patches = splitApplyRect(currentLeaf, applyRect);
+
+        /**
+         * The leaf is processed in two passes. The filters of the
+         * adjustment layers may read the current projection outside
+         * their patch, so it must not change until the originals of
+         * all the patches are recalculated.
+         */
+        processRects(m_threadPool, patches, [&] (const QRect &rc) {
+            KisUpdateOriginalVisitor originalVisitor(rc,
+                                                     m_currentProjection,
+                                                     walker.cropRect());
+
+            if(item.m_position & KisMergeWalker::N_FILTHY) {
+                DEBUG_NODE_ACTION("Updating", "N_FILTHY", currentLeaf, rc);
                 if (currentLeaf->visible()) {
                     currentLeaf->accept(originalVisitor);
-                    currentLeaf->projectionPlane()->recalculate(applyRect, currentLeaf->node());
+                    currentLeaf->projectionPlane()->recalculate(rc, walker.startNode());
                 }
             }
-        }
-        else if(item.m_position & KisMergeWalker::N_FILTHY_PROJECTION) {
-            DEBUG_NODE_ACTION("Updating", "N_FILTHY_PROJECTION", currentLeaf, applyRect);
-            if (currentLeaf->visible()) {
-                currentLeaf->projectionPlane()->recalculate(applyRect, walker.startNode());
+            else if(item.m_position & KisMergeWalker::N_ABOVE_FILTHY) {
+                DEBUG_NODE_ACTION("Updating", "N_ABOVE_FILTHY", currentLeaf, rc);
+                if(currentLeaf->dependsOnLowerNodes()) {
+                    if (currentLeaf->visible()) {
+                        currentLeaf->accept(originalVisitor);
+                        currentLeaf->projectionPlane()->recalculate(rc, currentLeaf->node());
+                    }
+                }
             }
-        }
-        else /*if(item.m_position & KisMergeWalker::N_BELOW_FILTHY)*/ {
-            DEBUG_NODE_ACTION("Updating", "N_BELOW_FILTHY", currentLeaf, applyRect);
-            /* nothing to do */
-        }
+            else if(item.m_position & KisMergeWalker::N_FILTHY_PROJECTION) {
+                DEBUG_NODE_ACTION("Updating", "N_FILTHY_PROJECTION", currentLeaf, rc);
+                if (currentLeaf->visible()) {
+                    currentLeaf->projectionPlane()->recalculate(rc, walker.startNode());
+                }
+            }
+            else /*if(item.m_position & KisMergeWalker::N_BELOW_FILTHY)*/ {
+                DEBUG_NODE_ACTION("Updating", "N_BELOW_FILTHY", currentLeaf, rc);
+                /* nothing to do */
+            }
+        });
 
-        compositeWithProjection(currentLeaf, applyRect);
+        /**
+         * The first visible leaf is composed onto an empty projection,
+         * so it can just share the tiles with the projection
+         */
+        const bool shareProjection =
+            m_currentProjectionIsEmpty && canShareWithProjection(currentLeaf);
+
+        processRects(m_threadPool, patches, [&] (const QRect &rc) {
+            if (shareProjection) {
+                copyAreaShared(currentLeaf->projection(), m_currentProjection, rc);
+            } else {
+                compositeWithProjection(currentLeaf, rc);
+            }
+
+            if(item.m_position & KisMergeWalker::N_TOPMOST) {
+                writeProjection(currentLeaf, useTempProjections, rc);
+            }
+        });
+
+        if (currentLeaf->visible()) {
+            m_currentProjectionIsEmpty = false;
+        }
 
         if(item.m_position & KisMergeWalker::N_TOPMOST) {
-            writeProjection(currentLeaf, useTempProjections, applyRect);
             resetProjection();
         }
 
@@ -305,6 +446,9 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 void KisAsyncMerger::resetProjection() {
     m_currentProjection = 0;
     m_finalProjection = 0;
+    m_projectionCacheGroup = 0;
+    m_projectionCacheLeaf.clear();
+    m_currentProjectionIsEmpty = false;
 }
 
 void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection) {
@@ -322,6 +466,8 @@ void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRec
             parentOriginal->clear(rect);
             m_finalProjection = m_currentProjection = parentOriginal;
         }
+
+        m_currentProjectionIsEmpty = true;
     }
     else {
         /**
@@ -335,13 +481,95 @@ void KisAsyncMerger::setupProjection(KisProjectionLeafSP currentLeaf, const QRec
     }
 }
 
+int KisAsyncMerger::setupProjectionCache(const KisMergeWalker::JobItem &firstItem,
+                                         const KisMergeWalker::LeafStack &leafStack)
+{
+    if (!m_currentProjection) return 0;
+
+    KisProjectionLeafSP parentLeaf = firstItem.m_leaf->parent();
+    KisGroupLayerSP group = qobject_cast<KisGroupLayer*>(parentLeaf->node().data());
+    if (!group) return 0;
+
+    /**
+     * The leaves of the group lie on the top of the stack,
+     * from the bottommost to the topmost one
+     */
+    QVector<KisMergeWalker::JobItem> items;
+    items << firstItem;
+
+    for (int i = leafStack.size() - 1;
+         i >= 0 && !(items.last().m_position & KisMergeWalker::N_TOPMOST); i--) {
+
+        items << leafStack[i];
+    }
+
+    /**
+     * Find the lowest leaf that is going to be recalculated. All the
+     * leaves below it stay untouched, so their composition may be
+     * taken from the cache.
+     */
+    int filthyIndex = -1;
+
+    for (int i = 0; i < items.size(); i++) {
+        const KisMergeWalker::NodePosition position = items[i].m_position;
+
+        if (position & KisMergeWalker::N_EXTRA) {
+            group->invalidateProjectionCache();
+            return 0;
+        }
+
+        if (filthyIndex < 0 && !(position & KisMergeWalker::N_BELOW_FILTHY)) {
+            filthyIndex = i;
+        }
+    }
+
+    if (filthyIndex < 0) return 0;
+
+    KisNodeSP cacheChild = group->projectionCacheChild();
+    int cachedIndex = -1;
+
+    for (int i = 0; i <= filthyIndex; i++) {
+        if (items[i].m_leaf->node() == cacheChild) {
+            cachedIndex = i;
+            break;
+        }
+    }
+
+    /**
+     * The cached prefix contains a leaf that is going to change
+     */
+    if (cacheChild && cachedIndex < 0) {
+        group->invalidateProjectionCache();
+    }
+
+    int numCachedLeaves = 0;
+
+    if (cachedIndex > 0 &&
+        group->fetchProjectionCache(cacheChild,
+                                    items[cachedIndex].m_applyRect,
+                                    m_currentProjection)) {
+
+        numCachedLeaves = cachedIndex;
+        m_currentProjectionIsEmpty = false;
+    }
+
+    if (filthyIndex >= minimalCachedPrefix &&
+        (!numCachedLeaves || cachedIndex != filthyIndex)) {
+
+        m_projectionCacheGroup = group;
+        m_projectionCacheLeaf = items[filthyIndex].m_leaf;
+    }
+
+    return numCachedLeaves;
+}
+
 void KisAsyncMerger::writeProjection(KisProjectionLeafSP topmostLeaf, bool useTempProjection, const QRect &rect) {
     Q_UNUSED(useTempProjection);
     Q_UNUSED(topmostLeaf);
     if (!m_currentProjection) return;
 
     if(m_currentProjection != m_finalProjection) {
-        KisPainter::copyAreaOptimized(rect.topLeft(), m_currentProjection, m_finalProjection, rect);
+        copyAreaShared(m_currentProjection, m_finalProjection, rect);
     }
     DEBUG_NODE_ACTION("Writing projection", "", topmostLeaf->parent(), rect);
 }
@@ -358,6 +586,91 @@ bool KisAsyncMerger::compositeWithProjection(KisProjectionLeafSP leaf, const QRe
     return true;
 }
 
+bool KisAsyncMerger::canShareWithProjection(KisProjectionLeafSP leaf)
+{
+    if (!m_currentProjection || !leaf->visible() ||
+        leaf->isOverlayProjectionLeaf()) {
+
+        return false;
+    }
+
+    KisLayer *layer = qobject_cast<KisLayer*>(leaf->node().data());
+    KisPaintDeviceSP device = leaf->projection();
+
+    if (!layer || !device || layer->layerStyle()) return false;
+
+    /**
+     * The same conditions as in KisGroupLayer::tryObligeChild(): the
+     * layer composed onto a transparent device should give exactly
+     * the same pixels as the layer itself
+     */
+    const QString compositeOpId = layer->compositeOpId();
+    const QBitArray channelFlags = leaf->channelFlags();
+
+    return
+        leaf->opacity() == OPACITY_OPAQUE_U8 &&
+        (compositeOpId == COMPOSITE_OVER ||
+         compositeOpId == COMPOSITE_ALPHA_DARKEN ||
+         compositeOpId == COMPOSITE_COPY) &&
+        (channelFlags.isEmpty() || channelFlags.count(true) == channelFlags.size()) &&
+        m_currentProjection->defaultPixel().opacityU8() == OPACITY_TRANSPARENT_U8 &&
+        device->defaultPixel() == m_currentProjection->defaultPixel() &&
+        m_currentProjection->fastBitBltPossible(device);
+}
+
+QVector<QRect> KisAsyncMerger::splitApplyRect(KisProjectionLeafSP leaf, const QRect &rect)
+{
+    QVector<QRect> patches;
+
+    if (rect.width() * rect.height() < minimalSplitArea) {
+        patches << rect;
+        return patches;
+    }
+
+    KisNodeSP node = leaf->node();
+    KisAbstractProjectionPlaneSP plane = leaf->projectionPlane();
+
+    /**
+     * The clones start their own merges of the source layer, so
+     * they are never split.
+     *
+     * The adjustment layers write into the requested rect only,
+     * the rest of their need rect is read from the current projection,
+     * which stays untouched while the originals are recalculated. Their
+     * masks still have to be checked though.
+     */
+    KisLayer *layer = qobject_cast<KisLayer*>(node.data());
+    const bool isLocalAdjustment =
+        qobject_cast<KisAdjustmentLayer*>(node.data()) &&
+        !layer->hasEffectMasks();
+
+    const bool isLocal =
+        isLocalAdjustment ||
+        (plane->needRect(rect) == rect &&
+         plane->changeRect(rect) == rect &&
+         plane->accessRect(rect) == rect);
+
+    if (!isLocal || qobject_cast<KisCloneLayer*>(node.data())) {
+        patches << rect;
+        return patches;
+    }
+
+    const int firstCol = qFloor(qreal(rect.left()) / mergePatchSize);
+    const int firstRow = qFloor(qreal(rect.top()) / mergePatchSize);
+    const int lastCol = qFloor(qreal(rect.right()) / mergePatchSize);
+    const int lastRow = qFloor(qreal(rect.bottom()) / mergePatchSize);
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const QRect patch(col * mergePatchSize, row * mergePatchSize,
+                              mergePatchSize, mergePatchSize);
+            patches << (patch & rect);
+        }
+    }
+
+    return patches;
+}
+
 void KisAsyncMerger::doNotifyClones(KisBaseRectsWalker &walker) {
     KisBaseRectsWalker::CloneNotificationsVector &vector =
         walker.cloneNotifications();
@@ -21,22 +21,58 @@
 
 #include "kritaimage_export.h"
 #include "kis_types.h"
+#include "kis_base_rects_walker.h"
+
+#include <QVector>
 
 class QRect;
-class KisBaseRectsWalker;
+class QThreadPool;
 
 class KRITAIMAGE_EXPORT KisAsyncMerger
 {
 public:
+    /**
+     * Sets the pool used for processing the patches of large rects
+     * in parallel. The merger doesn't own the pool. Without a pool
+     * (the default) the patches are processed sequentially.
+     */
+    void setThreadPool(QThreadPool *pool);
+
     void startMerge(KisBaseRectsWalker &walker, bool notifyClones = true);
 
 private:
     inline void resetProjection();
     inline void setupProjection(KisProjectionLeafSP currentLeaf, const QRect& rect, bool useTempProjection);
+
+    /**
+     * Prepares the projection cache of the group the leaves of which
+     * start with \p firstItem. If the composition of the leaves below
+     * the recalculated ones has been cached, it is copied into the
+     * current projection. Returns the number of the leaves that must
+     * be skipped.
+     */
+    int setupProjectionCache(const KisBaseRectsWalker::JobItem &firstItem,
+                             const KisBaseRectsWalker::LeafStack &leafStack);
+
     inline void writeProjection(KisProjectionLeafSP topmostLeaf, bool useTempProjection, const QRect &rect);
     inline bool compositeWithProjection(KisProjectionLeafSP leaf, const QRect &rect);
+
+    /**
+     * Checks whether composing \p leaf onto the empty current projection
+     * is equivalent to copying it, so the projection may share the tiles
+     * with the leaf instead of compositing
+     */
+    inline bool canShareWithProjection(KisProjectionLeafSP leaf);
     inline void doNotifyClones(KisBaseRectsWalker &walker);
 
+    /**
+     * Splits \p rect into tile-aligned patches that can be processed
+     * for \p leaf in parallel. If the leaf reads or writes pixels
+     * outside the requested rect (e.g. it has a blurring mask or a
+     * layer style), the rect is returned as a whole.
+     */
+    static QVector<QRect> splitApplyRect(KisProjectionLeafSP leaf, const QRect &rect);
+
 private:
     /**
      * The place where intermediate results of layer's merge
@@ -55,6 +91,11 @@ private:
      */
     KisPaintDeviceSP m_finalProjection;
 
+    /**
+     * True until a visible leaf is composed onto the current projection
+     */
+    bool m_currentProjectionIsEmpty = false;
+
     /**
      * Creation of the paint device is quite expensive, so we'll just
      * save the pointer to our temporary device here and will get it when
@@ -62,6 +103,15 @@ private:
      * setupProjection()
      */
     KisPaintDeviceSP m_cachedPaintDevice;
+
+    /**
+     * The leaf before compositing of which the current projection
+     * is saved into the projection cache of the group
+     */
+    KisGroupLayerSP m_projectionCacheGroup;
+    KisProjectionLeafSP m_projectionCacheLeaf;
+
+    QThreadPool *m_threadPool = 0;
 };
 
 
@@ -25,6 +25,7 @@
 
 #include "kis_abstract_projection_plane.h"
 #include "kis_projection_leaf.h"
+#include "kis_update_cost_model.h"
 
 
 class KisBaseRectsWalker;
@@ -180,6 +181,18 @@ public:
         return m_cropRect;
     }
 
+    /**
+     * The model the walker reports its execution time to
+     * after the merge is finished. May be null.
+     */
+    inline void setCostModel(KisUpdateCostModelSP costModel) {
+        m_costModel = costModel;
+    }
+
+    inline KisUpdateCostModelSP costModel() const {
+        return m_costModel;
+    }
+
     // return a reference for efficiency reasons
     inline LeafStack& leafStack() {
         return m_mergeTask;
@@ -483,6 +496,8 @@ private:
     QRect m_lastNeedRect;
 
     int m_levelOfDetail;
+
+    KisUpdateCostModelSP m_costModel;
 };
 
 #endif /* __KIS_BASE_RECTS_WALKER_H */
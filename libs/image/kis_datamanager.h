@@ -53,8 +53,14 @@ public:
      *
      * Note that if pixelSize > size of the defPixel array, we will happily read beyond the
      * defPixel array.
+     *
+     * The data is stored in tiles of tileWidth x tileHeight pixels, see
+     * KisTiledDataManager::isValidTileSize() for the supported values.
      */
-KisDataManager(quint32 pixelSize, const quint8 *defPixel) : ACTUAL_DATAMGR(pixelSize, defPixel) {}
+    KisDataManager(quint32 pixelSize, const quint8 *defPixel,
+                   qint32 tileWidth = KisTileData::WIDTH,
+                   qint32 tileHeight = KisTileData::HEIGHT)
+        : ACTUAL_DATAMGR(pixelSize, defPixel, tileWidth, tileHeight) {}
     KisDataManager(const KisDataManager& dm) : ACTUAL_DATAMGR(dm) { }
 
     ~KisDataManager() override {
@@ -26,6 +26,8 @@
 #include <KoColorSpace.h>
 #include <KoColor.h>
 
+#include <QMutex>
+#include <QRegion>
 
 #include "kis_node_visitor.h"
 #include "kis_processing_visitor.h"
@@ -37,6 +39,7 @@
 #include "kis_selection_mask.h"
 #include "kis_psd_layer_style.h"
 #include "kis_layer_properties_icons.h"
+#include "kis_painter.h"
 
 
 struct Q_DECL_HIDDEN KisGroupLayer::Private
@@ -54,6 +57,16 @@ public:
     qint32 x;
     qint32 y;
     bool passThroughMode;
+
+    /**
+     * The composition of the children below projectionCacheChild,
+     * valid inside projectionCacheRegion only
+     */
+    mutable QMutex projectionCacheLock;
+    KisPaintDeviceSP projectionCache;
+    KisNodeWSP projectionCacheChild;
+    QRegion projectionCacheRegion;
+    int projectionCacheGeneration = 0;
 };
 
 KisGroupLayer::KisGroupLayer(KisImageWSP image, const QString &name, quint8 opacity) :
@@ -201,6 +214,8 @@ void KisGroupLayer::resetCache(const KoColorSpace *colorSpace)
 
         m_d->paintDevice->clear();
     }
+
+    invalidateProjectionCache();
 }
 
 KisLayer* KisGroupLayer::onlyMeaningfulChild() const
@@ -278,6 +293,7 @@ bool KisGroupLayer::projectionIsValid() const
 void KisGroupLayer::setDefaultProjectionColor(KoColor color)
 {
     m_d->paintDevice->setDefaultPixel(color);
+    invalidateProjectionCache();
 }
 
 KoColor KisGroupLayer::defaultProjectionColor() const
@@ -297,6 +313,7 @@ void KisGroupLayer::setPassThroughMode(bool value)
 
     m_d->passThroughMode = value;
 
+    invalidateProjectionCache();
     baseNodeChangedCallback();
     baseNodeInvalidateAllFramesCallback();
 }
@@ -321,6 +338,115 @@ void KisGroupLayer::setSectionModelProperties(const KisBaseNode::PropertyList &p
     KisLayer::setSectionModelProperties(properties);
 }
 
+KisNodeSP KisGroupLayer::projectionCacheChild() const
+{
+    QMutexLocker l(&m_d->projectionCacheLock);
+
+    return m_d->projectionCacheChild.isValid() ?
+        KisNodeSP(m_d->projectionCacheChild) : KisNodeSP();
+}
+
+bool KisGroupLayer::fetchProjectionCache(KisNodeSP child, const QRect &rect, KisPaintDeviceSP dst) const
+{
+    KisPaintDeviceSP cache;
+
+    {
+        QMutexLocker l(&m_d->projectionCacheLock);
+
+        if (!m_d->projectionCache ||
+            !m_d->projectionCacheChild.isValid() ||
+            m_d->projectionCacheChild != child.data() ||
+            !(QRegion(rect) - m_d->projectionCacheRegion).isEmpty()) {
+
+            return false;
+        }
+
+        cache = m_d->projectionCache;
+    }
+
+    if (*cache->colorSpace() != *dst->colorSpace() ||
+        cache->x() != dst->x() || cache->y() != dst->y()) {
+
+        return false;
+    }
+
+    /**
+     * The walkers processed concurrently never intersect, so nobody
+     * can write into this rect of the cache while we are reading it
+     */
+    KisPainter::copyAreaOptimized(rect.topLeft(), cache, dst, rect);
+    return true;
+}
+
+void KisGroupLayer::storeProjectionCache(KisNodeSP child, const QRect &rect, KisPaintDeviceSP src)
+{
+    KisPaintDeviceSP cache;
+    int generation = 0;
+
+    {
+        QMutexLocker l(&m_d->projectionCacheLock);
+
+        /**
+         * The walkers of other rects may still be reading the old
+         * cache, so a new device is created instead of clearing it
+         */
+        if (!m_d->projectionCache ||
+            !m_d->projectionCacheChild.isValid() ||
+            m_d->projectionCacheChild != child.data() ||
+            *m_d->projectionCache->colorSpace() != *src->colorSpace() ||
+            m_d->projectionCache->x() != src->x() ||
+            m_d->projectionCache->y() != src->y()) {
+
+            m_d->projectionCache = new KisPaintDevice(src->colorSpace());
+            m_d->projectionCache->prepareClone(src);
+            m_d->projectionCacheChild = child;
+            m_d->projectionCacheRegion = QRegion();
+            m_d->projectionCacheGeneration++;
+        }
+
+        cache = m_d->projectionCache;
+        generation = m_d->projectionCacheGeneration;
+    }
+
+    KisPainter::copyAreaOptimized(rect.topLeft(), src, cache, rect);
+
+    QMutexLocker l(&m_d->projectionCacheLock);
+
+    /**
+     * The cache might have been invalidated while we were copying
+     */
+    if (generation == m_d->projectionCacheGeneration) {
+        m_d->projectionCacheRegion += rect;
+    }
+}
+
+void KisGroupLayer::invalidateProjectionCache()
+{
+    {
+        QMutexLocker l(&m_d->projectionCacheLock);
+
+        m_d->projectionCache = 0;
+        m_d->projectionCacheChild = 0;
+        m_d->projectionCacheRegion = QRegion();
+        m_d->projectionCacheGeneration++;
+    }
+
+    /**
+     * The children of a pass-through group are composed
+     * right into the projection of its parent
+     */
+    KisGroupLayer *parentGroup = qobject_cast<KisGroupLayer*>(parent().data());
+    if (m_d->passThroughMode && parentGroup) {
+        parentGroup->invalidateProjectionCache();
+    }
+}
+
+void KisGroupLayer::childNodeChanged(KisNodeSP changedChildNode)
+{
+    invalidateProjectionCache();
+    KisLayer::childNodeChanged(changedChildNode);
+}
+
 bool KisGroupLayer::accept(KisNodeVisitor &v)
 {
     return v.visit(this);
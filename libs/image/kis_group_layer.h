@@ -107,6 +107,44 @@ public:
 
     bool projectionIsValid() const;
 
+    /**
+     * Projection cache of the group
+     *
+     * While the user paints on a layer, the merger recomposes the
+     * group from that layer up, but the layers below it stay unchanged.
+     * So the merger saves the composition of the children below the
+     * dirty child (the prefix) in the cache of the group and starts the
+     * following updates of the same child from the cached prefix
+     * instead of compositing all the lower layers once again.
+     *
+     * The cache is kept for a single child only. Any update of the
+     * children below it (or of the child structure of the group)
+     * invalidates the cache. \see KisAsyncMerger
+     */
+
+    /**
+     * @return the child the cached prefix is stored for
+     */
+    KisNodeSP projectionCacheChild() const;
+
+    /**
+     * Copies \p rect of the composition of the children below \p child
+     * into \p dst. Returns false if the cache is not valid for \p child
+     * or \p rect.
+     */
+    bool fetchProjectionCache(KisNodeSP child, const QRect &rect, KisPaintDeviceSP dst) const;
+
+    /**
+     * Saves \p rect of \p src as the composition of the children
+     * below \p child. If the cache has been stored for another child,
+     * it is reset.
+     */
+    void storeProjectionCache(KisNodeSP child, const QRect &rect, KisPaintDeviceSP src);
+
+    void invalidateProjectionCache();
+
+    void childNodeChanged(KisNodeSP changedChildNode) override;
+
 protected:
     KisLayer* onlyMeaningfulChild() const;
     KisPaintDeviceSP tryObligeChild() const;
@@ -1674,6 +1674,21 @@ int KisImage::workingThreadsLimit() const
     return m_d->scheduler.threadsLimit();
 }
 
+QVector<KisUpdateCostModel::NodeCost> KisImage::learnedUpdateCosts() const
+{
+    return m_d->scheduler.learnedUpdateCosts();
+}
+
+KisStrokeLatencyStatistics KisImage::interactiveStrokesLatency() const
+{
+    return m_d->scheduler.interactiveStrokesLatency();
+}
+
+void KisImage::resetInteractiveStrokesLatency()
+{
+    m_d->scheduler.resetInteractiveStrokesLatency();
+}
+
 void KisImage::notifySelectionChanged()
 {
     /**
@@ -1856,6 +1871,7 @@ void KisImage::setLevelOfDetailBlocked(bool value)
         m_d->scheduler.setDesiredLevelOfDetail(0);
     }
 
+    m_d->scheduler.setAdaptiveLevelOfDetailAllowed(!value);
     m_d->blockLevelOfDetail = value;
 }
 
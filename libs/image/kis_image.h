@@ -35,6 +35,8 @@
 #include "kis_node_facade.h"
 #include "kis_image_interfaces.h"
 #include "kis_strokes_queue_undo_result.h"
+#include "kis_update_cost_model.h"
+#include "KisStrokeLatencyStatistics.h"
 
 #include <kritaimage_export.h>
 
@@ -111,6 +113,23 @@ public:
      */
     int workingThreadsLimit() const;
 
+    /**
+     * Returns the learned costs of updating the nodes of the image,
+     * for diagnostic purposes only
+     *
+     * \see KisUpdateScheduler::learnedUpdateCosts()
+     */
+    QVector<KisUpdateCostModel::NodeCost> learnedUpdateCosts() const;
+
+    /**
+     * Returns the latency of the jobs of the interactive strokes,
+     * for diagnostic purposes only
+     *
+     * \see KisUpdateScheduler::interactiveStrokesLatency()
+     */
+    KisStrokeLatencyStatistics interactiveStrokesLatency() const;
+    void resetInteractiveStrokesLatency();
+
     /**
      * Makes a copy of the image with all the layers. If possible, shallow
      * copies of the layers are made.
@@ -129,6 +129,17 @@ qreal KisImageConfig::maxMergeCollectAlpha() const
     return m_config.readEntry("maxMergeCollectAlpha", 1.5);
 }
 
+bool KisImageConfig::adaptiveUpdatePatches(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("adaptiveUpdatePatches", false) : false;
+}
+
+void KisImageConfig::setAdaptiveUpdatePatches(bool value)
+{
+    m_config.writeEntry("adaptiveUpdatePatches", value);
+}
+
 qreal KisImageConfig::schedulerBalancingRatio() const
 {
     /**
@@ -142,6 +153,50 @@ void KisImageConfig::setSchedulerBalancingRatio(qreal value)
     m_config.writeEntry("schedulerBalancingRatio", value);
 }
 
+bool KisImageConfig::adaptiveLevelOfDetail(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("adaptiveLevelOfDetail", false) : false;
+}
+
+void KisImageConfig::setAdaptiveLevelOfDetail(bool value)
+{
+    m_config.writeEntry("adaptiveLevelOfDetail", value);
+}
+
+int KisImageConfig::adaptiveLodLatencyTarget(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("adaptiveLodLatencyTarget", 30) : 30; // in ms
+}
+
+void KisImageConfig::setAdaptiveLodLatencyTarget(int value)
+{
+    m_config.writeEntry("adaptiveLodLatencyTarget", value);
+}
+
+int KisImageConfig::adaptiveLodRecoveryLatency(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("adaptiveLodRecoveryLatency", 20) : 20; // in ms
+}
+
+void KisImageConfig::setAdaptiveLodRecoveryLatency(int value)
+{
+    m_config.writeEntry("adaptiveLodRecoveryLatency", value);
+}
+
+int KisImageConfig::adaptiveLodMaxLevel(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("adaptiveLodMaxLevel", 2) : 2;
+}
+
+void KisImageConfig::setAdaptiveLodMaxLevel(int value)
+{
+    m_config.writeEntry("adaptiveLodMaxLevel", value);
+}
+
 int KisImageConfig::maxSwapSize(bool requestDefault) const
 {
     return !requestDefault ?
@@ -173,6 +228,72 @@ void KisImageConfig::setSwapWindowSize(int value)
     m_config.writeEntry("swapWindowSize", value);
 }
 
+QString KisImageConfig::swapCompressionCodec(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapCompressionCodec", "LZF") : "LZF";
+}
+
+void KisImageConfig::setSwapCompressionCodec(const QString &value)
+{
+    m_config.writeEntry("swapCompressionCodec", value);
+}
+
+bool KisImageConfig::useMappedSwapFile(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useMappedSwapFile", false) : false;
+}
+
+void KisImageConfig::setUseMappedSwapFile(bool value)
+{
+    m_config.writeEntry("useMappedSwapFile", value);
+}
+
+bool KisImageConfig::collapseUniformTiles(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("collapseUniformTiles", true) : true;
+}
+
+void KisImageConfig::setCollapseUniformTiles(bool value)
+{
+    m_config.writeEntry("collapseUniformTiles", value);
+}
+
+bool KisImageConfig::compressHistory(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("compressHistory", true) : true;
+}
+
+void KisImageConfig::setCompressHistory(bool value)
+{
+    m_config.writeEntry("compressHistory", value);
+}
+
+int KisImageConfig::compressedHistoryMemoryLimit(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("compressedHistoryMemoryLimit", 512) : 512; // in MiB
+}
+
+void KisImageConfig::setCompressedHistoryMemoryLimit(int value)
+{
+    m_config.writeEntry("compressedHistoryMemoryLimit", value);
+}
+
+bool KisImageConfig::useHugePagesForTiles(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useHugePagesForTiles", false) : false;
+}
+
+void KisImageConfig::setUseHugePagesForTiles(bool value)
+{
+    m_config.writeEntry("useHugePagesForTiles", value);
+}
+
 int KisImageConfig::tilesHardLimit() const
 {
     qreal hp = qreal(memoryHardLimitPercent()) / 100.0;
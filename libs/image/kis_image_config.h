@@ -46,9 +46,38 @@ public:
     qreal maxCollectAlpha() const;
     qreal maxMergeAlpha() const;
     qreal maxMergeCollectAlpha() const;
+
+    /**
+     * When enabled, the update queue measures the cost of updating
+     * every node and chooses the patch size and the merging of the
+     * update jobs from it, instead of using the static values above
+     */
+    bool adaptiveUpdatePatches(bool requestDefault = false) const;
+    void setAdaptiveUpdatePatches(bool value);
+
     qreal schedulerBalancingRatio() const;
     void setSchedulerBalancingRatio(qreal value);
 
+    /**
+     * When enabled, the strokes are painted on a coarser level of detail
+     * while the latency of the interactive strokes exceeds the target,
+     * even if the zoom doesn't require it. The latencies are in
+     * milliseconds.
+     *
+     * \see KisStrokesQueue::setAdaptiveLevelOfDetail()
+     */
+    bool adaptiveLevelOfDetail(bool requestDefault = false) const;
+    void setAdaptiveLevelOfDetail(bool value);
+
+    int adaptiveLodLatencyTarget(bool requestDefault = false) const;
+    void setAdaptiveLodLatencyTarget(int value);
+
+    int adaptiveLodRecoveryLatency(bool requestDefault = false) const;
+    void setAdaptiveLodRecoveryLatency(int value);
+
+    int adaptiveLodMaxLevel(bool requestDefault = false) const;
+    void setAdaptiveLodMaxLevel(int value);
+
     int maxSwapSize(bool requestDefault = false) const;
     void setMaxSwapSize(int value);
 
@@ -58,6 +87,48 @@ public:
     int swapWindowSize() const;
     void setSwapWindowSize(int value);
 
+    /**
+     * @return the name of the codec used for compressing the tiles
+     * in the swap file, one of KisCompressionFactory::availableCodecs()
+     */
+    QString swapCompressionCodec(bool requestDefault = false) const;
+    void setSwapCompressionCodec(const QString &value);
+
+    /**
+     * @return true if the whole swap file should be mapped into memory
+     * (see KisMappedSwapSpace) instead of using sliding read/write windows
+     */
+    bool useMappedSwapFile(bool requestDefault = false) const;
+    void setUseMappedSwapFile(bool value);
+
+    /**
+     * @return true if the tile data pooler should free the memory of
+     * the tiles filled with a single color
+     */
+    bool collapseUniformTiles(bool requestDefault = false) const;
+    void setCollapseUniformTiles(bool value);
+
+    /**
+     * @return true if the tiles of the undo history should be kept
+     * compressed in memory (see KisMementoArenaStore)
+     */
+    bool compressHistory(bool requestDefault = false) const;
+    void setCompressHistory(bool value);
+
+    /**
+     * @return the amount of the compressed history kept in memory
+     * before it is written into the swap file, in MiB
+     */
+    int compressedHistoryMemoryLimit(bool requestDefault = false) const;
+    void setCompressedHistoryMemoryLimit(int value);
+
+    /**
+     * @return true if the memory of the tiles should be backed by
+     * transparent huge pages (Linux only). Takes effect after restart.
+     */
+    bool useHugePagesForTiles(bool requestDefault = false) const;
+    void setUseHugePagesForTiles(bool value);
+
     int tilesHardLimit() const; // MiB
     int tilesSoftLimit() const; // MiB
     int poolLimit() const; // MiB
@@ -22,6 +22,7 @@
 #include <QApplication>
 
 #include "kis_image.h"
+#include "kis_paint_layer.h"
 #include "kis_image_config.h"
 #include "kis_signal_compressor.h"
 
@@ -64,10 +65,7 @@ KisMemoryStatisticsServer* KisMemoryStatisticsServer::instance()
 inline void addDevice(KisPaintDeviceSP dev,
                       bool isProjection,
                       QSet<KisPaintDevice*> &devices,
-                      qint64 &memBound,
-                      qint64 &layersSize,
-                      qint64 &projectionsSize,
-                      qint64 &lodSize)
+                      KisMemoryStatisticsServer::NodeStatistics &stats)
 {
     if (dev && !devices.contains(dev.data())) {
         devices.insert(dev.data());
@@ -75,66 +73,83 @@ inline void addDevice(KisPaintDeviceSP dev,
         qint64 imageData = 0;
         qint64 temporaryData = 0;
         qint64 lodData = 0;
+        qint64 framesData = 0;
+        qint64 historicalData = 0;
 
-        dev->estimateMemoryStats(imageData, temporaryData, lodData);
-        memBound += imageData + temporaryData + lodData;
+        dev->estimateMemoryStats(imageData, temporaryData, lodData,
+                                 framesData, historicalData);
 
         KIS_SAFE_ASSERT_RECOVER_NOOP(!temporaryData || isProjection);
 
         if (!isProjection) {
-            layersSize += imageData + temporaryData;
+            stats.layerSize += imageData + temporaryData;
         } else {
-            projectionsSize += imageData + temporaryData;
+            stats.projectionSize += imageData + temporaryData;
         }
 
-        lodSize += lodData;
+        stats.lodSize += lodData;
+        stats.framesSize += framesData;
+        stats.historySize += historicalData;
+    }
+}
+
+inline void addOnionSkinsDevice(KisPaintDeviceSP dev,
+                                QSet<KisPaintDevice*> &devices,
+                                KisMemoryStatisticsServer::NodeStatistics &stats)
+{
+    if (dev && !devices.contains(dev.data())) {
+        devices.insert(dev.data());
+
+        qint64 imageData = 0;
+        qint64 temporaryData = 0;
+        qint64 lodData = 0;
+
+        dev->estimateMemoryStats(imageData, temporaryData, lodData);
+        stats.onionSkinsSize += imageData + temporaryData + lodData;
     }
 }
 
-qint64 calculateNodeMemoryHiBoundStep(KisNodeSP node,
-                                      QSet<KisPaintDevice*> &devices,
-                                      qint64 &layersSize,
-                                      qint64 &projectionsSize,
-                                      qint64 &lodSize)
+void collectNodeStatistics(KisNodeSP node,
+                           QSet<KisPaintDevice*> &devices,
+                           QVector<KisMemoryStatisticsServer::NodeStatistics> &result)
 {
-    qint64 memBound = 0;
+    KisMemoryStatisticsServer::NodeStatistics stats;
+    stats.node = node;
 
     const bool originalIsProjection =
             node->inherits("KisGroupLayer") ||
             node->inherits("KisAdjustmentLayer");
 
+    addDevice(node->paintDevice(), false, devices, stats);
+    addDevice(node->original(), originalIsProjection, devices, stats);
+    addDevice(node->projection(), true, devices, stats);
 
-    addDevice(node->paintDevice(), false, devices, memBound, layersSize, projectionsSize, lodSize);
-    addDevice(node->original(), originalIsProjection, devices, memBound, layersSize, projectionsSize, lodSize);
-    addDevice(node->projection(), true, devices, memBound, layersSize, projectionsSize, lodSize);
+    const KisPaintLayer *paintLayer = qobject_cast<const KisPaintLayer*>(node.data());
+    if (paintLayer) {
+        addOnionSkinsDevice(paintLayer->onionSkinCacheDevice(), devices, stats);
+    }
+
+    result << stats;
 
     node = node->firstChild();
     while (node) {
-        memBound += calculateNodeMemoryHiBoundStep(node, devices,
-                                                   layersSize, projectionsSize, lodSize);
+        collectNodeStatistics(node, devices, result);
         node = node->nextSibling();
     }
-
-    return memBound;
 }
 
-qint64 calculateNodeMemoryHiBound(KisNodeSP node,
-                                  qint64 &layersSize,
-                                  qint64 &projectionsSize,
-                                  qint64 &lodSize)
+QVector<KisMemoryStatisticsServer::NodeStatistics>
+KisMemoryStatisticsServer::fetchNodeMemoryStatistics(KisImageSP image) const
 {
-    layersSize = 0;
-    projectionsSize = 0;
-    lodSize = 0;
-
-    QSet<KisPaintDevice*> devices;
-    return calculateNodeMemoryHiBoundStep(node,
-                                          devices,
-                                          layersSize,
-                                          projectionsSize,
-                                          lodSize);
-}
+    QVector<NodeStatistics> result;
 
+    if (image) {
+        QSet<KisPaintDevice*> devices;
+        collectNodeStatistics(image->root(), devices, result);
+    }
+
+    return result;
+}
 
 KisMemoryStatisticsServer::Statistics
 KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
@@ -143,12 +158,16 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
         KisTileDataStore::instance()->memoryStatistics();
 
     Statistics stats;
-    if (image) {
-        stats.imageSize =
-            calculateNodeMemoryHiBound(image->root(),
-                                       stats.layersSize,
-                                       stats.projectionsSize,
-                                       stats.lodSize);
+
+    Q_FOREACH (const NodeStatistics &nodeStats, fetchNodeMemoryStatistics(image)) {
+        stats.layersSize += nodeStats.layerSize;
+        stats.projectionsSize += nodeStats.projectionSize;
+        stats.lodSize += nodeStats.lodSize;
+        stats.framesSize += nodeStats.framesSize;
+        stats.onionSkinsSize += nodeStats.onionSkinsSize;
+        stats.historySize += nodeStats.historySize;
+
+        stats.imageSize += nodeStats.totalSize();
     }
     stats.totalMemorySize = tileStats.totalMemorySize;
     stats.realMemorySize = tileStats.realMemorySize;
@@ -156,6 +175,17 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
     stats.poolSize = tileStats.poolSize;
 
     stats.swapSize = tileStats.swapSize;
+    stats.swapOutThroughput = tileStats.swapOutThroughput;
+    stats.swapInThroughput = tileStats.swapInThroughput;
+
+    stats.uniformTilesReclaimedSize = tileStats.uniformTilesReclaimedSize;
+
+    stats.historyCompressedSize = tileStats.historyArenaSize;
+    stats.historyCompressedSwapSize = tileStats.historyArenaSwappedSize;
+    stats.historyCompressionSavedSize =
+        tileStats.historyArenaUncompressedSize -
+        tileStats.historyArenaSize - tileStats.historyArenaSwappedSize;
+    stats.numLostHistoryTiles = tileStats.numLostHistoryTiles;
 
     KisImageConfig cfg(true);
 
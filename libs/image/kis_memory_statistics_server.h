@@ -22,6 +22,7 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QScopedPointer>
+#include <QVector>
 
 #include "kritaimage_export.h"
 #include "kis_types.h"
@@ -38,6 +39,9 @@ public:
               layersSize(0),
               projectionsSize(0),
               lodSize(0),
+              framesSize(0),
+              onionSkinsSize(0),
+              historySize(0),
 
               totalMemorySize(0),
               realMemorySize(0),
@@ -45,6 +49,15 @@ public:
               poolSize(0),
 
               swapSize(0),
+              swapOutThroughput(0),
+              swapInThroughput(0),
+
+              uniformTilesReclaimedSize(0),
+
+              historyCompressedSize(0),
+              historyCompressedSwapSize(0),
+              historyCompressionSavedSize(0),
+              numLostHistoryTiles(0),
 
               totalMemoryLimit(0),
               tilesHardLimit(0),
@@ -57,6 +70,9 @@ public:
         qint64 layersSize;
         qint64 projectionsSize;
         qint64 lodSize;
+        qint64 framesSize;
+        qint64 onionSkinsSize;
+        qint64 historySize; // estimated from the devices' undo history
 
         qint64 totalMemorySize;
         qint64 realMemorySize;
@@ -64,6 +80,15 @@ public:
         qint64 poolSize;
 
         qint64 swapSize;
+        qint64 swapOutThroughput; // bytes per second
+        qint64 swapInThroughput; // bytes per second
+
+        qint64 uniformTilesReclaimedSize;
+
+        qint64 historyCompressedSize; // the compressed undo data in memory
+        qint64 historyCompressedSwapSize; // the compressed undo data in swap
+        qint64 historyCompressionSavedSize;
+        qint32 numLostHistoryTiles; // the undo tiles that failed to decompress
 
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
@@ -71,6 +96,40 @@ public:
         qint64 tilesPoolLimit;
     };
 
+    /**
+     * The memory used by a single node, split into categories. The
+     * devices shared between several nodes are accounted for the first
+     * node only (in the depth-first order).
+     */
+    struct NodeStatistics
+    {
+        NodeStatistics()
+            : layerSize(0),
+              projectionSize(0),
+              lodSize(0),
+              framesSize(0),
+              onionSkinsSize(0),
+              historySize(0)
+        {
+        }
+
+        /**
+         * The total size of the node data excluding the undo
+         * history, which is shared with the undo stack
+         */
+        qint64 totalSize() const {
+            return layerSize + projectionSize + lodSize + framesSize + onionSkinsSize;
+        }
+
+        KisNodeSP node;
+
+        qint64 layerSize;
+        qint64 projectionSize;
+        qint64 lodSize;
+        qint64 framesSize;
+        qint64 onionSkinsSize;
+        qint64 historySize;
+    };
 
 
 public:
@@ -80,6 +139,12 @@ public:
 
     Statistics fetchMemoryStatistics(KisImageSP image) const;
 
+    /**
+     * Returns the memory breakdown for every node of \p image
+     * (including the root node) in the depth-first order
+     */
+    QVector<NodeStatistics> fetchNodeMemoryStatistics(KisImageSP image) const;
+
 public Q_SLOTS:
     void notifyImageChanged();
 
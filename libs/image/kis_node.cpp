@@ -44,6 +44,7 @@ typedef KisSafeReadList<KisNodeSP> KisSafeReadNodeList;
 #include "kis_projection_leaf.h"
 #include "kis_undo_adapter.h"
 #include "kis_keyframe_channel.h"
+#include "KisTileAlignedRegion.h"
 
 /**
  *The link between KisProjection and KisImageUpdater
@@ -596,6 +597,12 @@ void KisNode::setDirty(const QRegion &region)
     setDirty(region.rects());
 }
 
+void KisNode::setDirty(const KisTileAlignedRegion &region)
+{
+    // see a note in the header
+    setDirty(region.rects());
+}
+
 void KisNode::setDirty(const QRect & rect)
 {
     setDirty(QVector<QRect>({rect}));
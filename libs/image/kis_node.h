@@ -40,6 +40,7 @@ class KisProjectionLeaf;
 class KisKeyframeChannel;
 class KisTimeRange;
 class KisUndoAdapter;
+class KisTileAlignedRegion;
 
 
 /**
@@ -130,6 +131,19 @@ public:
      */
     void setDirty(const QRegion &region);
 
+    /**
+     * Add the given region to the set of dirty rects for this node.
+     * Use it for the regions accumulated from a lot of small rects,
+     * e.g. the dabs of a stroke.
+     *
+     * NOTE: the region is passed to the graph listener as a list
+     *       of its rects, because the update filters, the animation
+     *       cache and the wrap-around mode work with rects. The rects
+     *       are tile-aligned and don't overlap, so the update queue
+     *       gets a few of them instead of every dab.
+     */
+    void setDirty(const KisTileAlignedRegion &region);
+
     /**
      * Convenience override of multirect version of setDirtyDontResetAnimationCache()
      *
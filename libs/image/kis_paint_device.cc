@@ -424,13 +424,17 @@ private:
 
 public:
 
-    void estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData) const {
+    void estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData,
+                             qint64 &framesData, qint64 &historicalData) const {
         imageData = 0;
         temporaryData = 0;
         lodData = 0;
+        framesData = 0;
+        historicalData = 0;
 
         if (m_data) {
             imageData += estimateDataSize(m_data.data());
+            historicalData += m_data->dataManager()->estimateHistoricalMemorySize();
         }
 
         if (m_lodData) {
@@ -442,7 +446,8 @@ public:
         }
 
         Q_FOREACH (DataSP value, m_frames.values()) {
-            imageData += estimateDataSize(value.data());
+            framesData += estimateDataSize(value.data());
+            historicalData += value->dataManager()->estimateHistoricalMemorySize();
         }
     }
 
@@ -1132,7 +1137,17 @@ int KisPaintDevice::sequenceNumber() const
 
 void KisPaintDevice::estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData) const
 {
-    m_d->estimateMemoryStats(imageData, temporaryData, lodData);
+    qint64 framesData = 0;
+    qint64 historicalData = 0;
+
+    m_d->estimateMemoryStats(imageData, temporaryData, lodData, framesData, historicalData);
+    imageData += framesData;
+}
+
+void KisPaintDevice::estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData,
+                                         qint64 &framesData, qint64 &historicalData) const
+{
+    m_d->estimateMemoryStats(imageData, temporaryData, lodData, framesData, historicalData);
 }
 
 void KisPaintDevice::setParentNode(KisNodeWSP parent)
@@ -780,6 +780,15 @@ public:
 
     void estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData) const;
 
+    /**
+     * Same as above, but reports the data of the animation frames
+     * separately (\p framesData is not included into \p imageData) and
+     * estimates the size of the undo history of the device in
+     * \p historicalData.
+     */
+    void estimateMemoryStats(qint64 &imageData, qint64 &temporaryData, qint64 &lodData,
+                             qint64 &framesData, qint64 &historicalData) const;
+
 public:
 
     KisHLineIteratorSP createHLineIteratorNG(qint32 x, qint32 y, qint32 w);
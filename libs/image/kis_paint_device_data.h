@@ -64,7 +64,8 @@ public:
     KisPaintDeviceData(const KisPaintDeviceData *rhs, bool cloneContent)
         : m_dataManager(cloneContent ?
                         new KisDataManager(*rhs->m_dataManager) :
-                        new KisDataManager(rhs->m_dataManager->pixelSize(), rhs->m_dataManager->defaultPixel())),
+                        new KisDataManager(rhs->m_dataManager->pixelSize(), rhs->m_dataManager->defaultPixel(),
+                                           rhs->m_dataManager->tileWidth(), rhs->m_dataManager->tileHeight())),
           m_cache(rhs->m_cache),
           m_x(rhs->m_x),
           m_y(rhs->m_y),
@@ -154,7 +155,9 @@ public:
         memset(dstDefaultPixel.data(), 0, dstPixelSize);
         m_colorSpace->convertPixelsTo(m_dataManager->defaultPixel(), dstDefaultPixel.data(), dstColorSpace, 1, renderingIntent, conversionFlags);
 
-        KisDataManagerSP dstDataManager = new KisDataManager(dstPixelSize, dstDefaultPixel.data());
+        KisDataManagerSP dstDataManager =
+            new KisDataManager(dstPixelSize, dstDefaultPixel.data(),
+                               m_dataManager->tileWidth(), m_dataManager->tileHeight());
 
 
         if (!rc.isEmpty()) {
@@ -201,7 +204,8 @@ public:
             // NOTE: we don't check default pixel value! it is the task of
             //       the higher level!
 
-            m_dataManager = new KisDataManager(srcData->dataManager()->pixelSize(), srcData->dataManager()->defaultPixel());
+            m_dataManager = new KisDataManager(srcData->dataManager()->pixelSize(), srcData->dataManager()->defaultPixel(),
+                                               srcData->dataManager()->tileWidth(), srcData->dataManager()->tileHeight());
             m_cache.setupCache();
         } else {
             m_dataManager->clear();
@@ -334,6 +334,11 @@ KisKeyframeChannel *KisPaintLayer::requestKeyframeChannel(const QString &id)
     return KisLayer::requestKeyframeChannel(id);
 }
 
+KisPaintDeviceSP KisPaintLayer::onionSkinCacheDevice() const
+{
+    return m_d->onionSkinCache.lodCapableDevice();
+}
+
 KisPaintDeviceList KisPaintLayer::getLodCapableDevices() const
 {
     KisPaintDeviceList list = KisLayer::getLodCapableDevices();
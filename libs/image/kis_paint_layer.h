@@ -143,6 +143,12 @@ public:
      */
     void setOnionSkinEnabled(bool state);
 
+    /**
+     * @return the device where the onion skins of the layer are
+     * cached or null if they have not been rendered yet
+     */
+    KisPaintDeviceSP onionSkinCacheDevice() const;
+
     KisPaintDeviceList getLodCapableDevices() const override;
 
 public Q_SLOTS:
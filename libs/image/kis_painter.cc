@@ -407,8 +407,8 @@ KisTransaction* KisPainter::takeTransaction()
 
 QVector<QRect> KisPainter::takeDirtyRegion()
 {
-    QVector<QRect> vrect = d->dirtyRects;
-    d->dirtyRects.clear();
+    QVector<QRect> vrect = d->dirtyRegion.rects();
+    d->dirtyRegion.clear();
     return vrect;
 }
 
@@ -417,18 +417,16 @@ void KisPainter::addDirtyRect(const QRect & rc)
 {
     QRect r = rc.normalized();
     if (r.isValid()) {
-        d->dirtyRects.append(rc);
+        d->dirtyRegion.addRect(r);
     }
 }
 
 void KisPainter::addDirtyRects(const QVector<QRect> &rects)
 {
-    d->dirtyRects.reserve(d->dirtyRects.size() + rects.size());
-
     Q_FOREACH (const QRect &rc, rects) {
         const QRect r = rc.normalized();
         if (r.isValid()) {
-            d->dirtyRects.append(rc);
+            d->dirtyRegion.addRect(r);
         }
     }
 }
@@ -2937,7 +2935,7 @@ void KisPainter::renderDabWithMirroringNonIncremental(QRect rc, KisPaintDeviceSP
 
 bool KisPainter::hasDirtyRegion() const
 {
-    return !d->dirtyRects.isEmpty();
+    return !d->dirtyRegion.isEmpty();
 }
 
 void KisPainter::mirrorRect(Qt::Orientation direction, QRect *rc) const
@@ -439,6 +439,9 @@ public:
     /**
       * The methods in this class do not tell the paintdevice to update, but they calculate the
       * dirty area. This method returns this dirty area and resets it.
+      *
+      * The dirty rects are accumulated in a KisTileAlignedRegion, so the returned
+      * rects are already merged and do not overlap.
       */
     QVector<QRect> takeDirtyRegion();
 
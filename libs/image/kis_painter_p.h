@@ -29,6 +29,7 @@
 #include "kis_painter.h"
 #include "kis_paintop_preset.h"
 #include <KisFakeRunnableStrokeJobsExecutor.h>
+#include "KisTileAlignedRegion.h"
 
 struct Q_DECL_HIDDEN KisPainter::Private {
     Private(KisPainter *_q) : q(_q) {}
@@ -42,7 +43,7 @@ struct Q_DECL_HIDDEN KisPainter::Private {
     KisTransaction*             transaction;
     KoUpdater*                  progressUpdater;
 
-    QVector<QRect>              dirtyRects;
+    KisTileAlignedRegion        dirtyRegion;
     KisPaintOp*                 paintOp;
     KoColor                     paintColor;
     KoColor                     backgroundColor;
@@ -19,11 +19,17 @@
 #include "kis_simple_update_queue.h"
 
 #include <QMutexLocker>
+#include <QThread>
 #include <QVector>
 
 #include "kis_image_config.h"
 #include "kis_full_refresh_walker.h"
 #include "kis_spontaneous_job.h"
+#include "kis_projection_leaf.h"
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "KisTileAlignedRegion.h"
 
 
 //#define ENABLE_DEBUG_JOIN
@@ -53,8 +59,27 @@
 #endif /* ENABLE_ACCUMULATOR */
 
 
+namespace {
+/**
+ * The range of the patch sizes the adaptive mode chooses from. All
+ * of them are multiples of the tile size.
+ */
+const int minimalAdaptivePatchSize = 64;
+const int maximalAdaptivePatchSize = 4096;
+
+/**
+ * A smaller patch size is chosen only if it is predicted to be
+ * faster by this ratio, because the prediction doesn't count the
+ * conflicts between the neighbouring patches
+ */
+const qreal adaptivePatchGainThreshold = 0.95;
+}
+
 KisSimpleUpdateQueue::KisSimpleUpdateQueue()
-    : m_overrideLevelOfDetail(-1)
+    : m_adaptivePatches(false),
+      m_costModel(new KisUpdateCostModel()),
+      m_threadsLimit(qMax(1, QThread::idealThreadCount())),
+      m_overrideLevelOfDetail(-1)
 {
     updateSettings();
 }
@@ -80,6 +105,8 @@ void KisSimpleUpdateQueue::updateSettings()
     m_maxCollectAlpha = config.maxCollectAlpha();
     m_maxMergeAlpha = config.maxMergeAlpha();
     m_maxMergeCollectAlpha = config.maxMergeCollectAlpha();
+
+    m_adaptivePatches = config.adaptiveUpdatePatches();
 }
 
 int KisSimpleUpdateQueue::overrideLevelOfDetail() const
@@ -87,10 +114,17 @@ int KisSimpleUpdateQueue::overrideLevelOfDetail() const
     return m_overrideLevelOfDetail;
 }
 
+KisUpdateCostModelSP KisSimpleUpdateQueue::costModel() const
+{
+    return m_costModel;
+}
+
 void KisSimpleUpdateQueue::processQueue(KisUpdaterContext &updaterContext)
 {
     updaterContext.lock();
 
+    m_threadsLimit.store(updaterContext.threadsLimit());
+
     while(updaterContext.hasSpareThread() &&
           processOneJob(updaterContext));
 
@@ -157,7 +191,22 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
 
 void KisSimpleUpdateQueue::addUpdateJob(KisNodeSP node, const QVector<QRect> &rects, const QRect& cropRect, int levelOfDetail)
 {
-    addJob(node, rects, cropRect, levelOfDetail, KisBaseRectsWalker::UPDATE);
+    /**
+     * The strokes report thousands of overlapping dab rects at once.
+     * Merging them one-by-one with tryMergeJob() scans the whole
+     * queue for every rect, so they are folded into a compact region
+     * first.
+     */
+    if (rects.size() > 1) {
+        addUpdateJob(node, KisTileAlignedRegion(rects), cropRect, levelOfDetail);
+    } else {
+        addJob(node, rects, cropRect, levelOfDetail, KisBaseRectsWalker::UPDATE);
+    }
+}
+
+void KisSimpleUpdateQueue::addUpdateJob(KisNodeSP node, const KisTileAlignedRegion &region, const QRect& cropRect, int levelOfDetail)
+{
+    addJob(node, region.rects(), cropRect, levelOfDetail, KisBaseRectsWalker::UPDATE);
 }
 
 void KisSimpleUpdateQueue::addUpdateJob(KisNodeSP node, const QRect &rc, const QRect& cropRect, int levelOfDetail)
@@ -202,7 +251,12 @@ void KisSimpleUpdateQueue::addJob(KisNodeSP node, const QVector<QRect> &rects,
         }
         /* else if(type == KisBaseRectsWalker::UNSUPPORTED) fatalKrita; */
 
+        if (m_adaptivePatches) {
+            walker->setCostModel(m_costModel);
+        }
+
         walker->collectRects(node, rc);
+        prefetchSwappedTiles(walker);
         walkers.append(walker);
     }
 
@@ -213,6 +267,36 @@ void KisSimpleUpdateQueue::addJob(KisNodeSP node, const QVector<QRect> &rects,
     }
 }
 
+void KisSimpleUpdateQueue::prefetchSwappedTiles(KisBaseRectsWalkerSP walker)
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    if (!store->numTilesSwapped()) return;
+
+    /**
+     * The devices of the scaled-down planes are small and are
+     * selected per-thread, so only the full-scale updates are
+     * prefetched
+     */
+    if (walker->levelOfDetail() > 0) return;
+
+    Q_FOREACH (const KisBaseRectsWalker::JobItem &item, walker->leafStack()) {
+        if (item.m_applyRect.isEmpty()) continue;
+
+        KisPaintDeviceSP original = item.m_leaf->original();
+        KisPaintDeviceSP projection = item.m_leaf->projection();
+
+        if (original) {
+            store->prefetchTileData(original->dataManager(),
+                                    item.m_applyRect.translated(-original->x(), -original->y()));
+        }
+
+        if (projection && projection != original) {
+            store->prefetchTileData(projection->dataManager(),
+                                    item.m_applyRect.translated(-projection->x(), -projection->y()));
+        }
+    }
+}
+
 void KisSimpleUpdateQueue::addSpontaneousJob(KisSpontaneousJob *spontaneousJob)
 {
     QMutexLocker locker(&m_lock);
@@ -251,23 +335,32 @@ bool KisSimpleUpdateQueue::trySplitJob(KisNodeSP node, const QRect& rc,
                                        int levelOfDetail,
                                        KisBaseRectsWalker::UpdateType type)
 {
-    if(rc.width() <= m_patchWidth || rc.height() <= m_patchHeight)
+    QSize patchSize(m_patchWidth, m_patchHeight);
+
+    if (m_adaptivePatches) {
+        patchSize = adaptivePatchSize(node, rc, patchSize);
+    }
+
+    const qint32 patchWidth = patchSize.width();
+    const qint32 patchHeight = patchSize.height();
+
+    if(rc.width() <= patchWidth || rc.height() <= patchHeight)
         return false;
 
     // a bit of recursive splitting...
 
-    qint32 firstCol = rc.x() / m_patchWidth;
-    qint32 firstRow = rc.y() / m_patchHeight;
+    qint32 firstCol = rc.x() / patchWidth;
+    qint32 firstRow = rc.y() / patchHeight;
 
-    qint32 lastCol = (rc.x() + rc.width()) / m_patchWidth;
-    qint32 lastRow = (rc.y() + rc.height()) / m_patchHeight;
+    qint32 lastCol = (rc.x() + rc.width()) / patchWidth;
+    qint32 lastRow = (rc.y() + rc.height()) / patchHeight;
 
     QVector<QRect> splitRects;
 
     for(qint32 i = firstRow; i <= lastRow; i++) {
         for(qint32 j = firstCol; j <= lastCol; j++) {
-            QRect maxPatchRect(j * m_patchWidth, i * m_patchHeight,
-                               m_patchWidth, m_patchHeight);
+            QRect maxPatchRect(j * patchWidth, i * patchHeight,
+                               patchWidth, patchHeight);
             QRect patchRect = rc & maxPatchRect;
             splitRects.append(patchRect);
         }
@@ -279,6 +372,47 @@ bool KisSimpleUpdateQueue::trySplitJob(KisNodeSP node, const QRect& rc,
     return true;
 }
 
+QSize KisSimpleUpdateQueue::adaptivePatchSize(KisNodeSP node, const QRect &rc, const QSize &defaultSize) const
+{
+    const qint64 area = qint64(rc.width()) * rc.height();
+
+    qreal bestTime = 0.0;
+    if (!m_costModel->predictCost(node, area, &bestTime)) {
+        return defaultSize;
+    }
+
+    const int numThreads = qMax(1, m_threadsLimit.load());
+    int bestPatchSize = maximalAdaptivePatchSize;
+
+    /**
+     * The patches are executed in waves of numThreads jobs, so the
+     * predicted wall time is the number of waves multiplied by the
+     * time of a single patch
+     */
+    for (int patchSize = maximalAdaptivePatchSize / 2;
+         patchSize >= minimalAdaptivePatchSize;
+         patchSize /= 2) {
+
+        const int numCols = (rc.x() + rc.width()) / patchSize - rc.x() / patchSize + 1;
+        const int numRows = (rc.y() + rc.height()) / patchSize - rc.y() / patchSize + 1;
+        const int numPatches = numCols * numRows;
+        const qint64 patchArea = qMin(qint64(patchSize) * patchSize, area);
+
+        qreal patchTime = 0.0;
+        if (!m_costModel->predictCost(node, patchArea, &patchTime)) break;
+
+        const int numWaves = (numPatches + numThreads - 1) / numThreads;
+        const qreal time = numWaves * patchTime;
+
+        if (time < adaptivePatchGainThreshold * bestTime) {
+            bestTime = time;
+            bestPatchSize = patchSize;
+        }
+    }
+
+    return QSize(bestPatchSize, bestPatchSize);
+}
+
 bool KisSimpleUpdateQueue::tryMergeJob(KisNodeSP node, const QRect& rc,
                                        const QRect& cropRect,
                                        int levelOfDetail,
@@ -307,7 +441,7 @@ bool KisSimpleUpdateQueue::tryMergeJob(KisNodeSP node, const QRect& rc,
         if(item->cropRect() != cropRect) continue;
         if(item->levelOfDetail() != levelOfDetail) continue;
 
-        if(joinRects(baseRect, item->requestedRect(), m_maxMergeAlpha)) {
+        if(joinRects(baseRect, item->requestedRect(), m_maxMergeAlpha, node)) {
             goodCandidate = item;
             break;
         }
@@ -347,7 +481,7 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
         if(item->cropRect() != baseWalker->cropRect()) continue;
         if(item->levelOfDetail() != baseWalker->levelOfDetail()) continue;
 
-        if(joinRects(baseRect, item->requestedRect(), maxAlpha)) {
+        if(joinRects(baseRect, item->requestedRect(), maxAlpha, baseWalker->startNode())) {
             iter.remove();
         }
     }
@@ -358,11 +492,10 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
 }
 
 bool KisSimpleUpdateQueue::joinRects(QRect& baseRect,
-                                     const QRect& newRect, qreal maxAlpha)
+                                     const QRect& newRect, qreal maxAlpha,
+                                     KisNodeSP node)
 {
     QRect unitedRect = baseRect | newRect;
-    if(unitedRect.width() > m_patchWidth || unitedRect.height() > m_patchHeight)
-        return false;
 
     bool result = false;
     qint64 baseWork = baseRect.width() * baseRect.height() +
@@ -372,7 +505,43 @@ bool KisSimpleUpdateQueue::joinRects(QRect& baseRect,
 
     qreal alpha = qreal(newWork) / baseWork;
 
-    if(alpha < maxAlpha) {
+    qreal baseCost = 0.0;
+    qreal newCost = 0.0;
+    qreal unitedCost = 0.0;
+
+    bool shouldJoin = false;
+
+    /**
+     * When the cost model has enough samples, it decides alone, so
+     * the rects may be joined beyond the static patch size when it
+     * pays off. The costs are measured per walker, i.e. for the whole
+     * graph walk starting at \p node, not for every node separately.
+     */
+    if (m_adaptivePatches &&
+        m_costModel->predictCost(node, qint64(baseRect.width()) * baseRect.height(), &baseCost) &&
+        m_costModel->predictCost(node, qint64(newRect.width()) * newRect.height(), &newCost) &&
+        m_costModel->predictCost(node, newWork, &unitedCost)) {
+
+        /**
+         * The separate updates can be executed in parallel only
+         * if they don't overlap, otherwise they will wait for
+         * each other anyway
+         */
+        const bool canRunInParallel =
+            m_threadsLimit.load() > 1 && !baseRect.intersects(newRect);
+
+        const qreal separateCost = canRunInParallel ?
+            qMax(baseCost, newCost) : baseCost + newCost;
+
+        shouldJoin = unitedCost <= separateCost;
+    } else {
+        shouldJoin =
+            unitedRect.width() <= m_patchWidth &&
+            unitedRect.height() <= m_patchHeight &&
+            alpha < maxAlpha;
+    }
+
+    if(shouldJoin) {
         DEBUG_JOIN(baseRect, newRect, alpha);
 
         DECLARE_ACCUMULATOR();
@@ -21,6 +21,9 @@
 
 #include <QMutex>
 #include "kis_updater_context.h"
+#include "kis_update_cost_model.h"
+
+class KisTileAlignedRegion;
 
 typedef QList<KisBaseRectsWalkerSP> KisWalkersList;
 typedef QListIterator<KisBaseRectsWalkerSP> KisWalkersListIterator;
@@ -40,6 +43,7 @@ public:
     void processQueue(KisUpdaterContext &updaterContext);
 
     void addUpdateJob(KisNodeSP node, const QVector<QRect> &rects, const QRect& cropRect, int levelOfDetail);
+    void addUpdateJob(KisNodeSP node, const KisTileAlignedRegion &region, const QRect& cropRect, int levelOfDetail);
     void addUpdateJob(KisNodeSP node, const QRect &rc, const QRect& cropRect, int levelOfDetail);
     void addUpdateNoFilthyJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail);
     void addFullRefreshJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail);
@@ -55,9 +59,22 @@ public:
 
     int overrideLevelOfDetail() const;
 
+    /**
+     * The costs of the updates learned in the adaptive mode
+     * \see KisImageConfig::adaptiveUpdatePatches()
+     */
+    KisUpdateCostModelSP costModel() const;
+
 protected:
     void addJob(KisNodeSP node, const QVector<QRect> &rects, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
 
+    /**
+     * Announces the areas the walker is going to touch to the tile
+     * swapper, so that the swapped tiles are read back before the
+     * walker is actually executed
+     */
+    void prefetchSwappedTiles(KisBaseRectsWalkerSP walker);
+
     bool processOneJob(KisUpdaterContext &updaterContext);
 
     bool trySplitJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
@@ -65,7 +82,14 @@ protected:
 
     void collectJobs(KisBaseRectsWalkerSP &baseWalker, QRect baseRect,
                      const qreal maxAlpha);
-    bool joinRects(QRect& baseRect, const QRect& newRect, qreal maxAlpha);
+    bool joinRects(QRect& baseRect, const QRect& newRect, qreal maxAlpha, KisNodeSP node);
+
+    /**
+     * Chooses the patch size that minimizes the predicted time of
+     * updating \p rc with the current number of threads. Returns
+     * \p defaultSize if the cost of the node is not known yet.
+     */
+    QSize adaptivePatchSize(KisNodeSP node, const QRect &rc, const QSize &defaultSize) const;
 
 protected:
 
@@ -102,6 +126,21 @@ protected:
      */
     qreal m_maxMergeCollectAlpha;
 
+    /**
+     * In the adaptive mode the walkers report their execution time
+     * to m_costModel, and the patch size and the merging of the jobs
+     * are decided by the predicted costs instead of the static
+     * parameters above
+     */
+    bool m_adaptivePatches;
+    KisUpdateCostModelSP m_costModel;
+
+    /**
+     * The number of threads of the updater context, as seen
+     * by the last call to processQueue()
+     */
+    QAtomicInt m_threadsLimit;
+
     int m_overrideLevelOfDetail;
 };
 
@@ -19,6 +19,7 @@
 #include "kis_stroke.h"
 
 #include "kis_stroke_strategy.h"
+#include "kis_node.h"
 
 
 KisStroke::KisStroke(KisStrokeStrategy *strokeStrategy, Type type, int levelOfDetail)
@@ -272,6 +273,16 @@ qreal KisStroke::balancingRatioOverride() const
     return m_strokeStrategy->balancingRatioOverride();
 }
 
+KisStrokeStrategy::Priority KisStroke::priority() const
+{
+    return m_strokeStrategy->priority();
+}
+
+KisNodeList KisStroke::affectedNodes() const
+{
+    return m_strokeStrategy->affectedNodes();
+}
+
 KisStrokeJobData::Sequentiality KisStroke::nextJobSequentiality() const
 {
     return !m_jobsQueue.isEmpty() ?
@@ -25,8 +25,8 @@
 #include <kis_types.h>
 #include "kritaimage_export.h"
 #include "kis_stroke_job.h"
+#include "kis_stroke_strategy.h"
 
-class KisStrokeStrategy;
 class KUndo2MagicString;
 
 
@@ -70,6 +70,8 @@ public:
     int worksOnLevelOfDetail() const;
     bool canForgetAboutMe() const;
     qreal balancingRatioOverride() const;
+    KisStrokeStrategy::Priority priority() const;
+    KisNodeList affectedNodes() const;
 
     KisStrokeJobData::Sequentiality nextJobSequentiality() const;
 
@@ -19,6 +19,8 @@
 #ifndef __KIS_STROKE_JOB_H
 #define __KIS_STROKE_JOB_H
 
+#include <QElapsedTimer>
+
 #include "kis_runnable.h"
 #include "kis_stroke_job_strategy.h"
 
@@ -34,6 +36,7 @@ public:
           m_levelOfDetail(levelOfDetail),
           m_isOwnJob(isOwnJob)
     {
+        m_queuedTime.start();
     }
 
     ~KisStrokeJob() override {
@@ -75,6 +78,13 @@ public:
         return m_isOwnJob;
     }
 
+    /**
+     * The time the job has spent in the strokes queue
+     */
+    qint64 nsecsQueued() const {
+        return m_queuedTime.nsecsElapsed();
+    }
+
 private:
     // for testing use only, do not use in real code
     friend QString getJobName(KisStrokeJob *job);
@@ -98,6 +108,8 @@ private:
 
     int m_levelOfDetail;
     bool m_isOwnJob;
+
+    QElapsedTimer m_queuedTime;
 };
 
 #endif /* __KIS_STROKE_JOB_H */
@@ -18,6 +18,7 @@
 
 #include "kis_stroke_strategy.h"
 #include <KoCompositeOpRegistry.h>
+#include "kis_node.h"
 #include "kis_stroke_job_strategy.h"
 #include "KisStrokesQueueMutatedJobInterface.h"
 
@@ -30,6 +31,7 @@ KisStrokeStrategy::KisStrokeStrategy(QString id, const KUndo2MagicString &name)
       m_canForgetAboutMe(false),
       m_needsExplicitCancel(false),
       m_balancingRatioOverride(-1.0),
+      m_priority(NORMAL),
       m_id(id),
       m_name(name),
       m_mutatedJobsInterface(0)
@@ -44,6 +46,8 @@ KisStrokeStrategy::KisStrokeStrategy(const KisStrokeStrategy &rhs)
       m_canForgetAboutMe(rhs.m_canForgetAboutMe),
       m_needsExplicitCancel(rhs.m_needsExplicitCancel),
       m_balancingRatioOverride(rhs.m_balancingRatioOverride),
+      m_priority(rhs.m_priority),
+      m_affectedNodes(rhs.m_affectedNodes),
       m_id(rhs.m_id),
       m_name(rhs.m_name),
       m_mutatedJobsInterface(0)
@@ -224,3 +228,23 @@ void KisStrokeStrategy::setBalancingRatioOverride(qreal value)
 {
     m_balancingRatioOverride = value;
 }
+
+KisStrokeStrategy::Priority KisStrokeStrategy::priority() const
+{
+    return m_priority;
+}
+
+void KisStrokeStrategy::setPriority(Priority value)
+{
+    m_priority = value;
+}
+
+KisNodeList KisStrokeStrategy::affectedNodes() const
+{
+    return m_affectedNodes;
+}
+
+void KisStrokeStrategy::setAffectedNodes(const KisNodeList &nodes)
+{
+    m_affectedNodes = nodes;
+}
@@ -31,6 +31,27 @@ class KisStrokesQueueMutatedJobInterface;
 
 class KRITAIMAGE_EXPORT KisStrokeStrategy
 {
+public:
+    /**
+     * The priority of the stroke in the strokes queue.
+     *
+     * A BACKGROUND stroke yields to the INTERACTIVE strokes queued
+     * after it. The strokes queue preempts it at a job boundary if the
+     * two strokes modify different nodes, \see setAffectedNodes(). A
+     * started stroke is preempted only if it also supports suspension
+     * (has suspend and resume jobs).
+     *
+     * NOTE: only the legacy strokes are preempted. With LoD enabled
+     *       the strokes are split into LOD0/LODN pairs and the
+     *       priority has no effect.
+     * \see KisStrokesQueue
+     */
+    enum Priority {
+        BACKGROUND,
+        NORMAL,
+        INTERACTIVE
+    };
+
 public:
     KisStrokeStrategy(QString id = QString(), const KUndo2MagicString &name = KUndo2MagicString());
     virtual ~KisStrokeStrategy();
@@ -109,6 +130,16 @@ public:
      */
     qreal balancingRatioOverride() const;
 
+    /**
+     * \see setPriority() for details
+     */
+    Priority priority() const;
+
+    /**
+     * \see setAffectedNodes() for details
+     */
+    KisNodeList affectedNodes() const;
+
     QString id() const;
     KUndo2MagicString name() const;
 
@@ -183,6 +214,21 @@ protected:
      */
     void setBalancingRatioOverride(qreal value);
 
+    /**
+     * Sets the priority of the stroke. The default is NORMAL.
+     */
+    void setPriority(Priority value);
+
+    /**
+     * Declares the nodes modified by the stroke. The default empty
+     * list means that the stroke may modify any node of the image.
+     *
+     * A background stroke, started or not, can be preempted only by
+     * the strokes that modify neither these nodes nor their parents
+     * or children. Otherwise the user's actions would be reordered.
+     */
+    void setAffectedNodes(const KisNodeList &nodes);
+
 protected:
     /**
      * Protected c-tor, used for cloning of hi-level strategies
@@ -198,6 +244,8 @@ private:
     bool m_canForgetAboutMe;
     bool m_needsExplicitCancel;
     qreal m_balancingRatioOverride;
+    Priority m_priority;
+    KisNodeList m_affectedNodes;
 
     QString m_id;
     KUndo2MagicString m_name;
@@ -27,11 +27,22 @@
 #include "kis_stroke_strategy.h"
 #include "kis_undo_stores.h"
 #include "kis_post_execution_undo_adapter.h"
+#include "kis_trace_recorder.h"
 
 typedef QQueue<KisStrokeSP> StrokesQueue;
 typedef QQueue<KisStrokeSP>::iterator StrokesQueueIterator;
 
+namespace {
+/**
+ * The adaptive level of detail is not changed
+ * by the strokes with fewer jobs
+ */
+const int minimalNumLatencySamples = 3;
+}
+
 #include "kis_image_interfaces.h"
+#include "kis_node.h"
+#include "kis_layer_utils.h"
 class KisStrokesQueue::LodNUndoStrokesFacade : public KisStrokesFacade
 {
 public:
@@ -81,6 +92,13 @@ struct Q_DECL_HIDDEN KisStrokesQueue::Private {
           lodNNeedsSynchronization(true),
           desiredLevelOfDetail(0),
           nextDesiredLevelOfDetail(0),
+          requestedLevelOfDetail(0),
+          adaptiveLodEnabled(false),
+          adaptiveLodAllowed(true),
+          adaptiveLodLatencyTarget(0),
+          adaptiveLodRecoveryLatency(0),
+          adaptiveLodMaxLevel(0),
+          adaptiveLevelOfDetail(0),
           lodNStrokesFacade(_q),
           lodNPostExecutionUndoAdapter(&lodNUndoStore, &lodNStrokesFacade) {}
 
@@ -95,6 +113,23 @@ struct Q_DECL_HIDDEN KisStrokesQueue::Private {
     bool lodNNeedsSynchronization;
     int desiredLevelOfDetail;
     int nextDesiredLevelOfDetail;
+
+    /**
+     * The level of detail requested by the zoom of the canvas,
+     * the adaptive mode may only make it coarser
+     */
+    int requestedLevelOfDetail;
+
+    bool adaptiveLodEnabled;
+    bool adaptiveLodAllowed;
+    qint64 adaptiveLodLatencyTarget;
+    qint64 adaptiveLodRecoveryLatency;
+    int adaptiveLodMaxLevel;
+    int adaptiveLevelOfDetail;
+
+    KisStrokeWSP measuredStroke;
+    KisStrokeLatencyStatistics measuredStrokeLatency;
+
     QMutex mutex;
     KisLodSyncStrokeStrategyFactory lod0ToNStrokeStrategyFactory;
     KisSuspendResumeStrategyFactory suspendUpdatesStrokeStrategyFactory;
@@ -102,6 +137,7 @@ struct Q_DECL_HIDDEN KisStrokesQueue::Private {
     KisSurrogateUndoStore lodNUndoStore;
     LodNUndoStrokesFacade lodNStrokesFacade;
     KisPostExecutionUndoAdapter lodNPostExecutionUndoAdapter;
+    KisStrokeLatencyStatistics interactiveLatency;
 
     void cancelForgettableStrokes();
     void startLod0ToNStroke(int levelOfDetail, bool forgettable);
@@ -114,6 +150,15 @@ struct Q_DECL_HIDDEN KisStrokesQueue::Private {
     void switchDesiredLevelOfDetail(bool forced);
     bool hasUnfinishedStrokes() const;
     void tryClearUndoOnStrokeCompletion(KisStrokeSP finishingStroke);
+
+    int findPreemptingStroke() const;
+    static bool modifyDifferentNodes(KisStrokeSP stroke1, KisStrokeSP stroke2);
+    void preemptBackgroundStroke(int preemptingStrokeIndex);
+    void resetCurrentStrokeProperties();
+
+    void recordInteractiveLatency(KisStrokeSP stroke, qint64 latency);
+    void updateAdaptiveLevelOfDetail(KisStrokeSP finishedStroke);
+    void updateNextDesiredLevelOfDetail();
 };
 
 
@@ -529,6 +574,180 @@ void KisStrokesQueue::Private::tryClearUndoOnStrokeCompletion(KisStrokeSP finish
     }
 }
 
+int KisStrokesQueue::Private::findPreemptingStroke() const
+{
+    KisStrokeSP head = strokesQueue.head();
+
+    /**
+     * Only the legacy strokes are reordered. When LoD is enabled the
+     * strokes are queued as LOD0/LODN pairs and are never preempted,
+     * their lodN part gives the user the feedback instead.
+     */
+    if (head->priority() != KisStrokeStrategy::BACKGROUND ||
+        head->type() != KisStroke::LEGACY ||
+        !head->hasJobs() ||
+        !head->supportsSuspension()) {
+
+        return -1;
+    }
+
+    /**
+     * The interactive stroke may also jump over the background
+     * strokes that haven't been started yet.
+     *
+     * Every stroke being jumped over must work on other nodes than
+     * the interactive one. A started stroke may keep a transaction
+     * open on its node (e.g. the filter stroke does), and an unstarted
+     * one is just the user's earlier action, e.g. a filter applied
+     * before painting on the same layer. Reordering them would corrupt
+     * either the undo history or the pixels.
+     */
+    for (int i = 1; i < strokesQueue.size(); i++) {
+        KisStrokeSP stroke = strokesQueue[i];
+
+        if (stroke->type() != KisStroke::LEGACY ||
+            stroke->isCancelled()) {
+
+            break;
+        }
+
+        if (stroke->priority() == KisStrokeStrategy::INTERACTIVE) {
+            if (!stroke->hasJobs()) return -1;
+
+            for (int j = 0; j < i; j++) {
+                if (!modifyDifferentNodes(strokesQueue[j], stroke)) {
+                    return -1;
+                }
+            }
+
+            return i;
+        }
+
+        if (stroke->priority() != KisStrokeStrategy::BACKGROUND ||
+            stroke->isInitialized()) {
+
+            break;
+        }
+    }
+
+    return -1;
+}
+
+bool KisStrokesQueue::Private::modifyDifferentNodes(KisStrokeSP stroke1, KisStrokeSP stroke2)
+{
+    const KisNodeList nodes1 = stroke1->affectedNodes();
+    const KisNodeList nodes2 = stroke2->affectedNodes();
+
+    // an empty list means the stroke may modify anything
+    if (nodes1.isEmpty() || nodes2.isEmpty()) return false;
+
+    Q_FOREACH (KisNodeSP node, nodes1) {
+        if (nodes2.contains(node) || KisLayerUtils::checkIsChildOf(node, nodes2)) {
+            return false;
+        }
+    }
+
+    Q_FOREACH (KisNodeSP node, nodes2) {
+        if (KisLayerUtils::checkIsChildOf(node, nodes1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void KisStrokesQueue::Private::preemptBackgroundStroke(int preemptingStrokeIndex)
+{
+    KisStrokeSP head = strokesQueue.head();
+    KisStrokeSP stroke = strokesQueue[preemptingStrokeIndex];
+
+    // does nothing if the head stroke has not been started yet
+    head->suspendStroke(stroke);
+
+    strokesQueue.move(preemptingStrokeIndex, 0);
+    resetCurrentStrokeProperties();
+
+    interactiveLatency.numPreemptions++;
+}
+
+void KisStrokesQueue::Private::resetCurrentStrokeProperties()
+{
+    needsExclusiveAccess = false;
+    wrapAroundModeSupported = false;
+    balancingRatioOverride = -1.0;
+    currentStrokeLoaded = false;
+}
+
+void KisStrokesQueue::Private::recordInteractiveLatency(KisStrokeSP stroke, qint64 latency)
+{
+    interactiveLatency.numJobs++;
+    interactiveLatency.totalLatencyNs += latency;
+    interactiveLatency.maxLatencyNs = qMax(interactiveLatency.maxLatencyNs, latency);
+
+    if (measuredStroke != stroke) {
+        measuredStroke = stroke;
+        measuredStrokeLatency = KisStrokeLatencyStatistics();
+    }
+
+    measuredStrokeLatency.numJobs++;
+    measuredStrokeLatency.totalLatencyNs += latency;
+    measuredStrokeLatency.maxLatencyNs = qMax(measuredStrokeLatency.maxLatencyNs, latency);
+}
+
+void KisStrokesQueue::Private::updateAdaptiveLevelOfDetail(KisStrokeSP finishedStroke)
+{
+    if (measuredStroke != finishedStroke) return;
+
+    const KisStrokeLatencyStatistics latency = measuredStrokeLatency;
+    const int strokeLevelOfDetail = finishedStroke->worksOnLevelOfDetail();
+
+    measuredStroke.clear();
+    measuredStrokeLatency = KisStrokeLatencyStatistics();
+
+    /**
+     * The stroke should have been painted with the level chosen
+     * by the adaptive mode, otherwise the measurement says
+     * nothing about the current level
+     */
+    if (!adaptiveLodEnabled || !adaptiveLodAllowed ||
+        latency.numJobs < minimalNumLatencySamples ||
+        strokeLevelOfDetail != desiredLevelOfDetail) {
+
+        return;
+    }
+
+    const qreal averageLatency = latency.averageLatencyNs();
+    const int coarserLevelOfDetail = qMax(adaptiveLevelOfDetail, strokeLevelOfDetail) + 1;
+
+    /**
+     * Every level of detail halves both dimensions of the image, so
+     * the finer level has four times more pixels to process and its
+     * latency is predicted as four times the measured one
+     */
+    const qreal predictedFinerLatency = 4.0 * averageLatency;
+
+    if (averageLatency > adaptiveLodLatencyTarget &&
+        coarserLevelOfDetail <= adaptiveLodMaxLevel) {
+
+        adaptiveLevelOfDetail = coarserLevelOfDetail;
+
+    } else if (adaptiveLevelOfDetail > 0 &&
+               predictedFinerLatency < adaptiveLodRecoveryLatency) {
+
+        adaptiveLevelOfDetail--;
+    }
+
+    updateNextDesiredLevelOfDetail();
+}
+
+void KisStrokesQueue::Private::updateNextDesiredLevelOfDetail()
+{
+    nextDesiredLevelOfDetail =
+        adaptiveLodEnabled && adaptiveLodAllowed ?
+        qMax(requestedLevelOfDetail, adaptiveLevelOfDetail) :
+        requestedLevelOfDetail;
+}
+
 void KisStrokesQueue::processQueue(KisUpdaterContext &updaterContext,
                                    bool externalJobsPending)
 {
@@ -604,12 +823,56 @@ void KisStrokesQueue::setDesiredLevelOfDetail(int lod)
 {
     QMutexLocker locker(&m_d->mutex);
 
-    if (lod == m_d->nextDesiredLevelOfDetail) return;
+    if (lod == m_d->requestedLevelOfDetail) return;
+
+    m_d->requestedLevelOfDetail = lod;
+    m_d->updateNextDesiredLevelOfDetail();
+    m_d->switchDesiredLevelOfDetail(false);
+}
+
+void KisStrokesQueue::setAdaptiveLevelOfDetail(bool enabled,
+                                               qint64 latencyTargetNs,
+                                               qint64 recoveryLatencyNs,
+                                               int maxLevelOfDetail)
+{
+    QMutexLocker locker(&m_d->mutex);
+
+    m_d->adaptiveLodEnabled = enabled;
+    m_d->adaptiveLodLatencyTarget = latencyTargetNs;
+    m_d->adaptiveLodRecoveryLatency = recoveryLatencyNs;
+    m_d->adaptiveLodMaxLevel = maxLevelOfDetail;
+
+    if (!enabled) {
+        m_d->adaptiveLevelOfDetail = 0;
+    }
+
+    m_d->adaptiveLevelOfDetail =
+        qBound(0, m_d->adaptiveLevelOfDetail, maxLevelOfDetail);
 
-    m_d->nextDesiredLevelOfDetail = lod;
+    m_d->updateNextDesiredLevelOfDetail();
     m_d->switchDesiredLevelOfDetail(false);
 }
 
+void KisStrokesQueue::setAdaptiveLevelOfDetailAllowed(bool value)
+{
+    QMutexLocker locker(&m_d->mutex);
+
+    m_d->adaptiveLodAllowed = value;
+
+    if (!value) {
+        m_d->adaptiveLevelOfDetail = 0;
+    }
+
+    m_d->updateNextDesiredLevelOfDetail();
+    m_d->switchDesiredLevelOfDetail(false);
+}
+
+int KisStrokesQueue::adaptiveLevelOfDetail() const
+{
+    QMutexLocker locker(&m_d->mutex);
+    return m_d->adaptiveLevelOfDetail;
+}
+
 void KisStrokesQueue::notifyUFOChangedImage()
 {
     QMutexLocker locker(&m_d->mutex);
@@ -628,6 +891,18 @@ void KisStrokesQueue::debugDumpAllStrokes()
     qDebug() <<"===";
 }
 
+KisStrokeLatencyStatistics KisStrokesQueue::interactiveLatency() const
+{
+    QMutexLocker locker(&m_d->mutex);
+    return m_d->interactiveLatency;
+}
+
+void KisStrokesQueue::resetInteractiveLatency()
+{
+    QMutexLocker locker(&m_d->mutex);
+    m_d->interactiveLatency = KisStrokeLatencyStatistics();
+}
+
 void KisStrokesQueue::setLod0ToNStrokeStrategyFactory(const KisLodSyncStrokeStrategyFactory &factory)
 {
     m_d->lod0ToNStrokeStrategyFactory = factory;
@@ -676,12 +951,40 @@ bool KisStrokesQueue::processOneJob(KisUpdaterContext &updaterContext,
                                  snapshot == HasMergeJob);
     const bool hasMergeJobs = snapshot & HasMergeJob;
 
+    const int preemptingStroke = m_d->findPreemptingStroke();
+
+    if (preemptingStroke > 0) {
+        /**
+         * The preemption is cooperative: the background stroke yields
+         * at a job boundary only, so no new jobs are started until
+         * its running jobs are finished
+         */
+        if (hasStrokeJobs) return false;
+
+        KisTraceScope trace("strokes", "preempt background stroke");
+        m_d->preemptBackgroundStroke(preemptingStroke);
+    }
+
     if(checkStrokeState(hasStrokeJobs, levelOfDetail) &&
        checkExclusiveProperty(hasMergeJobs, hasStrokeJobs) &&
        checkSequentialProperty(snapshot, externalJobsPending)) {
 
         KisStrokeSP stroke = m_d->strokesQueue.head();
-        updaterContext.addStrokeJob(stroke->popOneJob());
+        KisStrokeJob *job = stroke->popOneJob();
+
+        /**
+         * The LoD0 buddies of the strokes are executed in the background
+         * after their LoDN counterparts have been shown to the user
+         */
+        if (job &&
+            stroke->priority() == KisStrokeStrategy::INTERACTIVE &&
+            stroke->type() != KisStroke::LOD0) {
+
+            // only the time spent in the queue is measured, not the execution
+            m_d->recordInteractiveLatency(stroke, job->nsecsQueued());
+        }
+
+        updaterContext.addStrokeJob(job);
         result = true;
     }
 
@@ -741,12 +1044,10 @@ bool KisStrokesQueue::checkStrokeState(bool hasStrokeJobsRunning,
     }
     else if(stroke->isEnded() && !hasJobs && !hasStrokeJobsRunning) {
         m_d->tryClearUndoOnStrokeCompletion(stroke);
+        m_d->updateAdaptiveLevelOfDetail(stroke);
 
         m_d->strokesQueue.dequeue(); // deleted by shared pointer
-        m_d->needsExclusiveAccess = false;
-        m_d->wrapAroundModeSupported = false;
-        m_d->balancingRatioOverride = -1.0;
-        m_d->currentStrokeLoaded = false;
+        m_d->resetCurrentStrokeProperties();
 
         m_d->switchDesiredLevelOfDetail(false);
 
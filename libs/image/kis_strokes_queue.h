@@ -28,6 +28,7 @@
 #include "kis_strokes_queue_undo_result.h"
 #include "KisStrokesQueueMutatedJobInterface.h"
 #include "KisUpdaterContextSnapshotEx.h"
+#include "KisStrokeLatencyStatistics.h"
 
 
 class KisUpdaterContext;
@@ -67,6 +68,41 @@ public:
 
     void setDesiredLevelOfDetail(int lod);
     void explicitRegenerateLevelOfDetail();
+
+    /**
+     * In the adaptive mode the queue measures the average latency of
+     * the jobs of every interactive stroke. When it exceeds \p
+     * latencyTargetNs, the next strokes are painted on a coarser level
+     * of detail (up to \p maxLevelOfDetail), even if the zoom doesn't
+     * require it. The full-scale image is regenerated by the LoD0
+     * buddies of the strokes in the background as usual.
+     *
+     * The latency is the time a job waits in the strokes queue before
+     * it is given to a worker (KisStrokeJob::nsecsQueued()). The time
+     * of the job's execution and of the following canvas update is
+     * not counted.
+     *
+     * The level is lowered back when the latency predicted for the
+     * finer level is below \p recoveryLatencyNs. The prediction is
+     * four times the measured latency: every level of detail halves
+     * both dimensions of the image, so the finer level has four times
+     * more pixels to process.
+     */
+    void setAdaptiveLevelOfDetail(bool enabled,
+                                  qint64 latencyTargetNs,
+                                  qint64 recoveryLatencyNs,
+                                  int maxLevelOfDetail);
+
+    /**
+     * The adaptive mode is not used while the LoD functionality
+     * is blocked in the image
+     */
+    void setAdaptiveLevelOfDetailAllowed(bool value);
+
+    /**
+     * The level of detail chosen by the adaptive mode
+     */
+    int adaptiveLevelOfDetail() const;
     void setLod0ToNStrokeStrategyFactory(const KisLodSyncStrokeStrategyFactory &factory);
     void setSuspendUpdatesStrokeStrategyFactory(const KisSuspendResumeStrategyFactory &factory);
     void setResumeUpdatesStrokeStrategyFactory(const KisSuspendResumeStrategyFactory &factory);
@@ -81,6 +117,13 @@ public:
 
     void debugDumpAllStrokes();
 
+    /**
+     * Returns the statistics of the latency of the jobs of the
+     * interactive strokes collected since the last reset
+     */
+    KisStrokeLatencyStatistics interactiveLatency() const;
+    void resetInteractiveLatency();
+
     // interface for KisStrokeStrategy only!
     void addMutatedJobs(KisStrokeId id, const QVector<KisStrokeJobData*> list) final;
 
@@ -0,0 +1,357 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_trace_recorder.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+
+#include "kis_debug.h"
+
+Q_GLOBAL_STATIC(KisTraceRecorder, s_instance)
+
+/**
+ * KisTraceScope checks the flag before touching the instance, so it
+ * should be raised right on startup to let the environment variable
+ * work. The instance is created by the first recorded scope then.
+ */
+std::atomic<bool> KisTraceRecorder::s_enabled(!qEnvironmentVariableIsEmpty("KRITA_TRACE_FILE"));
+
+namespace {
+
+/**
+ * Limits the memory taken by a trace that has
+ * been forgotten enabled
+ */
+const int maxNumEvents = 1 << 20;
+const int maxNumEventsPerThread = 1 << 18;
+
+struct Event {
+    const char *category;
+    const char *name;
+    qint64 startTime;
+    qint64 endTime;
+    int threadId;
+    QString details;
+};
+
+}
+
+struct KisTraceRecorder::Private
+{
+    /**
+     * The events recorded by a single thread. The lock is taken by
+     * the owner thread on every event and by the other threads only
+     * when the trace is collected or restarted, so it is almost never
+     * contended.
+     */
+    struct ThreadBuffer {
+        ThreadBuffer(Private *_owner);
+        ~ThreadBuffer();
+
+        Private *owner;
+        int threadId;
+
+        QMutex lock;
+        QVector<Event> events;
+        int numDroppedEvents = 0;
+    };
+
+    QElapsedTimer clock;
+    QAtomicInteger<qint64> traceStartTime;
+
+    /**
+     * Guards the list of the buffers, the events of the exited
+     * threads and the thread names. Always taken before the lock
+     * of a buffer.
+     */
+    mutable QMutex lock;
+    QSet<ThreadBuffer*> allBuffers;
+    QVector<Event> retiredEvents;
+    int numRetiredDroppedEvents = 0;
+
+    QHash<Qt::HANDLE, int> threadIds;
+    QVector<QString> threadNames;
+
+    QString autoSaveFileName;
+
+    /**
+     * Declared last to be destroyed first: the buffers of the threads
+     * exiting after that are not deleted anymore, so they don't touch
+     * the members being destroyed
+     */
+    QThreadStorage<ThreadBuffer*> buffers;
+
+    int threadIdImpl();
+    ThreadBuffer* currentBuffer();
+    QVector<Event> collectEvents() const;
+};
+
+KisTraceRecorder::Private::ThreadBuffer::ThreadBuffer(Private *_owner)
+    : owner(_owner)
+{
+    QMutexLocker l(&owner->lock);
+    threadId = owner->threadIdImpl();
+    owner->allBuffers.insert(this);
+}
+
+KisTraceRecorder::Private::ThreadBuffer::~ThreadBuffer()
+{
+    /**
+     * The thread has exited, keep its events
+     * until the trace is saved
+     */
+    QMutexLocker l(&owner->lock);
+    owner->allBuffers.remove(this);
+
+    const int numEventsToKeep =
+        qMin(events.size(), maxNumEvents - owner->retiredEvents.size());
+
+    owner->retiredEvents += events.mid(0, numEventsToKeep);
+    owner->numRetiredDroppedEvents +=
+        numDroppedEvents + events.size() - numEventsToKeep;
+}
+
+int KisTraceRecorder::Private::threadIdImpl()
+{
+    const Qt::HANDLE handle = QThread::currentThreadId();
+
+    auto it = threadIds.constFind(handle);
+    if (it != threadIds.constEnd()) return *it;
+
+    const int id = threadNames.size();
+    threadIds.insert(handle, id);
+
+    QThread *thread = QThread::currentThread();
+    QString name = thread ? thread->objectName() : QString();
+
+    if (name.isEmpty()) {
+        name = thread && QCoreApplication::instance() &&
+            thread == QCoreApplication::instance()->thread() ?
+            QString("GUI thread") : QString("Thread %1").arg(id);
+    }
+
+    threadNames.append(name);
+
+    return id;
+}
+
+KisTraceRecorder::Private::ThreadBuffer* KisTraceRecorder::Private::currentBuffer()
+{
+    ThreadBuffer *buffer = buffers.localData();
+
+    if (!buffer) {
+        buffer = new ThreadBuffer(this);
+        buffers.setLocalData(buffer);
+    }
+
+    return buffer;
+}
+
+QVector<Event> KisTraceRecorder::Private::collectEvents() const
+{
+    QVector<Event> result = retiredEvents;
+
+    Q_FOREACH (ThreadBuffer *buffer, allBuffers) {
+        QMutexLocker l(&buffer->lock);
+        result += buffer->events;
+    }
+
+    return result;
+}
+
+KisTraceRecorder::KisTraceRecorder()
+    : m_d(new Private)
+{
+    m_d->clock.start();
+
+    m_d->autoSaveFileName = QString::fromLocal8Bit(qgetenv("KRITA_TRACE_FILE"));
+    if (!m_d->autoSaveFileName.isEmpty()) {
+        setEnabled(true);
+    }
+}
+
+KisTraceRecorder::~KisTraceRecorder()
+{
+    /**
+     * The scopes must not access the instance
+     * after it has been destroyed
+     */
+    s_enabled = false;
+
+    if (!m_d->autoSaveFileName.isEmpty()) {
+        saveChromeTrace(m_d->autoSaveFileName);
+    }
+}
+
+KisTraceRecorder* KisTraceRecorder::instance()
+{
+    return s_instance;
+}
+
+void KisTraceRecorder::setEnabled(bool value)
+{
+    QMutexLocker l(&m_d->lock);
+
+    if (value && !s_enabled) {
+        m_d->retiredEvents.clear();
+        m_d->numRetiredDroppedEvents = 0;
+
+        Q_FOREACH (Private::ThreadBuffer *buffer, m_d->allBuffers) {
+            QMutexLocker bufferLocker(&buffer->lock);
+            buffer->events.clear();
+            buffer->numDroppedEvents = 0;
+        }
+
+        m_d->traceStartTime.storeRelease(m_d->clock.nsecsElapsed());
+    }
+
+    s_enabled = value;
+}
+
+qint64 KisTraceRecorder::currentTime() const
+{
+    return m_d->clock.nsecsElapsed();
+}
+
+void KisTraceRecorder::addEvent(const char *category, const char *name,
+                                qint64 startTime, qint64 endTime,
+                                const QString &details)
+{
+    Private::ThreadBuffer *buffer = m_d->currentBuffer();
+    QMutexLocker l(&buffer->lock);
+
+    /**
+     * The scope might have been started before the
+     * recorder was restarted
+     */
+    if (startTime < m_d->traceStartTime.loadAcquire()) return;
+
+    if (buffer->events.size() >= maxNumEventsPerThread) {
+        buffer->numDroppedEvents++;
+        return;
+    }
+
+    Event event;
+    event.category = category;
+    event.name = name;
+    event.startTime = startTime;
+    event.endTime = endTime;
+    event.threadId = buffer->threadId;
+    event.details = details;
+
+    buffer->events.append(event);
+}
+
+int KisTraceRecorder::numEvents() const
+{
+    QMutexLocker l(&m_d->lock);
+
+    int numEvents = m_d->retiredEvents.size();
+
+    Q_FOREACH (Private::ThreadBuffer *buffer, m_d->allBuffers) {
+        QMutexLocker bufferLocker(&buffer->lock);
+        numEvents += buffer->events.size();
+    }
+
+    return numEvents;
+}
+
+int KisTraceRecorder::numDroppedEvents() const
+{
+    QMutexLocker l(&m_d->lock);
+
+    int numDroppedEvents = m_d->numRetiredDroppedEvents;
+
+    Q_FOREACH (Private::ThreadBuffer *buffer, m_d->allBuffers) {
+        QMutexLocker bufferLocker(&buffer->lock);
+        numDroppedEvents += buffer->numDroppedEvents;
+    }
+
+    return numDroppedEvents;
+}
+
+QByteArray KisTraceRecorder::toChromeTraceJson() const
+{
+    QMutexLocker l(&m_d->lock);
+    const QVector<Event> events = m_d->collectEvents();
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+
+    for (int i = 0; i < m_d->threadNames.size(); i++) {
+        QJsonObject args;
+        args["name"] = m_d->threadNames[i];
+
+        QJsonObject metadata;
+        metadata["name"] = "thread_name";
+        metadata["ph"] = "M";
+        metadata["pid"] = pid;
+        metadata["tid"] = i;
+        metadata["args"] = args;
+        traceEvents.append(metadata);
+    }
+
+    // the timestamps of the Chrome trace are in microseconds
+    Q_FOREACH (const Event &event, events) {
+        QJsonObject object;
+        object["name"] = event.name;
+        object["cat"] = event.category;
+        object["ph"] = "X";
+        object["ts"] = (event.startTime - m_d->traceStartTime.loadAcquire()) / 1000.0;
+        object["dur"] = (event.endTime - event.startTime) / 1000.0;
+        object["pid"] = pid;
+        object["tid"] = event.threadId;
+
+        if (!event.details.isEmpty()) {
+            QJsonObject args;
+            args["details"] = event.details;
+            object["args"] = args;
+        }
+
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool KisTraceRecorder::saveChromeTrace(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        warnKrita << "Failed to open the trace file" << fileName;
+        return false;
+    }
+
+    return file.write(toChromeTraceJson()) >= 0;
+}
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TRACE_RECORDER_H
+#define __KIS_TRACE_RECORDER_H
+
+#include "kritaimage_export.h"
+
+#include <atomic>
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+
+/**
+ * Records the timings of the stages of the update and stroke pipeline
+ * (stroke jobs, merge walkers, LoD synchronization, canvas texture
+ * uploads, swap I/O) and exports them in the Chrome trace format, which
+ * can be opened in chrome://tracing or in Perfetto.
+ *
+ * The recorder is disabled by default and can be switched on and off
+ * at runtime with setEnabled(), which is available to the scripts as
+ * Krita.setTraceRecording(). When disabled, an instrumented scope
+ * costs a single relaxed atomic load. When enabled, every thread
+ * records the events into its own buffer, so the instrumented
+ * threads don't wait for each other.
+ *
+ * If KRITA_TRACE_FILE environment variable is set, the recording is
+ * enabled from the application startup and the trace is written into
+ * the specified file on exit.
+ *
+ * The stages are instrumented with KisTraceScope:
+ *
+ * \code
+ * KisTraceScope trace("updates", "merge walker");
+ * if (trace.isActive()) {
+ *     trace.setDetails(node->name());
+ * }
+ * \endcode
+ *
+ * NOTE: the category and name strings are not copied, so they
+ *       must be string literals.
+ */
+class KRITAIMAGE_EXPORT KisTraceRecorder
+{
+public:
+    KisTraceRecorder();
+    ~KisTraceRecorder();
+
+    /**
+     * Returns null when the instance has already been
+     * destroyed on the application exit
+     */
+    static KisTraceRecorder* instance();
+
+    static inline bool isEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Enabling the recorder drops all the events recorded
+     * before and starts a new trace
+     */
+    void setEnabled(bool value);
+
+    /**
+     * The time in nanoseconds on the recorder's clock
+     */
+    qint64 currentTime() const;
+
+    void addEvent(const char *category, const char *name,
+                  qint64 startTime, qint64 endTime,
+                  const QString &details = QString());
+
+    int numEvents() const;
+
+    /**
+     * The number of events dropped because the recording
+     * threads reached the limit of the events
+     */
+    int numDroppedEvents() const;
+
+    QByteArray toChromeTraceJson() const;
+    bool saveChromeTrace(const QString &fileName) const;
+
+private:
+    static std::atomic<bool> s_enabled;
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+/**
+ * Records an event spanning the lifetime of the scope
+ * object, if the recorder is enabled
+ */
+class KisTraceScope
+{
+public:
+    inline KisTraceScope(const char *category, const char *name)
+        : m_category(category),
+          m_name(name),
+          m_startTime(startTime())
+    {
+    }
+
+    inline ~KisTraceScope() {
+        if (m_startTime >= 0 && KisTraceRecorder::isEnabled()) {
+            /**
+             * The flag may still be raised while the instance is being
+             * destroyed on exit, so the instance should be checked
+             * as well
+             */
+            KisTraceRecorder *recorder = KisTraceRecorder::instance();
+            if (recorder) {
+                recorder->addEvent(m_category, m_name,
+                                   m_startTime, recorder->currentTime(),
+                                   m_details);
+            }
+        }
+    }
+
+    inline bool isActive() const {
+        return m_startTime >= 0;
+    }
+
+    inline void setDetails(const QString &details) {
+        m_details = details;
+    }
+
+private:
+    static inline qint64 startTime() {
+        KisTraceRecorder *recorder =
+            KisTraceRecorder::isEnabled() ? KisTraceRecorder::instance() : 0;
+        return recorder ? recorder->currentTime() : -1;
+    }
+
+private:
+    Q_DISABLE_COPY(KisTraceScope)
+
+    const char *m_category;
+    const char *m_name;
+    const qint64 m_startTime;
+    QString m_details;
+};
+
+#endif /* __KIS_TRACE_RECORDER_H */
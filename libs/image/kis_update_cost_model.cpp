@@ -0,0 +1,183 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_update_cost_model.h"
+
+#include <QHash>
+#include <QMutex>
+
+#include "kis_node.h"
+
+namespace {
+
+/**
+ * The weight of every older sample is multiplied by this value
+ * when a new sample arrives, so the model follows the changes
+ * of the layer stack
+ */
+const qreal decayFactor = 0.95;
+
+/**
+ * The number of samples a prediction is made from
+ */
+const int minimalNumSamples = 4;
+
+struct NodeStatistics
+{
+    KisNodeWSP node;
+    QString nodeName;
+    int numSamples = 0;
+
+    // decayed sums for the least squares fit of time(area)
+    qreal sumWeights = 0.0;
+    qreal sumArea = 0.0;
+    qreal sumTime = 0.0;
+    qreal sumAreaSquared = 0.0;
+    qreal sumAreaTime = 0.0;
+
+    void addSample(qreal area, qreal time) {
+        sumWeights = decayFactor * sumWeights + 1.0;
+        sumArea = decayFactor * sumArea + area;
+        sumTime = decayFactor * sumTime + time;
+        sumAreaSquared = decayFactor * sumAreaSquared + area * area;
+        sumAreaTime = decayFactor * sumAreaTime + area * time;
+        numSamples++;
+    }
+
+    /**
+     * Calculates the overhead (ns) and the cost of a single
+     * pixel (ns/px) of the update
+     */
+    bool fit(qreal *overhead, qreal *pixelCost) const {
+        if (numSamples < minimalNumSamples || sumArea <= 0.0) return false;
+
+        const qreal meanArea = sumArea / sumWeights;
+        const qreal meanTime = sumTime / sumWeights;
+        const qreal areaVariance = sumAreaSquared / sumWeights - meanArea * meanArea;
+
+        qreal slope = 0.0;
+
+        /**
+         * When all the updates have roughly the same size (e.g. a brush
+         * stroke), the overhead cannot be separated from the per-pixel
+         * cost, so all the time is considered as a per-pixel cost.
+         */
+        if (areaVariance > 0.01 * meanArea * meanArea) {
+            slope = (sumAreaTime / sumWeights - meanArea * meanTime) / areaVariance;
+        }
+
+        if (slope <= 0.0) {
+            *pixelCost = meanTime / meanArea;
+            *overhead = 0.0;
+        } else {
+            *pixelCost = slope;
+            *overhead = qMax(0.0, meanTime - slope * meanArea);
+        }
+
+        return true;
+    }
+};
+
+}
+
+struct KisUpdateCostModel::Private
+{
+    mutable QMutex lock;
+    QHash<const KisNode*, NodeStatistics> statistics;
+};
+
+KisUpdateCostModel::KisUpdateCostModel()
+    : m_d(new Private)
+{
+}
+
+KisUpdateCostModel::~KisUpdateCostModel()
+{
+}
+
+void KisUpdateCostModel::recordUpdate(KisNodeSP node, const QRect &rect, qint64 nsecsElapsed)
+{
+    if (!node || rect.isEmpty()) return;
+
+    QMutexLocker l(&m_d->lock);
+
+    NodeStatistics &stats = m_d->statistics[node.data()];
+
+    /**
+     * The node might have been deleted and a new one allocated
+     * at the same address
+     */
+    if (!stats.node.isValid() || stats.node.data() != node.data()) {
+        stats = NodeStatistics();
+        stats.node = node;
+    }
+
+    stats.nodeName = node->name();
+    stats.addSample(qreal(rect.width()) * rect.height(), nsecsElapsed);
+}
+
+bool KisUpdateCostModel::predictCost(KisNodeSP node, qint64 area, qreal *nsecs) const
+{
+    QMutexLocker l(&m_d->lock);
+
+    auto it = m_d->statistics.constFind(node.data());
+    if (it == m_d->statistics.constEnd() || !it->node.isValid()) return false;
+
+    qreal overhead = 0.0;
+    qreal pixelCost = 0.0;
+    if (!it->fit(&overhead, &pixelCost)) return false;
+
+    *nsecs = overhead + pixelCost * area;
+    return true;
+}
+
+QVector<KisUpdateCostModel::NodeCost> KisUpdateCostModel::learnedCosts() const
+{
+    QMutexLocker l(&m_d->lock);
+
+    QVector<NodeCost> result;
+
+    for (auto it = m_d->statistics.begin(); it != m_d->statistics.end();) {
+        if (!it->node.isValid()) {
+            it = m_d->statistics.erase(it);
+            continue;
+        }
+
+        qreal overhead = 0.0;
+        qreal pixelCost = 0.0;
+
+        if (it->fit(&overhead, &pixelCost)) {
+            NodeCost cost;
+            cost.nodeName = it->nodeName;
+            cost.overheadNs = overhead;
+            cost.pixelsPerSecond = pixelCost > 0.0 ? 1e9 / pixelCost : 0.0;
+            cost.numSamples = it->numSamples;
+            result << cost;
+        }
+
+        ++it;
+    }
+
+    return result;
+}
+
+void KisUpdateCostModel::clear()
+{
+    QMutexLocker l(&m_d->lock);
+    m_d->statistics.clear();
+}
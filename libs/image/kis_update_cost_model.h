@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_UPDATE_COST_MODEL_H
+#define __KIS_UPDATE_COST_MODEL_H
+
+#include "kritaimage_export.h"
+
+#include <QRect>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "kis_types.h"
+
+class KisUpdateCostModel;
+typedef QSharedPointer<KisUpdateCostModel> KisUpdateCostModelSP;
+
+/**
+ * Learns how long it takes to update a rect starting from a node.
+ *
+ * Every finished merge job reports the area of its requested rect and
+ * the time it took. The model fits a linear function
+ *
+ *     time = overhead + area / throughput
+ *
+ * for every start node, using the least squares method with the older
+ * samples exponentially decaying. The overhead contains everything that
+ * doesn't depend on the size of the rect: walking the graph, scheduling
+ * and, most notably, the borders of the need rects of the blurring
+ * filters.
+ *
+ * The model is used by KisSimpleUpdateQueue to choose the patch size
+ * of the split updates and to decide whether two updates should be
+ * merged.
+ */
+class KRITAIMAGE_EXPORT KisUpdateCostModel
+{
+public:
+    struct NodeCost
+    {
+        QString nodeName;
+        qreal overheadNs = 0.0;
+        qreal pixelsPerSecond = 0.0;
+        int numSamples = 0;
+    };
+
+public:
+    KisUpdateCostModel();
+    ~KisUpdateCostModel();
+
+    /**
+     * Records that updating \p rect starting from \p node
+     * took \p nsecsElapsed nanoseconds
+     */
+    void recordUpdate(KisNodeSP node, const QRect &rect, qint64 nsecsElapsed);
+
+    /**
+     * Predicts the time (in nanoseconds) of updating a rect with area
+     * \p area starting from \p node. Returns false if the model
+     * hasn't collected enough samples for the node yet.
+     */
+    bool predictCost(KisNodeSP node, qint64 area, qreal *nsecs) const;
+
+    /**
+     * Returns the costs learned for all the nodes that still exist
+     */
+    QVector<NodeCost> learnedCosts() const;
+
+    void clear();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_UPDATE_COST_MODEL_H */
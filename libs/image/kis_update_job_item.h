@@ -21,6 +21,7 @@
 
 #include <atomic>
 
+#include <QElapsedTimer>
 #include <QRunnable>
 #include <QReadWriteLock>
 
@@ -29,6 +30,7 @@
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
 #include "kis_updater_context.h"
+#include "kis_trace_recorder.h"
 
 
 class KisUpdateJobItem :  public QObject, public QRunnable
@@ -51,6 +53,8 @@ public:
     {
         setAutoDelete(false);
         KIS_SAFE_ASSERT_RECOVER_NOOP(m_atomicType.is_lock_free());
+
+        m_merger.setThreadPool(updaterContext->patchThreadPool());
     }
     ~KisUpdateJobItem() override
     {
@@ -88,6 +92,9 @@ public:
                 KIS_ASSERT(m_atomicType == Type::STROKE ||
                            m_atomicType == Type::SPONTANEOUS);
 
+                KisTraceScope trace(m_atomicType == Type::STROKE ? "strokes" : "updates",
+                                    m_atomicType == Type::STROKE ? "stroke job" : "spontaneous job");
+
                 m_runnableJob->run();
             }
 
@@ -115,8 +122,31 @@ public:
         KIS_SAFE_ASSERT_RECOVER_RETURN(m_walker);
         // dbgKrita << "Executing merge job" << m_walker->changeRect()
         //          << "on thread" << QThread::currentThreadId();
+
+        KisTraceScope trace("updates", "merge walker");
+        if (trace.isActive()) {
+            const QRect rc = m_walker->requestedRect();
+            trace.setDetails(QString("%1 (%2, %3, %4x%5)")
+                             .arg(m_walker->startNode()->name())
+                             .arg(rc.x()).arg(rc.y())
+                             .arg(rc.width()).arg(rc.height()));
+        }
+
+        KisUpdateCostModelSP costModel = m_walker->costModel();
+
+        QElapsedTimer timer;
+        if (costModel) {
+            timer.start();
+        }
+
         m_merger.startMerge(*m_walker);
 
+        if (costModel) {
+            costModel->recordUpdate(m_walker->startNode(),
+                                    m_walker->requestedRect(),
+                                    timer.nsecsElapsed());
+        }
+
         QRect changeRect = m_walker->changeRect();
         m_updaterContext->continueUpdate(changeRect);
     }
@@ -115,6 +115,21 @@ int KisUpdateScheduler::threadsLimit() const
     return m_d->updaterContext.threadsLimit();
 }
 
+QVector<KisUpdateCostModel::NodeCost> KisUpdateScheduler::learnedUpdateCosts() const
+{
+    return m_d->updatesQueue.costModel()->learnedCosts();
+}
+
+KisStrokeLatencyStatistics KisUpdateScheduler::interactiveStrokesLatency() const
+{
+    return m_d->strokesQueue.interactiveLatency();
+}
+
+void KisUpdateScheduler::resetInteractiveStrokesLatency()
+{
+    m_d->strokesQueue.resetInteractiveLatency();
+}
+
 void KisUpdateScheduler::connectSignals()
 {
     connect(KisImageConfigNotifier::instance(), SIGNAL(configChanged()),
@@ -258,6 +273,19 @@ void KisUpdateScheduler::setDesiredLevelOfDetail(int lod)
     processQueues();
 }
 
+void KisUpdateScheduler::setAdaptiveLevelOfDetailAllowed(bool value)
+{
+    m_d->strokesQueue.setAdaptiveLevelOfDetailAllowed(value);
+
+    // \see a comment in setDesiredLevelOfDetail()
+    processQueues();
+}
+
+int KisUpdateScheduler::adaptiveLevelOfDetail() const
+{
+    return m_d->strokesQueue.adaptiveLevelOfDetail();
+}
+
 void KisUpdateScheduler::explicitRegenerateLevelOfDetail()
 {
     m_d->strokesQueue.explicitRegenerateLevelOfDetail();
@@ -307,6 +335,14 @@ void KisUpdateScheduler::updateSettings()
     KisImageConfig config(true);
     m_d->defaultBalancingRatio = config.schedulerBalancingRatio();
     setThreadsLimit(config.maxNumberOfThreads());
+
+    const qint64 nsecsPerMsec = 1000000;
+
+    m_d->strokesQueue.setAdaptiveLevelOfDetail(
+        config.adaptiveLevelOfDetail(),
+        config.adaptiveLodLatencyTarget() * nsecsPerMsec,
+        config.adaptiveLodRecoveryLatency() * nsecsPerMsec,
+        config.adaptiveLodMaxLevel());
 }
 
 void KisUpdateScheduler::lock()
@@ -26,6 +26,8 @@
 #include "kis_image_interfaces.h"
 #include "kis_stroke_strategy_factory.h"
 #include "kis_strokes_queue_undo_result.h"
+#include "kis_update_cost_model.h"
+#include "KisStrokeLatencyStatistics.h"
 
 class QRect;
 class KoProgressProxy;
@@ -52,6 +54,24 @@ public:
      */
     int threadsLimit() const;
 
+    /**
+     * Returns the costs of updating the nodes learned by the updates
+     * queue. The costs are collected only when the adaptive patches
+     * mode is enabled.
+     *
+     * \see KisImageConfig::adaptiveUpdatePatches()
+     */
+    QVector<KisUpdateCostModel::NodeCost> learnedUpdateCosts() const;
+
+    /**
+     * Returns the latency of the jobs of the interactive strokes
+     * collected since the last reset
+     *
+     * \see KisStrokeStrategy::Priority
+     */
+    KisStrokeLatencyStatistics interactiveStrokesLatency() const;
+    void resetInteractiveStrokesLatency();
+
     /**
      * Sets the proxy that is going to be notified about the progress
      * of processing of the queues. If you want to switch the proxy
@@ -156,6 +176,16 @@ public:
      */
     void setDesiredLevelOfDetail(int lod);
 
+    /**
+     * Allows the adaptive level of detail chosen from the latency of
+     * the interactive strokes. The mode itself is switched on in
+     * KisImageConfig.
+     *
+     * \see KisStrokesQueue::setAdaptiveLevelOfDetail()
+     */
+    void setAdaptiveLevelOfDetailAllowed(bool value);
+    int adaptiveLevelOfDetail() const;
+
     /**
      * Explicitly start regeneration of LoD planes of all the devices
      * in the image. This call should be performed when the user is idle,
@@ -19,15 +19,29 @@
 #include "kis_updater_context.h"
 
 #include <QThread>
-#include <QThreadPool>
 
 #include "kis_update_job_item.h"
 #include "kis_stroke_job.h"
 
 const int KisUpdaterContext::useIdealThreadCountTag = -1;
 
+namespace {
+/**
+ * Every thread has one job being executed and one
+ * job waiting in its queue
+ */
+const int defaultJobSlotsPerThread = 2;
+}
+
 KisUpdaterContext::KisUpdaterContext(qint32 threadCount, QObject *parent)
-    : QObject(parent), m_scheduler(qobject_cast<KisUpdateScheduler *>(parent))
+    : KisUpdaterContext(threadCount, defaultJobSlotsPerThread, parent)
+{
+}
+
+KisUpdaterContext::KisUpdaterContext(qint32 threadCount, int jobSlotsPerThread, QObject *parent)
+    : QObject(parent),
+      m_jobSlotsPerThread(jobSlotsPerThread),
+      m_scheduler(qobject_cast<KisUpdateScheduler *>(parent))
 {
     if(threadCount <= 0) {
         threadCount = QThread::idealThreadCount();
@@ -39,7 +53,7 @@ KisUpdaterContext::KisUpdaterContext(qint32 threadCount, QObject *parent)
 
 KisUpdaterContext::~KisUpdaterContext()
 {
-    m_threadPool.waitForDone();
+    m_executor.waitForDone();
     for(qint32 i = 0; i < m_jobs.size(); i++)
         delete m_jobs[i];
 }
@@ -144,7 +158,7 @@ void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
     // it might happen that we call this function from within
     // the thread itself, right when it finished its work
     if (shouldStartThread) {
-        m_threadPool.start(m_jobs[jobIndex]);
+        m_executor.start(m_jobs[jobIndex]);
     }
 }
 
@@ -174,7 +188,7 @@ void KisUpdaterContext::addStrokeJob(KisStrokeJob *strokeJob)
     // it might happen that we call this function from within
     // the thread itself, right when it finished its work
     if (shouldStartThread) {
-        m_threadPool.start(m_jobs[jobIndex]);
+        m_executor.start(m_jobs[jobIndex]);
     }
 }
 
@@ -204,7 +218,7 @@ void KisUpdaterContext::addSpontaneousJob(KisSpontaneousJob *spontaneousJob)
     // it might happen that we call this function from within
     // the thread itself, right when it finished its work
     if (shouldStartThread) {
-        m_threadPool.start(m_jobs[jobIndex]);
+        m_executor.start(m_jobs[jobIndex]);
     }
 }
 
@@ -225,7 +239,7 @@ void KisUpdaterContext::addSpontaneousJobTest(KisSpontaneousJob *spontaneousJob)
 
 void KisUpdaterContext::waitForDone()
 {
-    m_threadPool.waitForDone();
+    m_executor.waitForDone();
 }
 
 bool KisUpdaterContext::walkerIntersectsJob(KisBaseRectsWalkerSP walker,
@@ -256,8 +270,6 @@ void KisUpdaterContext::unlock()
 
 void KisUpdaterContext::setThreadsLimit(int value)
 {
-    m_threadPool.setMaxThreadCount(value);
-
     for (int i = 0; i < m_jobs.size(); i++) {
         KIS_SAFE_ASSERT_RECOVER_RETURN(!m_jobs[i]->isRunning());
         // don't delete the jobs until all of them are checked!
@@ -267,7 +279,9 @@ void KisUpdaterContext::setThreadsLimit(int value)
         delete m_jobs[i];
     }
 
-    m_jobs.resize(value);
+    m_executor.setMaxThreadCount(value);
+    m_patchThreadPool.setMaxThreadCount(value);
+    m_jobs.resize(value * m_jobSlotsPerThread);
 
     for(qint32 i = 0; i < m_jobs.size(); i++) {
         m_jobs[i] = new KisUpdateJobItem(this);
@@ -276,8 +290,13 @@ void KisUpdaterContext::setThreadsLimit(int value)
 
 int KisUpdaterContext::threadsLimit() const
 {
-    KIS_SAFE_ASSERT_RECOVER_NOOP(m_jobs.size() == m_threadPool.maxThreadCount());
-    return m_jobs.size();
+    KIS_SAFE_ASSERT_RECOVER_NOOP(m_jobs.size() == m_executor.maxThreadCount() * m_jobSlotsPerThread);
+    return m_executor.maxThreadCount();
+}
+
+QThreadPool* KisUpdaterContext::patchThreadPool()
+{
+    return &m_patchThreadPool;
 }
 
 void KisUpdaterContext::continueUpdate(const QRect& rc)
@@ -312,7 +331,7 @@ void KisUpdaterContext::clear()
 
 
 KisTestableUpdaterContext::KisTestableUpdaterContext(qint32 threadCount)
-    : KisUpdaterContext(threadCount)
+    : KisUpdaterContext(threadCount, 1, 0)
 {
 }
 
@@ -27,6 +27,7 @@
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
 #include "kis_lock_free_lod_counter.h"
+#include "kis_work_stealing_executor.h"
 
 #include "KisUpdaterContextSnapshotEx.h"
 #include "kis_update_scheduler.h"
@@ -113,6 +114,11 @@ public:
     /**
      * Locks the context to guarantee an exclusive access
      * to the context
+     *
+     * NOTE: the scheduler still checks hasSpareThread() and
+     *       isJobAllowed() under this lock. The executor only
+     *       distributes the admitted jobs between the workers,
+     *       the admission itself is not per-worker.
      */
     void lock();
 
@@ -143,7 +149,21 @@ public:
     void doSomeUsefulWork();
     void jobFinished();
 
+    /**
+     * The pool the merge jobs process the patches of large rects
+     * in. It is limited by the same number of threads as the context.
+     */
+    QThreadPool* patchThreadPool();
+
 protected:
+    /**
+     * Creates a context with \p jobSlotsPerThread job slots for every
+     * thread. The extra slots let the admissible jobs be queued into
+     * the executor before a thread becomes free, so the workers don't
+     * have to wait for the scheduler to give them the next job.
+     */
+    KisUpdaterContext(qint32 threadCount, int jobSlotsPerThread, QObject *parent);
+
     static bool walkerIntersectsJob(KisBaseRectsWalkerSP walker,
                                     const KisUpdateJobItem* job);
     qint32 findSpareThread();
@@ -159,7 +179,9 @@ protected:
 
     QMutex m_lock;
     QVector<KisUpdateJobItem*> m_jobs;
-    QThreadPool m_threadPool;
+    KisWorkStealingExecutor m_executor;
+    QThreadPool m_patchThreadPool;
+    const int m_jobSlotsPerThread;
     KisLockFreeLodCounter m_lodCounter;
     KisUpdateScheduler *m_scheduler;
 
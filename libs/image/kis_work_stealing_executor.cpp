@@ -0,0 +1,275 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_work_stealing_executor.h"
+
+#include <deque>
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+
+/**
+ * The same as the default expiry timeout of QThreadPool
+ */
+const int KisWorkStealingExecutor::EXPIRY_TIMEOUT = 30000;
+
+class KisWorkStealingExecutor::Worker : public QThread
+{
+public:
+    Worker(KisWorkStealingExecutor *executor, int index)
+        : m_executor(executor),
+          m_index(index)
+    {
+        setObjectName(QString("Update worker %1").arg(index));
+    }
+
+    void run() override;
+
+    KisWorkStealingExecutor * const m_executor;
+    const int m_index;
+
+    /**
+     * Set by the worker when it exits after being idle for too long,
+     * reset by start() when it restarts the worker. Protected by the
+     * idle lock of the executor.
+     */
+    bool m_expired = false;
+
+    /**
+     * The queue is accessed by the owner from the back and
+     * by the thieves from the front. The lock is almost never
+     * contended, so there is no need for a lockless deque.
+     */
+    QMutex m_queueLock;
+    std::deque<QRunnable*> m_queue;
+};
+
+struct KisWorkStealingExecutor::Private
+{
+    QVector<Worker*> workers;
+    QAtomicInt nextWorker;
+
+    /**
+     * The number of the jobs in the queues and of the jobs
+     * being executed at the moment
+     */
+    QAtomicInt numQueuedJobs;
+    QAtomicInt numPendingJobs;
+
+    QMutex idleLock;
+    QWaitCondition workAvailable;
+    QWaitCondition allJobsDone;
+    int numIdleWorkers = 0;
+    bool exiting = false;
+};
+
+void KisWorkStealingExecutor::Worker::run()
+{
+    while (1) {
+        QRunnable *runnable = 0;
+
+        if (m_executor->takeJob(m_index, runnable)) {
+            const bool autoDelete = runnable->autoDelete();
+            runnable->run();
+            if (autoDelete) {
+                delete runnable;
+            }
+
+            m_executor->jobFinished();
+            continue;
+        }
+
+        QMutexLocker l(&m_executor->m_d->idleLock);
+
+        /**
+         * The job counter is checked under the idle lock, and start()
+         * wakes up the workers under the same lock after updating the
+         * counter, so the wakeup cannot be lost
+         */
+        while (!m_executor->m_d->exiting &&
+               !m_executor->m_d->numQueuedJobs.loadAcquire()) {
+
+            m_executor->m_d->numIdleWorkers++;
+            const bool woken =
+                m_executor->m_d->workAvailable.wait(&m_executor->m_d->idleLock,
+                                                    EXPIRY_TIMEOUT);
+            m_executor->m_d->numIdleWorkers--;
+
+            if (!woken &&
+                !m_executor->m_d->exiting &&
+                !m_executor->m_d->numQueuedJobs.loadAcquire()) {
+
+                m_expired = true;
+                return;
+            }
+        }
+
+        if (m_executor->m_d->exiting) break;
+    }
+}
+
+KisWorkStealingExecutor::KisWorkStealingExecutor(int numThreads)
+    : m_d(new Private)
+{
+    startWorkers(numThreads);
+}
+
+KisWorkStealingExecutor::~KisWorkStealingExecutor()
+{
+    waitForDone();
+    stopWorkers();
+}
+
+void KisWorkStealingExecutor::setMaxThreadCount(int value)
+{
+    if (value == m_d->workers.size()) return;
+
+    waitForDone();
+    stopWorkers();
+    startWorkers(value);
+}
+
+int KisWorkStealingExecutor::maxThreadCount() const
+{
+    return m_d->workers.size();
+}
+
+void KisWorkStealingExecutor::start(QRunnable *runnable)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(!m_d->workers.isEmpty());
+
+    Worker *worker = dynamic_cast<Worker*>(QThread::currentThread());
+    if (!worker || worker->m_executor != this) {
+        const int index = m_d->nextWorker.fetchAndAddOrdered(1);
+        worker = m_d->workers[(index & 0x7fffffff) % m_d->workers.size()];
+    }
+
+    m_d->numPendingJobs.ref();
+
+    {
+        QMutexLocker l(&worker->m_queueLock);
+        worker->m_queue.push_back(runnable);
+        m_d->numQueuedJobs.ref();
+    }
+
+    QMutexLocker l(&m_d->idleLock);
+
+    /**
+     * The worker decides to expire under the idle lock when there are
+     * no queued jobs, so either it sees the new job, or we see the flag
+     */
+    if (worker->m_expired) {
+        worker->wait();
+        worker->m_expired = false;
+        worker->start();
+    } else if (m_d->numIdleWorkers > 0) {
+        m_d->workAvailable.wakeOne();
+    }
+}
+
+bool KisWorkStealingExecutor::takeJob(int workerIndex, QRunnable *&runnable)
+{
+    if (!m_d->numQueuedJobs.loadAcquire()) return false;
+
+    {
+        Worker *worker = m_d->workers[workerIndex];
+        QMutexLocker l(&worker->m_queueLock);
+
+        if (!worker->m_queue.empty()) {
+            runnable = worker->m_queue.back();
+            worker->m_queue.pop_back();
+            m_d->numQueuedJobs.deref();
+            return true;
+        }
+    }
+
+    const int numWorkers = m_d->workers.size();
+
+    for (int i = 1; i < numWorkers; i++) {
+        Worker *victim = m_d->workers[(workerIndex + i) % numWorkers];
+        QMutexLocker l(&victim->m_queueLock);
+
+        if (!victim->m_queue.empty()) {
+            runnable = victim->m_queue.front();
+            victim->m_queue.pop_front();
+            m_d->numQueuedJobs.deref();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void KisWorkStealingExecutor::jobFinished()
+{
+    if (!m_d->numPendingJobs.deref()) {
+        QMutexLocker l(&m_d->idleLock);
+        m_d->allJobsDone.wakeAll();
+    }
+}
+
+void KisWorkStealingExecutor::waitForDone()
+{
+    QMutexLocker l(&m_d->idleLock);
+
+    while (m_d->numPendingJobs.loadAcquire()) {
+        m_d->allJobsDone.wait(&m_d->idleLock);
+    }
+}
+
+void KisWorkStealingExecutor::startWorkers(int numThreads)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(m_d->workers.isEmpty());
+
+    m_d->exiting = false;
+
+    for (int i = 0; i < qMax(1, numThreads); i++) {
+        Worker *worker = new Worker(this, i);
+        m_d->workers.append(worker);
+    }
+
+    Q_FOREACH (Worker *worker, m_d->workers) {
+        worker->start();
+    }
+}
+
+void KisWorkStealingExecutor::stopWorkers()
+{
+    {
+        QMutexLocker l(&m_d->idleLock);
+        m_d->exiting = true;
+        m_d->workAvailable.wakeAll();
+    }
+
+    /**
+     * The expired workers have already finished,
+     * so waiting for them returns immediately
+     */
+    Q_FOREACH (Worker *worker, m_d->workers) {
+        worker->wait();
+        delete worker;
+    }
+
+    m_d->workers.clear();
+}
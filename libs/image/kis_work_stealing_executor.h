@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_WORK_STEALING_EXECUTOR_H
+#define __KIS_WORK_STEALING_EXECUTOR_H
+
+#include "kritaimage_export.h"
+
+#include <QScopedPointer>
+
+class QRunnable;
+
+/**
+ * A thread pool with a separate job queue for every worker thread.
+ *
+ * The jobs started from a worker thread (e.g. the jobs added by the
+ * update scheduler when the previous job has finished) go into the
+ * queue of the same worker, so they are executed without waking up
+ * any other thread and with the caches still warm. The jobs started
+ * from any other thread are distributed between the workers in
+ * a round-robin manner.
+ *
+ * A worker takes the jobs from the back of its own queue. When its
+ * queue is empty, it steals a job from the front of the queues of
+ * the other workers, so no thread stays idle while there is some
+ * work queued.
+ *
+ * Like in QThreadPool, a worker that has been idle for more than
+ * EXPIRY_TIMEOUT ms exits. It is restarted when a job is queued to it.
+ *
+ * The executor doesn't know anything about the dependencies of the
+ * jobs: it is the responsibility of the caller (KisUpdaterContext)
+ * to start only the jobs that may be executed concurrently. These
+ * admission checks are still done under the lock of the context,
+ * only the queueing and the execution of the jobs are distributed.
+ */
+class KRITAIMAGE_EXPORT KisWorkStealingExecutor
+{
+public:
+    KisWorkStealingExecutor(int numThreads = 1);
+    ~KisWorkStealingExecutor();
+
+    /**
+     * Changes the number of the worker threads. Blocks
+     * until all the queued jobs are finished.
+     */
+    void setMaxThreadCount(int value);
+    int maxThreadCount() const;
+
+    /**
+     * Queues \p runnable for execution. If runnable->autoDelete()
+     * is true, the runnable is deleted after execution.
+     */
+    void start(QRunnable *runnable);
+
+    /**
+     * Blocks until all the queued jobs are finished
+     */
+    void waitForDone();
+
+private:
+    static const int EXPIRY_TIMEOUT;
+
+    class Worker;
+    friend class Worker;
+
+    bool takeJob(int workerIndex, QRunnable *&runnable);
+    void jobFinished();
+
+    void startWorkers(int numThreads);
+    void stopWorkers();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_WORK_STEALING_EXECUTOR_H */
@@ -96,7 +96,11 @@ KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(KisPaintDeviceSP src,
     enableJob(JOB_INIT, true, KisStrokeJobData::SEQUENTIAL, KisStrokeJobData::EXCLUSIVE);
     enableJob(JOB_DOSTROKE, true, KisStrokeJobData::SEQUENTIAL, KisStrokeJobData::EXCLUSIVE);
     enableJob(JOB_CANCEL, true, KisStrokeJobData::SEQUENTIAL, KisStrokeJobData::EXCLUSIVE);
+    enableJob(JOB_SUSPEND, true, KisStrokeJobData::SEQUENTIAL, KisStrokeJobData::EXCLUSIVE);
+    enableJob(JOB_RESUME, true, KisStrokeJobData::SEQUENTIAL, KisStrokeJobData::EXCLUSIVE);
     setNeedsExplicitCancel(true);
+    setPriority(BACKGROUND);
+    setAffectedNodes({progressNode});
 }
 
 KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(const KisColorizeStrokeStrategy &rhs, int levelOfDetail)
@@ -272,6 +276,20 @@ void KisColorizeStrokeStrategy::cancelStrokeCallback()
     emit sigCancelled();
 }
 
+void KisColorizeStrokeStrategy::suspendStrokeCallback()
+{
+    /**
+     * All the intermediate state lives in the private devices of the
+     * stroke and the mask, which are not touched by the strokes working
+     * on other nodes, so nothing should be saved here. The strokes
+     * queue never lets the strokes on the mask or its parent in.
+     */
+}
+
+void KisColorizeStrokeStrategy::resumeStrokeCallback()
+{
+}
+
 KisStrokeStrategy* KisColorizeStrokeStrategy::createLodClone(int levelOfDetail)
 {
     KisImageConfig cfg(true);
@@ -54,7 +54,8 @@ public:
 
     void initStrokeCallback() override;
     void cancelStrokeCallback() override;
-    // TODO: suspend/resume
+    void suspendStrokeCallback() override;
+    void resumeStrokeCallback() override;
 
     KisStrokeStrategy *createLodClone(int levelOfDetail) override;
 
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisFilterProcessingVisitor.h"
+
+#include <klocalizedstring.h>
+
+#include "filter/kis_filter.h"
+#include "filter/kis_filter_configuration.h"
+#include "filter/kis_filter_registry.h"
+#include "kis_paint_device.h"
+#include "kis_paint_layer.h"
+#include "kis_transaction.h"
+#include "kis_undo_adapter.h"
+#include "kis_assert.h"
+
+
+KisFilterProcessingVisitor::KisFilterProcessingVisitor(KisFilterConfigurationSP config)
+    : m_config(config)
+{
+}
+
+void KisFilterProcessingVisitor::visit(KisPaintLayer *layer, KisUndoAdapter *undoAdapter)
+{
+    KisFilterSP filter = KisFilterRegistry::instance()->value(m_config->name());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(filter);
+
+    KisPaintDeviceSP device = layer->paintDevice();
+    const QRect applyRect = device->exactBounds();
+    if (applyRect.isEmpty()) return;
+
+    KisTransaction transaction(kundo2_i18n("Filter \"%1\"", filter->name()), device);
+    filter->process(device, applyRect, m_config);
+    transaction.commit(undoAdapter);
+}
+
+void KisFilterProcessingVisitor::visitNodeWithPaintDevice(KisNode *node, KisUndoAdapter *undoAdapter)
+{
+    Q_UNUSED(node);
+    Q_UNUSED(undoAdapter);
+}
+
+void KisFilterProcessingVisitor::visitExternalLayer(KisExternalLayer *layer, KisUndoAdapter *undoAdapter)
+{
+    Q_UNUSED(layer);
+    Q_UNUSED(undoAdapter);
+}
+
+void KisFilterProcessingVisitor::visitColorizeMask(KisColorizeMask *mask, KisUndoAdapter *undoAdapter)
+{
+    Q_UNUSED(mask);
+    Q_UNUSED(undoAdapter);
+}
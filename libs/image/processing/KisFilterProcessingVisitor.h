@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FILTER_PROCESSING_VISITOR_H
+#define __KIS_FILTER_PROCESSING_VISITOR_H
+
+#include "kis_simple_processing_visitor.h"
+#include "kis_types.h"
+
+
+/**
+ * Applies a filter to the paint devices of the paint layers. The
+ * masks, the adjustment and generator layers and the external layers
+ * are left untouched.
+ *
+ * The visitor is used for batch processing of the images, when there
+ * is no need for the preview of the filter provided by the filter
+ * stroke.
+ */
+class KRITAIMAGE_EXPORT KisFilterProcessingVisitor : public KisSimpleProcessingVisitor
+{
+public:
+    KisFilterProcessingVisitor(KisFilterConfigurationSP config);
+
+    void visit(KisPaintLayer *layer, KisUndoAdapter *undoAdapter) override;
+    using KisSimpleProcessingVisitor::visit;
+
+private:
+    void visitNodeWithPaintDevice(KisNode *node, KisUndoAdapter *undoAdapter) override;
+    void visitExternalLayer(KisExternalLayer *layer, KisUndoAdapter *undoAdapter) override;
+    void visitColorizeMask(KisColorizeMask *mask, KisUndoAdapter *undoAdapter) override;
+
+private:
+    KisFilterConfigurationSP m_config;
+};
+
+#endif /* __KIS_FILTER_PROCESSING_VISITOR_H */
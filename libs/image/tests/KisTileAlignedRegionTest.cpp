@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTileAlignedRegionTest.h"
+
+#include <QTest>
+#include <QRegion>
+
+#include "KisTileAlignedRegion.h"
+
+
+void KisTileAlignedRegionTest::testEmpty()
+{
+    KisTileAlignedRegion region;
+
+    QVERIFY(region.isEmpty());
+    QVERIFY(region.rects().isEmpty());
+    QVERIFY(region.boundingRect().isEmpty());
+    QVERIFY(!region.intersects(QRect(0,0,100,100)));
+
+    region.addRect(QRect());
+    QVERIFY(region.isEmpty());
+}
+
+void KisTileAlignedRegionTest::testSingleRect_data()
+{
+    QTest::addColumn<QRect>("rect");
+    QTest::addColumn<int>("numCells");
+
+    QTest::newRow("inside-cell") << QRect(10,10,20,20) << 1;
+    QTest::newRow("cell") << QRect(64,64,64,64) << 1;
+    QTest::newRow("crossing-cells") << QRect(50,50,100,30) << 6;
+    QTest::newRow("negative") << QRect(-10,-10,20,20) << 4;
+    QTest::newRow("big") << QRect(-100,-100,1000,1000) << 17 * 17;
+}
+
+void KisTileAlignedRegionTest::testSingleRect()
+{
+    QFETCH(QRect, rect);
+    QFETCH(int, numCells);
+
+    KisTileAlignedRegion region(rect);
+
+    QVERIFY(!region.isEmpty());
+    QCOMPARE(region.boundingRect(), rect);
+    QCOMPARE(region.numCells(), numCells);
+    QCOMPARE(region.rects(), QVector<QRect>({rect}));
+}
+
+void KisTileAlignedRegionTest::testOverlappingDabs()
+{
+    KisTileAlignedRegion region;
+
+    for (int i = 0; i < 1000; i++) {
+        region.addRect(QRect(i, 100, 20, 20));
+    }
+
+    QCOMPARE(region.numCells(), 16);
+    QCOMPARE(region.rects(), QVector<QRect>({QRect(0, 100, 1019, 20)}));
+}
+
+void KisTileAlignedRegionTest::testIntersects()
+{
+    KisTileAlignedRegion region;
+    region.addRect(QRect(0,0,10,10));
+    region.addRect(QRect(100,100,10,10));
+
+    QVERIFY(region.intersects(QRect(5,5,2,2)));
+    QVERIFY(region.intersects(QRect(105,105,100,100)));
+    QVERIFY(region.intersects(QRect(-1000,-1000,2000,2000)));
+
+    // inside the bounding rect, but outside the dirty areas of the cells
+    QVERIFY(!region.intersects(QRect(50,50,10,10)));
+    QVERIFY(!region.intersects(QRect(20,20,10,10)));
+
+    QVERIFY(!region.intersects(QRect(1000,1000,5,5)));
+}
+
+void KisTileAlignedRegionTest::testAddRegion()
+{
+    KisTileAlignedRegion region1(QRect(0,0,100,100));
+    KisTileAlignedRegion region2(QRect(200,0,100,100));
+
+    region1 += region2;
+
+    KisTileAlignedRegion reference;
+    reference.addRect(QRect(0,0,100,100));
+    reference.addRect(QRect(200,0,100,100));
+
+    QVERIFY(region1 == reference);
+    QCOMPARE(region1.boundingRect(), QRect(0,0,300,100));
+
+    KisTileAlignedRegion emptyRegion;
+    emptyRegion += region2;
+    QVERIFY(emptyRegion == region2);
+}
+
+void KisTileAlignedRegionTest::testCoverage()
+{
+    QVector<QRect> dabs;
+
+    // a pseudo-random walk of dabs of different sizes
+    int x = 300;
+    int y = 300;
+    for (int i = 0; i < 2000; i++) {
+        x += (i * 7919) % 13 - 6;
+        y += (i * 104729) % 11 - 5;
+
+        const int size = 5 + (i * 31) % 40;
+        dabs << QRect(x, y, size, size);
+    }
+
+    KisTileAlignedRegion region(dabs);
+    const QVector<QRect> rects = region.rects();
+
+    QRegion coveredArea;
+
+    for (int i = 0; i < rects.size(); i++) {
+        for (int j = i + 1; j < rects.size(); j++) {
+            QVERIFY(!rects[i].intersects(rects[j]));
+        }
+
+        QVERIFY(region.boundingRect().contains(rects[i]));
+        coveredArea += rects[i];
+    }
+
+    Q_FOREACH (const QRect &rc, dabs) {
+        QVERIFY((QRegion(rc) - coveredArea).isEmpty());
+    }
+
+    // no overestimation beyond the cells touched by the dabs
+    QVERIFY(rects.size() <= region.numCells());
+}
+
+void KisTileAlignedRegionTest::testLargeRects()
+{
+    const QRect layerRect(-10, -10, 4000, 3000);
+    const QRect dab(100, 100, 20, 20);
+
+    KisTileAlignedRegion region;
+    region.addRect(dab);
+    region.addRect(layerRect);
+    region.addRect(QRect(500, 500, 30, 30));
+
+    QCOMPARE(region.boundingRect(), layerRect);
+    QVERIFY(region.intersects(QRect(3000, 2000, 1, 1)));
+    QVERIFY(!region.intersects(QRect(4000, 0, 10, 10)));
+    QCOMPARE(region.rects(), QVector<QRect>({layerRect}));
+    QCOMPARE(region.numCells(), 64 * 48);
+
+    // the same area split into cells right away
+    KisTileAlignedRegion reference;
+    for (int y = layerRect.top(); y <= layerRect.bottom(); y += 100) {
+        reference.addRect(QRect(layerRect.left(), y, layerRect.width(), 100) & layerRect);
+    }
+    QVERIFY(region == reference);
+
+    // a large rect sticking out of the stored one
+    const QRect sideRect(3900, 0, 1000, 1000);
+    region.addRect(sideRect);
+    reference.addRect(sideRect);
+    QVERIFY(region == reference);
+    QCOMPARE(region.boundingRect(), layerRect | sideRect);
+
+    KisTileAlignedRegion merged(dab);
+    merged += region;
+    QVERIFY(merged == reference);
+
+    QRegion coveredArea;
+    Q_FOREACH (const QRect &rc, merged.rects()) {
+        coveredArea += rc;
+    }
+    QVERIFY((QRegion(layerRect) + sideRect - coveredArea).isEmpty());
+}
+
+QTEST_MAIN(KisTileAlignedRegionTest)
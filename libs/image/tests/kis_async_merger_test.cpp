@@ -25,6 +25,7 @@
 #include <QTest>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
+#include <KoColor.h>
 #include "kis_image.h"
 #include "kis_paint_layer.h"
 #include "kis_group_layer.h"
@@ -32,6 +33,7 @@
 #include "kis_adjustment_layer.h"
 #include "kis_filter_mask.h"
 #include "kis_selection.h"
+#include "kis_datamanager.h"
 
 #include "filter/kis_filter.h"
 #include "filter/kis_filter_configuration.h"
@@ -123,6 +125,166 @@ void KisAsyncMergerTest::testMerger()
 }
 
 
+/**
+ * The same graph as in testMerger(), but the whole image is
+ * updated at once, so the merger splits the rect into patches
+ * and processes them in parallel. The blur adjustment layer
+ * reads the pixels outside the patches.
+ */
+void KisAsyncMergerTest::testParallelMerge()
+{
+    const KoColorSpace * colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 640, 441, colorSpace, "merger test");
+
+    QImage sourceImage1(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    QImage sourceImage2(QString(FILES_DATA_DIR) + QDir::separator() + "inverted_hakonepa.png");
+    QImage referenceProjection(QString(FILES_DATA_DIR) + QDir::separator() + "merged_hakonepa.png");
+
+    KisPaintDeviceSP device1 = new KisPaintDevice(colorSpace);
+    KisPaintDeviceSP device2 = new KisPaintDevice(colorSpace);
+    device1->convertFromQImage(sourceImage1, 0, 0, 0);
+    device2->convertFromQImage(sourceImage2, 0, 0, 0);
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value("blur");
+    Q_ASSERT(filter);
+    KisFilterConfigurationSP configuration = filter->defaultConfiguration();
+    Q_ASSERT(configuration);
+
+    KisLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8, device1);
+    KisLayerSP paintLayer2 = new KisPaintLayer(image, "paint2", OPACITY_OPAQUE_U8, device2);
+    KisLayerSP groupLayer = new KisGroupLayer(image, "group", 200/*OPACITY_OPAQUE*/);
+    KisLayerSP blur1 = new KisAdjustmentLayer(image, "blur1", configuration, 0);
+
+    image->addNode(paintLayer1, image->rootLayer());
+    image->addNode(groupLayer, image->rootLayer());
+
+    image->addNode(paintLayer2, groupLayer);
+    image->addNode(blur1, groupLayer);
+
+    QRect cropRect(image->bounds());
+
+    KisMergeWalker walker(cropRect);
+    KisAsyncMerger merger;
+
+    walker.collectRects(paintLayer2, image->bounds());
+    merger.startMerge(walker);
+
+    KisLayerSP rootLayer = image->rootLayer();
+    QVERIFY(rootLayer->exactBounds() == image->bounds());
+
+    QImage resultProjection = rootLayer->projection()->convertToQImage(0);
+    QPoint pt;
+    QVERIFY(TestUtil::compareQImages(pt, resultProjection, referenceProjection, 5, 0, 0));
+}
+
+void KisAsyncMergerTest::testGroupProjectionCache()
+{
+    const KoColorSpace * colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 640, 441, colorSpace, "merger test");
+
+    KisLayerSP groupLayer = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+    image->addNode(groupLayer, image->rootLayer());
+
+    const QColor colors[] = {Qt::red, Qt::green, Qt::blue, Qt::yellow, Qt::cyan};
+    QVector<KisLayerSP> layers;
+
+    for (int i = 0; i < 5; i++) {
+        KisPaintDeviceSP device = new KisPaintDevice(colorSpace);
+        device->fill(QRect(i * 60, i * 40, 320, 240), KoColor(colors[i], colorSpace));
+
+        KisLayerSP layer = new KisPaintLayer(image, QString("paint%1").arg(i), 128, device);
+        image->addNode(layer, groupLayer);
+        layers << layer;
+    }
+
+    KisGroupLayer *group = qobject_cast<KisGroupLayer*>(groupLayer.data());
+    KisLayerSP topLayer = layers.last();
+
+    QRect cropRect(image->bounds());
+    KisMergeWalker walker(cropRect);
+    KisAsyncMerger merger;
+
+    // the first update fills the cache...
+    walker.collectRects(topLayer, image->bounds());
+    merger.startMerge(walker);
+    QCOMPARE(group->projectionCacheChild(), KisNodeSP(topLayer));
+
+    QImage referenceProjection = image->rootLayer()->projection()->convertToQImage(0);
+
+    // ... and the second one uses it
+    walker.collectRects(topLayer, image->bounds());
+    merger.startMerge(walker);
+
+    QPoint pt;
+    QImage resultProjection = image->rootLayer()->projection()->convertToQImage(0);
+    QVERIFY(TestUtil::compareQImages(pt, resultProjection, referenceProjection));
+
+    // an update of a lower layer invalidates the cache
+    KisPaintDeviceSP lowerDevice = layers[1]->paintDevice();
+    lowerDevice->fill(QRect(100, 100, 200, 200), KoColor(Qt::magenta, colorSpace));
+
+    walker.collectRects(layers[1], image->bounds());
+    merger.startMerge(walker);
+    QVERIFY(!group->projectionCacheChild());
+
+    referenceProjection = image->rootLayer()->projection()->convertToQImage(0);
+
+    for (int i = 0; i < 2; i++) {
+        walker.collectRects(topLayer, image->bounds());
+        merger.startMerge(walker);
+
+        resultProjection = image->rootLayer()->projection()->convertToQImage(0);
+        QVERIFY(TestUtil::compareQImages(pt, resultProjection, referenceProjection));
+    }
+
+    // adding a child invalidates the cache as well
+    KisLayerSP newLayer = new KisPaintLayer(image, "new", OPACITY_OPAQUE_U8);
+    image->addNode(newLayer, groupLayer, layers.first());
+    QVERIFY(!group->projectionCacheChild());
+}
+
+void KisAsyncMergerTest::testSharedProjection()
+{
+    const KoColorSpace * colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 640, 441, colorSpace, "merger test");
+
+    KisPaintDeviceSP device1 = new KisPaintDevice(colorSpace);
+    device1->fill(QRect(0, 0, 320, 240), KoColor(Qt::red, colorSpace));
+
+    KisLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8, device1);
+    KisLayerSP paintLayer2 = new KisPaintLayer(image, "hidden", OPACITY_OPAQUE_U8);
+    KisLayerSP groupLayer = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+    paintLayer2->setVisible(false);
+
+    image->addNode(groupLayer, image->rootLayer());
+    image->addNode(paintLayer1, groupLayer);
+    image->addNode(paintLayer2, groupLayer);
+
+    QRect cropRect(image->bounds());
+    KisMergeWalker walker(cropRect);
+    KisAsyncMerger merger;
+
+    walker.collectRects(paintLayer1, image->bounds());
+    merger.startMerge(walker);
+
+    // the hidden layer doesn't let the group oblige its child...
+    KisPaintDeviceSP groupOriginal = groupLayer->original();
+    QVERIFY(groupOriginal != device1);
+
+    QPoint pt;
+    QVERIFY(TestUtil::compareQImages(pt,
+                                     groupOriginal->convertToQImage(0, 0, 0, 640, 441),
+                                     device1->convertToQImage(0, 0, 0, 640, 441)));
+
+    // ... but the tiles are still shared with it
+    bool existingTile = false;
+    KisTileSP srcTile = device1->dataManager()->getReadOnlyTileLazy(0, 0, existingTile);
+    KisTileSP dstTile = groupOriginal->dataManager()->getReadOnlyTileLazy(0, 0, existingTile);
+    QVERIFY(existingTile);
+    QCOMPARE(dstTile->tileData(), srcTile->tileData());
+}
+
+
 /**
  * This in not fully automated test for child obliging in KisAsyncMerger.
  * It just checks whether devices are shared. To check if the merger
@@ -27,6 +27,9 @@ class KisAsyncMergerTest : public QObject
 
 private Q_SLOTS:
     void testMerger();
+    void testParallelMerge();
+    void testGroupProjectionCache();
+    void testSharedProjection();
     void debugObligeChild();
     void testFullRefreshWithClones();
     void testSubgraphingWithoutUpdatingParent();
@@ -29,6 +29,7 @@
 #include "filter/kis_filter_configuration.h"
 #include "filter/kis_filter_registry.h"
 #include "kis_selection.h"
+#include "kis_image_config.h"
 
 #include "kis_update_job_item.h"
 #include "kis_simple_update_queue.h"
@@ -275,6 +276,77 @@ void KisSimpleUpdateQueueTest::testSpontaneousJobsCompression()
     QCOMPARE(jobsList.size(), 1);
     QCOMPARE(jobsList[0], job3);
 }
+void KisSimpleUpdateQueueTest::testAdaptivePatches()
+{
+    QRect imageRect(0,0,1024,1024);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    {
+        KisImageConfig config(false);
+        config.setAdaptiveUpdatePatches(true);
+    }
+
+    KisTestableSimpleUpdateQueue queue;
+    KisWalkersList& walkersList = queue.getWalkersList();
+
+    /**
+     * Teach the model that the update of the node is very expensive
+     * regardless of its size, like a filter with a huge need rect
+     */
+    const qreal overhead = 100e6;
+    const qreal pixelCost = 0.001;
+
+    for (int i = 0; i < 2; i++) {
+        for (int size = 64; size <= 1024; size *= 2) {
+            const qint64 area = size * size;
+            queue.costModel()->recordUpdate(paintLayer, QRect(0, 0, size, size),
+                                            qint64(overhead + pixelCost * area));
+        }
+    }
+
+    QVector<KisUpdateCostModel::NodeCost> costs = queue.costModel()->learnedCosts();
+    QCOMPARE(costs.size(), 1);
+    QCOMPARE(costs[0].nodeName, QString("test"));
+    QCOMPARE(costs[0].numSamples, 10);
+    QVERIFY(qAbs(costs[0].overheadNs - overhead) < 0.01 * overhead);
+    QVERIFY(qAbs(costs[0].pixelsPerSecond - 1e9 / pixelCost) < 0.01 * 1e9 / pixelCost);
+
+    // splitting doesn't pay off
+    queue.addUpdateJob(paintLayer, QRect(0,0,1000,1000), imageRect, 0);
+    QCOMPARE(walkersList.size(), 1);
+    QVERIFY(checkWalker(walkersList[0], QRect(0,0,1000,1000)));
+
+    walkersList.clear();
+
+    // the overlapping updates are merged even though alpha > maxMergeAlpha
+    queue.addUpdateJob(paintLayer, QRect(0,0,100,100), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(50,50,100,100), imageRect, 0);
+    QCOMPARE(walkersList.size(), 1);
+    QVERIFY(checkWalker(walkersList[0], QRect(0,0,150,150)));
+
+    walkersList.clear();
+
+    // and even when the result is bigger than the static patch size
+    queue.addUpdateJob(paintLayer, QRect(0,0,400,400), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(300,300,400,400), imageRect, 0);
+    QCOMPARE(walkersList.size(), 1);
+    QVERIFY(checkWalker(walkersList[0], QRect(0,0,700,700)));
+
+    walkersList.clear();
+
+    {
+        KisImageConfig config(false);
+        config.setAdaptiveUpdatePatches(config.adaptiveUpdatePatches(true));
+    }
+}
 
 QTEST_MAIN(KisSimpleUpdateQueueTest)
 
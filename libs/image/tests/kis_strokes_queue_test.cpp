@@ -24,6 +24,7 @@
 #include "kis_updater_context.h"
 #include "kis_update_job_item.h"
 #include "kis_merge_walker.h"
+#include <sdk/tests/testing_nodes.h>
 
 
 void KisStrokesQueueTest::testSequentialJobs()
@@ -836,4 +837,286 @@ void KisStrokesQueueTest::testUniquelyConcurrentJobs()
 }
 
 
+struct PreemptionTestingNode : public TestUtil::DefaultNode
+{
+    KisNodeSP clone() const override {
+        return new PreemptionTestingNode(*this);
+    }
+};
+
+void KisStrokesQueueTest::testBackgroundStrokePreemption()
+{
+    KisNodeSP layer1 = new PreemptionTestingNode();
+    KisNodeSP layer2 = new PreemptionTestingNode();
+
+    LodStrokesQueueTester t;
+    KisStrokesQueue &queue = t.queue;
+
+    KisTestingStrokeStrategy *backgroundStrategy = new KisTestingStrokeStrategy("bg_", false);
+    backgroundStrategy->setPriority(KisStrokeStrategy::BACKGROUND);
+    backgroundStrategy->setAffectedNodes({layer1});
+
+    KisStrokeId id1 = queue.startStroke(backgroundStrategy);
+    queue.addJob(id1, 0);
+    queue.endStroke(id1);
+
+    KisTestingStrokeStrategy *interactiveStrategy = new KisTestingStrokeStrategy("int_", false);
+    interactiveStrategy->setPriority(KisStrokeStrategy::INTERACTIVE);
+    interactiveStrategy->setAffectedNodes({layer2});
+
+    KisStrokeId id2 = queue.startStroke(interactiveStrategy);
+    queue.addJob(id2, 0);
+    queue.endStroke(id2);
+
+    // the interactive stroke jumps over the background one
+    t.processQueue();
+    t.checkOnlyJob("int_init");
+
+    t.processQueue();
+    t.checkOnlyJob("int_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("int_finish");
+
+    t.processQueue();
+    t.checkOnlyJob("bg_init");
+
+    t.processQueue();
+    t.checkOnlyJob("bg_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("bg_finish");
+
+    t.processQueue();
+    t.checkNothing();
+
+    KisStrokeLatencyStatistics latency = queue.interactiveLatency();
+    QCOMPARE(latency.numJobs, 3);
+    QCOMPARE(latency.numPreemptions, 1);
+    QVERIFY(latency.maxLatencyNs >= 0);
+
+    queue.resetInteractiveLatency();
+    QCOMPARE(queue.interactiveLatency().numJobs, 0);
+}
+
+void KisStrokesQueueTest::testUnstartedBackgroundStrokeSameNode()
+{
+    KisNodeSP layer1 = new PreemptionTestingNode();
+
+    LodStrokesQueueTester t;
+    KisStrokesQueue &queue = t.queue;
+
+    KisTestingStrokeStrategy *filterStrategy = new KisTestingStrokeStrategy("filter_", false);
+    filterStrategy->setPriority(KisStrokeStrategy::BACKGROUND);
+    filterStrategy->setAffectedNodes({layer1});
+
+    KisStrokeId id1 = queue.startStroke(filterStrategy);
+    queue.addJob(id1, 0);
+    queue.endStroke(id1);
+
+    KisTestingStrokeStrategy *brushStrategy = new KisTestingStrokeStrategy("brush_", false);
+    brushStrategy->setPriority(KisStrokeStrategy::INTERACTIVE);
+    brushStrategy->setAffectedNodes({layer1});
+
+    KisStrokeId id2 = queue.startStroke(brushStrategy);
+    queue.addJob(id2, 0);
+    queue.endStroke(id2);
+
+    // the user filtered the layer before painting on it, keep the order
+    t.processQueue();
+    t.checkOnlyJob("filter_init");
+
+    t.processQueue();
+    t.checkOnlyJob("filter_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("filter_finish");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_init");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_finish");
+
+    t.processQueue();
+    t.checkNothing();
+
+    QCOMPARE(queue.interactiveLatency().numPreemptions, 0);
+}
+
+/**
+ * Mimics the filter stroke: it can be suspended, but keeps
+ * a transaction open on its node after the initialization
+ */
+class KisSuspendableTestingStrokeStrategy : public KisTestingStrokeStrategy
+{
+public:
+    KisSuspendableTestingStrokeStrategy(const QString &prefix)
+        : KisTestingStrokeStrategy(prefix, false),
+          m_prefix(prefix)
+    {
+    }
+
+    KisStrokeJobStrategy* createSuspendStrategy() override {
+        return new KisNoopDabStrategy(m_prefix + "suspend");
+    }
+
+    KisStrokeJobStrategy* createResumeStrategy() override {
+        return new KisNoopDabStrategy(m_prefix + "resume");
+    }
+
+private:
+    QString m_prefix;
+};
+
+void KisStrokesQueueTest::testStartedBackgroundStrokePreemption()
+{
+    KisNodeSP layer1 = new PreemptionTestingNode();
+    KisNodeSP layer2 = new PreemptionTestingNode();
+
+    LodStrokesQueueTester t;
+    KisStrokesQueue &queue = t.queue;
+
+    KisSuspendableTestingStrokeStrategy *filterStrategy =
+        new KisSuspendableTestingStrokeStrategy("filter_");
+    filterStrategy->setPriority(KisStrokeStrategy::BACKGROUND);
+    filterStrategy->setAffectedNodes({layer1});
+
+    KisStrokeId id1 = queue.startStroke(filterStrategy);
+    queue.addJob(id1, 0);
+    queue.endStroke(id1);
+
+    t.processQueue();
+    t.checkOnlyJob("filter_init");
+
+    // the brush paints on the layer being filtered
+    KisTestingStrokeStrategy *brushStrategy = new KisTestingStrokeStrategy("brush_", false);
+    brushStrategy->setPriority(KisStrokeStrategy::INTERACTIVE);
+    brushStrategy->setAffectedNodes({layer1});
+
+    KisStrokeId id2 = queue.startStroke(brushStrategy);
+    queue.addJob(id2, 0);
+    queue.endStroke(id2);
+
+    // the filter has already opened its transaction, so it is not preempted
+    t.processQueue();
+    t.checkOnlyJob("filter_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("filter_finish");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_init");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_finish");
+
+    t.processQueue();
+    t.checkNothing();
+
+    QCOMPARE(queue.interactiveLatency().numPreemptions, 0);
+
+    // the same, but the brush paints on another layer
+    filterStrategy = new KisSuspendableTestingStrokeStrategy("filter_");
+    filterStrategy->setPriority(KisStrokeStrategy::BACKGROUND);
+    filterStrategy->setAffectedNodes({layer1});
+
+    id1 = queue.startStroke(filterStrategy);
+    queue.addJob(id1, 0);
+    queue.endStroke(id1);
+
+    t.processQueue();
+    t.checkOnlyJob("filter_init");
+
+    brushStrategy = new KisTestingStrokeStrategy("brush_", false);
+    brushStrategy->setPriority(KisStrokeStrategy::INTERACTIVE);
+    brushStrategy->setAffectedNodes({layer2});
+
+    id2 = queue.startStroke(brushStrategy);
+    queue.addJob(id2, 0);
+    queue.endStroke(id2);
+
+    t.processQueue();
+    t.checkOnlyJob("filter_suspend");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_init");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("brush_finish");
+
+    t.processQueue();
+    t.checkOnlyJob("filter_resume");
+
+    t.processQueue();
+    t.checkOnlyJob("filter_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("filter_finish");
+
+    t.processQueue();
+    t.checkNothing();
+
+    QCOMPARE(queue.interactiveLatency().numPreemptions, 1);
+}
+
+void KisStrokesQueueTest::testAdaptiveLevelOfDetail()
+{
+    LodStrokesQueueTester t;
+    KisStrokesQueue &queue = t.queue;
+
+    /**
+     * The target latency is 1ms, the jobs below wait longer than
+     * that, so the level is raised. The recovery latency of 0 is
+     * never reached, so the level is never lowered back.
+     */
+    queue.setAdaptiveLevelOfDetail(true, 1000000, 0, 2);
+    QCOMPARE(queue.adaptiveLevelOfDetail(), 0);
+
+    KisTestingStrokeStrategy *strategy = new KisTestingStrokeStrategy("slow_", false);
+    strategy->setPriority(KisStrokeStrategy::INTERACTIVE);
+
+    KisStrokeId id1 = queue.startStroke(strategy);
+    queue.addJob(id1, 0);
+    queue.endStroke(id1);
+
+    // all the jobs of the stroke wait in the queue for too long
+    QTest::qSleep(5);
+
+    t.processQueue();
+    t.checkOnlyJob("slow_init");
+
+    t.processQueue();
+    t.checkOnlyJob("slow_dab");
+
+    t.processQueue();
+    t.checkOnlyJob("slow_finish");
+
+    // the stroke is finished and the LoD planes are synchronized
+    t.processQueue();
+    t.checkOnlyJob("sync_u_init");
+    QCOMPARE(queue.adaptiveLevelOfDetail(), 1);
+
+    // the next stroke is painted on the coarser level
+    KisStrokeId id2 = queue.startStroke(new KisTestingStrokeStrategy("lod_", false, true));
+    queue.addJob(id2, new KisTestingStrokeJobData(KisStrokeJobData::CONCURRENT));
+    queue.endStroke(id2);
+
+    t.processQueue();
+    t.checkOnlyJob("clone1_lod_dab");
+
+    // blocking the LoD switches the adaptive mode off
+    queue.setAdaptiveLevelOfDetailAllowed(false);
+    QCOMPARE(queue.adaptiveLevelOfDetail(), 0);
+}
+
 QTEST_MAIN(KisStrokesQueueTest)
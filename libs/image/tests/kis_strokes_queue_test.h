@@ -41,6 +41,10 @@ private Q_SLOTS:
     void testLodUndoBase2();
     void testMutatedJobs();
     void testUniquelyConcurrentJobs();
+    void testBackgroundStrokePreemption();
+    void testUnstartedBackgroundStrokeSameNode();
+    void testStartedBackgroundStrokePreemption();
+    void testAdaptiveLevelOfDetail();
 
 private:
     struct LodStrokesQueueTester;
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_trace_recorder_test.h"
+
+#include <QTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtConcurrent>
+
+#include "kis_trace_recorder.h"
+
+
+void KisTraceRecorderTest::testDisabled()
+{
+    KisTraceRecorder *recorder = KisTraceRecorder::instance();
+    recorder->setEnabled(true);
+    recorder->setEnabled(false);
+
+    {
+        KisTraceScope trace("test", "disabled scope");
+        QVERIFY(!trace.isActive());
+    }
+
+    QCOMPARE(recorder->numEvents(), 0);
+}
+
+void KisTraceRecorderTest::testRecording()
+{
+    KisTraceRecorder *recorder = KisTraceRecorder::instance();
+    recorder->setEnabled(true);
+
+    QVector<int> jobs(16);
+    QtConcurrent::blockingMap(jobs, [] (int &) {
+        KisTraceScope trace("test", "job");
+        QTest::qSleep(1);
+    });
+
+    recorder->setEnabled(false);
+
+    QCOMPARE(recorder->numEvents(), 16);
+    QCOMPARE(recorder->numDroppedEvents(), 0);
+
+    // the events are reset when the recording starts again
+    recorder->setEnabled(true);
+    QCOMPARE(recorder->numEvents(), 0);
+    recorder->setEnabled(false);
+}
+
+void KisTraceRecorderTest::testChromeTraceFormat()
+{
+    KisTraceRecorder *recorder = KisTraceRecorder::instance();
+    recorder->setEnabled(true);
+
+    {
+        KisTraceScope trace("test", "outer");
+        trace.setDetails("some details");
+
+        KisTraceScope innerTrace("test", "inner");
+        QTest::qSleep(1);
+    }
+
+    recorder->setEnabled(false);
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(recorder->toChromeTraceJson(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QJsonArray events = doc.object()["traceEvents"].toArray();
+
+    QJsonObject outer;
+    QJsonObject inner;
+    bool hasThreadName = false;
+
+    Q_FOREACH (const QJsonValue &value, events) {
+        QJsonObject event = value.toObject();
+
+        if (event["ph"].toString() == "M") {
+            hasThreadName |= event["name"].toString() == "thread_name";
+        } else if (event["name"].toString() == "outer") {
+            outer = event;
+        } else if (event["name"].toString() == "inner") {
+            inner = event;
+        }
+    }
+
+    QVERIFY(hasThreadName);
+    QCOMPARE(outer["ph"].toString(), QString("X"));
+    QCOMPARE(outer["cat"].toString(), QString("test"));
+    QCOMPARE(outer["args"].toObject()["details"].toString(), QString("some details"));
+    QCOMPARE(outer["tid"].toInt(), inner["tid"].toInt());
+
+    // the inner scope is nested into the outer one
+    QVERIFY(outer["ts"].toDouble() <= inner["ts"].toDouble());
+    QVERIFY(outer["ts"].toDouble() + outer["dur"].toDouble() >=
+            inner["ts"].toDouble() + inner["dur"].toDouble());
+    QVERIFY(inner["dur"].toDouble() >= 1000.0);
+}
+
+QTEST_MAIN(KisTraceRecorderTest)
@@ -216,6 +216,9 @@ public:
         m_prefix = QString("clone%1_%2").arg(levelOfDetail).arg(m_prefix);
     }
 
+    using KisStrokeStrategy::setPriority;
+    using KisStrokeStrategy::setAffectedNodes;
+
     KisStrokeJobStrategy* createInitStrategy() override {
         return m_forceAllowInitJob || !m_inhibitServiceJobs ?
             new KisNoopDabStrategy(m_prefix + "init") : 0;
@@ -235,7 +235,9 @@ void KisTiledExtentManager::Data::updateMax()
     }
 }
 
-KisTiledExtentManager::KisTiledExtentManager()
+KisTiledExtentManager::KisTiledExtentManager(qint32 tileWidth, qint32 tileHeight)
+    : m_tileWidth(tileWidth),
+      m_tileHeight(tileHeight)
 {
     QWriteLocker l(&m_extentLock);
     m_currentExtent = QRect(qint32_MAX, qint32_MAX, 0, 0);
@@ -306,8 +308,8 @@ void KisTiledExtentManager::updateExtent()
             minX = qint32_MAX;
             maxX = 0;
         } else {
-            minX = m_colsData.min() * KisTileData::WIDTH;
-            maxX = (m_colsData.max() + 1) * KisTileData::WIDTH - minX;
+            minX = m_colsData.min() * m_tileWidth;
+            maxX = (m_colsData.max() + 1) * m_tileWidth - minX;
         }
     }
 
@@ -318,8 +320,8 @@ void KisTiledExtentManager::updateExtent()
             minY = qint32_MAX;
             maxY = 0;
         } else {
-            minY = m_rowsData.min() * KisTileData::HEIGHT;
-            maxY = (m_rowsData.max() + 1) * KisTileData::HEIGHT - minY;
+            minY = m_rowsData.min() * m_tileHeight;
+            maxY = (m_rowsData.max() + 1) * m_tileHeight - minY;
         }
     }
 
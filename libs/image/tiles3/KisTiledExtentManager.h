@@ -66,7 +66,7 @@ class KRITAIMAGE_EXPORT KisTiledExtentManager
     };
 
 public:
-    KisTiledExtentManager();
+    KisTiledExtentManager(qint32 tileWidth, qint32 tileHeight);
 
     void notifyTileAdded(qint32 col, qint32 row);
     void notifyTileRemoved(qint32 col, qint32 row);
@@ -80,6 +80,8 @@ private:
 private:
     mutable QReadWriteLock m_extentLock;
     QRect m_currentExtent;
+    const qint32 m_tileWidth;
+    const qint32 m_tileHeight;
     Data m_colsData;
     Data m_rowsData;
 };
@@ -31,6 +31,8 @@ protected:
     KisBaseIterator(KisTiledDataManager * _dataManager, bool _writable, KisIteratorCompleteListener *listener) {
         m_dataManager = _dataManager;
         m_pixelSize = m_dataManager->pixelSize();
+        m_tileWidth = m_dataManager->tileWidth();
+        m_tileHeight = m_dataManager->tileHeight();
         m_writable = _writable;
         m_completeListener = listener;
     }
@@ -42,6 +44,8 @@ protected:
 
     KisTiledDataManager *m_dataManager;
     qint32 m_pixelSize;        // bytes per pixel
+    qint32 m_tileWidth;        // tile dimensions of the data manager
+    qint32 m_tileHeight;
     bool m_writable;
     inline void lockTile(KisTileSP &tile) {
         if (m_writable)
@@ -65,11 +69,11 @@ protected:
     }
 
     inline qint32 calcXInTile(qint32 x, qint32 col) const {
-        return x - col * KisTileData::WIDTH;
+        return x - col * m_tileWidth;
     }
 
     inline qint32 calcYInTile(qint32 y, qint32 row) const {
-        return y - row * KisTileData::HEIGHT;
+        return y - row * m_tileHeight;
     }
     
 private:
@@ -17,6 +17,7 @@
  */
 
 #include "kis_hline_iterator.h"
+#include "kis_tile_data_store.h"
 
 
 KisHLineIterator2::KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *competionListener)
@@ -51,17 +52,13 @@ KisHLineIterator2::KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint
     m_row = yToRow(m_y);
     m_yInTile = calcYInTile(m_y, m_row);
 
-    m_leftInLeftmostTile = m_left - m_leftCol * KisTileData::WIDTH;
+    m_leftInLeftmostTile = m_left - m_leftCol * m_tileWidth;
 
     m_tilesCacheSize = m_rightCol - m_leftCol + 1;
     m_tilesCache.resize(m_tilesCacheSize);
 
-    m_tileWidth = m_pixelSize * KisTileData::HEIGHT;
-
     // let's prealocate first row
-    for (quint32 i = 0; i < m_tilesCacheSize; i++){
-        fetchTileDataForCache(m_tilesCache[i], m_leftCol + i, m_row);
-    }
+    fetchTileRow();
     m_index = 0;
     switchToTile(m_leftInLeftmostTile);
 }
@@ -114,7 +111,7 @@ void KisHLineIterator2::nextRow()
     m_x = m_left;
     ++m_y;
 
-    if (++m_yInTile < KisTileData::HEIGHT) {
+    if (++m_yInTile < m_tileHeight) {
         /* do nothing, usual case */
     } else {
         ++m_row;
@@ -192,19 +189,17 @@ void KisHLineIterator2::switchToTile(qint32 xInTile)
     m_data = m_tilesCache[m_index].data;
     m_oldData = m_tilesCache[m_index].oldData;
 
-    int offset_row = m_pixelSize * (m_yInTile * KisTileData::WIDTH);
+    int offset_row = m_pixelSize * (m_yInTile * m_tileWidth);
     m_data += offset_row;
-    m_rightmostInTile = (m_leftCol + m_index + 1) * KisTileData::WIDTH - 1;
+    m_rightmostInTile = (m_leftCol + m_index + 1) * m_tileWidth - 1;
     int offset_col = m_pixelSize * xInTile;
     m_data  += offset_col;
     m_oldData += offset_row + offset_col;
 }
 
 
-void KisHLineIterator2::fetchTileDataForCache(KisTileInfo& kti, qint32 col, qint32 row)
+void KisHLineIterator2::lockTileDataForCache(KisTileInfo& kti)
 {
-    m_dataManager->getTilesPair(col, row, m_writable, &kti.tile, &kti.oldtile);
-
     lockTile(kti.tile);
     kti.data = kti.tile->data();
 
@@ -212,13 +207,48 @@ void KisHLineIterator2::fetchTileDataForCache(KisTileInfo& kti, qint32 col, qint
     kti.oldData = kti.oldtile->data();
 }
 
+void KisHLineIterator2::fetchTileRow()
+{
+    for (quint32 i = 0; i < m_tilesCacheSize; ++i) {
+        KisTileInfo &kti = m_tilesCache[i];
+        m_dataManager->getTilesPair(m_leftCol + i, m_row, m_writable, &kti.tile, &kti.oldtile);
+    }
+
+    prefetchTileRow();
+
+    for (quint32 i = 0; i < m_tilesCacheSize; ++i) {
+        lockTileDataForCache(m_tilesCache[i]);
+    }
+}
+
+void KisHLineIterator2::prefetchTileRow()
+{
+    /**
+     * The tiles of the row are already taken from the hash table, so
+     * when nothing is swapped out the prefetching costs nothing
+     */
+    if (m_tilesCacheSize > 1 && KisTileDataStore::instance()->numTilesSwapped()) {
+        QVector<KisTileSP> tiles;
+        tiles.reserve(2 * m_tilesCacheSize);
+
+        for (quint32 i = 0; i < m_tilesCacheSize; ++i) {
+            tiles.append(m_tilesCache[i].tile);
+            if (m_tilesCache[i].oldtile != m_tilesCache[i].tile) {
+                tiles.append(m_tilesCache[i].oldtile);
+            }
+        }
+
+        m_dataManager->prefetchSwappedTiles(tiles);
+    }
+}
+
 void KisHLineIterator2::preallocateTiles()
 {
     for (quint32 i = 0; i < m_tilesCacheSize; ++i){
         unlockTile(m_tilesCache[i].tile);
         unlockTile(m_tilesCache[i].oldtile);
-        fetchTileDataForCache(m_tilesCache[i], m_leftCol + i, m_row);
     }
+    fetchTileRow();
 }
 
 qint32 KisHLineIterator2::x() const
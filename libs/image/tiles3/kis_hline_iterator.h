@@ -61,7 +61,6 @@ private:
     qint32 m_y;        // current y position
     qint32 m_row;    // current row in tilemgr
     quint32 m_index;    // current col in tilemgr
-    quint32 m_tileWidth;
     quint8 *m_data;
     quint8 *m_oldData;
     bool m_havePixels;
@@ -83,7 +82,9 @@ private:
 private:
 
     void switchToTile(qint32 xInTile);
-    void fetchTileDataForCache(KisTileInfo& kti, qint32 col, qint32 row);
+    void lockTileDataForCache(KisTileInfo& kti);
+    void fetchTileRow();
     void preallocateTiles();
+    void prefetchTileRow();
 };
 #endif
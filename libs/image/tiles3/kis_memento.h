@@ -87,11 +87,11 @@ public:
 private:
     friend class KisMementoManager;
 
-    inline void updateExtent(qint32 col, qint32 row) {
-        const qint32 tileMinX = col * KisTileData::WIDTH;
-        const qint32 tileMinY = row * KisTileData::HEIGHT;
-        const qint32 tileMaxX = tileMinX + KisTileData::WIDTH - 1;
-        const qint32 tileMaxY = tileMinY + KisTileData::HEIGHT - 1;
+    inline void updateExtent(const QRect &tileExtent) {
+        const qint32 tileMinX = tileExtent.left();
+        const qint32 tileMinY = tileExtent.top();
+        const qint32 tileMaxX = tileExtent.right();
+        const qint32 tileMaxY = tileExtent.bottom();
 
         m_extentMinX = qMin(m_extentMinX, tileMinX);
         m_extentMaxX = qMax(m_extentMaxX, tileMaxX);
@@ -76,7 +76,8 @@
 KisMementoManager::KisMementoManager()
     : m_index(0),
       m_headsHashTable(0),
-      m_registrationBlocked(false)
+      m_registrationBlocked(false),
+      m_historicalMemorySize(0)
 {
     /**
      * Tile change/delete registration is enabled for all
@@ -90,7 +91,8 @@ KisMementoManager::KisMementoManager(const KisMementoManager& rhs)
         m_cancelledRevisions(rhs.m_cancelledRevisions),
         m_headsHashTable(rhs.m_headsHashTable, 0),
         m_currentMemento(rhs.m_currentMemento),
-        m_registrationBlocked(rhs.m_registrationBlocked)
+        m_registrationBlocked(rhs.m_registrationBlocked),
+        m_historicalMemorySize(rhs.m_historicalMemorySize)
 {
     Q_ASSERT_X(!m_registrationBlocked,
                "KisMementoManager", "(impossible happened) "
@@ -136,7 +138,7 @@ void KisMementoManager::registerTileChange(KisTile *tile)
         m_index.addTile(mi);
 
         if(namedTransactionInProgress())
-            m_currentMemento->updateExtent(mi->col(), mi->row());
+            m_currentMemento->updateExtent(tile->extent());
     }
     else {
         mi->reset();
@@ -158,7 +160,7 @@ void KisMementoManager::registerTileDeleted(KisTile *tile)
         m_index.addTile(mi);
 
         if(namedTransactionInProgress())
-            m_currentMemento->updateExtent(mi->col(), mi->row());
+            m_currentMemento->updateExtent(tile->extent());
     }
     else {
         mi->reset();
@@ -187,10 +189,28 @@ void KisMementoManager::commit()
     KisMementoItemSP parentMI;
     bool newTile;
 
+    /**
+     * The previous versions of the changed tiles are now used by
+     * the history only, so they can be compressed
+     */
+    QVector<KisTileData*> historicalTileData;
+    KisTileData *defaultTileData = m_headsHashTable.defaultTileData();
+
     KisMementoItemHashTableIterator iter(&m_index);
     while ((mi = iter.tile())) {
         parentMI = m_headsHashTable.getTileLazy(mi->col(), mi->row(), newTile);
 
+        KisTileData *parentTileData = parentMI->tileData();
+        if (parentTileData &&
+            parentTileData != defaultTileData &&
+            parentTileData->historical()) {
+
+            historicalTileData.append(parentTileData);
+        }
+
+        // the previous version of the tile now belongs to the undo history
+        m_historicalMemorySize += historicalDataSize(parentTileData);
+
         mi->setParent(parentMI);
         mi->commit();
         revisionList.append(mi);
@@ -211,6 +231,8 @@ void KisMementoManager::commit()
 
     DEBUG_DUMP_MESSAGE("COMMIT_DONE");
 
+    KisTileDataStore::instance()->scheduleHistoryCompression(historicalTileData);
+
     // Waking up pooler to prepare copies for us
     KisTileDataStore::instance()->kickPooler();
 }
@@ -238,6 +260,11 @@ KisMementoSP KisMementoManager::getMemento()
     Q_ASSERT(!namedTransactionInProgress());
 
     // Clear redo() information
+    Q_FOREACH (const KisHistoryItem &changeList, m_cancelledRevisions) {
+        Q_FOREACH (KisMementoItemSP mi, changeList.itemList) {
+            m_historicalMemorySize -= historicalDataSize(mi->tileData());
+        }
+    }
     m_cancelledRevisions.clear();
 
     commit();
@@ -281,6 +308,10 @@ void KisMementoManager::rollback(KisTileHashTable *ht)
         m_headsHashTable.deleteTile(parentMI->col(), parentMI->row());
         m_headsHashTable.addTile(parentMI);
 
+        // the versions swap: the parent goes to HEAD, the undone one to redo history
+        m_historicalMemorySize -= historicalDataSize(parentMI->tileData());
+        m_historicalMemorySize += historicalDataSize(mi->tileData());
+
         // This is not necessary
         //mi->setParent(0);
     }
@@ -326,6 +357,9 @@ void KisMementoManager::rollforward(KisTileHashTable *ht)
         if (mi->type() == KisMementoItem::CHANGED)
             ht->addTile(mi->tile(this));
 
+        // commit() below will account the parent instead
+        m_historicalMemorySize -= historicalDataSize(mi->tileData());
+
         m_index.addTile(mi);
     }
     // see comment in rollback()
@@ -346,12 +380,15 @@ void KisMementoManager::purgeHistory(KisMementoSP oldestMemento)
     if (revisionIndex < 0) return;
 
     for(; revisionIndex > 0; revisionIndex--) {
+        m_historicalMemorySize -= parentsDataSize(m_revisions.first().itemList);
         resetRevisionHistory(m_revisions.first().itemList);
         m_revisions.removeFirst();
     }
 
     Q_ASSERT(m_revisions.first().memento == oldestMemento);
+    m_historicalMemorySize -= parentsDataSize(m_revisions.first().itemList);
     resetRevisionHistory(m_revisions.first().itemList);
+    m_historicalMemorySize += parentsDataSize(m_revisions.first().itemList);
 
     DEBUG_DUMP_MESSAGE("PURGE_HISTORY");
 }
@@ -390,6 +427,34 @@ void KisMementoManager::setDefaultTileData(KisTileData *defaultTileData)
     m_index.setDefaultTileData(defaultTileData);
 }
 
+qint64 KisMementoManager::historicalDataSize(KisTileData *td)
+{
+    /**
+     * The default tile data is checked by the flag, since the default
+     * pixel may change between the revisions
+     */
+    return td && !td->isDefault() ? td->dataSize() : 0;
+}
+
+qint64 KisMementoManager::parentsDataSize(const KisMementoItemList &list)
+{
+    qint64 size = 0;
+
+    Q_FOREACH (KisMementoItemSP mi, list) {
+        KisMementoItemSP parentMI = mi->parent();
+        if (parentMI) {
+            size += historicalDataSize(parentMI->tileData());
+        }
+    }
+
+    return size;
+}
+
+qint64 KisMementoManager::estimateHistoricalMemorySize() const
+{
+    return m_historicalMemorySize;
+}
+
 void KisMementoManager::debugPrintInfo()
 {
     printf("KisMementoManager stats:\n");
@@ -38,7 +38,13 @@ typedef QList<KisHistoryItem> KisHistoryList;
 class KisMemento;
 typedef KisSharedPtr<KisMemento> KisMementoSP;
 
-#ifdef USE_LOCK_FREE_HASH_TABLE
+#if defined(USE_SHARDED_HASH_TABLE)
+#include "kis_tile_hash_table3.h"
+
+typedef KisTileHashTableTraits3<KisMementoItem> KisMementoItemHashTable;
+typedef KisTileHashTableIteratorTraits3<KisMementoItem> KisMementoItemHashTableIterator;
+typedef KisTileHashTableIteratorTraits3<KisMementoItem> KisMementoItemHashTableIteratorConst;
+#elif defined(USE_LOCK_FREE_HASH_TABLE)
 #include "kis_tile_hash_table2.h"
 
 typedef KisTileHashTableTraits2<KisMementoItem> KisMementoItemHashTable;
@@ -50,7 +56,7 @@ typedef KisTileHashTableIteratorTraits2<KisMementoItem> KisMementoItemHashTableI
 typedef KisTileHashTableTraits<KisMementoItem> KisMementoItemHashTable;
 typedef KisTileHashTableIteratorTraits<KisMementoItem, QWriteLocker> KisMementoItemHashTableIterator;
 typedef KisTileHashTableIteratorTraits<KisMementoItem, QReadLocker> KisMementoItemHashTableIteratorConst;
-#endif // USE_LOCK_FREE_HASH_TABLE
+#endif // USE_SHARDED_HASH_TABLE
 
 
 class KRITAIMAGE_EXPORT KisMementoManager
@@ -114,6 +120,20 @@ public:
 
     void setDefaultTileData(KisTileData *defaultTileData);
 
+    /**
+     * Returns the estimated size (in bytes) of the tile data which
+     * is kept alive by the undo and redo revisions only, that is
+     * the data that is not used by the HEAD revision.
+     *
+     * The value is a running counter updated by commit(), rollback(),
+     * rollforward() and purgeHistory(), so the call is cheap. A tile
+     * data shared by several revisions is counted by each of them.
+     *
+     * The caller must ensure that no commit() or rollback() happens
+     * concurrently.
+     */
+    qint64 estimateHistoricalMemorySize() const;
+
     void debugPrintInfo();
 
 
@@ -129,6 +149,17 @@ protected:
     qint32 findRevisionByMemento(KisMementoSP memento) const;
     void resetRevisionHistory(KisMementoItemList list);
 
+    /**
+     * The size of \p td accounted in the historical memory size,
+     * that is zero for the default tile data
+     */
+    static qint64 historicalDataSize(KisTileData *td);
+
+    /**
+     * The total historical size of the parents of the items in \p list
+     */
+    static qint64 parentsDataSize(const KisMementoItemList &list);
+
 protected:
     /**
      * INDEX of tiles to be committed with next commit()
@@ -169,6 +200,15 @@ protected:
      * \see rollforward()
      */
     bool m_registrationBlocked;
+
+    /**
+     * The size of the tile data kept by the undo history (the
+     * parents of the applied revisions) and by the redo history
+     * (the items of the cancelled revisions)
+     *
+     * \see estimateHistoricalMemorySize()
+     */
+    qint64 m_historicalMemorySize;
 };
 
 #endif /* KIS_MEMENTO_MANAGER_ */
@@ -33,8 +33,9 @@ void KisTile::init(qint32 col, qint32 row,
     m_row = row;
     m_lockCounter = 0;
 
-    m_extent = QRect(m_col * KisTileData::WIDTH, m_row * KisTileData::HEIGHT,
-                     KisTileData::WIDTH, KisTileData::HEIGHT);
+    const qint32 width = defaultTileData->width();
+    const qint32 height = defaultTileData->height();
+    m_extent = QRect(m_col * width, m_row * height, width, height);
 
     m_tileData = defaultTileData;
     m_tileData->acquire();
@@ -224,9 +225,9 @@ void KisTile::debugDumpTile()
     lockForRead();
     quint8 *data = this->data();
 
-    for (int i = 0; i < KisTileData::HEIGHT; i++) {
-        for (int j = 0; j < KisTileData::WIDTH; j++) {
-            dbgTiles << data[(i*KisTileData::WIDTH+j)*pixelSize()];
+    for (int i = 0; i < m_extent.height(); i++) {
+        for (int j = 0; j < m_extent.width(); j++) {
+            dbgTiles << data[(i*m_extent.width()+j)*pixelSize()];
         }
     }
     unlock();
@@ -113,6 +113,17 @@ public:
         return m_tileData;
     }
 
+    /**
+     * Returns the current tile data with an extra reference taken,
+     * so that it cannot be freed by a concurrent copy-on-write. The
+     * caller must call deref() on the tile data when done.
+     */
+    inline KisTileData* referenceTileData() {
+        QMutexLocker locker(&m_COWMutex);
+        m_tileData->ref();
+        return m_tileData;
+    }
+
 private:
     void init(qint32 col, qint32 row,
               KisTileData *defaultTileData, KisMementoManager* mm);
@@ -23,58 +23,147 @@
 
 #include <kis_debug.h>
 
-#include <boost/pool/singleton_pool.hpp>
 #include "kis_tile_data_store_iterators.h"
+#include "kis_tile_data_slab_allocator.h"
 
-// BPP == bytes per pixel
-#define TILE_SIZE_4BPP (4 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
-#define TILE_SIZE_8BPP (8 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
+#include "config-hash-table-implementaion.h"
 
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_4BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 256, 4096> BoostPool4BPP;
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_8BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 128, 2048> BoostPool8BPP;
+#ifdef USE_SHARDED_HASH_TABLE
+#include <QThreadStorage>
+#endif /* USE_SHARDED_HASH_TABLE */
 
 const qint32 KisTileData::WIDTH = __TILE_DATA_WIDTH;
 const qint32 KisTileData::HEIGHT = __TILE_DATA_HEIGHT;
 
-SimpleCache KisTileData::m_cache;
+#ifdef USE_SHARDED_HASH_TABLE
 
-SimpleCache::~SimpleCache()
-{
-    clear();
-}
+/**
+ * Incremented every time the pools are purged. The threads return
+ * their cached buffers to the shared allocator on the next access,
+ * so that the next purge could release their slabs.
+ */
+static QAtomicInt s_poolsGeneration;
 
-void SimpleCache::clear()
+/**
+ * Keeps a few freed tile buffers per thread. When several threads
+ * process separate patches of the image, most of the allocations
+ * are served from the memory the same thread has just freed, so
+ * they don't touch the shared free lists of the allocator.
+ */
+class KisTileDataThreadCache
 {
-    QWriteLocker l(&m_cacheLock);
-    quint8 *ptr = 0;
+public:
+    static const int MAX_BUFFERS = 32;
+
+    KisTileDataThreadCache()
+        : m_generation(s_poolsGeneration.loadAcquire())
+    {
+    }
+
+    ~KisTileDataThreadCache()
+    {
+        flush();
+    }
+
+    void flush()
+    {
+        returnBuffers(m_4Buffers, 4);
+        returnBuffers(m_8Buffers, 8);
+        returnBuffers(m_16Buffers, 16);
+    }
+
+    bool pop(int pixelSize, quint8 *&ptr)
+    {
+        QVector<quint8*> *buffers = buffersForPixelSize(pixelSize);
+        if (!buffers) return false;
+
+        flushIfStale();
+        if (buffers->isEmpty()) return false;
+
+        ptr = buffers->takeLast();
+        return true;
+    }
+
+    bool push(int pixelSize, quint8 *ptr)
+    {
+        QVector<quint8*> *buffers = buffersForPixelSize(pixelSize);
+        if (!buffers) return false;
+
+        flushIfStale();
+        if (buffers->size() >= MAX_BUFFERS) return false;
 
-    while (m_4Pool.pop(ptr)) {
-        BoostPool4BPP::free(ptr);
+        buffers->append(ptr);
+        return true;
     }
 
-    while (m_8Pool.pop(ptr)) {
-        BoostPool8BPP::free(ptr);
+private:
+    QVector<quint8*>* buffersForPixelSize(int pixelSize)
+    {
+        switch (pixelSize) {
+        case 4:
+            return &m_4Buffers;
+        case 8:
+            return &m_8Buffers;
+        case 16:
+            return &m_16Buffers;
+        default:
+            return 0;
+        }
     }
 
-    while (m_16Pool.pop(ptr)) {
-        free(ptr);
+    void flushIfStale()
+    {
+        const int currentGeneration = s_poolsGeneration.loadAcquire();
+        if (m_generation == currentGeneration) return;
+
+        flush();
+        m_generation = currentGeneration;
     }
+
+    static void returnBuffers(QVector<quint8*> &buffers, int pixelSize)
+    {
+        Q_FOREACH (quint8 *ptr, buffers) {
+            KisTileData::freeSharedData(ptr, pixelSize);
+        }
+        buffers.clear();
+    }
+
+private:
+    int m_generation;
+    QVector<quint8*> m_4Buffers;
+    QVector<quint8*> m_8Buffers;
+    QVector<quint8*> m_16Buffers;
+};
+
+static QThreadStorage<KisTileDataThreadCache*> s_threadCache;
+
+static inline KisTileDataThreadCache* threadCache()
+{
+    if (!s_threadCache.hasLocalData()) {
+        s_threadCache.setLocalData(new KisTileDataThreadCache());
+    }
+    return s_threadCache.localData();
 }
 
+#endif /* USE_SHARDED_HASH_TABLE */
 
-KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store, bool checkFreeMemory)
+KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store, bool checkFreeMemory,
+                         qint32 width, qint32 height)
     : m_state(NORMAL),
       m_mementoFlag(0),
       m_age(0),
       m_usersCount(0),
       m_refCount(0),
       m_pixelSize(pixelSize),
+      m_width(width),
+      m_height(height),
+      m_uniformPixel(0),
       m_store(store)
 {
     if (checkFreeMemory) {
         m_store->checkFreeMemory();
     }
-    m_data = allocateData(m_pixelSize);
+    m_data = allocateData(m_pixelSize, m_width * m_height);
 
     fillWithPixel(defPixel);
 }
@@ -98,27 +187,31 @@ KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
       m_usersCount(0),
       m_refCount(0),
       m_pixelSize(rhs.m_pixelSize),
+      m_width(rhs.m_width),
+      m_height(rhs.m_height),
+      m_uniformPixel(0),
       m_store(rhs.m_store)
 {
     if (checkFreeMemory) {
         m_store->checkFreeMemory();
     }
-    m_data = allocateData(m_pixelSize);
+    m_data = allocateData(m_pixelSize, m_width * m_height);
 
-    memcpy(m_data, rhs.data(), m_pixelSize * WIDTH * HEIGHT);
+    memcpy(m_data, rhs.data(), dataSize());
 }
 
 
 KisTileData::~KisTileData()
 {
     releaseMemory();
+    delete[] m_uniformPixel;
 }
 
 void KisTileData::fillWithPixel(const quint8 *defPixel)
 {
     quint8 *it = m_data;
 
-    for (int i = 0; i < WIDTH * HEIGHT; i++, it += m_pixelSize) {
+    for (int i = 0; i < m_width * m_height; i++, it += m_pixelSize) {
         memcpy(it, defPixel, m_pixelSize);
     }
 }
@@ -126,7 +219,7 @@ void KisTileData::fillWithPixel(const quint8 *defPixel)
 void KisTileData::releaseMemory()
 {
     if (m_data) {
-        freeData(m_data, m_pixelSize);
+        freeData(m_data, m_pixelSize, m_width * m_height);
         m_data = 0;
     }
 
@@ -141,45 +234,100 @@ void KisTileData::releaseMemory()
 void KisTileData::allocateMemory()
 {
     Q_ASSERT(!m_data);
-    m_data = allocateData(m_pixelSize);
+    m_data = allocateData(m_pixelSize, m_width * m_height);
+}
+
+bool KisTileData::isUniform() const
+{
+    Q_ASSERT(m_data);
+
+    /**
+     * The data is uniform iff it is equal to itself shifted by one
+     * pixel, so the overlapping ranges can be compared in one go
+     */
+    return !memcmp(m_data, m_data + m_pixelSize, dataSize() - m_pixelSize);
+}
+
+void KisTileData::collapseUniform()
+{
+    Q_ASSERT(m_data);
+    Q_ASSERT(m_state == NORMAL);
+
+    m_uniformPixel = new quint8[m_pixelSize];
+    memcpy(m_uniformPixel, m_data, m_pixelSize);
+
+    releaseMemory();
+    m_state = UNIFORM;
+}
+
+void KisTileData::expandUniform()
+{
+    Q_ASSERT(!m_data);
+    Q_ASSERT(m_state == UNIFORM);
+
+    m_data = allocateData(m_pixelSize, m_width * m_height);
+    fillWithPixel(m_uniformPixel);
+
+    delete[] m_uniformPixel;
+    m_uniformPixel = 0;
+    m_state = NORMAL;
 }
 
-quint8* KisTileData::allocateData(const qint32 pixelSize)
+quint8* KisTileData::allocateData(const qint32 pixelSize, const qint32 numPixels)
 {
+    /**
+     * The slabs are tuned for the default tile size only, the
+     * tiles of custom size are allocated from the heap directly
+     */
+    if (numPixels != WIDTH * HEIGHT) {
+        return (quint8*) qMallocAligned(pixelSize * numPixels,
+                                        KisTileDataSlabAllocator::ALIGNMENT);
+    }
+
+#ifdef USE_SHARDED_HASH_TABLE
     quint8 *ptr = 0;
+    if (threadCache()->pop(pixelSize, ptr)) {
+        return ptr;
+    }
+#endif /* USE_SHARDED_HASH_TABLE */
 
-    if (!m_cache.pop(pixelSize, ptr)) {
-        switch (pixelSize) {
-        case 4:
-            ptr = (quint8*)BoostPool4BPP::malloc();
-            break;
-        case 8:
-            ptr = (quint8*)BoostPool8BPP::malloc();
-            break;
-        default:
-            ptr = (quint8*) malloc(pixelSize * WIDTH * HEIGHT);
-            break;
-        }
+    return allocateSharedData(pixelSize);
+}
+
+void KisTileData::freeData(quint8* ptr, const qint32 pixelSize, const qint32 numPixels)
+{
+    if (numPixels != WIDTH * HEIGHT) {
+        qFreeAligned(ptr);
+        return;
+    }
+
+#ifdef USE_SHARDED_HASH_TABLE
+    if (threadCache()->push(pixelSize, ptr)) {
+        return;
     }
+#endif /* USE_SHARDED_HASH_TABLE */
 
-    return ptr;
+    freeSharedData(ptr, pixelSize);
 }
 
-void KisTileData::freeData(quint8* ptr, const qint32 pixelSize)
+quint8* KisTileData::allocateSharedData(const qint32 pixelSize)
 {
-    if (!m_cache.push(pixelSize, ptr)) {
-        switch (pixelSize) {
-        case 4:
-            BoostPool4BPP::free(ptr);
-            break;
-        case 8:
-            BoostPool8BPP::free(ptr);
-            break;
-        default:
-            free(ptr);
-            break;
-        }
+    if (KisTileDataSlabAllocator::canAllocate(pixelSize)) {
+        return KisTileDataSlabAllocator::instance()->allocate(pixelSize);
     }
+
+    return (quint8*) qMallocAligned(pixelSize * WIDTH * HEIGHT,
+                                    KisTileDataSlabAllocator::ALIGNMENT);
+}
+
+void KisTileData::freeSharedData(quint8* ptr, const qint32 pixelSize)
+{
+    if (KisTileDataSlabAllocator::canAllocate(pixelSize)) {
+        KisTileDataSlabAllocator::instance()->deallocate(ptr, pixelSize);
+        return;
+    }
+
+    qFreeAligned(ptr);
 }
 
 //#define DEBUG_POOL_RELEASE
@@ -210,8 +358,8 @@ void KisTileData::releaseInternalPools()
             }
 
             // check if the tile data has actually been pooled
-            if (item->m_pixelSize != 4 &&
-                item->m_pixelSize != 8) {
+            if (!KisTileDataSlabAllocator::canAllocate(item->m_pixelSize) ||
+                !item->hasDefaultSize()) {
 
                 continue;
             }
@@ -224,7 +372,7 @@ void KisTileData::releaseInternalPools()
                     break;
                 }
 
-                const int chunkSize = item->m_pixelSize * WIDTH * HEIGHT;
+                const int chunkSize = item->dataSize();
                 dataObjects << item;
                 memoryChunks << QByteArray((const char*)item->m_data, chunkSize);
             }
@@ -232,19 +380,30 @@ void KisTileData::releaseInternalPools()
         }
 
         if (!failedToLock) {
-            // purge the pools memory
-            m_cache.clear();
-            BoostPool4BPP::purge_memory();
-            BoostPool8BPP::purge_memory();
+            /**
+             * Return all the buffers to the allocator, so that the
+             * slabs became empty and could be released. The data is
+             * moved into compact new slabs afterwards.
+             */
+            Q_FOREACH (KisTileData *item, dataObjects) {
+                freeSharedData(item->m_data, item->m_pixelSize);
+                item->m_data = 0;
+            }
+
+#ifdef USE_SHARDED_HASH_TABLE
+            s_poolsGeneration.ref();
+            threadCache()->flush();
+#endif /* USE_SHARDED_HASH_TABLE */
+            KisTileDataSlabAllocator::instance()->purge();
 
             auto it = dataObjects.begin();
             auto chunkIt = memoryChunks.constBegin();
 
             for (; it != dataObjects.end(); ++it, ++chunkIt) {
                 KisTileData *item = *it;
-                const int chunkSize = item->m_pixelSize * WIDTH * HEIGHT;
+                const int chunkSize = item->dataSize();
 
-                item->m_data = allocateData(item->m_pixelSize);
+                item->m_data = allocateSharedData(item->m_pixelSize);
                 memcpy(item->m_data, chunkIt->data(), chunkSize);
 
                 item->m_swapLock.unlock();
@@ -37,13 +37,33 @@ inline quint8* KisTileData::data() const {
 
 void KisTileData::setData(const quint8 *data) {
     Q_ASSERT(m_data);
-    memcpy(m_data, data, m_pixelSize*WIDTH*HEIGHT);
+    memcpy(m_data, data, dataSize());
 }
 
 inline quint32 KisTileData::pixelSize() const {
     return m_pixelSize;
 }
 
+inline qint32 KisTileData::width() const {
+    return m_width;
+}
+
+inline qint32 KisTileData::height() const {
+    return m_height;
+}
+
+inline qint32 KisTileData::dataSize() const {
+    return m_pixelSize * m_width * m_height;
+}
+
+inline qint32 KisTileData::memoryMetric() const {
+    return dataSize() / (WIDTH * HEIGHT);
+}
+
+inline bool KisTileData::hasDefaultSize() const {
+    return m_width == WIDTH && m_height == HEIGHT;
+}
+
 inline bool KisTileData::acquire() {
     /**
      * We need to ensure the clones in the stack are
@@ -133,5 +153,9 @@ inline qint32 KisTileData::numUsers() const {
     return m_usersCount;
 }
 
+inline bool KisTileData::isDefault() const {
+    return m_isDefault;
+}
+
 #endif /* KIS_TILE_DATA_H_ */
 
@@ -43,64 +43,14 @@ typedef KisTileDataList::iterator KisTileDataListIterator;
 typedef KisTileDataList::const_iterator KisTileDataListConstIterator;
 
 
-class SimpleCache
-{
-public:
-    SimpleCache() = default;
-    ~SimpleCache();
-
-    bool push(int pixelSize, quint8 *&ptr)
-    {
-        QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            m_4Pool.push(ptr);
-            break;
-        case 8:
-            m_8Pool.push(ptr);
-            break;
-        case 16:
-            m_16Pool.push(ptr);
-            break;
-        default:
-            return false;
-        }
-
-        return true;
-    }
-
-    bool pop(int pixelSize, quint8 *&ptr)
-    {
-        QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            return m_4Pool.pop(ptr);
-        case 8:
-            return m_8Pool.pop(ptr);
-        case 16:
-            return m_16Pool.pop(ptr);
-        default:
-            return false;
-        }
-    }
-
-    void clear();
-
-private:
-    QReadWriteLock m_cacheLock;
-    KisLocklessStack<quint8*> m_4Pool;
-    KisLocklessStack<quint8*> m_8Pool;
-    KisLocklessStack<quint8*> m_16Pool;
-};
-
-
 /**
  * Stores actual tile's data
  */
 class KRITAIMAGE_EXPORT KisTileData
 {
 public:
-    KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store, bool checkFreeMemory = true);
+    KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store, bool checkFreeMemory = true,
+                qint32 width = WIDTH, qint32 height = HEIGHT);
 
 private:
     KisTileData(const KisTileData& rhs, bool checkFreeMemory = true);
@@ -111,7 +61,8 @@ public:
     enum EnumTileDataState {
         NORMAL = 0,
         COMPRESSED,
-        SWAPPED
+        SWAPPED,
+        UNIFORM
     };
 
     /**
@@ -121,6 +72,32 @@ public:
     inline void setData(const quint8 *data);
     inline quint32 pixelSize() const;
 
+    /**
+     * The dimensions of the tile data in pixels. They are equal
+     * to WIDTH and HEIGHT unless the data manager has been created
+     * with a custom tile size.
+     */
+    inline qint32 width() const;
+    inline qint32 height() const;
+
+    /**
+     * The size of the pixel data in bytes
+     */
+    inline qint32 dataSize() const;
+
+    /**
+     * The memory occupied by the tile data in the units of the
+     * store's memory metric, that is in blocks of WIDTH * HEIGHT
+     * bytes.
+     */
+    inline qint32 memoryMetric() const;
+
+    /**
+     * Returns true if the tile data has the default dimensions
+     * and therefore its memory is allocated from the pools
+     */
+    inline bool hasDefaultSize() const;
+
     /**
      * Increments usersCount of a TD and refs shared pointer counter
      * Used by KisTile for COW
@@ -184,6 +161,12 @@ public:
      */
     inline qint32 numUsers() const;
 
+    /**
+     * Returns true if the tile data has been created as the
+     * default tile data of a data manager
+     */
+    inline bool isDefault() const;
+
     /**
      * Conveniece method. Returns true iff the tile data is linked to
      * information only and therefore can be swapped out easily.
@@ -213,18 +196,53 @@ public:
     /**
      * Releases internal pools, which keep blobs where the tiles are
      * stored.  The point is that we don't allocate the tiles from
-     * glibc directly, but use pools (implemented via boost) to
-     * allocate bigger chunks. This method should be called when one
+     * glibc directly, but use slabs (see KisTileDataSlabAllocator)
+     * to allocate bigger chunks. This method should be called when one
      * knows that we have just free'd quite a lot of memory and we
      * won't need it anymore. E.g. when a document has been closed.
+     *
+     * NOTE: only the buffer cache of the calling thread is flushed
+     *       immediately. The other threads return their cached
+     *       buffers on their next tile allocation or deallocation,
+     *       so the slabs holding them are released by one of the
+     *       next calls to this method only.
      */
     static void releaseInternalPools();
 
+    /**
+     * Returns true if all the pixels of the tile data are equal.
+     * The data must be loaded.
+     */
+    bool isUniform() const;
+
+    /**
+     * Used by the store only. Frees the memory occupied by the
+     * tile data keeping the only pixel of a uniform tile data.
+     * The state becomes UNIFORM.
+     *
+     * \see isUniform(), expandUniform()
+     */
+    void collapseUniform();
+
+    /**
+     * Used by the store only. Reverses collapseUniform()
+     */
+    void expandUniform();
+
 private:
     void fillWithPixel(const quint8 *defPixel);
 
-    static quint8* allocateData(const qint32 pixelSize);
-    static void freeData(quint8 *ptr, const qint32 pixelSize);
+    static quint8* allocateData(const qint32 pixelSize, const qint32 numPixels);
+    static void freeData(quint8 *ptr, const qint32 pixelSize, const qint32 numPixels);
+
+    /**
+     * Allocate/free a default-sized chunk directly from the slab
+     * allocator, bypassing the per-thread cache
+     */
+    static quint8* allocateSharedData(const qint32 pixelSize);
+    static void freeSharedData(quint8 *ptr, const qint32 pixelSize);
+
+    friend class KisTileDataThreadCache;
 private:
     friend class KisTileDataPooler;
     friend class KisTileDataPoolerTest;
@@ -257,6 +275,12 @@ private:
      */
     int m_tileNumber = -1;
 
+    /**
+     * Set for the default tile data of a data manager, which
+     * is shared by all its empty tiles and mementoes
+     */
+    bool m_isDefault = false;
+
 private:
     /**
      * The chunk of the swap file, that corresponds
@@ -316,8 +340,16 @@ private:
     qint32 m_pixelSize;
     //qint32 m_timeStamp;
 
+    qint32 m_width;
+    qint32 m_height;
+
+    /**
+     * The color of the collapsed uniform tile data,
+     * null in all the other states
+     */
+    quint8 *m_uniformPixel;
+
     KisTileDataStore *m_store;
-    static SimpleCache m_cache;
 
 public:
     static const qint32 WIDTH;
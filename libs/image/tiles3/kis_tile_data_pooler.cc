@@ -97,9 +97,12 @@ KisTileDataPooler::KisTileDataPooler(KisTileDataStore *store, qint32 memoryLimit
 
     if(memoryLimit >= 0) {
         m_memoryLimit = memoryLimit;
+        m_collapseUniformTiles = false;
     }
     else {
-        m_memoryLimit = MiB_TO_METRIC(KisImageConfig(true).poolLimit());
+        KisImageConfig config(true);
+        m_memoryLimit = MiB_TO_METRIC(config.poolLimit());
+        m_collapseUniformTiles = config.collapseUniformTiles();
     }
 }
 
@@ -261,11 +264,11 @@ qint64 KisTileDataPooler::lastHistoricalMemoryMetric() const
 }
 
 inline int KisTileDataPooler::clonesMetric(KisTileData *td, int numClones) {
-    return numClones * td->pixelSize();
+    return numClones * td->memoryMetric();
 }
 
 inline int KisTileDataPooler::clonesMetric(KisTileData *td) {
-    return td->m_clonesStack.size() * td->pixelSize();
+    return td->m_clonesStack.size() * td->memoryMetric();
 }
 
 inline void KisTileDataPooler::tryFreeOrphanedClones(KisTileData *td)
@@ -277,6 +280,22 @@ inline void KisTileDataPooler::tryFreeOrphanedClones(KisTileData *td)
     }
 }
 
+inline bool KisTileDataPooler::canCollapseUniform(KisTileData *td)
+{
+    /**
+     * Expanding a collapsed tile back takes the store's lock, so we
+     * collapse only the tiles the swapper has already marked as old.
+     * The shared tile data (including the default tile data of the
+     * data managers) and the history are left alone, since they are
+     * read by many tiles at once or are going to be swapped out anyway.
+     */
+    return m_collapseUniformTiles &&
+        td->age() > 0 &&
+        td->numUsers() == 1 &&
+        !td->mementoed() &&
+        !td->isDefault();
+}
+
 inline qint32 KisTileDataPooler::needMemory(KisTileData *td)
 {
     qint32 clonesNeeded = !td->age() ? qMax(0, numClonesNeeded(td)) : 0;
@@ -313,6 +332,19 @@ void KisTileDataPooler::getLists(Iter *iter,
 
         tryFreeOrphanedClones(item);
 
+        /**
+         * The check exits on the first differing byte, so it is
+         * cheap for the tiles having any content. The collapsed
+         * tiles leave the store's list, so the iterator is not
+         * affected. They have a single user, so their clones have
+         * just been freed above and there is nothing to pre-clone.
+         */
+        if (canCollapseUniform(item) &&
+            m_store->tryCollapseUniformTileData(item)) {
+
+            continue;
+        }
+
         if((neededMemory = needMemory(item))) {
             needMemoryTotal += neededMemory;
             beggers.append(item);
@@ -326,9 +358,9 @@ void KisTileDataPooler::getLists(Iter *iter,
 
         // statistics gathering
         if (item->historical()) {
-            statHistoricalMemory += item->pixelSize();
+            statHistoricalMemory += item->memoryMetric();
         } else {
-            statRealMemory += item->pixelSize();
+            statRealMemory += item->memoryMetric();
         }
     }
 
@@ -416,5 +448,7 @@ void KisTileDataPooler::debugTileStatistics()
 
 void KisTileDataPooler::testingRereadConfig()
 {
-    m_memoryLimit = MiB_TO_METRIC(KisImageConfig(true).poolLimit());
+    KisImageConfig config(true);
+    m_memoryLimit = MiB_TO_METRIC(config.poolLimit());
+    m_collapseUniformTiles = config.collapseUniformTiles();
 }
@@ -68,6 +68,7 @@ protected:
     inline int clonesMetric(KisTileData *td);
 
     inline void tryFreeOrphanedClones(KisTileData *td);
+    inline bool canCollapseUniform(KisTileData *td);
     inline qint32 needMemory(KisTileData *td);
     inline qint32 canDonorMemory(KisTileData *td);
     qint32 tryGetMemory(QList<KisTileData*> &donors, qint32 memoryMetric);
@@ -92,6 +93,7 @@ protected:
     qint32 m_timeout;
     bool m_lastCycleHadWork;
     qint32 m_memoryLimit;
+    bool m_collapseUniformTiles;
     qint32 m_lastPoolMemoryMetric;
     qint32 m_lastRealMemoryMetric;
     qint32 m_lastHistoricalMemoryMetric;
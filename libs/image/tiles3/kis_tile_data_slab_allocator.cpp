@@ -0,0 +1,255 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_data_slab_allocator.h"
+
+#include <algorithm>
+
+#include "kis_debug.h"
+#include "kis_image_config.h"
+#include "kis_tile_data.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+struct KisTileDataSlabAllocator::SizeClass
+{
+    qint32 bufferSize;
+    qint32 buffersPerSlab;
+    qint32 slabSize;
+
+    KisLocklessStack<quint8*> freeBuffers;
+
+    mutable QMutex slabsLock;
+    QVector<quint8*> slabs;
+};
+
+KisTileDataSlabAllocator::KisTileDataSlabAllocator(qint32 bufferPixels, bool useHugePages)
+    : m_useHugePages(useHugePages)
+{
+    for (int i = 0; i < MAX_PIXEL_SIZE; i++) {
+        SizeClass *sizeClass = new SizeClass();
+
+        /**
+         * The buffer size is a multiple of the page size for
+         * the default tile size, so the alignment of the slab
+         * is preserved for every buffer
+         */
+        sizeClass->bufferSize = (i + 1) * bufferPixels;
+        sizeClass->bufferSize =
+            (sizeClass->bufferSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+        sizeClass->slabSize =
+            (sizeClass->bufferSize + SLAB_SIZE - 1) / SLAB_SIZE * SLAB_SIZE;
+        sizeClass->buffersPerSlab = sizeClass->slabSize / sizeClass->bufferSize;
+
+        m_sizeClasses[i] = sizeClass;
+    }
+}
+
+KisTileDataSlabAllocator::~KisTileDataSlabAllocator()
+{
+    for (int i = 0; i < MAX_PIXEL_SIZE; i++) {
+        SizeClass *sizeClass = m_sizeClasses[i];
+
+        Q_FOREACH (quint8 *slab, sizeClass->slabs) {
+            freeSlab(slab, sizeClass->slabSize);
+        }
+        delete sizeClass;
+    }
+}
+
+KisTileDataSlabAllocator* KisTileDataSlabAllocator::instance()
+{
+    /**
+     * The instance is never deleted: the tile data objects owned by
+     * other global objects may be destroyed after the end of main()
+     */
+    static KisTileDataSlabAllocator *s_instance =
+        new KisTileDataSlabAllocator(KisTileData::WIDTH * KisTileData::HEIGHT,
+                                     KisImageConfig(true).useHugePagesForTiles());
+    return s_instance;
+}
+
+quint8* KisTileDataSlabAllocator::allocate(qint32 pixelSize)
+{
+    KIS_ASSERT_RECOVER_RETURN_VALUE(canAllocate(pixelSize), 0);
+
+    SizeClass *sizeClass = m_sizeClasses[pixelSize - 1];
+    quint8 *ptr = 0;
+
+    if (sizeClass->freeBuffers.pop(ptr)) {
+        return ptr;
+    }
+
+    QMutexLocker slabsLocker(&sizeClass->slabsLock);
+
+    /**
+     * Someone else might have added a slab while we were waiting
+     * for the lock, or purge() might have returned the buffers
+     * it had taken off the stack
+     */
+    if (sizeClass->freeBuffers.pop(ptr)) {
+        return ptr;
+    }
+
+    quint8 *slab = allocateSlab(sizeClass->slabSize);
+    if (!slab) {
+        qWarning() << "Failed to allocate a slab for the tiles of pixel size" << pixelSize;
+        return 0;
+    }
+
+    sizeClass->slabs.append(slab);
+
+    for (int i = sizeClass->buffersPerSlab - 1; i > 0; i--) {
+        sizeClass->freeBuffers.push(slab + i * sizeClass->bufferSize);
+    }
+
+    return slab;
+}
+
+void KisTileDataSlabAllocator::deallocate(quint8 *ptr, qint32 pixelSize)
+{
+    KIS_ASSERT_RECOVER_RETURN(canAllocate(pixelSize));
+    m_sizeClasses[pixelSize - 1]->freeBuffers.push(ptr);
+}
+
+void KisTileDataSlabAllocator::purge()
+{
+    /**
+     * The buffers deallocated while we hold the free list are
+     * pushed back into the stack and simply keep their slab alive
+     * until the next purge
+     */
+    for (int i = 0; i < MAX_PIXEL_SIZE; i++) {
+        SizeClass *sizeClass = m_sizeClasses[i];
+        QMutexLocker slabsLocker(&sizeClass->slabsLock);
+
+        if (sizeClass->slabs.isEmpty()) continue;
+
+        QVector<quint8*> freeBuffers;
+        quint8 *ptr = 0;
+        while (sizeClass->freeBuffers.pop(ptr)) {
+            freeBuffers.append(ptr);
+        }
+
+        std::sort(sizeClass->slabs.begin(), sizeClass->slabs.end());
+        std::sort(freeBuffers.begin(), freeBuffers.end());
+
+        QVector<quint8*> usedSlabs;
+        auto bufferIt = freeBuffers.constBegin();
+
+        Q_FOREACH (quint8 *slab, sizeClass->slabs) {
+            quint8 *slabEnd = slab + sizeClass->slabSize;
+
+            auto slabBegin = bufferIt;
+            while (bufferIt != freeBuffers.constEnd() && *bufferIt < slabEnd) {
+                ++bufferIt;
+            }
+
+            if (bufferIt - slabBegin == sizeClass->buffersPerSlab) {
+                freeSlab(slab, sizeClass->slabSize);
+            } else {
+                usedSlabs.append(slab);
+
+                for (auto it = slabBegin; it != bufferIt; ++it) {
+                    sizeClass->freeBuffers.push(*it);
+                }
+            }
+        }
+
+        sizeClass->slabs = usedSlabs;
+    }
+}
+
+qint64 KisTileDataSlabAllocator::totalSlabsSize() const
+{
+    qint64 result = 0;
+
+    for (int i = 0; i < MAX_PIXEL_SIZE; i++) {
+        SizeClass *sizeClass = m_sizeClasses[i];
+        QMutexLocker slabsLocker(&sizeClass->slabsLock);
+
+        result += qint64(sizeClass->slabs.size()) * sizeClass->slabSize;
+    }
+
+    return result;
+}
+
+bool KisTileDataSlabAllocator::usesHugePages() const
+{
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    return m_useHugePages;
+#else
+    return false;
+#endif
+}
+
+quint8* KisTileDataSlabAllocator::allocateSlab(qint32 size)
+{
+#ifdef Q_OS_UNIX
+    /**
+     * The transparent huge pages can back only the regions aligned
+     * to the huge page size, so we map a bigger region and unmap
+     * the unaligned head and tail of it
+     */
+    const size_t alignment = usesHugePages() ? SLAB_SIZE : 0;
+    const size_t mappedSize = size + alignment;
+
+    void *mapping = mmap(0, mappedSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return 0;
+
+    quint8 *slab = static_cast<quint8*>(mapping);
+
+    if (alignment) {
+        const quintptr address = reinterpret_cast<quintptr>(slab);
+        const quintptr alignedAddress = (address + alignment - 1) & ~quintptr(alignment - 1);
+
+        const size_t headSize = alignedAddress - address;
+        const size_t tailSize = mappedSize - headSize - size;
+
+        if (headSize) {
+            munmap(slab, headSize);
+        }
+        if (tailSize) {
+            munmap(slab + headSize + size, tailSize);
+        }
+        slab += headSize;
+
+#ifdef MADV_HUGEPAGE
+        madvise(slab, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    return slab;
+#else
+    return static_cast<quint8*>(qMallocAligned(size, ALIGNMENT));
+#endif
+}
+
+void KisTileDataSlabAllocator::freeSlab(quint8 *slab, qint32 size)
+{
+#ifdef Q_OS_UNIX
+    munmap(slab, size);
+#else
+    Q_UNUSED(size);
+    qFreeAligned(slab);
+#endif
+}
@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_DATA_SLAB_ALLOCATOR_H
+#define __KIS_TILE_DATA_SLAB_ALLOCATOR_H
+
+#include "kritaimage_export.h"
+
+#include <QMutex>
+#include <QVector>
+
+#include "kis_lockless_stack.h"
+
+/**
+ * Allocates the pixel buffers of the default-sized tile data
+ * objects for all the pixel sizes from 1 to MAX_PIXEL_SIZE bytes.
+ *
+ * The memory is requested from the system in big slabs, which are
+ * split into the buffers of a single size. The free buffers are
+ * kept in a lockless stack per pixel size, so allocation and
+ * freeing take no locks unless a new slab is needed.
+ *
+ * All the buffers are aligned to ALIGNMENT bytes, so the SIMD code
+ * can use aligned loads on the tile rows. On Linux the slabs may be
+ * aligned to the huge page size and backed by transparent huge pages,
+ * which reduces the TLB misses when iterating over big images.
+ *
+ * The slabs are returned to the system only by purge(), and only
+ * when all their buffers are free. purge() doesn't block the
+ * concurrent allocate() and deallocate() calls: it temporarily takes
+ * all the free buffers off the stack, so a slab whose buffers are all
+ * held by purge() cannot be touched by anyone else. An allocation
+ * racing with it just falls into the slow path and waits for the
+ * slabs lock of the size class.
+ */
+class KRITAIMAGE_EXPORT KisTileDataSlabAllocator
+{
+public:
+    static const qint32 MAX_PIXEL_SIZE = 32;
+    static const qint32 ALIGNMENT = 64;
+    static const qint32 SLAB_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * \p bufferPixels is the number of pixels in every buffer
+     * \p useHugePages defines whether the slabs should be backed
+     * by transparent huge pages (Linux only, ignored otherwise)
+     */
+    KisTileDataSlabAllocator(qint32 bufferPixels, bool useHugePages);
+    ~KisTileDataSlabAllocator();
+
+    /**
+     * The global allocator for the tile data objects. It is
+     * configured by KisImageConfig::useHugePagesForTiles()
+     * on the first use.
+     */
+    static KisTileDataSlabAllocator* instance();
+
+    static inline bool canAllocate(qint32 pixelSize) {
+        return pixelSize > 0 && pixelSize <= MAX_PIXEL_SIZE;
+    }
+
+    /**
+     * Returns a buffer of pixelSize * bufferPixels bytes.
+     * PRECONDITIONS: canAllocate(pixelSize)
+     */
+    quint8* allocate(qint32 pixelSize);
+
+    /**
+     * Returns the buffer allocated by allocate() back
+     * into the allocator
+     */
+    void deallocate(quint8 *ptr, qint32 pixelSize);
+
+    /**
+     * Returns the slabs, where all the buffers are free, back to
+     * the system. Should be called when a lot of memory has been
+     * released, e.g. after closing a document.
+     *
+     * The buffers cached by the threads (see KisTileData) are not
+     * free from the allocator's point of view, so their slabs are kept.
+     */
+    void purge();
+
+    /**
+     * The total size of the slabs allocated from the system
+     */
+    qint64 totalSlabsSize() const;
+
+    bool usesHugePages() const;
+
+private:
+    struct SizeClass;
+
+    quint8* allocateSlab(qint32 size);
+    void freeSlab(quint8 *slab, qint32 size);
+
+private:
+    Q_DISABLE_COPY(KisTileDataSlabAllocator)
+
+    const bool m_useHugePages;
+
+    SizeClass *m_sizeClasses[MAX_PIXEL_SIZE];
+};
+
+#endif /* __KIS_TILE_DATA_SLAB_ALLOCATOR_H */
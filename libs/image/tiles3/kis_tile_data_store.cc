@@ -27,6 +27,7 @@
 #include "kis_debug.h"
 
 #include "kis_tile_data_store_iterators.h"
+#include "kis_image_config.h"
 
 Q_GLOBAL_STATIC(KisTileDataStore, s_instance)
 
@@ -70,8 +71,12 @@ qint64 __preclone_miss_age = 0;
 KisTileDataStore::KisTileDataStore()
     : m_pooler(this),
       m_swapper(this),
+      m_arenaStore(&m_swappedStore),
       m_numTiles(0),
       m_memoryMetric(0),
+      m_numUniformTiles(0),
+      m_uniformMemoryMetric(0),
+      m_numLostHistoryTiles(0),
       m_counter(1),
       m_clockIndex(1)
 {
@@ -114,9 +119,19 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
     stats.historicalMemorySize = m_pooler.lastHistoricalMemoryMetric() * metricCoeff;
     stats.poolSize = m_pooler.lastPoolMemoryMetric() * metricCoeff;
 
-    stats.totalMemorySize = memoryMetric() * metricCoeff + stats.poolSize;
+    stats.historyArenaUncompressedSize = m_arenaStore.uncompressedSize();
+    stats.historyArenaSize = m_arenaStore.compressedSize();
+    stats.historyArenaSwappedSize = m_arenaStore.spilledSize();
+    stats.numLostHistoryTiles = m_numLostHistoryTiles.loadAcquire();
+
+    stats.totalMemorySize = memoryMetric() * metricCoeff + stats.poolSize +
+        stats.historyArenaSize;
 
     stats.swapSize = m_swappedStore.totalMemoryMetric() * metricCoeff;
+    stats.uniformTilesReclaimedSize = m_uniformMemoryMetric.loadAcquire() * metricCoeff;
+
+    stats.swapOutThroughput = m_swappedStore.swapOutThroughput();
+    stats.swapInThroughput = m_swappedStore.swapInThroughput();
 
     return stats;
 }
@@ -127,7 +142,7 @@ inline void KisTileDataStore::registerTileDataImp(KisTileData *td)
     td->m_tileNumber = index;
     m_tileDataMap.assign(index, td);
     m_numTiles.ref();
-    m_memoryMetric += td->pixelSize();
+    m_memoryMetric += td->memoryMetric();
 }
 
 void KisTileDataStore::registerTileData(KisTileData *td)
@@ -148,7 +163,7 @@ inline void KisTileDataStore::unregisterTileDataImp(KisTileData *td)
     td->m_tileNumber = -1;
     m_tileDataMap.erase(index);
     m_numTiles.deref();
-    m_memoryMetric -= td->pixelSize();
+    m_memoryMetric -= td->memoryMetric();
 }
 
 void KisTileDataStore::unregisterTileData(KisTileData *td)
@@ -157,9 +172,26 @@ void KisTileDataStore::unregisterTileData(KisTileData *td)
     unregisterTileDataImp(td);
 }
 
-KisTileData *KisTileDataStore::allocTileData(qint32 pixelSize, const quint8 *defPixel)
+inline void KisTileDataStore::collapseUniformTileDataImp(KisTileData *td)
+{
+    unregisterTileDataImp(td);
+    td->collapseUniform();
+    m_numUniformTiles.ref();
+    m_uniformMemoryMetric += td->memoryMetric();
+}
+
+inline void KisTileDataStore::expandUniformTileDataImp(KisTileData *td)
+{
+    td->expandUniform();
+    m_numUniformTiles.deref();
+    m_uniformMemoryMetric -= td->memoryMetric();
+    registerTileDataImp(td);
+}
+
+KisTileData *KisTileDataStore::allocTileData(qint32 pixelSize, const quint8 *defPixel,
+                                             qint32 width, qint32 height)
 {
-    KisTileData *td = new KisTileData(pixelSize, defPixel, this);
+    KisTileData *td = new KisTileData(pixelSize, defPixel, this, true, width, height);
     registerTileData(td);
     return td;
 }
@@ -192,7 +224,12 @@ void KisTileDataStore::freeTileData(KisTileData *td)
     m_iteratorLock.lockForRead();
     td->m_swapLock.lockForWrite();
 
-    if (!td->data()) {
+    if (td->m_state == KisTileData::UNIFORM) {
+        m_numUniformTiles.deref();
+        m_uniformMemoryMetric -= td->memoryMetric();
+    } else if (td->m_state == KisTileData::COMPRESSED) {
+        m_arenaStore.forgetTileData(td);
+    } else if (!td->data()) {
         m_swappedStore.forgetTileData(td);
     } else {
         unregisterTileDataImp(td);
@@ -233,17 +270,45 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
          * m_listLock.
          */
 
+        QByteArray compressedData;
+        bool needsDecompression = false;
+
         if (!td->data()) {
             td->m_swapLock.lockForWrite();
 
-            m_swappedStore.swapInTileData(td);
-            registerTileDataImp(td);
-
-            td->m_swapLock.unlock();
+            if (td->m_state == KisTileData::UNIFORM) {
+                expandUniformTileDataImp(td);
+            } else if (td->m_state == KisTileData::COMPRESSED) {
+                /**
+                 * Only take the compressed data here. The memory is
+                 * allocated right away, so the other threads waiting for
+                 * the iterator lock see the tile as loaded, and the data
+                 * is decompressed after the iterator lock is released.
+                 * The swap lock is still held, so nobody can read the
+                 * tile until it is decompressed.
+                 */
+                m_arenaStore.takeCompressedTileData(td, compressedData);
+                td->allocateMemory();
+                td->m_state = KisTileData::NORMAL;
+                registerTileDataImp(td);
+                needsDecompression = true;
+            } else {
+                m_swappedStore.swapInTileData(td);
+                registerTileDataImp(td);
+            }
+
+            if (!needsDecompression) {
+                td->m_swapLock.unlock();
+            }
         }
 
         m_iteratorLock.unlock();
 
+        if (needsDecompression) {
+            decompressTileDataImp(td, compressedData);
+            td->m_swapLock.unlock();
+        }
+
         /**
          * <-- In theory, livelock is possible here...
          */
@@ -261,7 +326,10 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     bool result = false;
     if (!td->m_swapLock.tryLockForWrite()) return result;
 
-    if (td->data()) {
+    if (td->data() && td->isUniform()) {
+        collapseUniformTileDataImp(td);
+        result = true;
+    } else if (td->data()) {
         unregisterTileDataImp(td);
         if (m_swappedStore.trySwapOutTileData(td)) {
             result = true;
@@ -275,6 +343,190 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     return result;
 }
 
+bool KisTileDataStore::tryCollapseUniformTileData(KisTileData *td)
+{
+    /**
+     * This function is called with m_listLock acquired
+     */
+
+    if (!td->m_swapLock.tryLockForWrite()) return false;
+
+    bool result = false;
+
+    if (td->data() && td->isUniform()) {
+        collapseUniformTileDataImp(td);
+        result = true;
+    }
+
+    td->m_swapLock.unlock();
+
+    return result;
+}
+
+qint64 KisTileDataStore::trySwapTileDataBatch(const QVector<KisTileData*> &tileDataList)
+{
+    /**
+     * This function is called with m_listLock acquired
+     */
+
+    QVector<KisTileData*> lockedTiles;
+    lockedTiles.reserve(tileDataList.size());
+
+    qint64 freedMetric = 0;
+
+    Q_FOREACH (KisTileData *td, tileDataList) {
+        if (!td->m_swapLock.tryLockForWrite()) continue;
+
+        if (td->data() && td->isUniform()) {
+            /**
+             * Uniform tiles don't need the swap file at all
+             */
+            collapseUniformTileDataImp(td);
+            freedMetric += td->memoryMetric();
+            td->m_swapLock.unlock();
+        } else if (td->data()) {
+            unregisterTileDataImp(td);
+            lockedTiles.append(td);
+        } else {
+            td->m_swapLock.unlock();
+        }
+    }
+
+    m_swappedStore.trySwapOutTileDataBatch(lockedTiles);
+
+    Q_FOREACH (KisTileData *td, lockedTiles) {
+        if (td->data()) {
+            registerTileDataImp(td);
+        } else {
+            freedMetric += td->memoryMetric();
+        }
+        td->m_swapLock.unlock();
+    }
+
+    return freedMetric;
+}
+
+void KisTileDataStore::swapInTileDataBatch(const QVector<KisTileData*> &tileDataList)
+{
+    checkFreeMemory();
+
+    QVector<KisTileData*> swappedTiles;
+    swappedTiles.reserve(tileDataList.size());
+
+    QVector<KisTileData*> compressedTiles;
+    QVector<QByteArray> compressedData;
+
+    Q_FOREACH (KisTileData *td, tileDataList) {
+        /**
+         * Keep the same locking order as in ensureTileDataLoaded(), but
+         * hold the iterator lock for a single tile only, so that the
+         * other threads are not blocked for the whole batch. The tiles
+         * that are busy are skipped: they are being loaded or used by
+         * someone else right now.
+         */
+        QWriteLocker locker(&m_iteratorLock);
+
+        if (!td->m_swapLock.tryLockForWrite()) continue;
+
+        if (td->m_state == KisTileData::UNIFORM) {
+            expandUniformTileDataImp(td);
+            td->m_swapLock.unlock();
+        } else if (td->m_state == KisTileData::COMPRESSED) {
+            // decompressed after unlocking, see ensureTileDataLoaded()
+            compressedData.append(QByteArray());
+            m_arenaStore.takeCompressedTileData(td, compressedData.last());
+            td->allocateMemory();
+            td->m_state = KisTileData::NORMAL;
+            registerTileDataImp(td);
+            compressedTiles.append(td);
+        } else if (!td->data()) {
+            /**
+             * The same trick as for the compressed tiles: the memory is
+             * allocated right now, so ensureTileDataLoaded() in the other
+             * threads doesn't try to lock the tile while holding the
+             * iterator lock, and waits for the swap lock instead.
+             */
+            td->allocateMemory();
+            registerTileDataImp(td);
+            swappedTiles.append(td);
+        } else {
+            td->m_swapLock.unlock();
+        }
+    }
+
+    m_swappedStore.swapInTileDataBatch(swappedTiles);
+
+    Q_FOREACH (KisTileData *td, swappedTiles) {
+        td->m_swapLock.unlock();
+    }
+
+    for (int i = 0; i < compressedTiles.size(); i++) {
+        decompressTileDataImp(compressedTiles[i], compressedData[i]);
+        compressedTiles[i]->m_swapLock.unlock();
+    }
+}
+
+void KisTileDataStore::decompressTileDataImp(KisTileData *td, const QByteArray &compressedData)
+{
+    if (!m_arenaStore.decompressTileData(td, compressedData)) {
+        m_numLostHistoryTiles.ref();
+    }
+}
+
+void KisTileDataStore::scheduleHistoryCompression(const QVector<KisTileData*> &tileDataList)
+{
+    if (tileDataList.isEmpty()) return;
+
+    KisImageConfig config(true);
+    if (!config.compressHistory()) return;
+
+    m_swapper.compressHistory(tileDataList);
+}
+
+int KisTileDataStore::compressHistoricalTileDataBatch(const QVector<KisTileData*> &tileDataList)
+{
+    QVector<KisTileData*> lockedTiles;
+    lockedTiles.reserve(tileDataList.size());
+
+    {
+        QWriteLocker locker(&m_iteratorLock);
+
+        Q_FOREACH (KisTileData *td, tileDataList) {
+            if (!td->m_swapLock.tryLockForWrite()) continue;
+
+            if (td->data() &&
+                td->m_state == KisTileData::NORMAL &&
+                td->historical()) {
+
+                unregisterTileDataImp(td);
+                lockedTiles.append(td);
+            } else {
+                td->m_swapLock.unlock();
+            }
+        }
+    }
+
+    /**
+     * The tiles are unregistered and locked, so neither the
+     * swapper nor the pooler can reach them while we compress
+     * them without holding the iterator lock
+     */
+    const int numCompressed = m_arenaStore.compressTileDataBatch(lockedTiles);
+
+    QReadLocker locker(&m_iteratorLock);
+
+    Q_FOREACH (KisTileData *td, lockedTiles) {
+        if (td->data()) {
+            registerTileDataImp(td);
+        } else {
+            td->m_state = KisTileData::COMPRESSED;
+        }
+        td->m_swapLock.unlock();
+    }
+
+    return numCompressed;
+}
+
 KisTileDataStoreIterator* KisTileDataStore::beginIteration()
 {
     m_iteratorLock.lockForWrite();
@@ -363,6 +615,8 @@ void KisTileDataStore::testingRereadConfig()
 {
     m_pooler.testingRereadConfig();
     m_swapper.testingRereadConfig();
+    m_swappedStore.testingRereadConfig();
+    m_arenaStore.testingRereadConfig();
     kickPooler();
 }
 
@@ -28,6 +28,7 @@
 #include "kis_tile_data_pooler.h"
 #include "swap/kis_tile_data_swapper.h"
 #include "swap/kis_swapped_data_store.h"
+#include "swap/kis_memento_arena_store.h"
 #include "3rdparty/lock_free_map/concurrent_map.h"
 
 class KisTileDataStoreIterator;
@@ -54,6 +55,31 @@ public:
         qint64 poolSize;
 
         qint64 swapSize;
+
+        /**
+         * The memory freed by collapsing the uniform tiles
+         */
+        qint64 uniformTilesReclaimedSize;
+
+        /**
+         * Average swapping speed in uncompressed bytes per second
+         */
+        qint64 swapOutThroughput;
+        qint64 swapInThroughput;
+
+        /**
+         * The undo history kept compressed in memory (see
+         * KisMementoArenaStore): its uncompressed size, the memory
+         * occupied by the arenas and the part spilled into the swap
+         */
+        qint64 historyArenaUncompressedSize;
+        qint64 historyArenaSize;
+        qint64 historyArenaSwappedSize;
+
+        /**
+         * \see numLostHistoryTiles()
+         */
+        qint32 numLostHistoryTiles;
     };
 
     MemoryStatistics memoryStatistics();
@@ -64,7 +90,8 @@ public:
      */
     inline qint32 numTiles() const
     {
-        return m_numTiles.loadAcquire() + m_swappedStore.numTiles();
+        return m_numTiles.loadAcquire() + m_swappedStore.numTiles() +
+            m_numUniformTiles.loadAcquire() + m_arenaStore.numTiles();
     }
 
     /**
@@ -97,9 +124,13 @@ public:
     KisTileDataStoreClockIterator* beginClockIteration();
     void endIteration(KisTileDataStoreClockIterator* iterator);
 
-    inline KisTileData* createDefaultTileData(qint32 pixelSize, const quint8 *defPixel)
+    inline KisTileData* createDefaultTileData(qint32 pixelSize, const quint8 *defPixel,
+                                              qint32 width = KisTileData::WIDTH,
+                                              qint32 height = KisTileData::HEIGHT)
     {
-        return allocTileData(pixelSize, defPixel);
+        KisTileData *td = allocTileData(pixelSize, defPixel, width, height);
+        td->m_isDefault = true;
+        return td;
     }
 
     // Called by The Memento Manager after every commit
@@ -118,6 +149,99 @@ public:
      */
     bool trySwapTileData(KisTileData *td);
 
+    /**
+     * Try to free the memory of the tile data if all its pixels
+     * are equal. The tile data is expanded back on the next
+     * access, the same way as swapped tiles are loaded.
+     * It may fail in case the tile is being accessed
+     * at the same moment of time.
+     * This function should be called with the store iterator held.
+     */
+    bool tryCollapseUniformTileData(KisTileData *td);
+
+    /**
+     * Returns the number of collapsed uniform tile data objects
+     */
+    inline qint32 numTilesUniform() const
+    {
+        return m_numUniformTiles.loadAcquire();
+    }
+
+    /**
+     * Returns the number of the compressed history tiles which
+     * failed to be restored and have been replaced with
+     * transparent pixels (see KisMementoArenaStore::decompressTileData())
+     */
+    inline qint32 numLostHistoryTiles() const
+    {
+        return m_numLostHistoryTiles.loadAcquire();
+    }
+
+    /**
+     * Try swap out a batch of tile data objects in one go. The tiles
+     * that are being accessed at the moment are skipped.
+     * This function should be called with the store iterator held.
+     * \return the metric of the memory freed
+     */
+    qint64 trySwapTileDataBatch(const QVector<KisTileData*> &tileDataList);
+
+    /**
+     * Loads all the swapped-out tile data objects from \p tileDataList
+     * into memory in one batch. Unlike ensureTileDataLoaded() it
+     * doesn't block the swapping of the tiles afterwards, so it can
+     * be used for fetching the tiles in advance. The tiles that are
+     * being accessed at the moment are skipped.
+     * PRECONDITIONS: the caller holds a reference to every tile data
+     *                m_listRWLock is *unlocked*
+     */
+    void swapInTileDataBatch(const QVector<KisTileData*> &tileDataList);
+
+    /**
+     * Returns the number of tile data objects in the swap
+     */
+    inline qint32 numTilesSwapped() const
+    {
+        return m_swappedStore.numTiles();
+    }
+
+    /**
+     * Schedules asynchronous loading of the swapped tiles covering
+     * \p rect of the data manager \p dm. Does nothing if the swap
+     * file is empty.
+     */
+    inline void prefetchTileData(KisTiledDataManagerSP dm, const QRect &rect)
+    {
+        if (!numTilesSwapped()) return;
+        m_swapper.prefetch(dm, rect);
+    }
+
+    /**
+     * Schedules compression of the tile data objects that have just
+     * become historical. Called by the memento manager on every
+     * commit, so the tiles of one transaction are packed together.
+     * The compression itself is done by the swapper thread.
+     */
+    void scheduleHistoryCompression(const QVector<KisTileData*> &tileDataList);
+
+    /**
+     * Compresses the historical tile data objects of \p tileDataList
+     * into the arena store. The tiles that are not historical anymore
+     * or are being accessed at the moment are skipped.
+     * PRECONDITIONS: the caller holds a reference to every tile data
+     *                m_listRWLock is *unlocked*
+     * \return the number of tiles compressed
+     */
+    int compressHistoricalTileDataBatch(const QVector<KisTileData*> &tileDataList);
+
+    /**
+     * Returns the number of tile data objects kept in
+     * the compressed history arenas
+     */
+    inline qint32 numTilesCompressed() const
+    {
+        return m_arenaStore.numTiles();
+    }
+
 
     /**
      * WARN: The following three method are only for usage
@@ -144,12 +268,22 @@ public:
     void unregisterTileData(KisTileData *td);
 
 private:
-    KisTileData *allocTileData(qint32 pixelSize, const quint8 *defPixel);
+    KisTileData *allocTileData(qint32 pixelSize, const quint8 *defPixel,
+                               qint32 width, qint32 height);
 
     inline void registerTileDataImp(KisTileData *td);
     inline void unregisterTileDataImp(KisTileData *td);
     void freeRegisteredTiles();
 
+    inline void collapseUniformTileDataImp(KisTileData *td);
+    inline void expandUniformTileDataImp(KisTileData *td);
+
+    /**
+     * Decompresses the tile taken out of the arena store. The tile
+     * should be locked, but the iterator lock is not needed.
+     */
+    void decompressTileDataImp(KisTileData *td, const QByteArray &compressedData);
+
     friend class DeadlockyThread;
     friend class KisLowMemoryTests;
     void debugSwapAll();
@@ -168,14 +302,26 @@ private:
     friend class KisTileDataStoreTest;
     friend class KisTileDataPoolerTest;
     KisSwappedDataStore m_swappedStore;
+    KisMementoArenaStore m_arenaStore;
 
     /**
      * This metric is used for computing the volume
      * of memory occupied by tile data objects.
      * metric = num_bytes / (KisTileData::WIDTH * KisTileData::HEIGHT)
+     * \see KisTileData::memoryMetric()
      */
     QAtomicInt m_numTiles;
     QAtomicInt m_memoryMetric;
+
+    /**
+     * The number and the metric of the collapsed uniform tile
+     * data objects. They are not present in the tile data map.
+     */
+    QAtomicInt m_numUniformTiles;
+    QAtomicInt m_uniformMemoryMetric;
+
+    QAtomicInt m_numLostHistoryTiles;
+
     QAtomicInt m_counter;
     QAtomicInt m_clockIndex;
     ConcurrentMap<int, KisTileData*> m_tileDataMap;
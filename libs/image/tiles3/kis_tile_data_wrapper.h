@@ -45,10 +45,10 @@ public:
         const qint32 row = dm->yToRow(y);
 
         /* FIXME: Always positive? */
-        const qint32 xInTile = x - col * KisTileData::WIDTH;
-        const qint32 yInTile = y - row * KisTileData::HEIGHT;
+        const qint32 xInTile = x - col * dm->tileWidth();
+        const qint32 yInTile = y - row * dm->tileHeight();
 
-        const qint32 pixelIndex = xInTile + yInTile * KisTileData::WIDTH;
+        const qint32 pixelIndex = xInTile + yInTile * dm->tileWidth();
 
         KisTileSP tile = dm->getTile(col, row, type == WRITE);
 
@@ -24,6 +24,7 @@
 #include "3rdparty/lock_free_map/concurrent_map.h"
 #include "kis_tile.h"
 #include "kis_debug.h"
+#include "config-hash-table-implementaion.h"
 
 #define SANITY_CHECK
 
@@ -422,8 +423,10 @@ void KisTileHashTableTraits2<T>::debugMaxListLength(qint32 &/*min*/, qint32 &/*m
 {
 }
 
+#ifndef USE_SHARDED_HASH_TABLE
 typedef KisTileHashTableTraits2<KisTile> KisTileHashTable;
 typedef KisTileHashTableIteratorTraits2<KisTile> KisTileHashTableIterator;
 typedef KisTileHashTableIteratorTraits2<KisTile> KisTileHashTableConstIterator;
+#endif // USE_SHARDED_HASH_TABLE
 
 #endif // KIS_TILEHASHTABLE_2_H
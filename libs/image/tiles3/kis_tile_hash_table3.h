@@ -0,0 +1,281 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_TILEHASHTABLE_3_H
+#define KIS_TILEHASHTABLE_3_H
+
+#include "kis_tile_hash_table2.h"
+
+/**
+ * A sharded version of KisTileHashTableTraits2. The tiles are
+ * distributed over NUM_SHARDS independent lock-free tables by their
+ * coordinates. Neighbouring tiles (blocks of SHARD_BLOCK_SIZE x
+ * SHARD_BLOCK_SIZE tiles) go into the same shard, so the threads
+ * processing separate patches of the image mostly access different
+ * shards and don't share the locks, the atomic counters and the
+ * garbage collector of a single map.
+ *
+ * The interface is the same as the one of KisTileHashTableTraits2,
+ * so it can be used in KisTiledDataManager and KisMementoManager
+ * directly. The variant is selected by USE_SHARDED_HASH_TABLE option.
+ */
+
+template <class T>
+class KisTileHashTableIteratorTraits3;
+
+template <class T>
+class KisTileHashTableTraits3
+{
+public:
+    typedef T TileType;
+    typedef KisSharedPtr<T> TileTypeSP;
+    typedef KisTileHashTableTraits2<T> Shard;
+
+    static const int NUM_SHARDS = 16;
+    static const int SHARD_BLOCK_SHIFT = 2;
+    static const int SHARD_BLOCK_SIZE = 1 << SHARD_BLOCK_SHIFT;
+
+    KisTileHashTableTraits3(KisMementoManager *mm)
+    {
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            m_shards[i] = new Shard(mm);
+        }
+    }
+
+    KisTileHashTableTraits3(const KisTileHashTableTraits3<T> &ht, KisMementoManager *mm)
+    {
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            m_shards[i] = new Shard(*ht.m_shards[i], mm);
+        }
+    }
+
+    ~KisTileHashTableTraits3()
+    {
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            delete m_shards[i];
+        }
+    }
+
+    bool isEmpty()
+    {
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            if (!m_shards[i]->isEmpty()) return false;
+        }
+        return true;
+    }
+
+    bool tileExists(qint32 col, qint32 row)
+    {
+        return shard(col, row)->tileExists(col, row);
+    }
+
+    TileTypeSP getExistingTile(qint32 col, qint32 row)
+    {
+        return shard(col, row)->getExistingTile(col, row);
+    }
+
+    TileTypeSP getTileLazy(qint32 col, qint32 row, bool& newTile)
+    {
+        return shard(col, row)->getTileLazy(col, row, newTile);
+    }
+
+    TileTypeSP getReadOnlyTileLazy(qint32 col, qint32 row, bool &existingTile)
+    {
+        return shard(col, row)->getReadOnlyTileLazy(col, row, existingTile);
+    }
+
+    void addTile(TileTypeSP tile)
+    {
+        shard(tile->col(), tile->row())->addTile(tile);
+    }
+
+    bool deleteTile(TileTypeSP tile)
+    {
+        return deleteTile(tile->col(), tile->row());
+    }
+
+    bool deleteTile(qint32 col, qint32 row)
+    {
+        return shard(col, row)->deleteTile(col, row);
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            m_shards[i]->clear();
+        }
+    }
+
+    void setDefaultTileData(KisTileData *defaultTileData)
+    {
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            m_shards[i]->setDefaultTileData(defaultTileData);
+        }
+    }
+
+    KisTileData* defaultTileData()
+    {
+        return m_shards[0]->defaultTileData();
+    }
+
+    qint32 numTiles()
+    {
+        qint32 result = 0;
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            result += m_shards[i]->numTiles();
+        }
+        return result;
+    }
+
+    void debugPrintInfo()
+    {
+        dbgKrita << "==========================\n"
+                 << "TileHashTable (sharded):\n"
+                 << " total tiles:\t" << numTiles();
+
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            dbgKrita << " shard" << i << "tiles:\t" << m_shards[i]->numTiles();
+        }
+        dbgKrita << "==========================\n";
+    }
+
+    /**
+     * Reports the minimum and the maximum number of tiles per
+     * shard, which shows how well the tiles are distributed
+     */
+    void debugMaxListLength(qint32 &min, qint32 &max)
+    {
+        min = max = m_shards[0]->numTiles();
+
+        for (int i = 1; i < NUM_SHARDS; i++) {
+            const qint32 size = m_shards[i]->numTiles();
+            min = qMin(min, size);
+            max = qMax(max, size);
+        }
+    }
+
+    friend class KisTileHashTableIteratorTraits3<T>;
+
+private:
+    static inline int shardIndex(qint32 col, qint32 row)
+    {
+        const quint32 blockCol = static_cast<quint32>(col >> SHARD_BLOCK_SHIFT);
+        const quint32 blockRow = static_cast<quint32>(row >> SHARD_BLOCK_SHIFT);
+
+        const quint32 hash = blockCol * 0x9E3779B1U ^ blockRow * 0x85EBCA77U;
+        return (hash >> 16) & (NUM_SHARDS - 1);
+    }
+
+    inline Shard* shard(qint32 col, qint32 row)
+    {
+        return m_shards[shardIndex(col, row)];
+    }
+
+private:
+    Q_DISABLE_COPY(KisTileHashTableTraits3)
+
+    Shard *m_shards[NUM_SHARDS];
+};
+
+/**
+ * Iterates through all the shards one by one. All the shards are
+ * locked for the whole lifetime of the iterator (always in the same
+ * order), so it has the same guarantees as the iterator of
+ * KisTileHashTableTraits2.
+ */
+template <class T>
+class KisTileHashTableIteratorTraits3
+{
+public:
+    typedef T TileType;
+    typedef KisSharedPtr<T> TileTypeSP;
+    typedef KisTileHashTableTraits3<T> HashTable;
+    typedef KisTileHashTableIteratorTraits2<T> ShardIterator;
+
+    KisTileHashTableIteratorTraits3(HashTable *ht)
+        : m_ht(ht),
+          m_currentShard(0)
+    {
+        for (int i = 0; i < HashTable::NUM_SHARDS; i++) {
+            m_iterators[i] = new ShardIterator(m_ht->m_shards[i]);
+        }
+
+        skipFinishedShards();
+    }
+
+    ~KisTileHashTableIteratorTraits3()
+    {
+        for (int i = HashTable::NUM_SHARDS - 1; i >= 0; i--) {
+            delete m_iterators[i];
+        }
+    }
+
+    void next()
+    {
+        m_iterators[m_currentShard]->next();
+        skipFinishedShards();
+    }
+
+    TileTypeSP tile() const
+    {
+        return !isDone() ? m_iterators[m_currentShard]->tile() : TileTypeSP();
+    }
+
+    bool isDone() const
+    {
+        return m_currentShard >= HashTable::NUM_SHARDS;
+    }
+
+    void deleteCurrent()
+    {
+        m_iterators[m_currentShard]->deleteCurrent();
+        skipFinishedShards();
+    }
+
+    void moveCurrentToHashTable(HashTable *newHashTable)
+    {
+        TileTypeSP tile = this->tile();
+        next();
+
+        m_ht->shard(tile->col(), tile->row())->deleteTile(tile->col(), tile->row());
+        newHashTable->addTile(tile);
+    }
+
+private:
+    void skipFinishedShards()
+    {
+        while (m_currentShard < HashTable::NUM_SHARDS &&
+               m_iterators[m_currentShard]->isDone()) {
+
+            m_currentShard++;
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(KisTileHashTableIteratorTraits3)
+
+    HashTable *m_ht;
+    ShardIterator *m_iterators[HashTable::NUM_SHARDS];
+    int m_currentShard;
+};
+
+typedef KisTileHashTableTraits3<KisTile> KisTileHashTable;
+typedef KisTileHashTableIteratorTraits3<KisTile> KisTileHashTableIterator;
+typedef KisTileHashTableIteratorTraits3<KisTile> KisTileHashTableConstIterator;
+
+#endif // KIS_TILEHASHTABLE_3_H
@@ -26,15 +26,17 @@
 #include "kis_tile_data_wrapper.h"
 #include "kis_tiled_data_manager_p.h"
 #include "kis_memento_manager.h"
+#include "kis_tile_data_store.h"
 #include "swap/kis_legacy_tile_compressor.h"
 #include "swap/kis_tile_compressor_factory.h"
 
 #include "kis_paint_device_writer.h"
 
 #include "kis_global.h"
+#include "kis_assert.h"
 
 
-/* The data area is divided into tiles each say 64x64 pixels (defined at compiletime)
+/* The data area is divided into tiles each say 64x64 pixels (defined per data manager)
  * The tiles are laid out in a matrix that can have negative indexes.
  * The matrix grows automatically if needed (a call for writeacces to a tile
  * outside the current extent)
@@ -42,8 +44,23 @@
  * They are created on demand
  */
 
+namespace {
+qint32 sanitizeTileSize(qint32 size, qint32 defaultSize)
+{
+    KIS_SAFE_ASSERT_RECOVER(KisTiledDataManager::isValidTileSize(size)) {
+        return defaultSize;
+    }
+    return size;
+}
+}
+
 KisTiledDataManager::KisTiledDataManager(quint32 pixelSize,
-                                         const quint8 *defaultPixel)
+                                         const quint8 *defaultPixel,
+                                         qint32 tileWidth,
+                                         qint32 tileHeight)
+    : m_tileWidth(sanitizeTileSize(tileWidth, KisTileData::WIDTH)),
+      m_tileHeight(sanitizeTileSize(tileHeight, KisTileData::HEIGHT)),
+      m_extentManager(m_tileWidth, m_tileHeight)
 {
     /* See comment in destructor for details */
     m_mementoManager = new KisMementoManager();
@@ -55,7 +72,10 @@ KisTiledDataManager::KisTiledDataManager(quint32 pixelSize,
 }
 
 KisTiledDataManager::KisTiledDataManager(const KisTiledDataManager &dm)
-    : KisShared()
+    : KisShared(),
+      m_tileWidth(dm.m_tileWidth),
+      m_tileHeight(dm.m_tileHeight),
+      m_extentManager(m_tileWidth, m_tileHeight)
 {
     /* See comment in destructor for details */
 
@@ -98,7 +118,8 @@ void KisTiledDataManager::setDefaultPixel(const quint8 *defaultPixel)
 
 void KisTiledDataManager::setDefaultPixelImpl(const quint8 *defaultPixel)
 {
-    KisTileData *td = KisTileDataStore::instance()->createDefaultTileData(pixelSize(), defaultPixel);
+    KisTileData *td = KisTileDataStore::instance()->createDefaultTileData(pixelSize(), defaultPixel,
+                                                                          m_tileWidth, m_tileHeight);
     m_hashTable->setDefaultTileData(td);
     m_mementoManager->setDefaultTileData(td);
 
@@ -157,6 +178,10 @@ bool KisTiledDataManager::read(QIODevice *stream)
     quint32 numTiles;
     qint32 tilesVersion = LEGACY_VERSION;
 
+    // legacy files have no header and are always saved with 64x64 tiles
+    qint32 fileTileWidth = KisTileData::WIDTH;
+    qint32 fileTileHeight = KisTileData::HEIGHT;
+
     if (line[0] == 'V') {
         QList<QByteArray> lineItems = line.split(' ');
 
@@ -165,7 +190,7 @@ bool KisTiledDataManager::read(QIODevice *stream)
 
         tilesVersion = lineItems.takeFirst().toInt();
 
-        if(!processTilesHeader(stream, numTiles))
+        if(!processTilesHeader(stream, numTiles, fileTileWidth, fileTileHeight))
             return false;
     }
     else {
@@ -175,13 +200,30 @@ bool KisTiledDataManager::read(QIODevice *stream)
     KisAbstractTileCompressorSP compressor =
         KisTileCompressorFactory::create(tilesVersion);
 
+    /**
+     * The tiles saved with a different tile size are loaded into
+     * a temporary data manager and then copied pixel-wise
+     */
+    KisTiledDataManagerSP conversionDM;
+    KisTiledDataManager *targetDM = this;
+
+    if (fileTileWidth != m_tileWidth || fileTileHeight != m_tileHeight) {
+        conversionDM = new KisTiledDataManager(m_pixelSize, m_defaultPixel,
+                                               fileTileWidth, fileTileHeight);
+        targetDM = conversionDM.data();
+    }
+
     bool readSuccess = true;
     for (quint32 i = 0; i < numTiles; i++) {
-        if (!compressor->readTile(stream, this)) {
+        if (!compressor->readTile(stream, targetDM)) {
             readSuccess = false;
         }
     }
 
+    if (conversionDM) {
+        bitBltByPixelsImpl<false>(conversionDM.data(), conversionDM->extent());
+    }
+
     m_mementoManager->commit();
     return readSuccess;
 }
@@ -196,8 +238,8 @@ bool KisTiledDataManager::writeTilesHeader(KisPaintDeviceWriter &store, quint32
                      "PIXELSIZE %4\n"
                      "DATA %5\n")
         .arg(CURRENT_VERSION)
-        .arg(KisTileData::WIDTH)
-        .arg(KisTileData::HEIGHT)
+        .arg(m_tileWidth)
+        .arg(m_tileHeight)
         .arg(pixelSize())
         .arg(numTiles);
 
@@ -214,7 +256,8 @@ bool KisTiledDataManager::writeTilesHeader(KisPaintDeviceWriter &store, quint32
     } while(0)                                                  \
 
 
-bool KisTiledDataManager::processTilesHeader(QIODevice *stream, quint32 &numTiles)
+bool KisTiledDataManager::processTilesHeader(QIODevice *stream, quint32 &numTiles,
+                                             qint32 &tileWidth, qint32 &tileHeight)
 {
     /**
      * We assume that there is only one version of this header
@@ -234,12 +277,14 @@ bool KisTiledDataManager::processTilesHeader(QIODevice *stream, quint32 &numTile
         takeOneLine(stream, maxLineLength, keyword, value);
 
         if (keyword == "TILEWIDTH") {
-            if(value != KisTileData::WIDTH)
+            if(!isValidTileSize(value))
                 goto wrongString;
+            tileWidth = value;
         }
         else if (keyword == "TILEHEIGHT") {
-            if(value != KisTileData::HEIGHT)
+            if(!isValidTileSize(value))
                 goto wrongString;
+            tileHeight = value;
         }
         else if (keyword == "PIXELSIZE") {
             if((quint32)value != pixelSize())
@@ -272,7 +317,7 @@ void KisTiledDataManager::purge(const QRect& area)
 {
     QList<KisTileSP> tilesToDelete;
     {
-        const qint32 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize();
+        const qint32 tileDataSize = m_tileHeight * m_tileWidth * pixelSize();
         KisTileData *tileData = m_hashTable->defaultTileData();
         tileData->blockSwapping();
         const quint8 *defaultData = tileData->data();
@@ -342,27 +387,28 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
     qint32 firstRow = yToRow(clearRect.top());
     qint32 lastRow = yToRow(clearRect.bottom());
 
-    const quint32 rowStride = KisTileData::WIDTH * pixelSize;
+    const quint32 rowStride = m_tileWidth * pixelSize;
 
     // Generate one row
     quint8 *clearPixelData = 0;
-    quint32 maxRunLength = qMin(clearRect.width(), KisTileData::WIDTH);
+    quint32 maxRunLength = qMin(clearRect.width(), m_tileWidth);
     clearPixelData = duplicatePixel(maxRunLength, clearPixel);
 
     KisTileData *td = 0;
     if (!pixelBytesAreDefault &&
-        clearRect.width() >= KisTileData::WIDTH &&
-        clearRect.height() >= KisTileData::HEIGHT) {
+        clearRect.width() >= m_tileWidth &&
+        clearRect.height() >= m_tileHeight) {
 
-        td = KisTileDataStore::instance()->createDefaultTileData(pixelSize, clearPixel);
+        td = KisTileDataStore::instance()->createDefaultTileData(pixelSize, clearPixel,
+                                                                  m_tileWidth, m_tileHeight);
         td->acquire();
     }
 
     for (qint32 row = firstRow; row <= lastRow; ++row) {
         for (qint32 column = firstColumn; column <= lastColumn; ++column) {
 
-            QRect tileRect(column*KisTileData::WIDTH, row*KisTileData::HEIGHT,
-                           KisTileData::WIDTH, KisTileData::HEIGHT);
+            QRect tileRect(column*m_tileWidth, row*m_tileHeight,
+                           m_tileWidth, m_tileHeight);
             QRect clearTileRect = clearRect & tileRect;
 
             if (clearTileRect == tileRect) {
@@ -440,11 +486,18 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
 {
     if (rect.isEmpty()) return;
 
+    if (srcDM->tileWidth() != m_tileWidth ||
+        srcDM->tileHeight() != m_tileHeight) {
+
+        bitBltByPixelsImpl<useOldSrcData>(srcDM, rect);
+        return;
+    }
+
     const qint32 pixelSize = this->pixelSize();
     const bool defaultPixelsCoincide =
         !memcmp(srcDM->defaultPixel(), m_defaultPixel, pixelSize);
 
-    const quint32 rowStride = KisTileData::WIDTH * pixelSize;
+    const quint32 rowStride = m_tileWidth * pixelSize;
 
     qint32 firstColumn = xToCol(rect.left());
     qint32 lastColumn = xToCol(rect.right());
@@ -462,8 +515,8 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
                 srcDM->getOldTile(column, row, srcTileExists) :
                 srcDM->getReadOnlyTileLazy(column, row, srcTileExists);
 
-            QRect tileRect(column*KisTileData::WIDTH, row*KisTileData::HEIGHT,
-                           KisTileData::WIDTH, KisTileData::HEIGHT);
+            QRect tileRect(column*m_tileWidth, row*m_tileHeight,
+                           m_tileWidth, m_tileHeight);
             QRect cloneTileRect = rect & tileRect;
 
             if (cloneTileRect == tileRect) {
@@ -517,6 +570,22 @@ void KisTiledDataManager::bitBltRoughImpl(KisTiledDataManager *srcDM, const QRec
 {
     if (rect.isEmpty()) return;
 
+    if (srcDM->tileWidth() != m_tileWidth ||
+        srcDM->tileHeight() != m_tileHeight) {
+
+        /**
+         * The tiles cannot be shared, so just copy all the
+         * destination tiles touched by the rect
+         */
+        const QRect alignedRect(xToCol(rect.left()) * m_tileWidth,
+                                yToRow(rect.top()) * m_tileHeight,
+                                (xToCol(rect.right()) - xToCol(rect.left()) + 1) * m_tileWidth,
+                                (yToRow(rect.bottom()) - yToRow(rect.top()) + 1) * m_tileHeight);
+
+        bitBltByPixelsImpl<useOldSrcData>(srcDM, alignedRect);
+        return;
+    }
+
     const qint32 pixelSize = this->pixelSize();
     const bool defaultPixelsCoincide =
         !memcmp(srcDM->defaultPixel(), m_defaultPixel, pixelSize);
@@ -563,6 +632,54 @@ void KisTiledDataManager::bitBltRoughImpl(KisTiledDataManager *srcDM, const QRec
     }
 }
 
+template<bool useOldSrcData>
+void KisTiledDataManager::bitBltByPixelsImpl(KisTiledDataManager *srcDM, const QRect &rect)
+{
+    if (rect.isEmpty()) return;
+
+    const qint32 pixelSize = this->pixelSize();
+    const bool defaultPixelsCoincide =
+        !memcmp(srcDM->defaultPixel(), m_defaultPixel, pixelSize);
+
+    const qint32 srcRowStride = srcDM->tileWidth() * pixelSize;
+
+    const qint32 firstColumn = srcDM->xToCol(rect.left());
+    const qint32 lastColumn = srcDM->xToCol(rect.right());
+
+    const qint32 firstRow = srcDM->yToRow(rect.top());
+    const qint32 lastRow = srcDM->yToRow(rect.bottom());
+
+    for (qint32 row = firstRow; row <= lastRow; ++row) {
+        for (qint32 column = firstColumn; column <= lastColumn; ++column) {
+
+            bool srcTileExists = false;
+
+            KisTileSP srcTile = useOldSrcData ?
+                srcDM->getOldTile(column, row, srcTileExists) :
+                srcDM->getReadOnlyTileLazy(column, row, srcTileExists);
+
+            const QRect srcTileRect = srcTile->extent();
+            const QRect copyRect = rect & srcTileRect;
+
+            if (!srcTileExists && defaultPixelsCoincide) {
+                clear(copyRect, m_defaultPixel);
+                continue;
+            }
+
+            const qint32 srcOffset =
+                ((copyRect.top() - srcTileRect.top()) * srcTileRect.width() +
+                 copyRect.left() - srcTileRect.left()) * pixelSize;
+
+            srcTile->lockForRead();
+            writeBytesBody(srcTile->data() + srcOffset,
+                           copyRect.x(), copyRect.y(),
+                           copyRect.width(), copyRect.height(),
+                           srcRowStride);
+            srcTile->unlock();
+        }
+    }
+}
+
 void KisTiledDataManager::bitBlt(KisTiledDataManager *srcDM, const QRect &rect)
 {
     bitBltImpl<false>(srcDM, rect);
@@ -620,10 +737,10 @@ void KisTiledDataManager::setExtent(QRect newRect)
                 quint8* ptr;
 
                 /* FIXME: make it faster */
-                for (int y = 0; y < KisTileData::HEIGHT; y++) {
-                    for (int x = 0; x < KisTileData::WIDTH; x++) {
+                for (int y = 0; y < m_tileHeight; y++) {
+                    for (int x = 0; x < m_tileWidth; x++) {
                         if (!intersection.contains(x, y)) {
-                            ptr = data + pixelSize * (y * KisTileData::WIDTH + x);
+                            ptr = data + pixelSize * (y * m_tileWidth + x);
                             memcpy(ptr, m_defaultPixel, pixelSize);
                         }
                     }
@@ -666,6 +783,57 @@ QRect KisTiledDataManager::extent() const
     return m_extentManager.extent();
 }
 
+void KisTiledDataManager::prefetchSwappedTiles(const QRect &rect)
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    if (!store->numTilesSwapped() || rect.isEmpty()) return;
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 lastColumn = xToCol(rect.right());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    QVector<KisTileSP> tiles;
+
+    for (qint32 row = firstRow; row <= lastRow; ++row) {
+        for (qint32 column = firstColumn; column <= lastColumn; ++column) {
+            KisTileSP tile = m_hashTable->getExistingTile(column, row);
+            if (tile) {
+                tiles.append(tile);
+            }
+        }
+    }
+
+    prefetchSwappedTiles(tiles);
+}
+
+void KisTiledDataManager::prefetchSwappedTiles(const QVector<KisTileSP> &tiles)
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    if (!store->numTilesSwapped()) return;
+
+    QVector<KisTileData*> swappedTileData;
+
+    Q_FOREACH (KisTileSP tile, tiles) {
+        KisTileData *td = tile->referenceTileData();
+
+        // the check is racy, but the store rechecks it under the lock
+        if (!td->data()) {
+            swappedTileData.append(td);
+        } else {
+            td->deref();
+        }
+    }
+
+    if (swappedTileData.isEmpty()) return;
+
+    store->swapInTileDataBatch(swappedTileData);
+
+    Q_FOREACH (KisTileData *td, swappedTileData) {
+        td->deref();
+    }
+}
+
 QRegion KisTiledDataManager::region() const
 {
     QRegion region;
@@ -749,9 +917,9 @@ qint32 KisTiledDataManager::numContiguousColumns(qint32 x, qint32 minY, qint32 m
     Q_UNUSED(maxY);
 
     if (x >= 0) {
-        numColumns = KisTileData::WIDTH - (x % KisTileData::WIDTH);
+        numColumns = m_tileWidth - (x % m_tileWidth);
     } else {
-        numColumns = ((-x - 1) % KisTileData::WIDTH) + 1;
+        numColumns = ((-x - 1) % m_tileWidth) + 1;
     }
 
     return numColumns;
@@ -765,9 +933,9 @@ qint32 KisTiledDataManager::numContiguousRows(qint32 y, qint32 minX, qint32 maxX
     Q_UNUSED(maxX);
 
     if (y >= 0) {
-        numRows = KisTileData::HEIGHT - (y % KisTileData::HEIGHT);
+        numRows = m_tileHeight - (y % m_tileHeight);
     } else {
-        numRows = ((-y - 1) % KisTileData::HEIGHT) + 1;
+        numRows = ((-y - 1) % m_tileHeight) + 1;
     }
 
     return numRows;
@@ -778,10 +946,15 @@ qint32 KisTiledDataManager::rowStride(qint32 x, qint32 y) const
     Q_UNUSED(x);
     Q_UNUSED(y);
 
-    return KisTileData::WIDTH * pixelSize();
+    return m_tileWidth * pixelSize();
 }
 
 void KisTiledDataManager::releaseInternalPools()
 {
     KisTileData::releaseInternalPools();
 }
+
+bool KisTiledDataManager::isValidTileSize(qint32 size)
+{
+    return size == 64 || size == 128 || size == 256;
+}
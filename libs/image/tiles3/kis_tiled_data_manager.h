@@ -30,11 +30,13 @@
 //#include "kis_debug.h"
 #include "kritaimage_export.h"
 
-#ifdef USE_LOCK_FREE_HASH_TABLE
+#if defined(USE_SHARDED_HASH_TABLE)
+#include "kis_tile_hash_table3.h"
+#elif defined(USE_LOCK_FREE_HASH_TABLE)
 #include "kis_tile_hash_table2.h"
 #else
 #include "kis_tile_hash_table.h"
-#endif // USE_LOCK_FREE_HASH_TABLE
+#endif // USE_SHARDED_HASH_TABLE
 
 #include "kis_memento_manager.h"
 #include "kis_memento.h"
@@ -73,7 +75,18 @@ private:
 protected:
     /*FIXME:*/
 public:
-    KisTiledDataManager(quint32 pixelSize, const quint8 *defPixel);
+    /**
+     * Creates a data manager with tiles of \p tileWidth x \p tileHeight
+     * pixels. Bigger tiles reduce the number of entries in the hash
+     * table and the number of tile crossings in the iterators for
+     * huge images, at the cost of coarser copy-on-write and swapping.
+     * The dimensions should be 64, 128 or 256 pixels.
+     *
+     * \see isValidTileSize()
+     */
+    KisTiledDataManager(quint32 pixelSize, const quint8 *defPixel,
+                        qint32 tileWidth = KisTileData::WIDTH,
+                        qint32 tileHeight = KisTileData::HEIGHT);
     virtual ~KisTiledDataManager();
     KisTiledDataManager(const KisTiledDataManager &dm);
     KisTiledDataManager & operator=(const KisTiledDataManager &dm);
@@ -202,8 +215,36 @@ public:
         m_mementoManager->purgeHistory(oldestMemento);
     }
 
+    /**
+     * Returns the estimated size (in bytes) of the tile data kept
+     * alive by the undo/redo history of the data manager only
+     *
+     * \see KisMementoManager::estimateHistoricalMemorySize()
+     */
+    qint64 estimateHistoricalMemorySize() const {
+        QReadLocker locker(&m_lock);
+        return m_mementoManager->estimateHistoricalMemorySize();
+    }
+
     static void releaseInternalPools();
 
+    /**
+     * The dimensions of the tiles of the data manager
+     */
+    inline qint32 tileWidth() const {
+        return m_tileWidth;
+    }
+
+    inline qint32 tileHeight() const {
+        return m_tileHeight;
+    }
+
+    /**
+     * Returns true if \p size is a supported tile dimension,
+     * that is 64, 128 or 256 pixels
+     */
+    static bool isValidTileSize(qint32 size);
+
 protected:
     /**
      * Reads and writes the tiles 
@@ -228,6 +269,20 @@ public:
 
     QRegion region() const;
 
+    /**
+     * Loads the swapped-out tiles intersecting \p rect from the swap
+     * in one batch, so that the following accesses to them don't
+     * stall on reading them one by one. Does nothing if the swap is
+     * empty.
+     */
+    void prefetchSwappedTiles(const QRect &rect);
+
+    /**
+     * The same as above, but for the tiles the caller has already
+     * taken from the data manager, so no hash table lookups are needed
+     */
+    void prefetchSwappedTiles(const QVector<KisTileSP> &tiles);
+
     void clear(QRect clearRect, quint8 clearValue);
     void clear(QRect clearRect, const quint8 *clearPixel);
     void clear(qint32 x, qint32 y, qint32 w, qint32 h, quint8 clearValue);
@@ -348,6 +403,8 @@ private:
     KisMementoManager *m_mementoManager;
     quint8* m_defaultPixel;
     qint32 m_pixelSize;
+    qint32 m_tileWidth;
+    qint32 m_tileHeight;
     KisTiledExtentManager m_extentManager;
 
     mutable QReadWriteLock m_lock;
@@ -364,7 +421,8 @@ private:
     void setDefaultPixelImpl(const quint8 *defPixel);
 
     bool writeTilesHeader(KisPaintDeviceWriter &store, quint32 numTiles);
-    bool processTilesHeader(QIODevice *stream, quint32 &numTiles);
+    bool processTilesHeader(QIODevice *stream, quint32 &numTiles,
+                            qint32 &tileWidth, qint32 &tileHeight);
 
     qint32 divideRoundDown(qint32 x, const qint32 y) const;
 
@@ -376,6 +434,8 @@ private:
         void bitBltImpl(KisTiledDataManager *srcDM, const QRect &rect);
     template<bool useOldSrcData>
         void bitBltRoughImpl(KisTiledDataManager *srcDM, const QRect &rect);
+    template<bool useOldSrcData>
+        void bitBltByPixelsImpl(KisTiledDataManager *srcDM, const QRect &rect);
 
     void writeBytesBody(const quint8 *data,
                         qint32 x, qint32 y,
@@ -414,12 +474,12 @@ inline qint32 KisTiledDataManager::divideRoundDown(qint32 x, const qint32 y) con
 
 inline qint32 KisTiledDataManager::xToCol(qint32 x) const
 {
-    return divideRoundDown(x, KisTileData::WIDTH);
+    return divideRoundDown(x, m_tileWidth);
 }
 
 inline qint32 KisTiledDataManager::yToRow(qint32 y) const
 {
-    return divideRoundDown(y, KisTileData::HEIGHT);
+    return divideRoundDown(y, m_tileHeight);
 }
 
 // during development the following line helps to check the interface is correct
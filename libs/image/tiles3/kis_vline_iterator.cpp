@@ -18,6 +18,7 @@
  */
 
 #include "kis_vline_iterator.h"
+#include "kis_tile_data_store.h"
 
 #include <iostream>
 
@@ -33,7 +34,7 @@ KisVLineIterator2::KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint
     Q_ASSERT(h > 0); // for us, to warn us when abusing the iterators
     if (h < 1) h = 1;  // for release mode, to make sure there's always at least one pixel read.
 
-    m_lineStride = m_pixelSize * KisTileData::WIDTH;
+    m_lineStride = m_pixelSize * m_tileWidth;
 
     m_x = x;
     m_y = y;
@@ -55,17 +56,15 @@ KisVLineIterator2::KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint
     m_column = xToCol(m_x);
     m_xInTile = calcXInTile(m_x, m_column);
 
-    m_topInTopmostTile = m_top - m_topRow * KisTileData::WIDTH;
+    m_topInTopmostTile = m_top - m_topRow * m_tileHeight;
 
     m_tilesCacheSize = m_bottomRow - m_topRow + 1;
     m_tilesCache.resize(m_tilesCacheSize);
 
-    m_tileSize = m_lineStride * KisTileData::HEIGHT;
+    m_tileSize = m_lineStride * m_tileHeight;
 
     // let's prealocate first row
-    for (int i = 0; i < m_tilesCacheSize; i++){
-        fetchTileDataForCache(m_tilesCache[i], m_column, m_topRow + i);
-    }
+    fetchTileColumn();
     m_index = 0;
     switchToTile(m_topInTopmostTile);
 }
@@ -118,7 +117,7 @@ void KisVLineIterator2::nextColumn()
     m_y = m_top;
     ++m_x;
 
-    if (++m_xInTile < KisTileData::HEIGHT) {
+    if (++m_xInTile < m_tileWidth) {
         /* do nothing, usual case */
     } else {
         ++m_column;
@@ -197,16 +196,14 @@ void KisVLineIterator2::switchToTile(qint32 yInTile)
     m_oldData = m_tilesCache[m_index].oldData;
     m_data += offset_row;
     m_dataBottom = m_data + m_tileSize;
-    int offset_col = m_pixelSize * yInTile * KisTileData::WIDTH;
+    int offset_col = m_pixelSize * yInTile * m_tileWidth;
     m_data  += offset_col;
     m_oldData += offset_row + offset_col;
 }
 
 
-void KisVLineIterator2::fetchTileDataForCache(KisTileInfo& kti, qint32 col, qint32 row)
+void KisVLineIterator2::lockTileDataForCache(KisTileInfo& kti)
 {
-    m_dataManager->getTilesPair(col, row, m_writable, &kti.tile, &kti.oldtile);
-
     lockTile(kti.tile);
     kti.data = kti.tile->data();
 
@@ -214,13 +211,45 @@ void KisVLineIterator2::fetchTileDataForCache(KisTileInfo& kti, qint32 col, qint
     kti.oldData = kti.oldtile->data();
 }
 
+void KisVLineIterator2::fetchTileColumn()
+{
+    for (int i = 0; i < m_tilesCacheSize; ++i) {
+        KisTileInfo &kti = m_tilesCache[i];
+        m_dataManager->getTilesPair(m_column, m_topRow + i, m_writable, &kti.tile, &kti.oldtile);
+    }
+
+    prefetchTileColumn();
+
+    for (int i = 0; i < m_tilesCacheSize; ++i) {
+        lockTileDataForCache(m_tilesCache[i]);
+    }
+}
+
+void KisVLineIterator2::prefetchTileColumn()
+{
+    // see KisHLineIterator2::prefetchTileRow()
+    if (m_tilesCacheSize > 1 && KisTileDataStore::instance()->numTilesSwapped()) {
+        QVector<KisTileSP> tiles;
+        tiles.reserve(2 * m_tilesCacheSize);
+
+        for (int i = 0; i < m_tilesCacheSize; ++i) {
+            tiles.append(m_tilesCache[i].tile);
+            if (m_tilesCache[i].oldtile != m_tilesCache[i].tile) {
+                tiles.append(m_tilesCache[i].oldtile);
+            }
+        }
+
+        m_dataManager->prefetchSwappedTiles(tiles);
+    }
+}
+
 void KisVLineIterator2::preallocateTiles()
 {
     for (int i = 0; i < m_tilesCacheSize; ++i){
         unlockTile(m_tilesCache[i].tile);
         unlockTile(m_tilesCache[i].oldtile);
-        fetchTileDataForCache(m_tilesCache[i], m_column, m_topRow + i );
     }
+    fetchTileColumn();
 }
 
 qint32 KisVLineIterator2::x() const
@@ -84,7 +84,9 @@ private:
 private:
 
     void switchToTile(qint32 xInTile);
-    void fetchTileDataForCache(KisTileInfo& kti, qint32 col, qint32 row);
+    void lockTileDataForCache(KisTileInfo& kti);
+    void fetchTileColumn();
     void preallocateTiles();
+    void prefetchTileColumn();
 };
 #endif
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_ABSTRACT_SWAP_SPACE_H
+#define __KIS_ABSTRACT_SWAP_SPACE_H
+
+#include "kis_chunk_allocator.h"
+
+/**
+ * Base class for the storages of the swap file. The swap space
+ * gives access to the chunks allocated by KisChunkAllocator.
+ *
+ * All the methods should be called under the lock of the owner
+ * (KisSwappedDataStore).
+ */
+
+class KRITAIMAGE_EXPORT KisAbstractSwapSpace
+{
+public:
+    KisAbstractSwapSpace();
+    virtual ~KisAbstractSwapSpace();
+
+    inline quint8* getReadChunkPtr(KisChunk readChunk) {
+        return getReadChunkPtr(readChunk.data());
+    }
+
+    inline quint8* getWriteChunkPtr(KisChunk writeChunk) {
+        return getWriteChunkPtr(writeChunk.data());
+    }
+
+    /**
+     * Return the pointer to the data of the chunk or null
+     * if the swap file could not be accessed
+     */
+    virtual quint8* getReadChunkPtr(const KisChunkData &readChunk) = 0;
+    virtual quint8* getWriteChunkPtr(const KisChunkData &writeChunk) = 0;
+
+    /**
+     * If true, the pointers returned by the swap space are valid
+     * until the chunk is freed in the allocator, even after the
+     * lock is released. Otherwise, they are valid only till the
+     * next call to any of get*ChunkPtr().
+     *
+     * Default implementation returns false.
+     */
+    virtual bool hasStablePointers() const;
+
+    /**
+     * Hints that the chunks in range \p chunk are going to be written
+     * sequentially. Default implementation does nothing.
+     */
+    virtual void adviseSequentialWrite(const KisChunkData &chunk);
+
+    /**
+     * Hints that \p chunk is going to be read soon, so the system
+     * can start reading it from disk. Default implementation does
+     * nothing.
+     */
+    virtual void adviseWillRead(const KisChunkData &chunk);
+};
+
+#endif /* __KIS_ABSTRACT_SWAP_SPACE_H */
@@ -102,6 +102,10 @@ protected:
     inline qint32 pixelSize(KisTiledDataManager *dm) {
         return dm->pixelSize();
     }
+
+    inline qint32 tileSizeInBytes(KisTiledDataManager *dm) {
+        return dm->pixelSize() * dm->tileWidth() * dm->tileHeight();
+    }
 };
 
 #endif /* __KIS_ABSTRACT_TILE_COMPRESSOR_H */
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_compression_factory.h"
+
+#include "kis_lzf_compression.h"
+#include "kis_lz4_compression.h"
+#include "kis_zlib_compression.h"
+
+
+KisAbstractCompression* KisCompressionFactory::create(qint32 id)
+{
+    switch (id) {
+    case LZF:
+        return new KisLzfCompression();
+    case LZ4:
+        return new KisLz4Compression();
+    case ZLIB:
+        return new KisZlibCompression();
+    default:
+        return 0;
+    };
+}
+
+qint32 KisCompressionFactory::idFromName(const QString &name)
+{
+    if (name == "LZF") {
+        return LZF;
+    } else if (name == "LZ4") {
+        return LZ4;
+    } else if (name == "ZLIB") {
+        return ZLIB;
+    }
+
+    return 0;
+}
+
+QString KisCompressionFactory::nameFromId(qint32 id)
+{
+    switch (id) {
+    case LZF:
+        return "LZF";
+    case LZ4:
+        return "LZ4";
+    case ZLIB:
+        return "ZLIB";
+    default:
+        return QString();
+    };
+}
+
+QStringList KisCompressionFactory::availableCodecs()
+{
+    return QStringList() << "LZF" << "LZ4" << "ZLIB";
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_COMPRESSION_FACTORY_H
+#define __KIS_COMPRESSION_FACTORY_H
+
+#include "kritaimage_export.h"
+#include <QString>
+#include <QStringList>
+
+class KisAbstractCompression;
+
+/**
+ * The registry of the compression codecs available for the tiles.
+ *
+ * Every codec has a numerical id, which is stored in the first
+ * byte of every compressed tile, and a short name, which is written
+ * into the tile headers of .kra files. Both of them are a part of
+ * the file format, so they must never be changed or reused.
+ */
+class KRITAIMAGE_EXPORT KisCompressionFactory
+{
+public:
+    enum CodecId {
+        LZF = 1,
+        LZ4 = 2,
+        ZLIB = 3
+    };
+
+    /**
+     * Creates a new codec with id \p id or returns null if
+     * the id is unknown. The caller takes the ownership.
+     */
+    static KisAbstractCompression* create(qint32 id);
+
+    /**
+     * \return the id of a codec with name \p name or 0 if
+     * there is no such codec
+     */
+    static qint32 idFromName(const QString &name);
+
+    /**
+     * \return the name of the codec with \p id, e.g. "LZF"
+     */
+    static QString nameFromId(qint32 id);
+
+    /**
+     * \return names of all the available codecs
+     */
+    static QStringList availableCodecs();
+
+    static qint32 defaultCodec() {
+        return LZF;
+    }
+
+private:
+    KisCompressionFactory();
+};
+
+#endif /* __KIS_COMPRESSION_FACTORY_H */
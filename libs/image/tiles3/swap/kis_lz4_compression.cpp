@@ -0,0 +1,335 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_lz4_compression.h"
+
+#include <cstring>
+
+
+#define LZ4_HASH_LOG 12
+#define LZ4_HASH_SIZE (1 << LZ4_HASH_LOG)
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5
+#define MF_LIMIT 12
+#define MAX_DISTANCE 65535
+#define RUN_MASK 15
+#define SKIP_TRIGGER 6
+
+namespace {
+
+inline quint32 read32(const quint8 *p)
+{
+    quint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline quint32 hash32(quint32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/**
+ * Copies data in 8-byte blocks, so it may write up to 7 bytes past
+ * \p dstEnd. Callers must check that both buffers have this slack.
+ */
+inline void wildCopy(quint8 *dst, const quint8 *src, quint8 *dstEnd)
+{
+    do {
+        memcpy(dst, src, 8);
+        dst += 8;
+        src += 8;
+    } while (dst < dstEnd);
+}
+
+inline qint32 commonBytes(const quint8 *p, const quint8 *ref, const quint8 *limit)
+{
+    const quint8 *start = p;
+
+#if defined(__GNUC__) || defined(__clang__)
+    while (p + 8 <= limit) {
+        quint64 a, b;
+        memcpy(&a, p, 8);
+        memcpy(&b, ref, 8);
+        const quint64 diff = a ^ b;
+
+        if (diff) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            return p - start + (__builtin_ctzll(diff) >> 3);
+#else
+            return p - start + (__builtin_clzll(diff) >> 3);
+#endif
+        }
+        p += 8;
+        ref += 8;
+    }
+#endif
+
+    while (p < limit && *p == *ref) {
+        p++;
+        ref++;
+    }
+
+    return p - start;
+}
+
+inline quint8* writeLength(quint8 *op, qint32 length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = length;
+    return op;
+}
+
+inline quint8* writeLiterals(quint8 *op, quint8 *oend,
+                             const quint8 *anchor, const quint8 *iend,
+                             qint32 length, quint8 *token)
+{
+    if (length >= RUN_MASK) {
+        *token = RUN_MASK << 4;
+        op = writeLength(op, length - RUN_MASK);
+    } else {
+        *token = length << 4;
+    }
+
+    if (op + length + 8 <= oend && anchor + length + 8 <= iend) {
+        wildCopy(op, anchor, op + length);
+    } else {
+        memcpy(op, anchor, length);
+    }
+
+    return op + length;
+}
+
+inline bool readLength(const quint8 *&ip, const quint8 *iend, quint32 &length)
+{
+    quint8 s;
+    do {
+        if (ip >= iend) return false;
+        s = *ip++;
+        length += s;
+    } while (s == 255);
+
+    return true;
+}
+
+}
+
+qint32 lz4_compress(const quint8 *input, qint32 length, quint8 *output, qint32 maxout)
+{
+    const quint8 *ip = input;
+    const quint8 *anchor = input;
+    const quint8 * const iend = input + length;
+    const quint8 * const mflimit = iend - MF_LIMIT;
+    const quint8 * const matchlimit = iend - LAST_LITERALS;
+
+    quint8 *op = output;
+    quint8 * const oend = output + maxout;
+
+    /**
+     * The format requires the last match to start at least
+     * MF_LIMIT bytes before the end of the block, so short
+     * blocks are just written as a sequence of literals.
+     */
+    if (length > MF_LIMIT) {
+        qint32 htab[LZ4_HASH_SIZE];
+        memset(htab, 0, sizeof(htab));
+
+        qint32 searchCount = 1 << SKIP_TRIGGER;
+
+        while (ip < mflimit) {
+            const quint32 sequence = read32(ip);
+            const quint32 h = hash32(sequence);
+            const quint8 *ref = input + htab[h];
+            htab[h] = ip - input;
+
+            if (ref >= ip || ip - ref > MAX_DISTANCE || read32(ref) != sequence) {
+                /**
+                 * Incompressible areas are skipped with a growing
+                 * step to avoid wasting time on hash lookups
+                 */
+                ip += searchCount++ >> SKIP_TRIGGER;
+                continue;
+            }
+            searchCount = 1 << SKIP_TRIGGER;
+
+            /* extend the match backwards */
+            while (ip > anchor && ref > input && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            const quint8 *matchEnd = ip + MIN_MATCH +
+                commonBytes(ip + MIN_MATCH, ref + MIN_MATCH, matchlimit);
+
+            quint8 *token = op++;
+            op = writeLiterals(op, oend, anchor, iend, ip - anchor, token);
+
+            const qint32 offset = ip - ref;
+            *op++ = offset & 0xff;
+            *op++ = offset >> 8;
+
+            const qint32 matchLength = matchEnd - ip - MIN_MATCH;
+            if (matchLength >= RUN_MASK) {
+                *token |= RUN_MASK;
+                op = writeLength(op, matchLength - RUN_MASK);
+            } else {
+                *token |= matchLength;
+            }
+
+            ip = anchor = matchEnd;
+
+            /* update the hash at match boundary */
+            if (ip < mflimit) {
+                htab[hash32(read32(ip - 2))] = ip - 2 - input;
+            }
+        }
+    }
+
+    /* left-over as literal copy */
+    quint8 *token = op++;
+    op = writeLiterals(op, oend, anchor, iend, iend - anchor, token);
+
+    return op - output;
+}
+
+qint32 lz4_decompress(const quint8 *input, qint32 length, quint8 *output, qint32 maxout)
+{
+    const quint8 *ip = input;
+    const quint8 * const iend = input + length;
+    quint8 *op = output;
+    quint8 * const oend = output + maxout;
+
+    while (ip < iend) {
+        const quint8 token = *ip++;
+
+        /**
+         * Fast path for the most common case: short literals and
+         * a short non-overlapping match far enough from both ends
+         * of the buffers to copy in fixed-size blocks
+         */
+        if ((token >> 4) < RUN_MASK && (token & RUN_MASK) < RUN_MASK &&
+            iend - ip >= 32 && oend - op >= 32) {
+
+            const quint32 literalLength = token >> 4;
+            memcpy(op, ip, 16);
+            op += literalLength;
+            ip += literalLength;
+
+            const quint32 offset = ip[0] | (ip[1] << 8);
+            const quint32 matchLength = (token & RUN_MASK) + MIN_MATCH;
+
+            if (offset >= 8 && offset <= quint32(op - output)) {
+                ip += 2;
+
+                const quint8 *ref = op - offset;
+                memcpy(op, ref, 8);
+                memcpy(op + 8, ref + 8, 8);
+                memcpy(op + 16, ref + 16, 2);
+                op += matchLength;
+                continue;
+            }
+
+            /* let the generic code below handle the match */
+            if (!offset || offset > quint32(op - output)) return 0;
+            ip += 2;
+
+            const quint8 *ref = op - offset;
+            for (quint32 i = 0; i < matchLength; i++) {
+                *op++ = *ref++;
+            }
+            continue;
+        }
+
+        quint32 literalLength = token >> 4;
+        if (literalLength == RUN_MASK && !readLength(ip, iend, literalLength)) {
+            return 0;
+        }
+
+        if (literalLength > quint32(iend - ip) ||
+            literalLength > quint32(oend - op)) {
+
+            return 0;
+        }
+
+        memcpy(op, ip, literalLength);
+        op += literalLength;
+        ip += literalLength;
+
+        /* the last sequence has no match part */
+        if (ip >= iend) break;
+
+        if (iend - ip < 2) return 0;
+
+        const quint32 offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (!offset || offset > quint32(op - output)) return 0;
+
+        quint32 matchLength = token & RUN_MASK;
+        if (matchLength == RUN_MASK && !readLength(ip, iend, matchLength)) {
+            return 0;
+        }
+        matchLength += MIN_MATCH;
+
+        if (matchLength > quint32(oend - op)) return 0;
+
+        const quint8 *ref = op - offset;
+
+        if (offset >= matchLength) {
+            memcpy(op, ref, matchLength);
+            op += matchLength;
+        } else {
+            /* overlapping copy, e.g. runs of a single color */
+            for (; matchLength; --matchLength) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return op - output;
+}
+
+
+KisLz4Compression::KisLz4Compression()
+{
+}
+
+KisLz4Compression::~KisLz4Compression()
+{
+}
+
+qint32 KisLz4Compression::compress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength)
+{
+    return lz4_compress(input, inputLength, output, outputLength);
+}
+
+qint32 KisLz4Compression::decompress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength)
+{
+    return lz4_decompress(input, inputLength, output, outputLength);
+}
+
+qint32 KisLz4Compression::outputBufferSize(qint32 dataSize)
+{
+    // the worst case of the LZ4 block format, plus the final token
+    // and some space for the block copies
+    return dataSize + dataSize / 255 + 32;
+}
@@ -0,0 +1,199 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_debug.h"
+#include "kis_mapped_swap_space.h"
+
+#include <QDir>
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SWP_PREFIX "KRITA_SWAP_FILE_XXXXXX"
+
+KisMappedSwapSpace::KisMappedSwapSpace(const QString &swapDir, quint64 maxSize, quint64 growStep)
+    : m_valid(false),
+      m_mapping(0),
+      m_mappingSize(maxSize),
+      m_fileSize(0),
+      m_growStep(growStep)
+{
+#ifdef Q_OS_UNIX
+    /**
+     * The whole swap should fit into the address space
+     */
+    if (sizeof(void*) < 8) return;
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!swapDir.isEmpty());
+
+    QDir d(swapDir);
+    if (!d.exists() && !d.mkpath(swapDir)) {
+        qWarning() << "Could not create the directory for the mapped swapfile" << swapDir;
+        return;
+    }
+
+    const QString swapFileTemplate = swapDir + QDir::separator() + SWP_PREFIX;
+    m_file.setFileTemplate(swapFileTemplate);
+
+    if (!m_file.open() || m_file.fileName().isEmpty()) {
+        qWarning() << "Could not create or open the mapped swapfile" << swapFileTemplate;
+        return;
+    }
+
+    /**
+     * It is safe to map the range beyond the end of the file. We
+     * just never touch the pages before the file is resized to
+     * cover them.
+     */
+    void *mapping = mmap(0, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file.handle(), 0);
+    if (mapping == MAP_FAILED) {
+        qWarning() << "Could not map the swapfile" << m_file.fileName() << "of size" << m_mappingSize;
+        return;
+    }
+
+    m_mapping = static_cast<quint8*>(mapping);
+
+    /**
+     * The tiles are read back in the order the user accesses them,
+     * so the default read-ahead would only pollute the page cache
+     */
+    posix_madvise(m_mapping, m_mappingSize, POSIX_MADV_RANDOM);
+
+    m_valid = true;
+#else
+    Q_UNUSED(swapDir);
+#endif
+}
+
+KisMappedSwapSpace::~KisMappedSwapSpace()
+{
+#ifdef Q_OS_UNIX
+    if (m_mapping) {
+        munmap(m_mapping, m_mappingSize);
+    }
+#endif
+}
+
+bool KisMappedSwapSpace::isValid() const
+{
+    return m_valid;
+}
+
+quint8* KisMappedSwapSpace::getReadChunkPtr(const KisChunkData &readChunk)
+{
+    if (!m_valid || readChunk.m_end >= m_fileSize) {
+        return nullptr;
+    }
+
+    return m_mapping + readChunk.m_begin;
+}
+
+quint8* KisMappedSwapSpace::getWriteChunkPtr(const KisChunkData &writeChunk)
+{
+    if (!m_valid || writeChunk.m_end >= m_mappingSize) {
+        return nullptr;
+    }
+
+    if (!ensureFileSize(writeChunk.m_end + 1)) {
+        return nullptr;
+    }
+
+    return m_mapping + writeChunk.m_begin;
+}
+
+bool KisMappedSwapSpace::hasStablePointers() const
+{
+    return true;
+}
+
+void KisMappedSwapSpace::adviseSequentialWrite(const KisChunkData &chunk)
+{
+#ifdef Q_OS_UNIX
+    /**
+     * The advice is applied to the existing pages only, so the
+     * file should be grown before, not on the first write
+     */
+    if (!m_valid || chunk.m_end >= m_mappingSize) return;
+    if (!ensureFileSize(chunk.m_end + 1)) return;
+
+    advise(chunk, POSIX_MADV_SEQUENTIAL);
+#else
+    Q_UNUSED(chunk);
+#endif
+}
+
+void KisMappedSwapSpace::adviseWillRead(const KisChunkData &chunk)
+{
+#ifdef Q_OS_UNIX
+    advise(chunk, POSIX_MADV_WILLNEED);
+#else
+    Q_UNUSED(chunk);
+#endif
+}
+
+bool KisMappedSwapSpace::ensureFileSize(quint64 size)
+{
+    if (size <= m_fileSize) return true;
+
+    quint64 newSize = ((size + m_growStep - 1) / m_growStep) * m_growStep;
+    newSize = qMin(newSize, m_mappingSize);
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MACOS)
+    /**
+     * QFile::resize() creates a sparse file, so running out of disk
+     * space would only be noticed on writing into the mapping, which
+     * kills the process with SIGBUS. Reserve the blocks instead and
+     * fail the swap-out if the disk is full.
+     */
+    const int result = posix_fallocate(m_file.handle(), m_fileSize, newSize - m_fileSize);
+    if (result) {
+        qWarning() << "Could not allocate the mapped swapfile of size" << newSize << ":" << strerror(result);
+        return false;
+    }
+#else
+    if (!m_file.resize(newSize)) {
+        qWarning() << "Could not resize the mapped swapfile to" << newSize;
+        return false;
+    }
+#endif
+
+    m_fileSize = newSize;
+    return true;
+}
+
+void KisMappedSwapSpace::advise(const KisChunkData &chunk, int advice)
+{
+#ifdef Q_OS_UNIX
+    if (!m_valid || chunk.m_begin >= m_fileSize) return;
+
+    static const quint64 pageSize = sysconf(_SC_PAGESIZE);
+
+    const quint64 begin = chunk.m_begin & ~(pageSize - 1);
+    const quint64 end = qMin(chunk.m_end + 1, m_fileSize);
+
+    posix_madvise(m_mapping + begin, end - begin, advice);
+#else
+    Q_UNUSED(chunk);
+    Q_UNUSED(advice);
+#endif
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_MAPPED_SWAP_SPACE_H
+#define __KIS_MAPPED_SWAP_SPACE_H
+
+#include <QTemporaryFile>
+
+#include "kis_abstract_swap_space.h"
+
+/**
+ * A swap space that maps the whole address range of the swap file
+ * at once. The file itself grows by \p growStep steps, when the
+ * allocator hands out chunks beyond its current end.
+ *
+ * Since the mapping is never moved, the returned pointers stay valid
+ * after the lock is released, so the data can be decompressed right
+ * from the mapping without copying it into a buffer first.
+ *
+ * The swap space needs enough address space to fit \p maxSize, so
+ * it is available on 64-bit Unix systems only. Check isValid() after
+ * construction and fall back to KisMemoryWindow if it fails.
+ */
+
+class KRITAIMAGE_EXPORT KisMappedSwapSpace : public KisAbstractSwapSpace
+{
+public:
+    KisMappedSwapSpace(const QString &swapDir,
+                       quint64 maxSize = DEFAULT_STORE_SIZE,
+                       quint64 growStep = DEFAULT_SLAB_SIZE);
+    ~KisMappedSwapSpace() override;
+
+    bool isValid() const;
+
+    using KisAbstractSwapSpace::getReadChunkPtr;
+    using KisAbstractSwapSpace::getWriteChunkPtr;
+
+    quint8* getReadChunkPtr(const KisChunkData &readChunk) override;
+    quint8* getWriteChunkPtr(const KisChunkData &writeChunk) override;
+
+    bool hasStablePointers() const override;
+
+    void adviseSequentialWrite(const KisChunkData &chunk) override;
+    void adviseWillRead(const KisChunkData &chunk) override;
+
+private:
+    bool ensureFileSize(quint64 size);
+    void advise(const KisChunkData &chunk, int advice);
+
+private:
+    QTemporaryFile m_file;
+
+    bool m_valid;
+    quint8 *m_mapping;
+    quint64 m_mappingSize;
+    quint64 m_fileSize;
+    const quint64 m_growStep;
+};
+
+#endif /* __KIS_MAPPED_SWAP_SPACE_H */
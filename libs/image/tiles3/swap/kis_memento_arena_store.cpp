@@ -0,0 +1,340 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_memento_arena_store.h"
+
+#include <cstring>
+
+#include <QtConcurrent>
+
+#include "kis_debug.h"
+#include "kis_image_config.h"
+#include "tiles3/kis_tile_data.h"
+#include "kis_swapped_data_store.h"
+#include "kis_abstract_tile_compressor.h"
+#include "kis_chunk_allocator.h"
+
+namespace {
+
+/**
+ * The tile is kept in the arena only if compression saves
+ * at least a quarter of its size
+ */
+inline bool compressedWellEnough(qint32 compressedSize, qint32 dataSize) {
+    return compressedSize < dataSize - dataSize / 4;
+}
+
+struct CompressionJob {
+    KisTileData *td;
+    quint8 *buffer;
+    qint32 bufferSize;
+    qint32 bytesWritten;
+};
+
+}
+
+struct KisMementoArenaStore::Arena {
+    QByteArray data;
+    qint32 size = 0;
+    qint32 numTiles = 0;
+
+    bool spilled = false;
+    KisChunk chunk;
+
+    QLinkedList<Arena*>::iterator position;
+};
+
+KisMementoArenaStore::KisMementoArenaStore(KisSwappedDataStore *swappedStore)
+    : m_swappedStore(swappedStore),
+      m_uncompressedSize(0),
+      m_compressedSize(0),
+      m_spilledSize(0)
+{
+    KisImageConfig config(true);
+    m_memoryLimit = qint64(config.compressedHistoryMemoryLimit()) * MiB;
+}
+
+KisMementoArenaStore::~KisMementoArenaStore()
+{
+    Q_FOREACH (Arena *arena, m_arenas) {
+        if (arena->spilled) {
+            m_swappedStore->freeRawData(arena->chunk);
+        }
+        delete arena;
+    }
+}
+
+int KisMementoArenaStore::compressTileDataBatch(const QVector<KisTileData*> &tileDataList)
+{
+    if (tileDataList.isEmpty()) return 0;
+
+    /**
+     * The tiles are compressed in parallel into a staging buffer
+     * and then only the well-compressed ones are packed into the
+     * arena, so the arena is allocated with the exact size.
+     */
+    KisAbstractTileCompressor *sizeCompressor = m_swappedStore->acquireCompressor();
+
+    QVector<CompressionJob> jobs(tileDataList.size());
+    qint32 totalBufferSize = 0;
+
+    for (int i = 0; i < tileDataList.size(); i++) {
+        KisTileData *td = tileDataList[i];
+        Q_ASSERT(td->data());
+
+        jobs[i].td = td;
+        jobs[i].bufferSize = sizeCompressor->tileDataBufferSize(td);
+        jobs[i].bytesWritten = 0;
+        totalBufferSize += jobs[i].bufferSize;
+    }
+
+    m_swappedStore->releaseCompressor(sizeCompressor);
+
+    QByteArray stagingBuffer(totalBufferSize, Qt::Uninitialized);
+    quint8 *bufferPtr = (quint8*) stagingBuffer.data();
+    for (int i = 0; i < jobs.size(); i++) {
+        jobs[i].buffer = bufferPtr;
+        bufferPtr += jobs[i].bufferSize;
+    }
+
+    QtConcurrent::blockingMap(jobs, [this] (CompressionJob &job) {
+        KisAbstractTileCompressor *compressor = m_swappedStore->acquireCompressor();
+        compressor->compressTileData(job.td, job.buffer, job.bufferSize, job.bytesWritten);
+        m_swappedStore->releaseCompressor(compressor);
+    });
+
+    qint32 arenaSize = 0;
+    Q_FOREACH (const CompressionJob &job, jobs) {
+        if (compressedWellEnough(job.bytesWritten, job.td->dataSize())) {
+            arenaSize += job.bytesWritten;
+        }
+    }
+
+    if (!arenaSize) return 0;
+
+    Arena *arena = new Arena();
+    arena->data.resize(arenaSize);
+    arena->size = arenaSize;
+
+    QMutexLocker locker(&m_lock);
+
+    qint32 offset = 0;
+    Q_FOREACH (const CompressionJob &job, jobs) {
+        if (!compressedWellEnough(job.bytesWritten, job.td->dataSize())) continue;
+
+        memcpy(arena->data.data() + offset, job.buffer, job.bytesWritten);
+
+        Entry entry;
+        entry.arena = arena;
+        entry.offset = offset;
+        entry.size = job.bytesWritten;
+        m_entries.insert(job.td, entry);
+
+        offset += job.bytesWritten;
+        arena->numTiles++;
+
+        m_uncompressedSize += job.td->dataSize();
+        job.td->releaseMemory();
+    }
+
+    m_arenas.append(arena);
+    arena->position = --m_arenas.end();
+    m_compressedSize += arena->size;
+
+    spillArenasImp();
+
+    return arena->numTiles;
+}
+
+void KisMementoArenaStore::takeCompressedTileData(KisTileData *td, QByteArray &compressedData)
+{
+    QMutexLocker locker(&m_lock);
+
+    QHash<KisTileData*, Entry>::iterator it = m_entries.find(td);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(it != m_entries.end());
+
+    const Entry entry = *it;
+    m_entries.erase(it);
+
+    Arena *arena = entry.arena;
+
+    /**
+     * Copying the compressed data is much cheaper than decompressing
+     * it, so the lock is not held while the tile is decompressed
+     */
+    if (!arena->spilled || loadArenaImp(arena)) {
+        compressedData = QByteArray(arena->data.constData() + entry.offset, entry.size);
+    }
+
+    m_uncompressedSize -= td->dataSize();
+
+    if (!--arena->numTiles) {
+        releaseArenaImp(arena);
+    }
+}
+
+bool KisMementoArenaStore::decompressTileData(KisTileData *td, const QByteArray &compressedData)
+{
+    Q_ASSERT(td->data());
+
+    bool result = !compressedData.isEmpty();
+
+    if (result) {
+        KisAbstractTileCompressor *compressor = m_swappedStore->acquireCompressor();
+        result = compressor->decompressTileData((quint8*) compressedData.constData(),
+                                                compressedData.size(), td);
+        m_swappedStore->releaseCompressor(compressor);
+    }
+
+    if (!result) {
+        qWarning() << "decompression of a history tile failed, the tile is replaced with transparent pixels";
+
+        /**
+         * The entry has already been forgotten, so the tile cannot
+         * stay compressed. Don't leave it uninitialized at least.
+         */
+        memset(td->data(), 0, td->dataSize());
+    }
+
+    return result;
+}
+
+bool KisMementoArenaStore::decompressTileData(KisTileData *td)
+{
+    Q_ASSERT(!td->data());
+
+    QByteArray compressedData;
+    takeCompressedTileData(td, compressedData);
+
+    td->allocateMemory();
+    return decompressTileData(td, compressedData);
+}
+
+void KisMementoArenaStore::forgetTileData(KisTileData *td)
+{
+    QMutexLocker locker(&m_lock);
+
+    QHash<KisTileData*, Entry>::iterator it = m_entries.find(td);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(it != m_entries.end());
+
+    Arena *arena = it->arena;
+    m_entries.erase(it);
+
+    m_uncompressedSize -= td->dataSize();
+
+    if (!--arena->numTiles) {
+        releaseArenaImp(arena);
+    }
+}
+
+void KisMementoArenaStore::spillArenasImp()
+{
+    auto it = m_arenas.begin();
+
+    while (m_compressedSize > m_memoryLimit && it != m_arenas.end()) {
+        Arena *arena = *it;
+        ++it;
+
+        if (arena->spilled) continue;
+
+        if (!m_swappedStore->writeRawData((const quint8*) arena->data.constData(),
+                                          arena->size, arena->chunk)) {
+            break;
+        }
+
+        arena->data = QByteArray();
+        arena->spilled = true;
+
+        m_compressedSize -= arena->size;
+        m_spilledSize += arena->size;
+    }
+}
+
+bool KisMementoArenaStore::loadArenaImp(Arena *arena)
+{
+    arena->data.resize(arena->size);
+
+    if (!m_swappedStore->readRawData(arena->chunk, (quint8*) arena->data.data())) {
+        return false;
+    }
+
+    /**
+     * The rest of the arena will most probably be needed soon, so
+     * keep it in memory until the next spill. Move it to the end
+     * of the list to not spill it back immediately.
+     */
+    m_swappedStore->freeRawData(arena->chunk);
+    arena->chunk = KisChunk();
+    arena->spilled = false;
+
+    m_spilledSize -= arena->size;
+    m_compressedSize += arena->size;
+
+    m_arenas.erase(arena->position);
+    m_arenas.append(arena);
+    arena->position = --m_arenas.end();
+
+    return true;
+}
+
+void KisMementoArenaStore::releaseArenaImp(Arena *arena)
+{
+    if (arena->spilled) {
+        m_swappedStore->freeRawData(arena->chunk);
+        m_spilledSize -= arena->size;
+    } else {
+        m_compressedSize -= arena->size;
+    }
+
+    m_arenas.erase(arena->position);
+    delete arena;
+}
+
+qint32 KisMementoArenaStore::numTiles() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_entries.size();
+}
+
+qint64 KisMementoArenaStore::uncompressedSize() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_uncompressedSize;
+}
+
+qint64 KisMementoArenaStore::compressedSize() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_compressedSize;
+}
+
+qint64 KisMementoArenaStore::spilledSize() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_spilledSize;
+}
+
+void KisMementoArenaStore::testingRereadConfig()
+{
+    QMutexLocker locker(&m_lock);
+
+    KisImageConfig config(true);
+    m_memoryLimit = qint64(config.compressedHistoryMemoryLimit()) * MiB;
+
+    spillArenasImp();
+}
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_MEMENTO_ARENA_STORE_H
+#define __KIS_MEMENTO_ARENA_STORE_H
+
+#include "kritaimage_export.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QHash>
+#include <QLinkedList>
+#include <QVector>
+
+class KisTileData;
+class KisSwappedDataStore;
+
+/**
+ * Keeps the tile data of the undo history compressed in memory.
+ *
+ * The tiles that became historical in one transaction (one commit
+ * of the memento manager) are compressed together and packed into
+ * a single contiguous block of memory, an arena. Such tiles are
+ * usually needed together as well (undo and redo restore the whole
+ * transaction), so the arena is the unit of spilling: when the
+ * compressed history exceeds compressedHistoryMemoryLimit(), the
+ * oldest arenas are written into the swap file as a whole and read
+ * back as a whole on the first access to any of their tiles.
+ *
+ * The arena is freed when the last of its tiles is decompressed
+ * or deleted.
+ *
+ * LOCKING: all the tile data objects passed to the methods should
+ *          be locked by the caller (see KisTileDataStore)
+ */
+class KRITAIMAGE_EXPORT KisMementoArenaStore
+{
+public:
+    KisMementoArenaStore(KisSwappedDataStore *swappedStore);
+    ~KisMementoArenaStore();
+
+    /**
+     * Compresses the tiles and moves them into a new arena. The
+     * tiles that don't compress well enough are left untouched.
+     * \return the number of tiles compressed. The tiles that
+     *          failed still have their data in memory.
+     */
+    int compressTileDataBatch(const QVector<KisTileData*> &tileDataList);
+
+    /**
+     * Restores the data of a tile compressed by
+     * compressTileDataBatch(), reading its arena from the swap
+     * file if needed
+     *
+     * \return false if the arena could not be read or the data could
+     *         not be decompressed. The data of the tile is zero-filled
+     *         (transparent) in such a case, so it is still in a valid
+     *         NORMAL state.
+     */
+    bool decompressTileData(KisTileData *td);
+
+    /**
+     * The first half of decompressTileData(): moves the compressed
+     * data of the tile out of the store into \p compressedData. If
+     * the arena could not be read, \p compressedData is left empty.
+     */
+    void takeCompressedTileData(KisTileData *td, QByteArray &compressedData);
+
+    /**
+     * The second half of decompressTileData(): decompresses
+     * \p compressedData into the already allocated memory of the tile.
+     * It doesn't touch the store, so no locks are needed, except the
+     * lock of the tile itself.
+     */
+    bool decompressTileData(KisTileData *td, const QByteArray &compressedData);
+
+    /**
+     * Forget the compressed data of the tile. This should be done
+     * before deleting of the compressed tile data.
+     */
+    void forgetTileData(KisTileData *td);
+
+    /**
+     * Returns the number of the tiles stored in the arenas
+     */
+    qint32 numTiles() const;
+
+    /**
+     * The size of the data stored in the arenas in uncompressed form
+     */
+    qint64 uncompressedSize() const;
+
+    /**
+     * The memory occupied by the arenas, not counting the
+     * ones spilled into the swap file
+     */
+    qint64 compressedSize() const;
+
+    /**
+     * The size of the arenas spilled into the swap file
+     */
+    qint64 spilledSize() const;
+
+    void testingRereadConfig();
+
+private:
+    struct Arena;
+
+    struct Entry {
+        Arena *arena;
+        qint32 offset;
+        qint32 size;
+    };
+
+    void spillArenasImp();
+    bool loadArenaImp(Arena *arena);
+    void releaseArenaImp(Arena *arena);
+
+private:
+    Q_DISABLE_COPY(KisMementoArenaStore)
+
+    KisSwappedDataStore *m_swappedStore;
+
+    mutable QMutex m_lock;
+    QHash<KisTileData*, Entry> m_entries;
+
+    /**
+     * The arenas in the order of their creation, the oldest first
+     */
+    QLinkedList<Arena*> m_arenas;
+
+    qint64 m_memoryLimit;
+
+    qint64 m_uncompressedSize;
+    qint64 m_compressedSize;
+    qint64 m_spilledSize;
+};
+
+#endif /* __KIS_MEMENTO_ARENA_STORE_H */
@@ -19,47 +19,125 @@
 //#include "kis_debug.h"
 #include "kis_swapped_data_store.h"
 #include "kis_memory_window.h"
+#include "kis_mapped_swap_space.h"
 #include "kis_image_config.h"
 
 #include "kis_tile_compressor_2.h"
+#include "kis_compression_factory.h"
+#include "kis_trace_recorder.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
 
 //#define COMPRESSOR_VERSION 2
 
+namespace {
+
+struct SwapJob {
+    KisTileData *td;
+    KisChunk chunk;
+    quint8 *buffer;
+    qint32 bufferSize;
+    qint32 bytesWritten;
+    bool result;
+};
+
+inline qint64 calculateThroughput(qint64 bytes, qint64 nsecs) {
+    return nsecs > 0 ? qint64(bytes * 1e9 / nsecs) : 0;
+}
+
+inline qint64 metricToBytes(qint64 metric) {
+    return metric * KisTileData::WIDTH * KisTileData::HEIGHT;
+}
+
+}
+
 KisSwappedDataStore::KisSwappedDataStore()
-    : m_memoryMetric(0)
+    : m_memoryMetric(0),
+      m_numRawChunks(0),
+      m_swappedOutBytes(0),
+      m_swapOutTime(0),
+      m_swappedInBytes(0),
+      m_swapInTime(0)
 {
     KisImageConfig config(true);
     const quint64 maxSwapSize = config.maxSwapSize() * MiB;
     const quint64 swapSlabSize = config.swapSlabSize() * MiB;
-    const quint64 swapWindowSize = config.swapWindowSize() * MiB;
 
     m_allocator = new KisChunkAllocator(swapSlabSize, maxSwapSize);
-    m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
+    m_swapSpace = createSwapSpace();
+
+    m_codecId = KisCompressionFactory::idFromName(config.swapCompressionCodec());
 
     // FIXME: use a factory after the patch is committed
-    m_compressor = new KisTileCompressor2();
+    m_compressor = new KisTileCompressor2(m_codecId);
 }
 
 KisSwappedDataStore::~KisSwappedDataStore()
 {
+    KisAbstractTileCompressor *compressor = 0;
+    while (m_compressorsPool.pop(compressor)) {
+        delete compressor;
+    }
+
     delete m_compressor;
     delete m_swapSpace;
     delete m_allocator;
 }
 
+KisAbstractSwapSpace* KisSwappedDataStore::createSwapSpace()
+{
+    KisImageConfig config(true);
+
+    if (config.useMappedSwapFile()) {
+        KisMappedSwapSpace *space =
+            new KisMappedSwapSpace(config.swapDir(),
+                                   config.maxSwapSize() * MiB,
+                                   config.swapSlabSize() * MiB);
+        if (space->isValid()) {
+            return space;
+        }
+
+        qWarning() << "Mapped swapfile is not available, falling back to the windowed one";
+        delete space;
+    }
+
+    return new KisMemoryWindow(config.swapDir(), config.swapWindowSize() * MiB);
+}
+
 quint64 KisSwappedDataStore::numTiles() const
 {
     // We are not acquiring the lock here...
     // Hope QLinkedList will ensure atomic access to it's size...
 
-    return m_allocator->numChunks();
+    return m_allocator->numChunks() - m_numRawChunks;
+}
+
+KisAbstractTileCompressor* KisSwappedDataStore::acquireCompressor()
+{
+    KisAbstractTileCompressor *compressor = 0;
+    if (!m_compressorsPool.pop(compressor)) {
+        compressor = new KisTileCompressor2(m_codecId);
+    }
+    return compressor;
+}
+
+void KisSwappedDataStore::releaseCompressor(KisAbstractTileCompressor *compressor)
+{
+    m_compressorsPool.push(compressor);
 }
 
 bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
 {
+    KisTraceScope trace("swap", "swap out");
     Q_ASSERT(td->data());
     QMutexLocker locker(&m_lock);
 
+    QElapsedTimer timer;
+    timer.start();
+
     /**
      * We are expecting that the lock of KisTileData
      * has already been taken by the caller for us.
@@ -84,18 +162,114 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     td->releaseMemory();
     td->setSwapChunk(chunk);
 
-    m_memoryMetric += td->pixelSize();
+    m_memoryMetric += td->memoryMetric();
+
+    m_swappedOutBytes.fetchAndAddOrdered(metricToBytes(td->memoryMetric()));
+    m_swapOutTime.fetchAndAddOrdered(timer.nsecsElapsed());
 
     return true;
 }
 
+int KisSwappedDataStore::trySwapOutTileDataBatch(const QVector<KisTileData*> &tileDataList)
+{
+    KisTraceScope trace("swap", "swap out batch");
+    if (tileDataList.isEmpty()) return 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    /**
+     * Compress the tiles in parallel into a single staging buffer.
+     * The workers don't touch the swap file and the allocator, so
+     * they don't need the store lock.
+     */
+    QVector<SwapJob> jobs(tileDataList.size());
+    qint32 totalBufferSize = 0;
+
+    for (int i = 0; i < tileDataList.size(); i++) {
+        KisTileData *td = tileDataList[i];
+        Q_ASSERT(td->data());
+
+        jobs[i].td = td;
+        jobs[i].bufferSize = m_compressor->tileDataBufferSize(td);
+        jobs[i].bytesWritten = 0;
+        jobs[i].result = false;
+        totalBufferSize += jobs[i].bufferSize;
+    }
+
+    QByteArray stagingBuffer(totalBufferSize, Qt::Uninitialized);
+    quint8 *bufferPtr = (quint8*) stagingBuffer.data();
+    for (int i = 0; i < jobs.size(); i++) {
+        jobs[i].buffer = bufferPtr;
+        bufferPtr += jobs[i].bufferSize;
+    }
+
+    QtConcurrent::blockingMap(jobs, [this] (SwapJob &job) {
+        KisAbstractTileCompressor *compressor = acquireCompressor();
+        compressor->compressTileData(job.td, job.buffer, job.bufferSize, job.bytesWritten);
+        releaseCompressor(compressor);
+    });
+
+    /**
+     * Now write all the compressed data in one pass. The allocator
+     * returns consecutive chunks for consecutive requests, so the
+     * writes go into the swap file sequentially.
+     */
+    int numSwappedOut = 0;
+    qint64 swappedOutMetric = 0;
+
+    QMutexLocker locker(&m_lock);
+
+    quint64 writeBegin = std::numeric_limits<quint64>::max();
+    quint64 writeEnd = 0;
+
+    for (int i = 0; i < jobs.size(); i++) {
+        jobs[i].chunk = m_allocator->getChunk(jobs[i].bytesWritten);
+        writeBegin = qMin(writeBegin, jobs[i].chunk.begin());
+        writeEnd = qMax(writeEnd, jobs[i].chunk.end());
+    }
+
+    m_swapSpace->adviseSequentialWrite(KisChunkData(writeBegin, writeEnd - writeBegin + 1));
+
+    for (int i = 0; i < jobs.size(); i++) {
+        SwapJob &job = jobs[i];
+
+        quint8 *ptr = m_swapSpace->getWriteChunkPtr(job.chunk);
+        if (!ptr) {
+            qWarning() << "swap out of tile failed";
+            for (int j = i; j < jobs.size(); j++) {
+                m_allocator->freeChunk(jobs[j].chunk);
+            }
+            break;
+        }
+        memcpy(ptr, job.buffer, job.bytesWritten);
+
+        job.td->releaseMemory();
+        job.td->setSwapChunk(job.chunk);
+
+        swappedOutMetric += job.td->memoryMetric();
+        numSwappedOut++;
+    }
+
+    m_memoryMetric += swappedOutMetric;
+
+    m_swappedOutBytes.fetchAndAddOrdered(metricToBytes(swappedOutMetric));
+    m_swapOutTime.fetchAndAddOrdered(timer.nsecsElapsed());
+
+    return numSwappedOut;
+}
+
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
+    KisTraceScope trace("swap", "swap in");
     Q_ASSERT(!td->data());
     QMutexLocker locker(&m_lock);
 
     // see comment in swapOutTileData()
 
+    QElapsedTimer timer;
+    timer.start();
+
     KisChunk chunk = td->swapChunk();
 
     td->allocateMemory();
@@ -106,7 +280,118 @@ void KisSwappedDataStore::swapInTileData(KisTileData *td)
     m_compressor->decompressTileData(ptr, chunk.size(), td);
     m_allocator->freeChunk(chunk);
 
-    m_memoryMetric -= td->pixelSize();
+    m_memoryMetric -= td->memoryMetric();
+
+    m_swappedInBytes.fetchAndAddOrdered(metricToBytes(td->memoryMetric()));
+    m_swapInTime.fetchAndAddOrdered(timer.nsecsElapsed());
+}
+
+void KisSwappedDataStore::swapInTileDataBatch(const QVector<KisTileData*> &tileDataList)
+{
+    KisTraceScope trace("swap", "swap in batch");
+    if (tileDataList.isEmpty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<SwapJob> jobs(tileDataList.size());
+    qint32 totalBufferSize = 0;
+
+    for (int i = 0; i < tileDataList.size(); i++) {
+        KisTileData *td = tileDataList[i];
+        Q_ASSERT(td->data());
+
+        jobs[i].td = td;
+        jobs[i].bufferSize = td->swapChunk().size();
+        jobs[i].result = false;
+        totalBufferSize += jobs[i].bufferSize;
+    }
+
+    /**
+     * Read the chunks in the order of their position
+     * in the swap file to keep the access sequential
+     */
+    std::sort(jobs.begin(), jobs.end(),
+              [] (const SwapJob &lhs, const SwapJob &rhs) {
+                  return lhs.td->swapChunk().begin() < rhs.td->swapChunk().begin();
+              });
+
+    /**
+     * When the swap space guarantees the pointers to be stable,
+     * the data is decompressed right from the swap file. The chunks
+     * are kept allocated until the decompression is finished.
+     * Otherwise the data is copied into a staging buffer, because
+     * the next read may invalidate the pointer.
+     */
+    const bool readInPlace = m_swapSpace->hasStablePointers();
+    QByteArray stagingBuffer;
+
+    {
+        QMutexLocker locker(&m_lock);
+
+        if (!readInPlace) {
+            stagingBuffer.resize(totalBufferSize);
+        }
+
+        quint8 *bufferPtr = (quint8*) stagingBuffer.data();
+        qint64 swappedInMetric = 0;
+
+        if (readInPlace) {
+            for (int i = 0; i < jobs.size(); i++) {
+                m_swapSpace->adviseWillRead(jobs[i].td->swapChunk().data());
+            }
+        }
+
+        for (int i = 0; i < jobs.size(); i++) {
+            SwapJob &job = jobs[i];
+            job.chunk = job.td->swapChunk();
+
+            quint8 *ptr = m_swapSpace->getReadChunkPtr(job.chunk);
+            Q_ASSERT(ptr);
+
+            if (readInPlace) {
+                job.buffer = ptr;
+            } else {
+                memcpy(bufferPtr, ptr, job.bufferSize);
+                job.buffer = bufferPtr;
+                bufferPtr += job.bufferSize;
+                m_allocator->freeChunk(job.chunk);
+            }
+
+            job.td->setSwapChunk(KisChunk());
+
+            swappedInMetric += job.td->memoryMetric();
+        }
+
+        m_memoryMetric -= swappedInMetric;
+        m_swappedInBytes.fetchAndAddOrdered(metricToBytes(swappedInMetric));
+    }
+
+    /**
+     * The tile data objects are locked by the caller, so
+     * we can fill them without holding the store lock
+     */
+    QtConcurrent::blockingMap(jobs, [this] (SwapJob &job) {
+        KisAbstractTileCompressor *compressor = acquireCompressor();
+        job.result = compressor->decompressTileData(job.buffer, job.bufferSize, job.td);
+        releaseCompressor(compressor);
+    });
+
+    Q_FOREACH (const SwapJob &job, jobs) {
+        if (!job.result) {
+            qWarning() << "swap in of tile failed";
+        }
+    }
+
+    QMutexLocker locker(&m_lock);
+
+    if (readInPlace) {
+        Q_FOREACH (const SwapJob &job, jobs) {
+            m_allocator->freeChunk(job.chunk);
+        }
+    }
+
+    m_swapInTime.fetchAndAddOrdered(timer.nsecsElapsed());
 }
 
 void KisSwappedDataStore::forgetTileData(KisTileData *td)
@@ -116,7 +401,7 @@ void KisSwappedDataStore::forgetTileData(KisTileData *td)
     m_allocator->freeChunk(td->swapChunk());
     td->setSwapChunk(KisChunk());
 
-    m_memoryMetric -= td->pixelSize();
+    m_memoryMetric -= td->memoryMetric();
 }
 
 qint64 KisSwappedDataStore::totalMemoryMetric() const
@@ -124,6 +409,67 @@ qint64 KisSwappedDataStore::totalMemoryMetric() const
     return m_memoryMetric;
 }
 
+qint64 KisSwappedDataStore::swapOutThroughput() const
+{
+    return calculateThroughput(m_swappedOutBytes.loadAcquire(), m_swapOutTime.loadAcquire());
+}
+
+qint64 KisSwappedDataStore::swapInThroughput() const
+{
+    return calculateThroughput(m_swappedInBytes.loadAcquire(), m_swapInTime.loadAcquire());
+}
+
+void KisSwappedDataStore::testingRereadConfig()
+{
+    QMutexLocker locker(&m_lock);
+
+    // the swapped data cannot be moved between the swap spaces
+    if (m_allocator->numChunks()) return;
+
+    delete m_swapSpace;
+    m_swapSpace = createSwapSpace();
+}
+
+bool KisSwappedDataStore::writeRawData(const quint8 *data, qint32 size, KisChunk &chunk)
+{
+    QMutexLocker locker(&m_lock);
+
+    chunk = m_allocator->getChunk(size);
+    quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
+    if (!ptr) {
+        qWarning() << "writing of raw data into swap failed";
+        m_allocator->freeChunk(chunk);
+        chunk = KisChunk();
+        return false;
+    }
+    memcpy(ptr, data, size);
+
+    m_numRawChunks++;
+    return true;
+}
+
+bool KisSwappedDataStore::readRawData(KisChunk chunk, quint8 *data)
+{
+    QMutexLocker locker(&m_lock);
+
+    quint8 *ptr = m_swapSpace->getReadChunkPtr(chunk);
+    if (!ptr) {
+        qWarning() << "reading of raw data from swap failed";
+        return false;
+    }
+    memcpy(data, ptr, chunk.size());
+
+    return true;
+}
+
+void KisSwappedDataStore::freeRawData(KisChunk chunk)
+{
+    QMutexLocker locker(&m_lock);
+
+    m_allocator->freeChunk(chunk);
+    m_numRawChunks--;
+}
+
 void KisSwappedDataStore::debugStatistics()
 {
     m_allocator->sanityCheck();
@@ -22,14 +22,19 @@
 #include "kritaimage_export.h"
 
 #include <QMutex>
+#include <QAtomicInt>
 #include <QByteArray>
+#include <QVector>
+
+#include "tiles3/kis_lockless_stack.h"
+#include "kis_chunk_allocator.h"
 
 
 class QMutex;
 class KisTileData;
 class KisAbstractTileCompressor;
 class KisChunkAllocator;
-class KisMemoryWindow;
+class KisAbstractSwapSpace;
 
 class KRITAIMAGE_EXPORT KisSwappedDataStore
 {
@@ -58,6 +63,31 @@ public:
      */
     void swapInTileData(KisTileData *td);
 
+    /**
+     * Swap out a batch of tile data objects. The tiles are
+     * compressed in parallel by the global thread pool and then
+     * written into the swap file in one sequential pass.
+     * LOCKING: the locks on all the tile data objects should be
+     *          taken by the caller before making a call.
+     * \return the number of tiles swapped out. The tiles that
+     *          failed still have their data in memory.
+     */
+    int trySwapOutTileDataBatch(const QVector<KisTileData*> &tileDataList);
+
+    /**
+     * Restore the data of a batch of tile data objects. The
+     * compressed data is read from the swap file sequentially and
+     * decompressed in parallel.
+     * LOCKING: the locks on all the tile data objects should be
+     *          taken by the caller before making a call.
+     * PRECONDITIONS: the memory of the tile data objects is already
+     *                allocated by the caller, their swap chunks are
+     *                still set. This way the caller can make the tiles
+     *                look loaded to the other threads before the
+     *                actual reading starts.
+     */
+    void swapInTileDataBatch(const QVector<KisTileData*> &tileDataList);
+
     /**
      * Forget all the information linked with the tile data.
      * This should be done before deleting of the tile data,
@@ -71,21 +101,80 @@ public:
      */
     qint64 totalMemoryMetric() const;
 
+    /**
+     * The average speed of swapping out and in of the tile data,
+     * in *uncompressed* bytes per second
+     */
+    qint64 swapOutThroughput() const;
+    qint64 swapInThroughput() const;
+
     /**
      * Some debugging output
      */
     void debugStatistics();
 
+    /**
+     * Recreate the swap space according to the current
+     * configuration. Works only when the swap is empty.
+     */
+    void testingRereadConfig();
+
+    /**
+     * Write an arbitrary block of data into the swap file. Used by
+     * KisMementoArenaStore for spilling the compressed history.
+     * The raw chunks are not counted as swapped tiles.
+     * \return true on success, \p chunk is set to the chunk holding the data
+     */
+    bool writeRawData(const quint8 *data, qint32 size, KisChunk &chunk);
+
+    /**
+     * Read the data written by writeRawData() into \p data. The
+     * buffer should be at least chunk.size() bytes long.
+     */
+    bool readRawData(KisChunk chunk, quint8 *data);
+
+    /**
+     * Free the chunk returned by writeRawData()
+     */
+    void freeRawData(KisChunk chunk);
+
+    /**
+     * The pool of the compressors for the batched operations. It
+     * is shared with KisMementoArenaStore, which uses the same
+     * tile compression format. The methods are thread-safe.
+     */
+    KisAbstractTileCompressor* acquireCompressor();
+    void releaseCompressor(KisAbstractTileCompressor *compressor);
+
+private:
+    static KisAbstractSwapSpace* createSwapSpace();
+
 private:
     QByteArray m_buffer;
     KisAbstractTileCompressor *m_compressor;
 
+    /**
+     * Compressors for the batched operations. Every worker thread
+     * takes its own one, so they don't need any locking.
+     */
+    qint32 m_codecId;
+    KisLocklessStack<KisAbstractTileCompressor*> m_compressorsPool;
+
     KisChunkAllocator *m_allocator;
-    KisMemoryWindow *m_swapSpace;
+    KisAbstractSwapSpace *m_swapSpace;
 
     QMutex m_lock;
 
     qint64 m_memoryMetric;
+    qint64 m_numRawChunks;
+
+    /**
+     * Written under m_lock, but read by the statistics without it
+     */
+    QAtomicInteger<qint64> m_swappedOutBytes;
+    QAtomicInteger<qint64> m_swapOutTime;
+    QAtomicInteger<qint64> m_swappedInBytes;
+    QAtomicInteger<qint64> m_swapInTime;
 };
 
 #endif /* __KIS_SWAPPED_DATA_STORE_H */
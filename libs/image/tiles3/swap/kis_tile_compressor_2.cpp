@@ -17,27 +17,51 @@
  */
 
 #include "kis_tile_compressor_2.h"
-#include "kis_lzf_compression.h"
+#include "kis_abstract_compression.h"
 #include <QIODevice>
 #include "kis_paint_device_writer.h"
-#define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
+#include "kis_debug.h"
 
-const QString KisTileCompressor2::m_compressionName = "LZF";
 
-
-KisTileCompressor2::KisTileCompressor2()
+KisTileCompressor2::KisTileCompressor2(qint32 codecId)
+    : m_codecId(codecId)
 {
-    m_compression = new KisLzfCompression();
+    m_compression = KisCompressionFactory::create(m_codecId);
+
+    if (!m_compression) {
+        warnKrita << "Unknown tile compression codec" << codecId << "falling back to the default one";
+        m_codecId = KisCompressionFactory::defaultCodec();
+        m_compression = KisCompressionFactory::create(m_codecId);
+    }
+
+    m_compressionName = KisCompressionFactory::nameFromId(m_codecId);
 }
 
 KisTileCompressor2::~KisTileCompressor2()
 {
+    qDeleteAll(m_decompressors);
     delete m_compression;
 }
 
+KisAbstractCompression* KisTileCompressor2::decompressorForCodec(qint32 codecId)
+{
+    if (codecId == m_codecId) return m_compression;
+    if (codecId <= 0) return 0;
+
+    if (codecId >= m_decompressors.size()) {
+        m_decompressors.resize(codecId + 1);
+    }
+
+    if (!m_decompressors[codecId]) {
+        m_decompressors[codecId] = KisCompressionFactory::create(codecId);
+    }
+
+    return m_decompressors[codecId];
+}
+
 bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
 {
-    const qint32 tileDataSize = TILE_DATA_SIZE(tile->pixelSize());
+    const qint32 tileDataSize = tile->tileData()->dataSize();
     prepareStreamingBuffer(tileDataSize);
 
     qint32 bytesWritten;
@@ -62,7 +86,7 @@ bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
 
 bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
 {
-    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize(dm));
+    const qint32 tileDataSize = tileSizeInBytes(dm);
     prepareStreamingBuffer(tileDataSize);
 
     QByteArray header = stream->readLine(maxHeaderLength());
@@ -75,7 +99,11 @@ bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
         qint32 dataSize = headerItems.takeFirst().toInt();
 
         Q_ASSERT(headerItems.isEmpty());
-        Q_ASSERT(compressionName == m_compressionName);
+
+        if (!KisCompressionFactory::idFromName(compressionName)) {
+            warnFile << "Unknown tile compression codec:" << compressionName;
+            return false;
+        }
 
         qint32 row = yToRow(dm, y);
         qint32 col = xToCol(dm, x);
@@ -115,7 +143,7 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
                                           qint32 &bytesWritten)
 {
     const qint32 pixelSize = tileData->pixelSize();
-    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
+    const qint32 tileDataSize = tileData->dataSize();
     qint32 compressedBytes;
 
     Q_UNUSED(bufferSize);
@@ -129,8 +157,8 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
     compressedBytes = m_compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
                                               (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
 
-    if(compressedBytes < tileDataSize) {
-        buffer[0] = COMPRESSED_DATA_FLAG;
+    if(compressedBytes > 0 && compressedBytes < tileDataSize) {
+        buffer[0] = m_codecId;
         memcpy(buffer + 1, m_compressionBuffer.data(), compressedBytes);
         bytesWritten = compressedBytes + 1;
     }
@@ -146,14 +174,20 @@ bool KisTileCompressor2::decompressTileData(quint8 *buffer,
                                             KisTileData *tileData)
 {
     const qint32 pixelSize = tileData->pixelSize();
-    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
+    const qint32 tileDataSize = tileData->dataSize();
+
+    if(buffer[0] != RAW_DATA_FLAG) {
+        KisAbstractCompression *compression = decompressorForCodec(buffer[0]);
+        if (!compression) {
+            warnKrita << "Unknown tile compression codec id:" << buffer[0];
+            return false;
+        }
 
-    if(buffer[0] == COMPRESSED_DATA_FLAG) {
         prepareWorkBuffers(tileDataSize);
 
         qint32 bytesWritten;
-        bytesWritten = m_compression->decompress(buffer + 1, bufferSize - 1,
-                                                 (quint8*)m_linearizationBuffer.data(), tileDataSize);
+        bytesWritten = compression->decompress(buffer + 1, bufferSize - 1,
+                                               (quint8*)m_linearizationBuffer.data(), tileDataSize);
         if (bytesWritten == tileDataSize) {
             KisAbstractCompression::delinearizeColors((quint8*)m_linearizationBuffer.data(),
                                                       tileData->data(),
@@ -172,7 +206,7 @@ bool KisTileCompressor2::decompressTileData(quint8 *buffer,
 
 qint32 KisTileCompressor2::tileDataBufferSize(KisTileData *tileData)
 {
-    return TILE_DATA_SIZE(tileData->pixelSize()) + 1;
+    return tileData->dataSize() + 1;
 }
 
 inline qint32 KisTileCompressor2::maxHeaderLength()
@@ -20,13 +20,23 @@
 #define __KIS_TILE_COMPRESSOR_2_H
 
 #include "kis_abstract_tile_compressor.h"
+#include "kis_compression_factory.h"
+
+#include <QVector>
 
 class KisAbstractCompression;
 
+/**
+ * Every compressed tile starts with a one-byte flag. It is either
+ * RAW_DATA_FLAG, if the data didn't compress, or the id of the codec
+ * used for it (see KisCompressionFactory). The compressor writes the
+ * tiles with the codec passed to the constructor, but can read the
+ * tiles compressed with any registered codec.
+ */
 class KRITAIMAGE_EXPORT KisTileCompressor2 : public KisAbstractTileCompressor
 {
 public:
-    KisTileCompressor2();
+    KisTileCompressor2(qint32 codecId = KisCompressionFactory::defaultCodec());
     ~KisTileCompressor2() override;
 
     bool writeTile(KisTileSP tile, KisPaintDeviceWriter &store) override;
@@ -49,16 +59,25 @@ private:
     void prepareWorkBuffers(qint32 tileDataSize);
     void prepareStreamingBuffer(qint32 tileDataSize);
 
+    KisAbstractCompression* decompressorForCodec(qint32 codecId);
+
 private:
     static const qint8 RAW_DATA_FLAG = 0;
-    static const qint8 COMPRESSED_DATA_FLAG = 1;
 
 private:
     QByteArray m_linearizationBuffer;
     QByteArray m_compressionBuffer;
     QByteArray m_streamingBuffer;
+
+    qint32 m_codecId;
     KisAbstractCompression *m_compression;
-    static const QString m_compressionName;
+    QString m_compressionName;
+
+    /**
+     * Codecs for reading tiles written with a codec different
+     * from ours, created on demand. Indexed by the codec id.
+     */
+    QVector<KisAbstractCompression*> m_decompressors;
 };
 
 #endif /* __KIS_TILE_COMPRESSOR_2_H */
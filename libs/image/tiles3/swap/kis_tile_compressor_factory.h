@@ -25,13 +25,21 @@
 class KRITAIMAGE_EXPORT KisTileCompressorFactory
 {
 public:
-    static KisAbstractTileCompressorSP create(qint32 version) {
+    /**
+     * Creates a tile compressor for the tiles format \p version.
+     * The \p codecId is used for writing the tiles only, the
+     * reading is always done with the codec stored in the tile.
+     *
+     * \see KisCompressionFactory
+     */
+    static KisAbstractTileCompressorSP create(qint32 version,
+                                              qint32 codecId = KisCompressionFactory::defaultCodec()) {
         switch(version) {
         case 1:
             return KisAbstractTileCompressorSP(new KisLegacyTileCompressor());
             break;
         case 2:
-            return KisAbstractTileCompressorSP(new KisTileCompressor2());
+            return KisAbstractTileCompressorSP(new KisTileCompressor2(codecId));
             break;
         default:
             qFatal("Unknown version of the tiles");
@@ -23,6 +23,7 @@
 #include "tiles3/kis_tile_data.h"
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
+#include "tiles3/kis_tiled_data_manager.h"
 #include "kis_debug.h"
 
 #define SEC 1000
@@ -30,6 +31,20 @@
 const qint32 KisTileDataSwapper::TIMEOUT = -1;
 const qint32 KisTileDataSwapper::DELAY = 0.7 * SEC;
 
+/**
+ * The number of tiles compressed in parallel and written
+ * into the swap file in one go
+ */
+const qint32 KisTileDataSwapper::BATCH_SIZE = 64;
+
+/**
+ * The maximum number of pending prefetch requests. When the
+ * update queue outruns the swapper, the oldest requests are
+ * dropped: the walkers have most probably loaded these tiles
+ * themselves already.
+ */
+const qint32 KisTileDataSwapper::MAX_PREFETCH_REQUESTS = 256;
+
 //#define DEBUG_SWAPPER
 
 #ifdef DEBUG_SWAPPER
@@ -44,6 +59,17 @@ class SoftSwapStrategy;
 class AggressiveSwapStrategy;
 
 
+/**
+ * The request doesn't keep the data manager alive: if the device
+ * is deleted while the request waits in the queue, there is nothing
+ * to prefetch anymore
+ */
+struct PrefetchRequest
+{
+    KisWeakSharedPtr<KisTiledDataManager> dataManager;
+    QRect rect;
+};
+
 struct Q_DECL_HIDDEN KisTileDataSwapper::Private
 {
 public:
@@ -52,6 +78,12 @@ public:
     KisTileDataStore *store;
     KisStoreLimits limits;
     QMutex cycleLock;
+
+    QMutex prefetchLock;
+    QList<PrefetchRequest> prefetchQueue;
+
+    QMutex historyLock;
+    QList<QVector<KisTileData*>> historyQueue;
 };
 
 KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
@@ -79,6 +111,24 @@ void KisTileDataSwapper::terminateSwapper()
         m_d->shouldExitFlag = true;
         kick();
     } while(!wait(exitTimeout));
+
+    {
+        QMutexLocker locker(&m_d->prefetchLock);
+        m_d->prefetchQueue.clear();
+    }
+
+    QList<QVector<KisTileData*>> historyQueue;
+
+    {
+        QMutexLocker locker(&m_d->historyLock);
+        historyQueue.swap(m_d->historyQueue);
+    }
+
+    Q_FOREACH (const QVector<KisTileData*> &batch, historyQueue) {
+        Q_FOREACH (KisTileData *td, batch) {
+            td->deref();
+        }
+    }
 }
 
 void KisTileDataSwapper::waitForWork()
@@ -86,6 +136,117 @@ void KisTileDataSwapper::waitForWork()
     m_d->semaphore.tryAcquire(1, TIMEOUT);
 }
 
+void KisTileDataSwapper::prefetch(KisTiledDataManagerSP dm, const QRect &rect)
+{
+    if (rect.isEmpty()) return;
+
+    bool wasEmpty = false;
+
+    {
+        QMutexLocker locker(&m_d->prefetchLock);
+
+        Q_FOREACH (const PrefetchRequest &request, m_d->prefetchQueue) {
+            if (request.dataManager == dm.data() && request.rect.contains(rect)) {
+                return;
+            }
+        }
+
+        if (m_d->prefetchQueue.size() >= MAX_PREFETCH_REQUESTS) {
+            m_d->prefetchQueue.removeFirst();
+        }
+
+        wasEmpty = m_d->prefetchQueue.isEmpty();
+        m_d->prefetchQueue.append({dm, rect});
+    }
+
+    /**
+     * The swapper drains the whole queue on every wakeup, so
+     * every extra permit would only cost it an idle swap cycle
+     */
+    if (wasEmpty) {
+        kick();
+    }
+}
+
+bool KisTileDataSwapper::processPrefetchRequests()
+{
+    bool hasPrefetched = false;
+
+    while (1) {
+        PrefetchRequest request;
+
+        {
+            QMutexLocker locker(&m_d->prefetchLock);
+            if (m_d->prefetchQueue.isEmpty()) break;
+            request = m_d->prefetchQueue.takeFirst();
+        }
+
+        /**
+         * Reading the tiles back while we are over the soft limit
+         * would only make them be swapped out again right away
+         */
+        if (m_d->store->memoryMetric() > m_d->limits.softLimitThreshold()) {
+            DEBUG_ACTION("Skipped prefetch request: low memory");
+            continue;
+        }
+
+        KisTiledDataManagerSP dataManager = request.dataManager.toStrongRef();
+        if (!dataManager) continue;
+
+        DEBUG_ACTION("Prefetching swapped tiles");
+        DEBUG_VALUE(request.rect);
+        dataManager->prefetchSwappedTiles(request.rect);
+        hasPrefetched = true;
+    }
+
+    return hasPrefetched;
+}
+
+void KisTileDataSwapper::compressHistory(const QVector<KisTileData*> &tileDataList)
+{
+    Q_FOREACH (KisTileData *td, tileDataList) {
+        td->ref();
+    }
+
+    {
+        QMutexLocker locker(&m_d->historyLock);
+        m_d->historyQueue.append(tileDataList);
+    }
+
+    kick();
+}
+
+void KisTileDataSwapper::processHistoryRequests()
+{
+    while (1) {
+        QVector<KisTileData*> batch;
+
+        {
+            QMutexLocker locker(&m_d->historyLock);
+            if (m_d->historyQueue.isEmpty()) break;
+            batch = m_d->historyQueue.takeFirst();
+        }
+
+        DEBUG_ACTION("Compressing history tiles");
+        DEBUG_VALUE(batch.size());
+
+        /**
+         * Every batch comes from a single transaction, so it
+         * goes into a single arena of the history store
+         */
+        m_d->store->compressHistoricalTileDataBatch(batch);
+
+        /**
+         * The tiles might have been deleted while waiting in the
+         * queue, so the last reference may be ours. It must be
+         * dropped without holding any store locks.
+         */
+        Q_FOREACH (KisTileData *td, batch) {
+            td->deref();
+        }
+    }
+}
+
 void KisTileDataSwapper::run()
 {
     while (1) {
@@ -94,8 +255,16 @@ void KisTileDataSwapper::run()
         if (m_d->shouldExitFlag)
             return;
 
+        /**
+         * Prefetch requests are latency-critical, so they are
+         * handled without the usual swapping delay
+         */
+        if (processPrefetchRequests())
+            continue;
+
         QThread::msleep(DELAY);
 
+        processHistoryRequests();
         doJob();
     }
 }
@@ -192,12 +361,29 @@ public:
 };
 
 
+qint64 KisTileDataSwapper::swapOutBatch(QVector<KisTileData*> &batch)
+{
+    const qint64 freedMetric = m_d->store->trySwapTileDataBatch(batch);
+    batch.clear();
+    return freedMetric;
+}
+
 template<class strategy>
 qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
 {
     qint64 freedMetric = 0;
     QList<KisTileData*> additionalCandidates;
 
+    /**
+     * The candidates are collected into batches, which are
+     * compressed in parallel and written into the swap file
+     * sequentially. The metric of the pending batch is counted
+     * in advance to avoid swapping out more than needed.
+     */
+    QVector<KisTileData*> batch;
+    qint64 batchMetric = 0;
+    batch.reserve(BATCH_SIZE);
+
     typename strategy::iterator *iter =
         strategy::beginIteration(m_d->store);
 
@@ -206,14 +392,18 @@ qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
     while(iter->hasNext()) {
         item = iter->next();
 
-        if(freedMetric >= needToFreeMetric) break;
+        if(freedMetric + batchMetric >= needToFreeMetric) break;
 
 
         if(!strategy::isInteresting(item)) continue;
 
         if(strategy::swapOutFirst(item)) {
-            if(iter->trySwapOut(item)) {
-                freedMetric += item->pixelSize();
+            batch.append(item);
+            batchMetric += item->memoryMetric();
+
+            if (batch.size() >= BATCH_SIZE) {
+                freedMetric += swapOutBatch(batch);
+                batchMetric = 0;
             }
         }
         else {
@@ -223,14 +413,23 @@ qint64 KisTileDataSwapper::pass(qint64 needToFreeMetric)
 
     }
 
+    freedMetric += swapOutBatch(batch);
+    batchMetric = 0;
+
     Q_FOREACH (item, additionalCandidates) {
-        if(freedMetric >= needToFreeMetric) break;
+        if(freedMetric + batchMetric >= needToFreeMetric) break;
 
-        if(iter->trySwapOut(item)) {
-            freedMetric += item->pixelSize();
+        batch.append(item);
+        batchMetric += item->memoryMetric();
+
+        if (batch.size() >= BATCH_SIZE) {
+            freedMetric += swapOutBatch(batch);
+            batchMetric = 0;
         }
     }
 
+    freedMetric += swapOutBatch(batch);
+
     strategy::endIteration(m_d->store, iter);
 
     return freedMetric;
@@ -20,12 +20,17 @@
 
 #include <QObject>
 #include <QThread>
+#include <QVector>
+#include <QRect>
 
 #include "kritaimage_export.h"
+#include "kis_shared_ptr.h"
 
 
 class KisTileDataStore;
 class KisTileData;
+class KisTiledDataManager;
+typedef KisSharedPtr<KisTiledDataManager> KisTiledDataManagerSP;
 
 class KRITAIMAGE_EXPORT KisTileDataSwapper : public QThread
 {
@@ -40,6 +45,21 @@ public:
     void terminateSwapper();
     void checkFreeMemory();
 
+    /**
+     * Asks the swapper to read the swapped tiles of \p rect of the
+     * data manager \p dm back into memory in the background. The
+     * update queue calls it for the rects it is going to process,
+     * so that the disk reads overlap with the walkers' work.
+     */
+    void prefetch(KisTiledDataManagerSP dm, const QRect &rect);
+
+    /**
+     * Asks the swapper to compress the tiles that have just become
+     * historical (see KisTileDataStore::compressHistoricalTileDataBatch()).
+     * The swapper holds a reference to every tile until it is processed.
+     */
+    void compressHistory(const QVector<KisTileData*> &tileDataList);
+
     void testingRereadConfig();
 
 private:
@@ -47,11 +67,16 @@ private:
     void run() override;
 
     void doJob();
+    bool processPrefetchRequests();
+    void processHistoryRequests();
     template<class strategy> qint64 pass(qint64 needToFreeMetric);
+    qint64 swapOutBatch(QVector<KisTileData*> &batch);
 
 private:
     static const qint32 TIMEOUT;
     static const qint32 DELAY;
+    static const qint32 BATCH_SIZE;
+    static const qint32 MAX_PREFETCH_REQUESTS;
 
 private:
     struct Private;
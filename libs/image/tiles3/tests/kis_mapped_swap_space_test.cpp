@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_mapped_swap_space_test.h"
+#include <QTest>
+
+#include "kis_debug.h"
+#include <QTemporaryDir>
+
+#include "../swap/kis_mapped_swap_space.h"
+
+#define MAPPED_SPACE_OR_SKIP(memory)                                    \
+    if (!memory.isValid()) {                                            \
+        QSKIP("Mapped swap space is not supported on this platform");   \
+    }
+
+void KisMappedSwapSpaceTest::testReadWrite()
+{
+    QTemporaryDir swapDir;
+    KisMappedSwapSpace memory(swapDir.path(), 16 * MiB, 1024);
+    MAPPED_SPACE_OR_SKIP(memory);
+
+    QVERIFY(memory.hasStablePointers());
+
+    quint8 oddValue = 0xee;
+    const quint8 chunkLength = 10;
+
+    quint8 oddBuf[chunkLength];
+    memset(oddBuf, oddValue, chunkLength);
+
+    KisChunkData chunk1(0, chunkLength);
+    KisChunkData chunk2(1025, chunkLength);
+
+    quint8 *ptr1 = memory.getWriteChunkPtr(chunk1);
+    QVERIFY(ptr1);
+    memcpy(ptr1, oddBuf, chunkLength);
+
+    quint8 *ptr2 = memory.getWriteChunkPtr(chunk2);
+    QVERIFY(ptr2);
+    memcpy(ptr2, oddBuf, chunkLength);
+
+    memory.adviseWillRead(chunk1);
+
+    // the pointers are not invalidated by the following requests
+    QCOMPARE(memory.getReadChunkPtr(chunk2), ptr2);
+    QCOMPARE(memory.getReadChunkPtr(chunk1), ptr1);
+
+    QVERIFY(!memcmp(ptr1, oddBuf, chunkLength));
+    QVERIFY(!memcmp(ptr2, oddBuf, chunkLength));
+}
+
+void KisMappedSwapSpaceTest::testGrowing()
+{
+    QTemporaryDir swapDir;
+    KisMappedSwapSpace memory(swapDir.path(), 4 * MiB, MiB);
+    MAPPED_SPACE_OR_SKIP(memory);
+
+    // nothing has been written there yet
+    QVERIFY(!memory.getReadChunkPtr(KisChunkData(2 * MiB, 16)));
+
+    memory.adviseSequentialWrite(KisChunkData(0, 4 * MiB));
+
+    for (int i = 0; i < 4; i++) {
+        KisChunkData chunk(i * MiB, MiB);
+        quint8 *ptr = memory.getWriteChunkPtr(chunk);
+        QVERIFY(ptr);
+        memset(ptr, i + 1, MiB);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        KisChunkData chunk(i * MiB + MiB / 2, 16);
+        quint8 *ptr = memory.getReadChunkPtr(chunk);
+        QVERIFY(ptr);
+        QCOMPARE(int(ptr[0]), i + 1);
+        QCOMPARE(int(ptr[15]), i + 1);
+    }
+
+    // out of the reserved range
+    QVERIFY(!memory.getWriteChunkPtr(KisChunkData(4 * MiB, 16)));
+}
+
+QTEST_MAIN(KisMappedSwapSpaceTest)
@@ -0,0 +1,206 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "kis_memento_arena_store_test.h"
+#include <QTest>
+
+#include "kis_debug.h"
+
+#include "kis_image_config.h"
+
+#include "tiles3/kis_tile_data.h"
+#include "tiles_test_utils.h"
+
+#include "tiles3/kis_tile_data_store.h"
+#include "tiles3/swap/kis_swapped_data_store.h"
+#include "tiles3/swap/kis_memento_arena_store.h"
+
+
+#define COLUMN2COLOR(col) (col%255)
+
+namespace {
+
+QVector<KisTileData*> createTiles(qint32 numTiles, qint32 firstColor = 0)
+{
+    const qint32 pixelSize = 1;
+    const quint8 defaultPixel = 128;
+
+    QVector<KisTileData*> tileDataList;
+    for(qint32 i = 0; i < numTiles; i++) {
+        KisTileData *td = new KisTileData(pixelSize, &defaultPixel, KisTileDataStore::instance());
+        memset(td->data(), COLUMN2COLOR(firstColor + i), TILESIZE);
+        tileDataList.append(td);
+    }
+    return tileDataList;
+}
+
+void setUpConfig(int historyMemoryLimit)
+{
+    KisImageConfig config(false);
+    config.setMaxSwapSize(4);
+    config.setSwapSlabSize(1);
+    config.setSwapWindowSize(1);
+    config.setCompressedHistoryMemoryLimit(historyMemoryLimit);
+}
+
+}
+
+void KisMementoArenaStoreTest::testRoundTrip()
+{
+    const qint32 NUM_TILES = 1000;
+    const qint32 BATCH_SIZE = 100;
+
+    setUpConfig(16);
+
+    KisSwappedDataStore swappedStore;
+    KisMementoArenaStore store(&swappedStore);
+
+    QVector<KisTileData*> tileDataList = createTiles(NUM_TILES);
+
+    for(qint32 i = 0; i < NUM_TILES; i += BATCH_SIZE) {
+        // the tiles are owned by the test only, no locking needed
+        QCOMPARE(store.compressTileDataBatch(tileDataList.mid(i, BATCH_SIZE)), BATCH_SIZE);
+    }
+
+    QCOMPARE(store.numTiles(), NUM_TILES);
+    QCOMPARE(store.uncompressedSize(), qint64(NUM_TILES * TILESIZE));
+    QVERIFY(store.compressedSize() > 0);
+    QVERIFY(store.compressedSize() < store.uncompressedSize() / 4);
+    QCOMPARE(store.spilledSize(), qint64(0));
+
+    for(qint32 i = NUM_TILES - 1; i >= 0; i--) {
+        KisTileData *td = tileDataList[i];
+        QVERIFY(!td->data());
+
+        QVERIFY(store.decompressTileData(td));
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data(), TILESIZE));
+    }
+
+    QCOMPARE(store.numTiles(), 0);
+    QCOMPARE(store.uncompressedSize(), qint64(0));
+    QCOMPARE(store.compressedSize(), qint64(0));
+
+    qDeleteAll(tileDataList);
+}
+
+void KisMementoArenaStoreTest::testSpilling()
+{
+    const qint32 NUM_TILES = 1000;
+    const qint32 BATCH_SIZE = 100;
+
+    // everything goes to the swap file right away
+    setUpConfig(0);
+
+    KisSwappedDataStore swappedStore;
+    KisMementoArenaStore store(&swappedStore);
+
+    QVector<KisTileData*> tileDataList = createTiles(NUM_TILES);
+
+    for(qint32 i = 0; i < NUM_TILES; i += BATCH_SIZE) {
+        QCOMPARE(store.compressTileDataBatch(tileDataList.mid(i, BATCH_SIZE)), BATCH_SIZE);
+    }
+
+    QCOMPARE(store.compressedSize(), qint64(0));
+    QVERIFY(store.spilledSize() > 0);
+
+    // the raw chunks are not counted as swapped tiles
+    QCOMPARE(swappedStore.numTiles(), quint64(0));
+
+    /**
+     * Access one tile of every arena: the arena is loaded as a
+     * whole, the rest of its tiles are decompressed from memory
+     */
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = tileDataList[i];
+
+        QVERIFY(store.decompressTileData(td));
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data(), TILESIZE));
+
+        if (i % BATCH_SIZE == 0) {
+            QVERIFY(store.compressedSize() > 0);
+        }
+    }
+
+    QCOMPARE(store.numTiles(), 0);
+    QCOMPARE(store.compressedSize(), qint64(0));
+    QCOMPARE(store.spilledSize(), qint64(0));
+
+    qDeleteAll(tileDataList);
+}
+
+void KisMementoArenaStoreTest::testForgetTileData()
+{
+    const qint32 NUM_TILES = 100;
+
+    setUpConfig(0);
+
+    KisSwappedDataStore swappedStore;
+    KisMementoArenaStore store(&swappedStore);
+
+    QVector<KisTileData*> tileDataList = createTiles(NUM_TILES);
+    QCOMPARE(store.compressTileDataBatch(tileDataList), NUM_TILES);
+    QVERIFY(store.spilledSize() > 0);
+
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        store.forgetTileData(tileDataList[i]);
+    }
+
+    QCOMPARE(store.numTiles(), 0);
+    QCOMPARE(store.uncompressedSize(), qint64(0));
+    QCOMPARE(store.spilledSize(), qint64(0));
+
+    qDeleteAll(tileDataList);
+}
+
+void KisMementoArenaStoreTest::testIncompressibleTiles()
+{
+    const qint32 NUM_TILES = 10;
+
+    setUpConfig(16);
+
+    KisSwappedDataStore swappedStore;
+    KisMementoArenaStore store(&swappedStore);
+
+    QVector<KisTileData*> tileDataList = createTiles(NUM_TILES);
+
+    // fill every second tile with noise
+    qsrand(1);
+    for(qint32 i = 0; i < NUM_TILES; i += 2) {
+        quint8 *data = tileDataList[i]->data();
+        for (qint32 j = 0; j < TILESIZE; j++) {
+            data[j] = qrand() & 0xff;
+        }
+    }
+
+    QCOMPARE(store.compressTileDataBatch(tileDataList), NUM_TILES / 2);
+
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = tileDataList[i];
+
+        if (i % 2) {
+            QVERIFY(!td->data());
+            QVERIFY(store.decompressTileData(td));
+            QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data(), TILESIZE));
+        } else {
+            QVERIFY(td->data());
+        }
+    }
+
+    qDeleteAll(tileDataList);
+}
+
+QTEST_MAIN(KisMementoArenaStoreTest)
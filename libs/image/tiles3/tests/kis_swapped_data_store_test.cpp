@@ -28,6 +28,8 @@
 
 #include "tiles3/kis_tile_data_store.h"
 
+#include <algorithm>
+
 
 #define COLUMN2COLOR(col) (col%255)
 
@@ -78,6 +80,72 @@ void KisSwappedDataStoreTest::testRoundTrip()
         delete tileDataList[i];
 }
 
+void KisSwappedDataStoreTest::testBatchRoundTrip()
+{
+    const qint32 pixelSize = 1;
+    const quint8 defaultPixel = 128;
+    const qint32 NUM_TILES = 10000;
+    const qint32 BATCH_SIZE = 64;
+
+    KisImageConfig config(false);
+    config.setMaxSwapSize(4);
+    config.setSwapSlabSize(1);
+    config.setSwapWindowSize(1);
+
+
+    KisSwappedDataStore store;
+
+    QVector<KisTileData*> tileDataList;
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = new KisTileData(pixelSize, &defaultPixel, KisTileDataStore::instance());
+        memset(td->data(), COLUMN2COLOR(i), TILESIZE);
+        tileDataList.append(td);
+    }
+
+    for(qint32 i = 0; i < NUM_TILES; i += BATCH_SIZE) {
+        QVector<KisTileData*> batch = tileDataList.mid(i, BATCH_SIZE);
+
+        // FIXME: take a lock of the tile data
+        QCOMPARE(store.trySwapOutTileDataBatch(batch), batch.size());
+    }
+
+    QCOMPARE(store.numTiles(), quint64(NUM_TILES));
+    store.debugStatistics();
+
+    /**
+     * Swap in the tiles in batches of a different size and in
+     * a different order to check that the chunks are restored
+     * correctly when they are sorted by their position
+     */
+    for(qint32 i = NUM_TILES - BATCH_SIZE / 2; i > -BATCH_SIZE; i -= BATCH_SIZE / 2) {
+        QVector<KisTileData*> batch = tileDataList.mid(qMax(0, i), BATCH_SIZE / 2 + qMin(0, i));
+        std::reverse(batch.begin(), batch.end());
+
+        Q_FOREACH (KisTileData *td, batch) {
+            QVERIFY(!td->data());
+            td->allocateMemory();
+        }
+
+        // FIXME: take a lock of the tile data
+        store.swapInTileDataBatch(batch);
+    }
+
+    QCOMPARE(store.numTiles(), quint64(0));
+
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = tileDataList[i];
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data(), TILESIZE));
+    }
+
+    QVERIFY(store.swapOutThroughput() > 0);
+    QVERIFY(store.swapInThroughput() > 0);
+
+    store.debugStatistics();
+
+    for(qint32 i = 0; i < NUM_TILES; i++)
+        delete tileDataList[i];
+}
+
 void KisSwappedDataStoreTest::processTileData(qint32 column, KisTileData *td, KisSwappedDataStore &store)
 {
     if(td->data()) {
@@ -32,6 +32,7 @@ private:
 
 private Q_SLOTS:
     void testRoundTrip();
+    void testBatchRoundTrip();
     void testRandomAccess();
 
 };
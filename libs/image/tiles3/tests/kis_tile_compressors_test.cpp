@@ -179,6 +179,59 @@ void KisTileCompressorsTest::testLowLevelRoundTripIncompressible2()
     delete compressor;
 }
 
+void KisTileCompressorsTest::testRoundTripCodecs_data()
+{
+    QTest::addColumn<int>("codecId");
+
+    QTest::newRow("lzf") << int(KisCompressionFactory::LZF);
+    QTest::newRow("lz4") << int(KisCompressionFactory::LZ4);
+    QTest::newRow("zlib") << int(KisCompressionFactory::ZLIB);
+}
+
+void KisTileCompressorsTest::testRoundTripCodecs()
+{
+    QFETCH(int, codecId);
+
+    KisAbstractTileCompressor *compressor = new KisTileCompressor2(codecId);
+    doRoundTrip(compressor);
+    doLowLevelRoundTrip(compressor);
+    doLowLevelRoundTripIncompressible(compressor);
+    delete compressor;
+}
+
+void KisTileCompressorsTest::testReadForeignCodec()
+{
+    /**
+     * The data written by one codec should be readable by
+     * a compressor configured for another one
+     */
+    const qint32 pixelSize = 1;
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    KisTiledDataManager dm(pixelSize, &oddPixel1);
+    KisTileSP tile = dm.getTile(0, 0, true);
+    tile->lockForWrite();
+
+    KisTileData *td = tile->tileData();
+
+    KisTileCompressor2 writer(KisCompressionFactory::LZ4);
+    KisTileCompressor2 reader(KisCompressionFactory::LZF);
+
+    qint32 bufferSize = writer.tileDataBufferSize(td);
+    quint8 *buffer = new quint8[bufferSize];
+    qint32 bytesWritten;
+    writer.compressTileData(td, buffer, bufferSize, bytesWritten);
+    QCOMPARE(int(buffer[0]), int(KisCompressionFactory::LZ4));
+
+    memset(td->data(), oddPixel2, TILESIZE);
+
+    QVERIFY(reader.decompressTileData(buffer, bytesWritten, td));
+    QVERIFY(memoryIsFilled(oddPixel1, td->data(), TILESIZE));
+
+    delete[] buffer;
+    tile->unlock();
+}
 
 QTEST_MAIN(KisTileCompressorsTest)
 
@@ -18,6 +18,7 @@
 
 #include "kis_tile_data_store_test.h"
 #include <QTest>
+#include <QElapsedTimer>
 
 #include "kis_debug.h"
 
@@ -188,5 +189,124 @@ void KisTileDataStoreTest::testSwapping()
     }
 }
 
+void KisTileDataStoreTest::testPrefetch()
+{
+    {
+        KisImageConfig config(false);
+        config.setMemoryHardLimitPercent(512.0 * 100.0 / KisImageConfig::totalRAM());
+        config.setMemorySoftLimitPercent(50);
+        config.setMemoryPoolLimitPercent(0);
+    }
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+    store->testingRereadConfig();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManagerSP dm = new KisTiledDataManager(pixelSize, &defaultPixel);
+
+    // the tiles should not be uniform, otherwise they are not swapped
+    for(qint32 col = 0; col < 100; col++) {
+        KisTileSP tile = dm->getTile(col, 0, true);
+        tile->lockForWrite();
+        memset(tile->tileData()->data(), COLUMN2COLOR(col), TILESIZE);
+        tile->tileData()->data()[0] = ~COLUMN2COLOR(col);
+        tile->unlock();
+    }
+
+    store->debugSwapAll();
+    QCOMPARE(store->numTilesSwapped(), 100);
+
+    // only the left half of the row is requested
+    store->prefetchTileData(dm, QRect(0, 0, 50 * KisTileData::WIDTH, KisTileData::HEIGHT));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (store->numTilesSwapped() > 50 && timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+
+    QCOMPARE(store->numTilesSwapped(), 50);
+
+    for(qint32 col = 0; col < 100; col++) {
+        KisTileSP tile = dm->getTile(col, 0, false);
+        tile->lockForRead();
+        QCOMPARE(tile->tileData()->data()[0], quint8(~COLUMN2COLOR(col)));
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(col), tile->tileData()->data() + 1, TILESIZE - 1));
+        tile->unlock();
+    }
+
+    dm = 0;
+    store->debugClear();
+}
+
+void KisTileDataStoreTest::testUniformTiles()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+
+    // the pooler may collapse the tiles as well
+    store->testingSuspendPooler();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    for(qint32 col = 0; col < 10; col++) {
+        KisTileSP tile = dm.getTile(col, 0, true);
+        tile->lockForWrite();
+        memset(tile->tileData()->data(), COLUMN2COLOR(col), TILESIZE);
+
+        // the odd tiles are not uniform
+        if (col & 0x1) {
+            tile->tileData()->data()[TILESIZE - 1] = ~COLUMN2COLOR(col);
+        }
+
+        tile->unlock();
+    }
+
+    const qint32 numTiles = store->numTiles();
+
+    store->debugSwapAll();
+
+    // the default tile data of the data manager is uniform as well
+    QCOMPARE(store->numTilesUniform(), 6);
+    QCOMPARE(store->numTilesSwapped(), 5);
+    QCOMPARE(store->numTiles(), numTiles);
+
+    KisTileDataStore::MemoryStatistics stats = store->memoryStatistics();
+    QCOMPARE(stats.uniformTilesReclaimedSize, qint64(6 * TILESIZE));
+
+    for(qint32 col = 0; col < 10; col++) {
+        KisTileSP tile = dm.getTile(col, 0, false);
+        tile->lockForRead();
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(col), tile->tileData()->data(), TILESIZE - 1));
+        QCOMPARE(tile->tileData()->data()[TILESIZE - 1],
+                 quint8(col & 0x1 ? ~COLUMN2COLOR(col) : COLUMN2COLOR(col)));
+        tile->unlock();
+    }
+
+    QCOMPARE(store->numTilesUniform(), 1);
+    QCOMPARE(store->numTilesSwapped(), 0);
+    QCOMPARE(store->memoryStatistics().uniformTilesReclaimedSize, qint64(TILESIZE));
+
+    // writing into a collapsed tile expands it as well
+    store->debugSwapAll();
+    QCOMPARE(store->numTilesUniform(), 6);
+
+    {
+        KisTileSP tile = dm.getTile(0, 0, true);
+        tile->lockForWrite();
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(0), tile->tileData()->data(), TILESIZE));
+        tile->tileData()->data()[0] = 0;
+        tile->unlock();
+    }
+
+    QCOMPARE(store->numTilesUniform(), 5);
+
+    store->testingResumePooler();
+}
+
 QTEST_MAIN(KisTileDataStoreTest)
 
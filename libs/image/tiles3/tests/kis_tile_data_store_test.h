@@ -30,6 +30,8 @@ private Q_SLOTS:
     void testClockIterator();
     void testLeaks();
     void testSwapping();
+    void testPrefetch();
+    void testUniformTiles();
 };
 
 #endif /* KIS_TILE_DATA_STORE_TEST_H */
@@ -18,12 +18,40 @@
 
 #include "kis_tiled_data_manager_test.h"
 #include <QTest>
+#include <QBuffer>
 
 #include "tiles3/kis_tiled_data_manager.h"
+#include "kis_datamanager.h"
+#include "kis_paint_device_writer.h"
+#include "tiles3/kis_hline_iterator.h"
+#include "tiles3/kis_vline_iterator.h"
+#include "tiles3/kis_random_accessor.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "kis_image_config.h"
 
 #include "tiles_test_utils.h"
 #include "config-limit-long-tests.h"
 
+class KisBufferPaintDeviceWriter : public KisPaintDeviceWriter
+{
+public:
+    KisBufferPaintDeviceWriter(QIODevice *device)
+        : m_device(device)
+    {
+    }
+
+    bool write(const QByteArray &data) override {
+        return m_device->write(data) == data.size();
+    }
+
+    bool write(const char* data, qint64 length) override {
+        return m_device->write(data, length) == length;
+    }
+
+private:
+    QIODevice *m_device;
+};
+
 bool KisTiledDataManagerTest::checkHole(quint8* buffer,
                                         quint8 holeColor, QRect holeRect,
                                         quint8 backgroundColor, QRect backgroundRect)
@@ -540,6 +568,294 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
     QVERIFY(memoryIsFilled(oddPixel2, tile10->data(), TILESIZE));
 }
 
+void KisTiledDataManagerTest::testHistoricalMemorySize()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    QCOMPARE(dm.estimateHistoricalMemorySize(), 0LL);
+
+    KisMementoSP memento1 = dm.getMemento();
+    dm.clear(0, 0, 10, 10, &oddPixel1);
+    dm.commit();
+
+    /**
+     * The only version of the tile is used by the device itself
+     */
+    QCOMPARE(dm.estimateHistoricalMemorySize(), 0LL);
+
+    KisMementoSP memento2 = dm.getMemento();
+    dm.clear(0, 0, 10, 10, &oddPixel2);
+    dm.commit();
+
+    /**
+     * The first version is kept by the undo history only
+     */
+    QCOMPARE(dm.estimateHistoricalMemorySize(), qint64(TILESIZE));
+
+    dm.rollback(memento2);
+
+    /**
+     * And now the second one is kept by the redo history
+     */
+    QCOMPARE(dm.estimateHistoricalMemorySize(), qint64(TILESIZE));
+
+    dm.rollforward(memento2);
+    QCOMPARE(dm.estimateHistoricalMemorySize(), qint64(TILESIZE));
+
+    dm.rollback(memento2);
+
+    /**
+     * A new transaction drops the redo history
+     */
+    KisMementoSP memento3 = dm.getMemento();
+    QCOMPARE(dm.estimateHistoricalMemorySize(), 0LL);
+
+    dm.clear(0, 0, 10, 10, &oddPixel2);
+    dm.commit();
+    QCOMPARE(dm.estimateHistoricalMemorySize(), qint64(TILESIZE));
+
+    KisMementoSP memento4 = dm.getMemento();
+    dm.clear(0, 0, 10, 10, &oddPixel1);
+    dm.commit();
+    QCOMPARE(dm.estimateHistoricalMemorySize(), qint64(2 * TILESIZE));
+
+    /**
+     * After purging the oldest revisions the undo history refers
+     * to the initial (default) state of the tile only
+     */
+    dm.purgeHistory(memento4);
+    QCOMPARE(dm.estimateHistoricalMemorySize(), 0LL);
+}
+
+void KisTiledDataManagerTest::testUndoCompressedHistory()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+
+    /**
+     * Compress the history explicitly, the swapper and
+     * the pooler should not touch the tiles meanwhile
+     */
+    KisImageConfig config(false);
+    const bool compressHistory = config.compressHistory();
+    config.setCompressHistory(false);
+    store->testingSuspendPooler();
+
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    const QRect rect(0, 0, 256, 256);
+    const int numPixels = rect.width() * rect.height();
+
+    QVector<quint8> buffer1(numPixels);
+    QVector<quint8> buffer2(numPixels);
+    for (int i = 0; i < numPixels; i++) {
+        buffer1[i] = i % 251;
+        buffer2[i] = i % 241;
+    }
+
+    KisMementoSP memento1 = dm.getMemento();
+    dm.writeBytes(buffer1.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    dm.commit();
+
+    QVector<KisTileData*> tileDataList;
+    for (int row = 0; row < rect.height() / KisTileData::HEIGHT; row++) {
+        for (int col = 0; col < rect.width() / KisTileData::WIDTH; col++) {
+            KisTileSP tile = dm.getTile(col, row, false);
+            KisTileData *td = tile->tileData();
+            td->ref();
+            tileDataList.append(td);
+        }
+    }
+
+    KisMementoSP memento2 = dm.getMemento();
+    dm.writeBytes(buffer2.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    dm.commit();
+
+    /**
+     * The first version of the tiles is kept by the undo history only
+     */
+    const qint32 numLostTiles = store->numLostHistoryTiles();
+    QCOMPARE(store->compressHistoricalTileDataBatch(tileDataList), tileDataList.size());
+
+    dm.rollback(memento2);
+
+    QVector<quint8> result(numPixels);
+    dm.readBytes(result.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(result == buffer1);
+    QCOMPARE(store->numLostHistoryTiles(), numLostTiles);
+
+    dm.rollforward(memento2);
+    dm.readBytes(result.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(result == buffer2);
+
+    Q_FOREACH (KisTileData *td, tileDataList) {
+        td->deref();
+    }
+
+    store->testingResumePooler();
+    config.setCompressHistory(compressHistory);
+}
+
+void KisTiledDataManagerTest::testCustomTileSize()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel, 256, 128);
+
+    QCOMPARE(dm.tileWidth(), 256);
+    QCOMPARE(dm.tileHeight(), 128);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    QRect rect(0,0,512,512);
+    QRect fillRect(100,100,300,50);
+
+    dm.clear(fillRect, &oddPixel1);
+
+    QCOMPARE(dm.extent(), QRect(0,0,512,256));
+
+    KisTileSP tile = dm.getTile(0, 0, false);
+    QCOMPARE(tile->extent(), QRect(0,0,256,128));
+
+    quint8 *buffer = new quint8[rect.width()*rect.height()];
+    dm.readBytes(buffer, rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(checkHole(buffer, oddPixel1, fillRect,
+                      defaultPixel, rect));
+
+    // a whole-tile clear should create a single shared tile data
+    dm.clear(QRect(256,256,256,256), &oddPixel2);
+    QVERIFY(dm.getTile(1, 2, false)->tileData() ==
+            dm.getTile(1, 3, false)->tileData());
+    QCOMPARE(dm.getTile(1, 2, false)->tileData()->width(), 256);
+    QCOMPARE(dm.getTile(1, 2, false)->tileData()->height(), 128);
+
+    dm.clear();
+
+    // bitBlt between data managers with different tile sizes
+    KisTiledDataManager srcDM(1, &defaultPixel);
+    srcDM.clear(fillRect, &oddPixel1);
+
+    dm.clear(rect, &oddPixel2);
+    dm.bitBlt(&srcDM, QRect(80,80,400,400));
+
+    dm.readBytes(buffer, rect.x(), rect.y(), rect.width(), rect.height());
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            const quint8 expectedColor =
+                fillRect.contains(x, y) ? oddPixel1 :
+                QRect(80,80,400,400).contains(x, y) ? defaultPixel :
+                oddPixel2;
+
+            QCOMPARE(buffer[y * rect.width() + x], expectedColor);
+        }
+    }
+
+    // bitBltRough copies all the destination tiles touched
+    dm.clear();
+    dm.bitBltRough(&srcDM, fillRect);
+    QCOMPARE(dm.extent(), QRect(0,0,512,256));
+    dm.readBytes(buffer, rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(checkHole(buffer, oddPixel1, fillRect,
+                      defaultPixel, rect));
+
+    delete[] buffer;
+}
+
+void KisTiledDataManagerTest::testCustomTileSizeIterators()
+{
+    const quint8 defaultPixel[2] = {0, 0};
+
+    QList<QPair<int, int>> tileSizes;
+    tileSizes << qMakePair(64, 64) << qMakePair(128, 128)
+              << qMakePair(256, 256) << qMakePair(256, 64);
+
+    for (auto it = tileSizes.constBegin(); it != tileSizes.constEnd(); ++it) {
+        KisDataManager dm(2, defaultPixel, it->first, it->second);
+
+        const QRect rect(-70, -130, 600, 333);
+
+        {
+            KisHLineIteratorSP hIt = new KisHLineIterator2(&dm, rect.x(), rect.y(), rect.width(), 0, 0, true, 0);
+            for (int row = 0; row < rect.height(); row++) {
+                do {
+                    quint8 *data = hIt->rawData();
+                    data[0] = hIt->x() & 0xff;
+                    data[1] = hIt->y() & 0xff;
+                } while (hIt->nextPixel());
+                hIt->nextRow();
+            }
+        }
+
+        {
+            KisVLineConstIteratorSP vIt = new KisVLineIterator2(&dm, rect.x(), rect.y(), rect.height(), 0, 0, false, 0);
+            for (int column = 0; column < rect.width(); column++) {
+                do {
+                    const quint8 *data = vIt->rawDataConst();
+                    QCOMPARE(data[0], quint8(vIt->x() & 0xff));
+                    QCOMPARE(data[1], quint8(vIt->y() & 0xff));
+                } while (vIt->nextPixel());
+                vIt->nextColumn();
+            }
+        }
+
+        {
+            KisRandomConstAccessorSP rIt = new KisRandomAccessor2(&dm, 0, 0, 0, 0, false, 0);
+            for (int y = rect.top(); y <= rect.bottom(); y += 7) {
+                for (int x = rect.left(); x <= rect.right(); x += 13) {
+                    rIt->moveTo(x, y);
+                    const quint8 *data = rIt->rawDataConst();
+                    QCOMPARE(data[0], quint8(x & 0xff));
+                    QCOMPARE(data[1], quint8(y & 0xff));
+                }
+            }
+        }
+    }
+}
+
+void KisTiledDataManagerTest::testCustomTileSizeReadWrite()
+{
+    quint8 defaultPixel = 0;
+    quint8 oddPixel1 = 128;
+
+    const QRect rect(-100, -100, 700, 600);
+    const QRect fillRect(-30, 20, 333, 444);
+
+    KisDataManager srcDM(1, &defaultPixel, 128, 128);
+    srcDM.clear(fillRect, &oddPixel1);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    KisBufferPaintDeviceWriter writer(&buffer);
+    QVERIFY(srcDM.write(writer));
+    buffer.close();
+
+    QVERIFY(buffer.data().contains("TILEWIDTH 128"));
+
+    // the file is read by the data managers of any tile size
+    QList<int> tileSizes;
+    tileSizes << 64 << 128 << 256;
+
+    Q_FOREACH (int tileSize, tileSizes) {
+        KisDataManager dstDM(1, &defaultPixel, tileSize, tileSize);
+
+        buffer.open(QIODevice::ReadOnly);
+        QVERIFY(dstDM.read(&buffer));
+        buffer.close();
+
+        QCOMPARE(dstDM.tileWidth(), tileSize);
+
+        quint8 *pixels = new quint8[rect.width()*rect.height()];
+        dstDM.readBytes(pixels, rect.x(), rect.y(), rect.width(), rect.height());
+        QVERIFY(checkHole(pixels, oddPixel1, fillRect,
+                          defaultPixel, rect));
+        delete[] pixels;
+    }
+}
+
 //#include <valgrind/callgrind.h>
 
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
@@ -52,6 +52,11 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testHistoricalMemorySize();
+    void testUndoCompressedHistory();
+    void testCustomTileSize();
+    void testCustomTileSizeIterators();
+    void testCustomTileSizeReadWrite();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
@@ -842,6 +842,26 @@ QRect Document::bounds() const
     return d->document->image()->bounds();
 }
 
+QMap<QString, QVariant> Document::memoryUsage() const
+{
+    if (!d->document) return QMap<QString, QVariant>();
+
+    KisMemoryStatisticsServer::NodeStatistics total;
+
+    Q_FOREACH (const KisMemoryStatisticsServer::NodeStatistics &stats,
+               KisMemoryStatisticsServer::instance()->fetchNodeMemoryStatistics(d->document->image())) {
+
+        total.layerSize += stats.layerSize;
+        total.projectionSize += stats.projectionSize;
+        total.lodSize += stats.lodSize;
+        total.framesSize += stats.framesSize;
+        total.onionSkinsSize += stats.onionSkinsSize;
+        total.historySize += stats.historySize;
+    }
+
+    return LibKisUtils::memoryUsageToMap(total);
+}
+
 QPointer<KisDocument> Document::document() const
 {
     return d->document;
@@ -750,6 +750,15 @@ print(root.childNodes())
      */
     QRect bounds() const;
 
+    /**
+     * @brief memoryUsage estimates how much memory the image takes, split into categories.
+     * The keys of the map are the same as in Node::memoryUsage(), the values are summed
+     * over all the nodes of the image. Use Node::memoryUsage() to find out which nodes
+     * take most of the memory.
+     * @return the map with the memory usage in bytes
+     */
+    QMap<QString, QVariant> memoryUsage() const;
+
 
 
 
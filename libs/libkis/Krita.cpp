@@ -54,6 +54,7 @@
 #include <KoResourceServerProvider.h>
 #include <kis_action_registry.h>
 #include <kis_icon_utils.h>
+#include <kis_trace_recorder.h>
 
 #include "View.h"
 #include "Document.h"
@@ -143,6 +144,21 @@ void Krita::setBatchmode(bool value)
     d->batchMode = value;
 }
 
+bool Krita::traceRecording() const
+{
+    return KisTraceRecorder::isEnabled();
+}
+
+void Krita::setTraceRecording(bool value)
+{
+    KisTraceRecorder::instance()->setEnabled(value);
+}
+
+bool Krita::saveTrace(const QString &fileName) const
+{
+    return KisTraceRecorder::instance()->saveChromeTrace(fileName);
+}
+
 
 QList<Document *> Krita::documents() const
 {
@@ -75,6 +75,34 @@ public Q_SLOTS:
      */
     void setBatchmode(bool value);
 
+    /**
+     * @brief traceRecording shows whether the timings of the update and stroke
+     * pipeline are being recorded.
+     * @return true if the trace recording is on
+     */
+    bool traceRecording() const;
+
+    /**
+     * @brief setTraceRecording switches the recording of the timings of the update
+     * and stroke pipeline on or off. Switching it on drops the previously recorded trace.
+     *
+     * @code
+     * Krita.instance().setTraceRecording(True)
+     * # ... paint something ...
+     * Krita.instance().setTraceRecording(False)
+     * Krita.instance().saveTrace("/tmp/krita-trace.json")
+     * @endcode
+     */
+    void setTraceRecording(bool value);
+
+    /**
+     * @brief saveTrace saves the recorded trace in the Chrome trace format, which
+     * can be opened in chrome://tracing or in Perfetto.
+     * @param fileName the name of the file
+     * @return true if the trace has been saved successfully
+     */
+    bool saveTrace(const QString &fileName) const;
+
     /**
      * @return return a list of all actions for the currently active mainWindow.
      */
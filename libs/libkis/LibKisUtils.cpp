@@ -79,3 +79,18 @@ QList<Node *> LibKisUtils::createNodeList(KisNodeList kisnodes, KisImageWSP imag
     }
     return nodes;
 }
+
+QMap<QString, QVariant> LibKisUtils::memoryUsageToMap(const KisMemoryStatisticsServer::NodeStatistics &stats)
+{
+    QMap<QString, QVariant> result;
+
+    result["layer"] = stats.layerSize;
+    result["projection"] = stats.projectionSize;
+    result["lod"] = stats.lodSize;
+    result["frames"] = stats.framesSize;
+    result["onionSkins"] = stats.onionSkinsSize;
+    result["history"] = stats.historySize;
+    result["total"] = stats.totalSize();
+
+    return result;
+}
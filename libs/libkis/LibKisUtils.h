@@ -22,13 +22,23 @@
 
 class Node;
 
+#include <QMap>
+#include <QVariant>
+
 #include <kis_types.h>
+#include <kis_memory_statistics_server.h>
 
 namespace LibKisUtils
 {
 
 QList<Node *> createNodeList(KisNodeList kisnodes, KisImageWSP image);
 
+/**
+ * Converts the memory statistics of a node into a map, which is
+ * returned by Node::memoryUsage() and Document::memoryUsage()
+ */
+QMap<QString, QVariant> memoryUsageToMap(const KisMemoryStatisticsServer::NodeStatistics &stats);
+
 }
 
 #endif // LIBKISUTILS_H
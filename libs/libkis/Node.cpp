@@ -513,6 +513,23 @@ QRect Node::bounds() const
     return d->node->exactBounds();
 }
 
+QMap<QString, QVariant> Node::memoryUsage() const
+{
+    QMap<QString, QVariant> result;
+    if (!d->node || !d->image) return result;
+
+    Q_FOREACH (const KisMemoryStatisticsServer::NodeStatistics &stats,
+               KisMemoryStatisticsServer::instance()->fetchNodeMemoryStatistics(d->image)) {
+
+        if (stats.node == d->node) {
+            result = LibKisUtils::memoryUsageToMap(stats);
+            break;
+        }
+    }
+
+    return result;
+}
+
 void Node::move(int x, int y)
 {
     if (!d->node) return;
@@ -451,6 +451,26 @@ public Q_SLOTS:
      */
     QRect bounds() const;
 
+    /**
+     * @brief memoryUsage estimates how much memory the node takes, split into categories.
+     *
+     * The values are in bytes, the keys of the map are:
+     *
+     * <ul>
+     * <li>layer: the pixels of the node itself
+     * <li>projection: the projection and the other caches of the node
+     * <li>lod: the planes of the instant preview mode
+     * <li>frames: the animation frames
+     * <li>onionSkins: the cached onion skins
+     * <li>history: the data kept by the undo history of the node
+     * <li>total: the sum of all the above except history
+     * </ul>
+     *
+     * @return the map with the memory usage, or an empty map if the node
+     * does not belong to an image
+     */
+    QMap<QString, QVariant> memoryUsage() const;
+
     /**
      *  move the pixels to the given x, y location in the image coordinate space.
      */
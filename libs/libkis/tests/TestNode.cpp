@@ -163,5 +163,30 @@ void TestNode::testMergeDown()
     delete n2;
 }
 
+void TestNode::testMemoryUsage()
+{
+    KisImageSP image = new KisImage(0, 100, 100, KoColorSpaceRegistry::instance()->rgb8(), "test");
+
+    KisNodeSP layer = new KisPaintLayer(image, "test1", 255);
+    {
+        KisFillPainter gc(layer->paintDevice());
+        gc.fillRect(0, 0, 100, 100, KoColor(Qt::gray, layer->colorSpace()));
+    }
+    image->addNode(layer);
+
+    Node node(image, layer);
+    QMap<QString, QVariant> usage = node.memoryUsage();
+
+    QVERIFY(usage["layer"].toLongLong() >= 100 * 100 * 4);
+    QCOMPARE(usage["frames"].toLongLong(), 0LL);
+    QCOMPARE(usage["onionSkins"].toLongLong(), 0LL);
+    QCOMPARE(usage["total"].toLongLong(),
+             usage["layer"].toLongLong() + usage["projection"].toLongLong() +
+             usage["lod"].toLongLong());
+
+    Node orphan(0, layer);
+    QVERIFY(orphan.memoryUsage().isEmpty());
+}
+
 QTEST_MAIN(TestNode)
 
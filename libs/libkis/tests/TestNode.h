@@ -31,6 +31,7 @@ private Q_SLOTS:
     void testProjectionPixelData();
     void testThumbnail();
     void testMergeDown();
+    void testMemoryUsage();
 };
 
 #endif
@@ -19,9 +19,11 @@
 
 #include "KoColorConversionCache.h"
 
+#include <QAtomicInt>
 #include <QHash>
 #include <QList>
 #include <QMutex>
+#include <QSet>
 #include <QThreadStorage>
 
 #include <KoColorSpace.h>
@@ -56,33 +58,150 @@ uint qHash(const KoColorConversionCacheKey& key)
     return qHash(key.src) + qHash(key.dst) + qHash(key.renderingIntent) + qHash(key.conversionFlags);
 }
 
+/**
+ * The transformation is reference counted: one reference is owned by
+ * the shared hash of the cache, one by every thread shard it is
+ * registered in and one by every KoCachedColorConversionTransformation
+ * handle. The last released reference deletes the transformation.
+ */
 struct KoColorConversionCache::CachedTransformation {
 
     CachedTransformation(KoColorConversionTransformation* _transfo)
-        : transfo(_transfo), use(0)
+        : transfo(_transfo),
+          use(1),
+          isShared(_transfo->isThreadSafe())
     {}
 
     ~CachedTransformation() {
         delete transfo;
     }
 
+    /**
+     * A thread safe transformation can be used by any number of
+     * threads, the rest can be taken by a thread only when nobody
+     * except the cache holds it.
+     */
     bool available() {
-        return use == 0;
+        return isShared || use.loadAcquire() == 1;
     }
 
     KoColorConversionTransformation* transfo;
-    int use;
+    QAtomicInt use;
+    const bool isShared;
 };
 
-typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
+/**
+ * The part of the cache private to a thread. It is accessed by the
+ * owner thread only, so it needs no locking. The only exception are
+ * the usage counters, which are read by statistics().
+ */
+struct KoColorConversionCache::ThreadShard {
+    ThreadShard(Private *_owner);
+    ~ThreadShard();
+
+    void clear() {
+        Q_FOREACH (CachedTransformation *ct, items) {
+            KoColorConversionCache::releaseTransformation(ct);
+        }
+        items.clear();
+    }
+
+    /**
+     * Counts a lookup. The counters are written by the owner thread
+     * only, so a plain store is enough and the threads never write
+     * to the same counter. They are summed up by statistics().
+     */
+    static void count(QAtomicInteger<qint64> &counter) {
+        counter.storeRelease(counter.loadAcquire() + 1);
+    }
+
+    Private *owner;
+    int generation = 0;
+    QHash<KoColorConversionCacheKey, CachedTransformation*> items;
+
+    QAtomicInteger<qint64> hits;
+    QAtomicInteger<qint64> misses;
+};
 
 struct KoColorConversionCache::Private {
     QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
     QMutex cacheMutex;
 
-    QThreadStorage<FastPathCacheItem*> fastStorage;
+    /**
+     * Incremented every time a transformation is removed from the
+     * cache. The shards of the other threads notice the change on
+     * their next lookup and drop all their references.
+     */
+    QAtomicInt generation;
+
+    QThreadStorage<ThreadShard*> shards;
+
+    /**
+     * All the living shards, used for collecting the statistics.
+     * The counters of the deleted shards are added to
+     * retiredHits and retiredMisses. Guarded by cacheMutex.
+     */
+    QSet<ThreadShard*> allShards;
+    qint64 retiredHits = 0;
+    qint64 retiredMisses = 0;
+
+    /**
+     * The totals at the moment of the last resetStatistics() call,
+     * the counters of the shards themselves are never reset.
+     * Guarded by cacheMutex.
+     */
+    qint64 hitsOffset = 0;
+    qint64 missesOffset = 0;
+
+    QAtomicInteger<qint64> creations;
+
+    ThreadShard* currentShard() {
+        ThreadShard *shard = shards.localData();
+
+        if (!shard) {
+            shard = new ThreadShard(this);
+            shard->generation = generation.loadAcquire();
+            shards.setLocalData(shard);
+        } else {
+            const int currentGeneration = generation.loadAcquire();
+
+            if (shard->generation != currentGeneration) {
+                shard->clear();
+                shard->generation = currentGeneration;
+            }
+        }
+
+        return shard;
+    }
+
+    void totalCounts(qint64 *hits, qint64 *misses) const {
+        *hits = retiredHits;
+        *misses = retiredMisses;
+
+        Q_FOREACH (ThreadShard *shard, allShards) {
+            *hits += shard->hits.loadAcquire();
+            *misses += shard->misses.loadAcquire();
+        }
+    }
 };
 
+KoColorConversionCache::ThreadShard::ThreadShard(Private *_owner)
+    : owner(_owner)
+{
+    QMutexLocker lock(&owner->cacheMutex);
+    owner->allShards.insert(this);
+}
+
+KoColorConversionCache::ThreadShard::~ThreadShard()
+{
+    clear();
+
+    QMutexLocker lock(&owner->cacheMutex);
+    owner->allShards.remove(this);
+    owner->retiredHits += hits.loadAcquire();
+    owner->retiredMisses += misses.loadAcquire();
+}
+
 
 KoColorConversionCache::KoColorConversionCache() : d(new Private)
 {
@@ -103,56 +222,110 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
 {
     KoColorConversionCacheKey key(src, dst, _renderingIntent, _conversionFlags);
 
-    FastPathCacheItem *cacheItem =
-        d->fastStorage.localData();
+    ThreadShard *shard = d->currentShard();
 
-    if (cacheItem) {
-        if (cacheItem->first == key) {
-            return cacheItem->second;
-        }
+    auto it = shard->items.constFind(key);
+    if (it != shard->items.constEnd()) {
+        ThreadShard::count(shard->hits);
+        return KoCachedColorConversionTransformation(this, it.value());
     }
 
-    cacheItem = 0;
+    ThreadShard::count(shard->misses);
 
-    QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
+    CachedTransformation *cachedTransfo = 0;
+
+    {
+        QMutexLocker lock(&d->cacheMutex);
+        QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
         Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
             if (ct->available()) {
-                ct->transfo->setSrcColorSpace(src);
-                ct->transfo->setDstColorSpace(dst);
+                // the shared transformations are used concurrently, so they are never modified
+                if (!ct->isShared) {
+                    ct->transfo->setSrcColorSpace(src);
+                    ct->transfo->setDstColorSpace(dst);
+                }
 
-                cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+                cachedTransfo = ct;
                 break;
             }
         }
-    }
-    if (!cacheItem) {
-        KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
-        CachedTransformation* ct = new CachedTransformation(transfo);
-        d->cache.insert(key, ct);
-        cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+
+        if (!cachedTransfo) {
+            KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
+            cachedTransfo = new CachedTransformation(transfo);
+            d->cache.insert(key, cachedTransfo);
+            d->creations.ref();
+        }
+
+        // the reference of the shard, taken under the lock to keep the transformation exclusive
+        cachedTransfo->use.ref();
     }
 
-    d->fastStorage.setLocalData(cacheItem);
-    return cacheItem->second;
+    shard->items.insert(key, cachedTransfo);
+
+    return KoCachedColorConversionTransformation(this, cachedTransfo);
 }
 
 void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
 {
-    d->fastStorage.setLocalData(0);
-
     QMutexLocker lock(&d->cacheMutex);
+
+    bool removedSomething = false;
+
     QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
     for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
         if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
-            delete it.value();
+            releaseTransformation(it.value());
             it = d->cache.erase(it);
+            removedSomething = true;
         } else {
             ++it;
         }
     }
+
+    if (removedSomething) {
+        d->generation.ref();
+
+        /**
+         * The shard of the current thread is cleaned up right now,
+         * the other shards drop their references on the next lookup.
+         * If someone is still using a transformation with the color space
+         * being deleted, it is terribly evil, but the transformation will
+         * at least stay alive until the last handle is released.
+         */
+        if (d->shards.hasLocalData()) {
+            d->currentShard();
+        }
+    }
+}
+
+KoColorConversionCache::Statistics KoColorConversionCache::statistics() const
+{
+    Statistics stats;
+
+    stats.creations = d->creations.loadAcquire();
+
+    QMutexLocker lock(&d->cacheMutex);
+    d->totalCounts(&stats.hits, &stats.misses);
+    stats.hits -= d->hitsOffset;
+    stats.misses -= d->missesOffset;
+    stats.numTransformations = d->cache.size();
+
+    return stats;
+}
+
+void KoColorConversionCache::resetStatistics()
+{
+    QMutexLocker lock(&d->cacheMutex);
+    d->totalCounts(&d->hitsOffset, &d->missesOffset);
+    d->creations.storeRelease(0);
+}
+
+void KoColorConversionCache::releaseTransformation(CachedTransformation *ct)
+{
+    if (!ct->use.deref()) {
+        delete ct;
+    }
 }
 
 //--------- KoCachedColorConversionTransformation ----------//
@@ -165,21 +338,19 @@ struct KoCachedColorConversionTransformation::Private {
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoColorConversionCache* cache, KoColorConversionCache::CachedTransformation* transfo) : d(new Private)
 {
-    Q_ASSERT(transfo->available());
     d->cache = cache;
     d->transfo = transfo;
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
 {
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
+    KoColorConversionCache::releaseTransformation(d->transfo);
     delete d;
 }
 
@@ -187,4 +358,3 @@ const KoColorConversionTransformation* KoCachedColorConversionTransformation::tr
 {
     return d->transfo->transfo;
 }
-
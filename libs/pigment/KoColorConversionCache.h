@@ -25,15 +25,38 @@ class KoColorSpace;
 
 #include "KoColorConversionTransformation.h"
 
+#include "kritapigment_export.h"
+
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
+ * Every thread has its own shard of the cache, so the lookup of an
+ * already used transformation takes no locks. The transformations
+ * that report KoColorConversionTransformation::isThreadSafe() are
+ * created only once and shared between all the threads, the rest
+ * are created per thread.
+ *
  * This class is not part of public API, and can be changed without notice.
  */
-class KoColorConversionCache
+class KRITAPIGMENT_EXPORT KoColorConversionCache
 {
 public:
     struct CachedTransformation;
+
+    /**
+     * Counters of the cache usage for diagnostics
+     */
+    struct Statistics {
+        /// the lookups served by the shard of the calling thread
+        qint64 hits = 0;
+        /// the lookups that had to go to the shared part of the cache
+        qint64 misses = 0;
+        /// the transformations created by the cache
+        qint64 creations = 0;
+        /// the transformations currently stored in the cache
+        int numTransformations = 0;
+    };
+
 public:
     KoColorConversionCache();
     ~KoColorConversionCache();
@@ -58,6 +81,15 @@ public:
      * @param src source color space
      */
     void colorSpaceIsDestroyed(const KoColorSpace* src);
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private:
+    friend class KoCachedColorConversionTransformation;
+    struct ThreadShard;
+    static void releaseTransformation(CachedTransformation *ct);
+
 private:
     struct Private;
     Private* const d;
@@ -70,7 +102,7 @@ private:
  *
  * This class is not part of public API, and can be changed without notice.
  */
-class KoCachedColorConversionTransformation
+class KRITAPIGMENT_EXPORT KoCachedColorConversionTransformation
 {
     friend class KoColorConversionCache;
 private:
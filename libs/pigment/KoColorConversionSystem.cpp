@@ -28,6 +28,7 @@
 #include "KoColorProfile.h"
 #include "KoColorSpace.h"
 #include "KoCopyColorConversionTransformation.h"
+#include "KoFastColorConversionTransformation.h"
 #include "KoMultipleColorConversionTransformation.h"
 
 
@@ -232,6 +233,18 @@ KoColorConversionTransformation* KoColorConversionSystem::createColorConverter(c
     }
     Q_ASSERT(srcColorSpace);
     Q_ASSERT(dstColorSpace);
+
+    /**
+     * Depth changes within the same profile and conversions between
+     * the profiles differing in TRC only do not need the color
+     * management engine at all
+     */
+    KoColorConversionTransformation *fastTransfo =
+        KoFastColorConversionTransformation::create(srcColorSpace, dstColorSpace, renderingIntent, conversionFlags);
+    if (fastTransfo) {
+        return fastTransfo;
+    }
+
     dbgPigmentCCS << srcColorSpace->id() << (srcColorSpace->profile() ? srcColorSpace->profile()->name() : "default");
     dbgPigmentCCS << dstColorSpace->id() << (dstColorSpace->profile() ? dstColorSpace->profile()->name() : "default");
     Path path = findBestPath(
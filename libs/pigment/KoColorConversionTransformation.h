@@ -126,6 +126,13 @@ public:
      */
     bool isValid() const override { return true; }
 
+    /**
+     * @return true if transform() can be called from several threads
+     * simultaneously. KoColorConversionCache shares such transformations
+     * between all the threads instead of creating a copy per thread.
+     */
+    virtual bool isThreadSafe() const { return false; }
+
 private:
 
     void setSrcColorSpace(const KoColorSpace*) const;
@@ -156,6 +156,12 @@ public:
      * @return if the profile has a TRC(required for linearisation).
      */
     virtual bool hasTRC() const = 0;
+    /**
+     * @return if the profile is a matrix-shaper one, that is, it
+     * converts colors with a TRC and a 3x3 matrix only and has no
+     * lookup tables.
+     */
+    virtual bool isMatrixShaper() const = 0;
     /**
      * Linearizes first 3 values of QVector, leaving other values unchanged.
      * Returns the same QVector if it is not possible to linearize.
@@ -28,6 +28,7 @@ class KoCopyColorConversionTransformation : public KoColorConversionTransformati
 public:
     explicit KoCopyColorConversionTransformation(const KoColorSpace *cs);
     void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const override;
+    bool isThreadSafe() const override { return true; }
 };
 
 class KoCopyColorConversionTransformationFactory : public KoColorConversionTransformationFactory
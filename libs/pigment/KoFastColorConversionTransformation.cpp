@@ -0,0 +1,644 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KoFastColorConversionTransformation.h"
+
+#include <cstring>
+
+#include <QByteArray>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <KoConfig.h>
+#ifdef HAVE_OPENEXR
+#include <half.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "KoChannelInfo.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorProfile.h"
+#include "KoColorSpace.h"
+#include "KoColorSpaceMaths.h"
+
+namespace {
+
+enum ChannelType {
+    TypeUnsupported,
+    TypeU8,
+    TypeU16,
+    TypeF16,
+    TypeF32
+};
+
+const int MaxChannels = 4;
+
+/**
+ * The pixels are converted in chunks through an intermediate float
+ * buffer, which is small enough to stay in L1 cache
+ */
+const int ChunkSize = 256;
+
+ChannelType channelType(const KoColorSpace *cs)
+{
+    const KoID depthId = cs->colorDepthId();
+
+    if (depthId == Integer8BitsColorDepthID) {
+        return TypeU8;
+    } else if (depthId == Integer16BitsColorDepthID) {
+        return TypeU16;
+#ifdef HAVE_OPENEXR
+    } else if (depthId == Float16BitsColorDepthID) {
+        return TypeF16;
+#endif
+    } else if (depthId == Float32BitsColorDepthID) {
+        return TypeF32;
+    }
+
+    return TypeUnsupported;
+}
+
+inline bool isIntegerType(ChannelType type)
+{
+    return type == TypeU8 || type == TypeU16;
+}
+
+/**
+ * Matches the channels of the two color spaces by their display
+ * position. For every channel of the destination pixel (in memory
+ * order) \p srcOffsets gets the byte offset of the corresponding
+ * source channel.
+ */
+bool computeChannelLayout(const KoColorSpace *srcColorSpace,
+                          const KoColorSpace *dstColorSpace,
+                          int *srcOffsets,
+                          int *dstDisplayPositions,
+                          KoChannelInfo::enumChannelType *dstChannelTypes)
+{
+    const QList<KoChannelInfo*> srcChannels = srcColorSpace->channels();
+    const QList<KoChannelInfo*> dstChannels = dstColorSpace->channels();
+
+    if (srcChannels.size() != dstChannels.size() ||
+        dstChannels.size() > MaxChannels ||
+        int(srcColorSpace->pixelSize()) != srcChannels.size() * srcChannels.first()->size() ||
+        int(dstColorSpace->pixelSize()) != dstChannels.size() * dstChannels.first()->size()) {
+
+        return false;
+    }
+
+    Q_FOREACH (const KoChannelInfo *dstChannel, dstChannels) {
+        const int index = dstChannel->pos() / dstChannel->size();
+        if (index >= MaxChannels) return false;
+
+        const KoChannelInfo *srcChannel = 0;
+        Q_FOREACH (const KoChannelInfo *channel, srcChannels) {
+            if (channel->displayPosition() == dstChannel->displayPosition()) {
+                srcChannel = channel;
+                break;
+            }
+        }
+
+        if (!srcChannel || srcChannel->channelType() != dstChannel->channelType()) {
+            return false;
+        }
+
+        srcOffsets[index] = srcChannel->pos();
+        dstDisplayPositions[index] = dstChannel->displayPosition();
+        dstChannelTypes[index] = dstChannel->channelType();
+    }
+
+    return true;
+}
+
+bool hasCompatibleLayout(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace)
+{
+    int srcOffsets[MaxChannels];
+    int dstDisplayPositions[MaxChannels];
+    KoChannelInfo::enumChannelType dstChannelTypes[MaxChannels];
+
+    return computeChannelLayout(srcColorSpace, dstColorSpace,
+                                srcOffsets, dstDisplayPositions, dstChannelTypes);
+}
+
+bool fuzzyCompareVectors(const QVector<qreal> &lhs, const QVector<qreal> &rhs)
+{
+    // the values are stored in the profile as s15Fixed16Number
+    const qreal epsilon = 1e-4;
+
+    if (lhs.size() != rhs.size() || lhs.isEmpty()) return false;
+
+    for (int i = 0; i < lhs.size(); i++) {
+        if (qAbs(lhs[i] - rhs[i]) > epsilon) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Integer to integer conversion, no floating point involved
+ */
+template <typename src_channel_t, typename dst_channel_t>
+void scaleChannels(const quint8 *src, quint8 *dst, int numPixels,
+                   int numChannels, int srcPixelSize, int dstPixelSize,
+                   const int *srcOffsets, bool identityLayout)
+{
+    if (identityLayout) {
+        const src_channel_t *srcPtr = reinterpret_cast<const src_channel_t*>(src);
+        dst_channel_t *dstPtr = reinterpret_cast<dst_channel_t*>(dst);
+        const int numValues = numPixels * numChannels;
+
+        for (int i = 0; i < numValues; i++) {
+            dstPtr[i] = KoColorSpaceMaths<src_channel_t, dst_channel_t>::scaleToA(srcPtr[i]);
+        }
+        return;
+    }
+
+    for (int i = 0; i < numPixels; i++) {
+        dst_channel_t *dstPtr = reinterpret_cast<dst_channel_t*>(dst);
+
+        for (int j = 0; j < numChannels; j++) {
+            const src_channel_t value = *reinterpret_cast<const src_channel_t*>(src + srcOffsets[j]);
+            dstPtr[j] = KoColorSpaceMaths<src_channel_t, dst_channel_t>::scaleToA(value);
+        }
+
+        src += srcPixelSize;
+        dst += dstPixelSize;
+    }
+}
+
+template <typename src_channel_t>
+void unpackScaled(const quint8 *src, float *dst, int numPixels,
+                  int numChannels, int srcPixelSize, const int *srcOffsets)
+{
+    for (int i = 0; i < numPixels; i++) {
+        for (int j = 0; j < numChannels; j++) {
+            const src_channel_t value = *reinterpret_cast<const src_channel_t*>(src + srcOffsets[j]);
+            dst[j] = KoColorSpaceMaths<src_channel_t, float>::scaleToA(value);
+        }
+
+        src += srcPixelSize;
+        dst += numChannels;
+    }
+}
+
+/**
+ * The channels having a table are mapped through it, the rest
+ * (alpha) are just rescaled
+ */
+template <typename src_channel_t>
+void unpackWithTables(const quint8 *src, float *dst, int numPixels,
+                      int numChannels, int srcPixelSize, const int *srcOffsets,
+                      const float * const *tables)
+{
+    for (int i = 0; i < numPixels; i++) {
+        for (int j = 0; j < numChannels; j++) {
+            const src_channel_t value = *reinterpret_cast<const src_channel_t*>(src + srcOffsets[j]);
+            dst[j] = tables[j] ? tables[j][value] : KoColorSpaceMaths<src_channel_t, float>::scaleToA(value);
+        }
+
+        src += srcPixelSize;
+        dst += numChannels;
+    }
+}
+
+#ifdef __SSE2__
+inline __m128i floatToInt32(const float *src, __m128 scale)
+{
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 value = _mm_mul_ps(_mm_loadu_ps(src), scale);
+
+    // NaN is converted into zero, max_ps returns the second operand
+    value = _mm_min_ps(_mm_max_ps(value, zero), scale);
+
+    return _mm_cvtps_epi32(value);
+}
+#endif
+
+void packToU8(const float *src, quint8 *dst, int numValues)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 scale = _mm_set1_ps(255.0f);
+
+    for (; i + 16 <= numValues; i += 16) {
+        const __m128i v0 = floatToInt32(src + i, scale);
+        const __m128i v1 = floatToInt32(src + i + 4, scale);
+        const __m128i v2 = floatToInt32(src + i + 8, scale);
+        const __m128i v3 = floatToInt32(src + i + 12, scale);
+
+        const __m128i packed =
+            _mm_packus_epi16(_mm_packs_epi32(v0, v1),
+                             _mm_packs_epi32(v2, v3));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#endif
+
+    for (; i < numValues; i++) {
+        dst[i] = KoColorSpaceMaths<float, quint8>::scaleToA(src[i]);
+    }
+}
+
+void packToU16(const float *src, quint16 *dst, int numValues)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 scale = _mm_set1_ps(65535.0f);
+
+    /**
+     * SSE2 has no unsigned 32->16 bit pack, so the values are
+     * shifted into the signed range before packing and shifted
+     * back afterwards
+     */
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(short(0x8000));
+
+    for (; i + 8 <= numValues; i += 8) {
+        const __m128i v0 = _mm_sub_epi32(floatToInt32(src + i, scale), bias32);
+        const __m128i v1 = _mm_sub_epi32(floatToInt32(src + i + 4, scale), bias32);
+
+        const __m128i packed = _mm_xor_si128(_mm_packs_epi32(v0, v1), bias16);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#endif
+
+    for (; i < numValues; i++) {
+        dst[i] = KoColorSpaceMaths<float, quint16>::scaleToA(src[i]);
+    }
+}
+
+#ifdef HAVE_OPENEXR
+void packToF16(const float *src, half *dst, int numValues)
+{
+    for (int i = 0; i < numValues; i++) {
+        dst[i] = half(src[i]);
+    }
+}
+#endif
+
+/**
+ * The tone curve tables are indexed by the display position of
+ * the color channel, the source integer value is the index
+ * inside the table
+ */
+struct ToneCurveTables {
+    QVector<float> curves[3];
+};
+
+typedef QSharedPointer<const ToneCurveTables> ToneCurveTablesSP;
+
+ToneCurveTablesSP createToneCurveTables(const KoColorProfile *srcProfile,
+                                        const KoColorProfile *dstProfile,
+                                        int size)
+{
+    QSharedPointer<ToneCurveTables> tables(new ToneCurveTables);
+
+    const qreal maxValue = size - 1;
+
+    for (int c = 0; c < 3; c++) {
+        tables->curves[c].resize(size);
+    }
+
+    QVector<qreal> value(3);
+
+    for (int i = 0; i < size; i++) {
+        value.fill(i / maxValue);
+
+        srcProfile->linearizeFloatValue(value);
+        dstProfile->delinearizeFloatValue(value);
+
+        for (int c = 0; c < 3; c++) {
+            tables->curves[c][i] = value[c];
+        }
+    }
+
+    return tables;
+}
+
+/**
+ * The tables for a U16 source take 768 KiB and evaluate the lcms
+ * curves 196608 times, so the transformations between the same pair
+ * of the profiles share them. Every thread has its own copy of a
+ * transformation in KoColorConversionCache, and all of them get the
+ * same tables from here. The cache holds only weak references: the
+ * tables are freed together with the last transformation using them.
+ */
+class ToneCurveTablesCache
+{
+public:
+    ToneCurveTablesSP tables(const KoColorProfile *srcProfile,
+                             const KoColorProfile *dstProfile,
+                             int size)
+    {
+        const QByteArray srcId = srcProfile->uniqueId();
+        const QByteArray dstId = dstProfile->uniqueId();
+
+        if (srcId.isEmpty() || dstId.isEmpty()) {
+            return createToneCurveTables(srcProfile, dstProfile, size);
+        }
+
+        const QByteArray key = srcId + '|' + dstId + '|' + QByteArray::number(size);
+
+        // the tables are built under the lock, so that two threads don't build them twice
+        QMutexLocker l(&m_lock);
+
+        ToneCurveTablesSP result = m_tables.value(key).toStrongRef();
+
+        if (!result) {
+            result = createToneCurveTables(srcProfile, dstProfile, size);
+            m_tables.insert(key, result);
+            purgeExpiredTables();
+        }
+
+        return result;
+    }
+
+private:
+    void purgeExpiredTables() {
+        auto it = m_tables.begin();
+        while (it != m_tables.end()) {
+            if (it.value().isNull()) {
+                it = m_tables.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+    QMutex m_lock;
+    QHash<QByteArray, QWeakPointer<const ToneCurveTables>> m_tables;
+};
+
+Q_GLOBAL_STATIC(ToneCurveTablesCache, s_toneCurveTablesCache)
+
+}
+
+struct KoFastColorConversionTransformation::Private
+{
+    ConversionPath path;
+    ChannelType srcType;
+    ChannelType dstType;
+
+    int numChannels;
+    int srcPixelSize;
+    int dstPixelSize;
+
+    /**
+     * All the per-channel arrays are indexed by the position of
+     * the channel in the destination pixel
+     */
+    int srcOffsets[MaxChannels];
+    int dstDisplayPositions[MaxChannels];
+    KoChannelInfo::enumChannelType dstChannelTypes[MaxChannels];
+    bool identityLayout;
+
+    ToneCurveTablesSP toneCurves;
+    const float *channelTables[MaxChannels];
+};
+
+KoFastColorConversionTransformation::KoFastColorConversionTransformation(ConversionPath path,
+                                                                         const KoColorSpace *srcColorSpace,
+                                                                         const KoColorSpace *dstColorSpace,
+                                                                         Intent renderingIntent,
+                                                                         ConversionFlags conversionFlags)
+    : KoColorConversionTransformation(srcColorSpace, dstColorSpace, renderingIntent, conversionFlags),
+      d(new Private)
+{
+    d->path = path;
+    d->srcType = channelType(srcColorSpace);
+    d->dstType = channelType(dstColorSpace);
+    d->numChannels = srcColorSpace->channelCount();
+    d->srcPixelSize = srcColorSpace->pixelSize();
+    d->dstPixelSize = dstColorSpace->pixelSize();
+
+    computeChannelLayout(srcColorSpace, dstColorSpace,
+                         d->srcOffsets, d->dstDisplayPositions, d->dstChannelTypes);
+
+    const int srcChannelSize = d->srcPixelSize / d->numChannels;
+
+    d->identityLayout = true;
+    for (int i = 0; i < d->numChannels; i++) {
+        d->channelTables[i] = 0;
+        d->identityLayout &= d->srcOffsets[i] == i * srcChannelSize;
+    }
+
+    if (d->path == ToneCurves) {
+        buildToneCurveTables();
+    }
+}
+
+KoFastColorConversionTransformation::~KoFastColorConversionTransformation()
+{
+    delete d;
+}
+
+KoFastColorConversionTransformation* KoFastColorConversionTransformation::create(const KoColorSpace *srcColorSpace,
+                                                                                 const KoColorSpace *dstColorSpace,
+                                                                                 Intent renderingIntent,
+                                                                                 ConversionFlags conversionFlags)
+{
+    if (canConvertByDepthScaling(srcColorSpace, dstColorSpace)) {
+        return new KoFastColorConversionTransformation(DepthScaling, srcColorSpace, dstColorSpace, renderingIntent, conversionFlags);
+    } else if (canConvertByToneCurves(srcColorSpace, dstColorSpace)) {
+        return new KoFastColorConversionTransformation(ToneCurves, srcColorSpace, dstColorSpace, renderingIntent, conversionFlags);
+    }
+
+    return 0;
+}
+
+bool KoFastColorConversionTransformation::canConvertByDepthScaling(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace)
+{
+    if (srcColorSpace->colorModelId() != dstColorSpace->colorModelId() ||
+        (srcColorSpace->colorModelId() != RGBAColorModelID &&
+         srcColorSpace->colorModelId() != GrayAColorModelID)) {
+
+        return false;
+    }
+
+    const ChannelType srcType = channelType(srcColorSpace);
+    const ChannelType dstType = channelType(dstColorSpace);
+
+    if (srcType == TypeUnsupported || dstType == TypeUnsupported || srcType == dstType) {
+        return false;
+    }
+
+    const KoColorProfile *srcProfile = srcColorSpace->profile();
+    const KoColorProfile *dstProfile = dstColorSpace->profile();
+
+    if (!srcProfile || !dstProfile || !(*srcProfile == *dstProfile)) {
+        return false;
+    }
+
+    return hasCompatibleLayout(srcColorSpace, dstColorSpace);
+}
+
+bool KoFastColorConversionTransformation::canConvertByToneCurves(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace)
+{
+    if (srcColorSpace->colorModelId() != RGBAColorModelID ||
+        dstColorSpace->colorModelId() != RGBAColorModelID) {
+
+        return false;
+    }
+
+    // the tables are indexed by the source channel value
+    if (!isIntegerType(channelType(srcColorSpace)) ||
+        channelType(dstColorSpace) == TypeUnsupported) {
+
+        return false;
+    }
+
+    const KoColorProfile *srcProfile = srcColorSpace->profile();
+    const KoColorProfile *dstProfile = dstColorSpace->profile();
+
+    if (!srcProfile || !dstProfile) return false;
+
+    if (!srcProfile->isMatrixShaper() || !dstProfile->isMatrixShaper() ||
+        !srcProfile->hasColorants() || !dstProfile->hasColorants() ||
+        !srcProfile->hasTRC() || !dstProfile->hasTRC()) {
+
+        return false;
+    }
+
+    if (!fuzzyCompareVectors(srcProfile->getColorantsXYZ(), dstProfile->getColorantsXYZ()) ||
+        !fuzzyCompareVectors(srcProfile->getWhitePointXYZ(), dstProfile->getWhitePointXYZ())) {
+
+        return false;
+    }
+
+    return hasCompatibleLayout(srcColorSpace, dstColorSpace);
+}
+
+KoFastColorConversionTransformation::ConversionPath KoFastColorConversionTransformation::conversionPath() const
+{
+    return d->path;
+}
+
+void KoFastColorConversionTransformation::buildToneCurveTables()
+{
+    const KoColorProfile *srcProfile = srcColorSpace()->profile();
+    const KoColorProfile *dstProfile = dstColorSpace()->profile();
+
+    const int size = d->srcType == TypeU8 ? 256 : 65536;
+
+    // the cache may be already destroyed on exit
+    ToneCurveTablesCache *cache = s_toneCurveTablesCache;
+
+    d->toneCurves = cache ?
+        cache->tables(srcProfile, dstProfile, size) :
+        createToneCurveTables(srcProfile, dstProfile, size);
+
+    for (int i = 0; i < d->numChannels; i++) {
+        if (d->dstChannelTypes[i] == KoChannelInfo::COLOR) {
+            d->channelTables[i] = d->toneCurves->curves[d->dstDisplayPositions[i]].constData();
+        }
+    }
+}
+
+void KoFastColorConversionTransformation::transform(const quint8 *src, quint8 *dst, qint32 nPixels) const
+{
+    if (d->path == DepthScaling && isIntegerType(d->srcType) && isIntegerType(d->dstType)) {
+        if (d->srcType == TypeU8) {
+            scaleChannels<quint8, quint16>(src, dst, nPixels, d->numChannels,
+                                           d->srcPixelSize, d->dstPixelSize,
+                                           d->srcOffsets, d->identityLayout);
+        } else {
+            scaleChannels<quint16, quint8>(src, dst, nPixels, d->numChannels,
+                                           d->srcPixelSize, d->dstPixelSize,
+                                           d->srcOffsets, d->identityLayout);
+        }
+        return;
+    }
+
+    float buffer[ChunkSize * MaxChannels];
+
+    while (nPixels > 0) {
+        const int numPixels = qMin(nPixels, ChunkSize);
+        const int numValues = numPixels * d->numChannels;
+        const float *values = buffer;
+
+        if (d->path == ToneCurves) {
+            if (d->srcType == TypeU8) {
+                unpackWithTables<quint8>(src, buffer, numPixels, d->numChannels,
+                                         d->srcPixelSize, d->srcOffsets, d->channelTables);
+            } else {
+                unpackWithTables<quint16>(src, buffer, numPixels, d->numChannels,
+                                          d->srcPixelSize, d->srcOffsets, d->channelTables);
+            }
+        } else if (d->srcType == TypeF32 && d->identityLayout) {
+            // the source is already in the layout of the buffer
+            values = reinterpret_cast<const float*>(src);
+        } else {
+            switch (d->srcType) {
+            case TypeU8:
+                unpackScaled<quint8>(src, buffer, numPixels, d->numChannels, d->srcPixelSize, d->srcOffsets);
+                break;
+            case TypeU16:
+                unpackScaled<quint16>(src, buffer, numPixels, d->numChannels, d->srcPixelSize, d->srcOffsets);
+                break;
+#ifdef HAVE_OPENEXR
+            case TypeF16:
+                unpackScaled<half>(src, buffer, numPixels, d->numChannels, d->srcPixelSize, d->srcOffsets);
+                break;
+#endif
+            case TypeF32:
+                unpackScaled<float>(src, buffer, numPixels, d->numChannels, d->srcPixelSize, d->srcOffsets);
+                break;
+            default:
+                Q_ASSERT(0 && "unsupported channel type");
+                break;
+            }
+        }
+
+        switch (d->dstType) {
+        case TypeU8:
+            packToU8(values, dst, numValues);
+            break;
+        case TypeU16:
+            packToU16(values, reinterpret_cast<quint16*>(dst), numValues);
+            break;
+#ifdef HAVE_OPENEXR
+        case TypeF16:
+            packToF16(values, reinterpret_cast<half*>(dst), numValues);
+            break;
+#endif
+        case TypeF32:
+            memcpy(dst, values, numValues * sizeof(float));
+            break;
+        default:
+            Q_ASSERT(0 && "unsupported channel type");
+            break;
+        }
+
+        src += numPixels * d->srcPixelSize;
+        dst += numPixels * d->dstPixelSize;
+        nPixels -= numPixels;
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef _KO_FAST_COLOR_CONVERSION_TRANSFORMATION_H_
+#define _KO_FAST_COLOR_CONVERSION_TRANSFORMATION_H_
+
+#include "KoColorConversionTransformation.h"
+
+#include "kritapigment_export.h"
+
+/**
+ * A color conversion that bypasses the color management engine
+ * for the conversions that do not need a real ICC transform.
+ *
+ * Two cases are recognized:
+ *
+ *  - DepthScaling: the color spaces differ in channel depth only
+ *    (U8, U16, F16 or F32), the model and the profile are the same.
+ *    The channels are just rescaled.
+ *
+ *  - ToneCurves: both profiles are RGB matrix-shaper ones with the
+ *    same colorants and white point, i.e. they differ in the tone
+ *    reproduction curves only (e.g. linear and sRGB-trc variants of
+ *    the same color space). The matrices cancel out, so the color
+ *    channels are converted with a per-channel look-up table sampled
+ *    for every value of the integer source channel. Such a table is
+ *    at least as precise as the unoptimized lcms pipeline. The tables
+ *    are shared by all the transformations between the same profiles.
+ *
+ * Use create() to get the transformation; it returns 0 if the
+ * pair of the color spaces needs the color management engine.
+ */
+class KRITAPIGMENT_EXPORT KoFastColorConversionTransformation : public KoColorConversionTransformation
+{
+public:
+    enum ConversionPath {
+        DepthScaling,
+        ToneCurves
+    };
+
+public:
+    ~KoFastColorConversionTransformation() override;
+
+    /**
+     * @return a fast transformation between \p srcColorSpace and
+     * \p dstColorSpace or 0 if the conversion cannot be done without
+     * the color management engine
+     */
+    static KoFastColorConversionTransformation* create(const KoColorSpace *srcColorSpace,
+                                                        const KoColorSpace *dstColorSpace,
+                                                        Intent renderingIntent,
+                                                        ConversionFlags conversionFlags);
+
+    static bool canConvertByDepthScaling(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace);
+    static bool canConvertByToneCurves(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace);
+
+    /**
+     * @return the way the pixels are converted
+     */
+    ConversionPath conversionPath() const;
+
+    void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override;
+
+    /**
+     * All the tables are built in the constructor, transform()
+     * doesn't modify anything
+     */
+    bool isThreadSafe() const override { return true; }
+
+private:
+    KoFastColorConversionTransformation(ConversionPath path,
+                                        const KoColorSpace *srcColorSpace,
+                                        const KoColorSpace *dstColorSpace,
+                                        Intent renderingIntent,
+                                        ConversionFlags conversionFlags);
+
+    void buildToneCurveTables();
+
+private:
+    struct Private;
+    Private * const d;
+};
+
+#endif
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_MIX_COLORS_ACCUMULATOR_H
+#define __KO_MIX_COLORS_ACCUMULATOR_H
+
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "KoColorSpaceMaths.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * The type used for summing up the weighted channels. It is
+ * wider than compositetype for 8-bit channels, because the sum
+ * of a whole dab area doesn't fit into 32 bits.
+ */
+template<typename channels_type>
+struct KoMixColorsMixType {
+    typedef typename KoColorSpaceMathsTraits<channels_type>::compositetype type;
+};
+
+template<>
+struct KoMixColorsMixType<quint8> {
+    typedef qint64 type;
+};
+
+/**
+ * Sums up the colors premultiplied by their alpha and weights
+ * and converts the sums into the mixed color.
+ *
+ * The source wrapper should provide getPixel() and nextPixel(),
+ * the weights wrapper should provide premultiplyAlphaWithWeight(),
+ * weight() and nextPixel(). See KoMixColorsOpImpl.
+ */
+template<class _CSTrait>
+class KoMixColorsScalarAccumulator
+{
+public:
+    typedef typename _CSTrait::channels_type channels_type;
+    typedef typename KoMixColorsMixType<channels_type>::type mixtype;
+
+public:
+    KoMixColorsScalarAccumulator()
+        : m_totalAlpha(0)
+    {
+        memset(m_totals, 0, sizeof(m_totals));
+    }
+
+    template<class AbstractSource, class WeightsWrapper>
+    void accumulate(AbstractSource &source, WeightsWrapper &weightsWrapper, int nPixels) {
+        while (nPixels--) {
+            const channels_type* color = _CSTrait::nativeArray(source.getPixel());
+            mixtype alphaTimesWeight;
+
+            if (_CSTrait::alpha_pos != -1) {
+                alphaTimesWeight = color[_CSTrait::alpha_pos];
+            } else {
+                alphaTimesWeight = KoColorSpaceMathsTraits<channels_type>::unitValue;
+            }
+
+            weightsWrapper.premultiplyAlphaWithWeight(alphaTimesWeight);
+
+            for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
+                if (i != _CSTrait::alpha_pos) {
+                    m_totals[i] += color[i] * alphaTimesWeight;
+                }
+            }
+
+            m_totalAlpha += alphaTimesWeight;
+            source.nextPixel();
+            weightsWrapper.nextPixel();
+        }
+    }
+
+    void computeMixedColor(qint64 sumOfWeights, quint8 *dst) const {
+        // set totalAlpha to the minimum between its value and the unit value of the channels
+        const mixtype maxTotalAlpha = mixtype(KoColorSpaceMathsTraits<channels_type>::unitValue) * sumOfWeights;
+        const mixtype totalAlpha = qMin(m_totalAlpha, maxTotalAlpha);
+
+        channels_type* dstColor = _CSTrait::nativeArray(dst);
+
+        if (totalAlpha > 0) {
+
+            for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
+                if (i != _CSTrait::alpha_pos) {
+
+                    mixtype v = m_totals[i] / totalAlpha;
+
+                    if (v > KoColorSpaceMathsTraits<channels_type>::max) {
+                        v = KoColorSpaceMathsTraits<channels_type>::max;
+                    }
+                    if (v < KoColorSpaceMathsTraits<channels_type>::min) {
+                        v = KoColorSpaceMathsTraits<channels_type>::min;
+                    }
+                    dstColor[ i ] = v;
+                }
+            }
+
+            if (_CSTrait::alpha_pos != -1) {
+                dstColor[ _CSTrait::alpha_pos ] = totalAlpha / sumOfWeights;
+            }
+        } else {
+            memset(dst, 0, sizeof(channels_type) * _CSTrait::channels_nb);
+        }
+    }
+
+protected:
+    mixtype m_totals[_CSTrait::channels_nb];
+    mixtype m_totalAlpha;
+};
+
+#ifdef __SSE2__
+
+/**
+ * The accumulators below process the four channels of a pixel with
+ * a single SIMD operation. They are used for the color spaces with
+ * four channels and alpha in the last position (RGBA, BGRA, LabA).
+ * The order of the color channels doesn't matter for mixing.
+ *
+ * The vectorized sums are exactly the same as the ones of
+ * KoMixColorsScalarAccumulator, the pixels with weights which
+ * don't fit into the unsigned SIMD arithmetic (e.g. the negative
+ * lobes of the Lanczos filter) are summed up by the scalar code.
+ */
+
+template<class _CSTrait>
+class KoMixColorsAccumulatorU8x4 : public KoMixColorsScalarAccumulator<_CSTrait>
+{
+    typedef KoMixColorsScalarAccumulator<_CSTrait> BaseClass;
+
+public:
+    template<class AbstractSource, class WeightsWrapper>
+    void accumulate(AbstractSource &source, WeightsWrapper &weightsWrapper, int nPixels) {
+        /**
+         * A 32-bit lane can hold 258 products of 255 * 255 * 255
+         * without overflowing, so flush them regularly into the 64-bit totals.
+         */
+        const int maxPixelsPerChunk = 128;
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, 0, 0, 0, 0);
+        const __m128i alphaOne = _mm_setr_epi16(0, 0, 0, 1, 0, 0, 0, 0);
+
+        while (nPixels > 0) {
+            const int chunkSize = qMin(nPixels, maxPixelsPerChunk);
+            __m128i chunkTotals = zero;
+
+            for (int i = 0; i < chunkSize; i++) {
+                const quint8 *pixel = source.getPixel();
+                const int alphaTimesWeight = pixel[3] * weightsWrapper.weight();
+
+                if (alphaTimesWeight >= 0 && alphaTimesWeight <= 0xffff) {
+                    qint32 rawPixel;
+                    memcpy(&rawPixel, pixel, sizeof(rawPixel));
+
+                    // the alpha lane is replaced with 1, so that it sums up alphaTimesWeight
+                    __m128i color = _mm_unpacklo_epi8(_mm_cvtsi32_si128(rawPixel), zero);
+                    color = _mm_or_si128(_mm_and_si128(color, colorMask), alphaOne);
+
+                    const __m128i weight = _mm_set1_epi16(short(alphaTimesWeight));
+                    const __m128i productLo = _mm_mullo_epi16(color, weight);
+                    const __m128i productHi = _mm_mulhi_epu16(color, weight);
+
+                    chunkTotals = _mm_add_epi32(chunkTotals, _mm_unpacklo_epi16(productLo, productHi));
+                } else {
+                    for (int ch = 0; ch < 3; ch++) {
+                        BaseClass::m_totals[ch] += qint64(pixel[ch]) * alphaTimesWeight;
+                    }
+                    BaseClass::m_totalAlpha += alphaTimesWeight;
+                }
+
+                source.nextPixel();
+                weightsWrapper.nextPixel();
+            }
+
+            quint32 sums[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), chunkTotals);
+
+            for (int ch = 0; ch < 3; ch++) {
+                BaseClass::m_totals[ch] += sums[ch];
+            }
+            BaseClass::m_totalAlpha += sums[3];
+
+            nPixels -= chunkSize;
+        }
+    }
+};
+
+template<class _CSTrait>
+class KoMixColorsAccumulatorU16x4 : public KoMixColorsScalarAccumulator<_CSTrait>
+{
+    typedef KoMixColorsScalarAccumulator<_CSTrait> BaseClass;
+
+public:
+    template<class AbstractSource, class WeightsWrapper>
+    void accumulate(AbstractSource &source, WeightsWrapper &weightsWrapper, int nPixels) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i colorMask = _mm_setr_epi32(-1, -1, -1, 0);
+        const __m128i alphaOne = _mm_setr_epi32(0, 0, 0, 1);
+
+        // the totals of the channels 0, 2 and 1, 3 in 64-bit lanes
+        __m128i totals02 = zero;
+        __m128i totals13 = zero;
+
+        while (nPixels--) {
+            const quint16 *pixel = reinterpret_cast<const quint16*>(source.getPixel());
+            const qint64 alphaTimesWeight = qint64(pixel[3]) * weightsWrapper.weight();
+
+            if (alphaTimesWeight >= 0) {
+                __m128i color = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel));
+                color = _mm_unpacklo_epi16(color, zero);
+                color = _mm_or_si128(_mm_and_si128(color, colorMask), alphaOne);
+
+                const __m128i weight = _mm_set1_epi32(int(alphaTimesWeight));
+
+                totals02 = _mm_add_epi64(totals02, _mm_mul_epu32(color, weight));
+                totals13 = _mm_add_epi64(totals13, _mm_mul_epu32(_mm_srli_epi64(color, 32), weight));
+            } else {
+                for (int ch = 0; ch < 3; ch++) {
+                    BaseClass::m_totals[ch] += pixel[ch] * alphaTimesWeight;
+                }
+                BaseClass::m_totalAlpha += alphaTimesWeight;
+            }
+
+            source.nextPixel();
+            weightsWrapper.nextPixel();
+        }
+
+        qint64 sums02[2];
+        qint64 sums13[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums02), totals02);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums13), totals13);
+
+        BaseClass::m_totals[0] += sums02[0];
+        BaseClass::m_totals[1] += sums13[0];
+        BaseClass::m_totals[2] += sums02[1];
+        BaseClass::m_totalAlpha += sums13[1];
+    }
+};
+
+template<class _CSTrait>
+class KoMixColorsAccumulatorF32x4 : public KoMixColorsScalarAccumulator<_CSTrait>
+{
+    typedef KoMixColorsScalarAccumulator<_CSTrait> BaseClass;
+
+public:
+    template<class AbstractSource, class WeightsWrapper>
+    void accumulate(AbstractSource &source, WeightsWrapper &weightsWrapper, int nPixels) {
+        const __m128d one = _mm_set1_pd(1.0);
+
+        // the totals are summed up in doubles, like in the scalar version
+        __m128d totals01 = _mm_setzero_pd();
+        __m128d totals23 = _mm_setzero_pd();
+
+        while (nPixels--) {
+            const float *pixel = reinterpret_cast<const float*>(source.getPixel());
+            const double alphaTimesWeight = double(pixel[3]) * weightsWrapper.weight();
+
+            const __m128 color = _mm_loadu_ps(pixel);
+            const __m128d color01 = _mm_cvtps_pd(color);
+
+            // the alpha lane is replaced with 1, so that it sums up alphaTimesWeight
+            const __m128d color23 = _mm_move_sd(one, _mm_cvtps_pd(_mm_movehl_ps(color, color)));
+
+            const __m128d weight = _mm_set1_pd(alphaTimesWeight);
+
+            totals01 = _mm_add_pd(totals01, _mm_mul_pd(color01, weight));
+            totals23 = _mm_add_pd(totals23, _mm_mul_pd(color23, weight));
+
+            source.nextPixel();
+            weightsWrapper.nextPixel();
+        }
+
+        double sums[4];
+        _mm_storeu_pd(sums, totals01);
+        _mm_storeu_pd(sums + 2, totals23);
+
+        for (int ch = 0; ch < 3; ch++) {
+            BaseClass::m_totals[ch] += sums[ch];
+        }
+        BaseClass::m_totalAlpha += sums[3];
+    }
+};
+
+#endif /* __SSE2__ */
+
+/**
+ * Selects the fastest accumulator available for the color space
+ */
+template<class _CSTrait,
+         typename channels_type = typename _CSTrait::channels_type,
+         bool hasFourChannelsAndAlphaLast = _CSTrait::channels_nb == 4 && _CSTrait::alpha_pos == 3>
+struct KoMixColorsAccumulatorSelector {
+    typedef KoMixColorsScalarAccumulator<_CSTrait> type;
+};
+
+#ifdef __SSE2__
+
+template<class _CSTrait>
+struct KoMixColorsAccumulatorSelector<_CSTrait, quint8, true> {
+    typedef KoMixColorsAccumulatorU8x4<_CSTrait> type;
+};
+
+template<class _CSTrait>
+struct KoMixColorsAccumulatorSelector<_CSTrait, quint16, true> {
+    typedef KoMixColorsAccumulatorU16x4<_CSTrait> type;
+};
+
+template<class _CSTrait>
+struct KoMixColorsAccumulatorSelector<_CSTrait, float, true> {
+    typedef KoMixColorsAccumulatorF32x4<_CSTrait> type;
+};
+
+#endif /* __SSE2__ */
+
+#endif /* __KO_MIX_COLORS_ACCUMULATOR_H */
@@ -76,6 +76,34 @@ public:
      */
     virtual void mixColors(const quint8 * const*colors, quint32 nColors, quint8 *dst) const = 0;
     virtual void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const = 0;
+
+    /**
+     * Mix all the pixels of a rectangular area, e.g. the area under
+     * a dab, into a single color. The pixels are read directly from
+     * the buffer, so there is no need to build an array of pointers.
+     *
+     * @param colors a pointer to the top-left pixel of the area
+     * @param rowStride the distance between the rows of \p colors in bytes
+     * @param mask the weights of the pixels, e.g. a dab mask. If it is
+     *             null, all the pixels have the same weight
+     * @param maskRowStride the distance between the rows of \p mask in bytes
+     * @param rows the height of the area
+     * @param cols the width of the area
+     * @param dst the destination pixel
+     *
+     * Unlike the other overloads the weights are not required to sum
+     * up to 255, the result is normalized by the actual sum of the mask.
+     *
+     * @code
+     * mixColors(dabData, dabWidth * pixelSize,
+     *           maskData, dabWidth,
+     *           dabHeight, dabWidth,
+     *           ptrToDestinationPixel);
+     * @endcode
+     */
+    virtual void mixColors(const quint8 *colors, int rowStride,
+                           const quint8 *mask, int maskRowStride,
+                           int rows, int cols, quint8 *dst) const = 0;
 };
 
 #endif
@@ -22,8 +22,15 @@
 #define KOMIXCOLORSOPIMPL_H
 
 #include "KoMixColorsOp.h"
-
-template<class _CSTrait>
+#include "KoMixColorsAccumulator.h"
+
+/**
+ * @param _CSTrait the traits of the color space
+ * @param _Accumulator the class summing up the pixels, by default the
+ *                     vectorized one is used if it exists for the color space
+ */
+template<class _CSTrait,
+         class _Accumulator = typename KoMixColorsAccumulatorSelector<_CSTrait>::type>
 class KoMixColorsOpImpl : public KoMixColorsOp
 {
 public:
@@ -31,22 +38,56 @@ public:
     }
     ~KoMixColorsOpImpl() override { }
     void mixColors(const quint8 * const* colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(ArrayOfPointers(colors), WeightsWrapper(weights), nColors, dst);
+        mixColorsImpl(ArrayOfPointers(colors), WeightsWrapper(weights), nColors, 255, dst);
     }
 
     void mixColors(const quint8 *colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), WeightsWrapper(weights), nColors, dst);
+        mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), WeightsWrapper(weights), nColors, 255, dst);
     }
 
     void mixColors(const quint8 * const* colors, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(ArrayOfPointers(colors), NoWeightsSurrogate(nColors), nColors, dst);
+        mixColorsImpl(ArrayOfPointers(colors), NoWeightsSurrogate(), nColors, nColors, dst);
     }
 
     void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(nColors), nColors, dst);
+        mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(), nColors, nColors, dst);
+    }
+
+    void mixColors(const quint8 *colors, int rowStride,
+                   const quint8 *mask, int maskRowStride,
+                   int rows, int cols, quint8 *dst) const override {
+
+        _Accumulator accumulator;
+        qint64 sumOfWeights = 0;
+
+        for (int row = 0; row < rows; row++) {
+            PointerToArray source(colors, _CSTrait::pixelSize);
+
+            if (mask) {
+                MaskWrapper weights(mask);
+                accumulator.accumulate(source, weights, cols);
+
+                for (int col = 0; col < cols; col++) {
+                    sumOfWeights += mask[col];
+                }
+
+                mask += maskRowStride;
+            } else {
+                NoWeightsSurrogate weights;
+                accumulator.accumulate(source, weights, cols);
+
+                sumOfWeights += cols;
+            }
+
+            colors += rowStride;
+        }
+
+        accumulator.computeMixedColor(sumOfWeights, dst);
     }
 
 private:
+    typedef typename KoMixColorsMixType<typename _CSTrait::channels_type>::type mixtype;
+
     struct ArrayOfPointers {
         ArrayOfPointers(const quint8 * const* colors)
             : m_colors(colors)
@@ -87,8 +128,6 @@ private:
 
     struct WeightsWrapper
     {
-        typedef typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype compositetype;
-
         WeightsWrapper(const qint16 *weights)
             : m_weights(weights)
         {
@@ -98,106 +137,59 @@ private:
             m_weights++;
         }
 
-        inline void premultiplyAlphaWithWeight(compositetype &alpha) const {
+        inline void premultiplyAlphaWithWeight(mixtype &alpha) const {
             alpha *= *m_weights;
         }
 
-        inline int normalizeFactor() const {
-            return 255;
+        inline int weight() const {
+            return *m_weights;
         }
 
     private:
         const qint16 *m_weights;
     };
 
-    struct NoWeightsSurrogate
+    struct MaskWrapper
     {
-        typedef typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype compositetype;
-
-        NoWeightsSurrogate(int numPixels)
-            : m_numPixles(numPixels)
+        MaskWrapper(const quint8 *mask)
+            : m_mask(mask)
         {
         }
 
         inline void nextPixel() {
+            m_mask++;
         }
 
-        inline void premultiplyAlphaWithWeight(compositetype &) const {
+        inline void premultiplyAlphaWithWeight(mixtype &alpha) const {
+            alpha *= *m_mask;
         }
 
-        inline int normalizeFactor() const {
-            return m_numPixles;
+        inline int weight() const {
+            return *m_mask;
         }
 
     private:
-        const int m_numPixles;
+        const quint8 *m_mask;
     };
 
-    template<class AbstractSource, class WeightsWrapper>
-    void mixColorsImpl(AbstractSource source, WeightsWrapper weightsWrapper, quint32 nColors, quint8 *dst) const {
-        // Create and initialize to 0 the array of totals
-        typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totals[_CSTrait::channels_nb];
-        typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totalAlpha = 0;
-
-        memset(totals, 0, sizeof(totals));
-
-        // Compute the total for each channel by summing each colors multiplied by the weightlabcache
-
-        while (nColors--) {
-            const typename _CSTrait::channels_type* color = _CSTrait::nativeArray(source.getPixel());
-            typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype alphaTimesWeight;
-
-            if (_CSTrait::alpha_pos != -1) {
-                alphaTimesWeight = color[_CSTrait::alpha_pos];
-            } else {
-                alphaTimesWeight = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue;
-            }
-
-            weightsWrapper.premultiplyAlphaWithWeight(alphaTimesWeight);
-
-            for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
-                if (i != _CSTrait::alpha_pos) {
-                    totals[i] += color[i] * alphaTimesWeight;
-                }
-            }
-
-            totalAlpha += alphaTimesWeight;
-            source.nextPixel();
-            weightsWrapper.nextPixel();
+    struct NoWeightsSurrogate
+    {
+        inline void nextPixel() {
         }
 
-        // set totalAlpha to the minimum between its value and the unit value of the channels
-        const int sumOfWeights = weightsWrapper.normalizeFactor();
-
-        if (totalAlpha > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights) {
-            totalAlpha = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights;
+        inline void premultiplyAlphaWithWeight(mixtype &) const {
         }
 
-        typename _CSTrait::channels_type* dstColor = _CSTrait::nativeArray(dst);
-
-        if (totalAlpha > 0) {
-
-            for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
-                if (i != _CSTrait::alpha_pos) {
-
-                    typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype v = totals[i] / totalAlpha;
-
-                    if (v > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::max) {
-                        v = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::max;
-                    }
-                    if (v < KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::min) {
-                        v = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::min;
-                    }
-                    dstColor[ i ] = v;
-                }
-            }
-
-            if (_CSTrait::alpha_pos != -1) {
-                dstColor[ _CSTrait::alpha_pos ] = totalAlpha / sumOfWeights;
-            }
-        } else {
-            memset(dst, 0, sizeof(typename _CSTrait::channels_type) * _CSTrait::channels_nb);
+        inline int weight() const {
+            return 1;
         }
+    };
+
+    template<class AbstractSource, class WeightsWrapper>
+    void mixColorsImpl(AbstractSource source, WeightsWrapper weightsWrapper, quint32 nColors, qint64 sumOfWeights, quint8 *dst) const {
+        _Accumulator accumulator;
+        accumulator.accumulate(source, weightsWrapper, nColors);
+        accumulator.computeMixedColor(sumOfWeights, dst);
     }
 
 };
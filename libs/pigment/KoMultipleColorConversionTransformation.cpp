@@ -68,3 +68,11 @@ void KoMultipleColorConversionTransformation::transform(const quint8 *src, quint
     delete [] buff2;
     delete [] buff1;
 }
+
+bool KoMultipleColorConversionTransformation::isThreadSafe() const
+{
+    Q_FOREACH (KoColorConversionTransformation* transfo, d->transfos) {
+        if (!transfo->isThreadSafe()) return false;
+    }
+    return true;
+}
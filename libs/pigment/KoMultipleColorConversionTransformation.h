@@ -50,6 +50,10 @@ public:
      */
     void appendTransfo(KoColorConversionTransformation* transfo);
     void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override;
+    /**
+     * The chain is thread safe when all its transformations are
+     */
+    bool isThreadSafe() const override;
 private:
     struct Private;
     Private* const d;
@@ -19,8 +19,12 @@
 #include "KoColorSpacesBenchmark.h"
 
 #include <QTest>
+#include <QElapsedTimer>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
+#include <KoColorSpaceEngine.h>
+#include <KoColorModelStandardIds.h>
+#include <KoFastColorConversionTransformation.h>
 
 #define NB_PIXELS 1000000
 
@@ -146,4 +150,101 @@ void KoColorSpacesBenchmark::benchmarkSetAlpha2IndividualCall()
     END_BENCHMARK
 }
 
+namespace {
+void addConversionRows(const QString &name,
+                       const KoID &srcDepthId, const QString &srcProfile,
+                       const KoID &dstDepthId, const QString &dstProfile)
+{
+    QTest::newRow(QString("%1 fast").arg(name).toLatin1().data())
+        << srcDepthId.id() << srcProfile << dstDepthId.id() << dstProfile << false;
+    QTest::newRow(QString("%1 lcms").arg(name).toLatin1().data())
+        << srcDepthId.id() << srcProfile << dstDepthId.id() << dstProfile << true;
+}
+}
+
+void KoColorSpacesBenchmark::benchmarkConversion_data()
+{
+    QTest::addColumn<QString>("srcDepthID");
+    QTest::addColumn<QString>("srcProfile");
+    QTest::addColumn<QString>("dstDepthID");
+    QTest::addColumn<QString>("dstProfile");
+    QTest::addColumn<bool>("useEngine");
+
+    const QString srgb("sRGB-elle-V2-srgbtrc.icc");
+    const QString linear("sRGB-elle-V2-g10.icc");
+
+    addConversionRows("depth U8->U16", Integer8BitsColorDepthID, srgb, Integer16BitsColorDepthID, srgb);
+    addConversionRows("depth U16->U8", Integer16BitsColorDepthID, srgb, Integer8BitsColorDepthID, srgb);
+    addConversionRows("depth U8->F32", Integer8BitsColorDepthID, srgb, Float32BitsColorDepthID, srgb);
+    addConversionRows("depth F32->U8", Float32BitsColorDepthID, srgb, Integer8BitsColorDepthID, srgb);
+    addConversionRows("depth U16->F32", Integer16BitsColorDepthID, srgb, Float32BitsColorDepthID, srgb);
+    addConversionRows("depth F32->U16", Float32BitsColorDepthID, srgb, Integer16BitsColorDepthID, srgb);
+    addConversionRows("depth F16->F32", Float16BitsColorDepthID, srgb, Float32BitsColorDepthID, srgb);
+    addConversionRows("depth F32->F16", Float32BitsColorDepthID, srgb, Float16BitsColorDepthID, srgb);
+
+    addConversionRows("trc U8 sRGB->U8 linear", Integer8BitsColorDepthID, srgb, Integer8BitsColorDepthID, linear);
+    addConversionRows("trc U8 sRGB->U16 linear", Integer8BitsColorDepthID, srgb, Integer16BitsColorDepthID, linear);
+    addConversionRows("trc U16 sRGB->F32 linear", Integer16BitsColorDepthID, srgb, Float32BitsColorDepthID, linear);
+    addConversionRows("trc U16 linear->U16 sRGB", Integer16BitsColorDepthID, linear, Integer16BitsColorDepthID, srgb);
+    addConversionRows("trc U16 linear->U8 sRGB", Integer16BitsColorDepthID, linear, Integer8BitsColorDepthID, srgb);
+}
+
+void KoColorSpacesBenchmark::benchmarkConversion()
+{
+    QFETCH(QString, srcDepthID);
+    QFETCH(QString, srcProfile);
+    QFETCH(QString, dstDepthID);
+    QFETCH(QString, dstProfile);
+    QFETCH(bool, useEngine);
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcColorSpace = registry->colorSpace(RGBAColorModelID.id(), srcDepthID, srcProfile);
+    const KoColorSpace *dstColorSpace = registry->colorSpace(RGBAColorModelID.id(), dstDepthID, dstProfile);
+
+    if (!srcColorSpace || !dstColorSpace) {
+        QSKIP("The color space is not available");
+    }
+
+    const KoColorConversionTransformation::Intent intent = KoColorConversionTransformation::internalRenderingIntent();
+    const KoColorConversionTransformation::ConversionFlags flags = KoColorConversionTransformation::internalConversionFlags();
+
+    QScopedPointer<KoColorConversionTransformation> transfo;
+
+    if (useEngine) {
+        KoColorSpaceEngine *engine = KoColorSpaceEngineRegistry::instance()->get("icc");
+        QVERIFY(engine);
+        transfo.reset(engine->createColorTransformation(srcColorSpace, dstColorSpace, intent, flags));
+    } else {
+        transfo.reset(registry->createColorConverter(srcColorSpace, dstColorSpace, intent, flags));
+        QVERIFY(dynamic_cast<KoFastColorConversionTransformation*>(transfo.data()));
+    }
+
+    // fill the source with valid values of the source color space
+    const KoColorSpace *rgb8 = registry->rgb8(srcProfile);
+    QVector<quint8> noise(NB_PIXELS * rgb8->pixelSize());
+    for (int i = 0; i < noise.size(); i++) {
+        noise[i] = (i * 7919) & 0xff;
+    }
+
+    QVector<quint8> src(NB_PIXELS * srcColorSpace->pixelSize());
+    QVector<quint8> dst(NB_PIXELS * dstColorSpace->pixelSize());
+    rgb8->convertPixelsTo(noise.constData(), src.data(), srcColorSpace, NB_PIXELS, intent, flags);
+
+    const int numRuns = 10;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < numRuns; i++) {
+        transfo->transform(src.constData(), dst.data(), NB_PIXELS);
+    }
+
+    qDebug() << QTest::currentDataTag() << "throughput:"
+             << qreal(NB_PIXELS) * numRuns / (timer.nsecsElapsed() * 1e-3) << "Mpx/s";
+
+    QBENCHMARK {
+        transfo->transform(src.constData(), dst.data(), NB_PIXELS);
+    }
+}
+
 QTEST_MAIN(KoColorSpacesBenchmark)
@@ -23,7 +23,9 @@
 #include <KoOptimizedCompositeOpFactory.h>
 
 #include <KoColorSpaceTraits.h>
+#include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoCompositeOp.h>
 
 #include <QTest>
 
@@ -87,5 +89,45 @@ void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarken()
     }
 }
 
+void KoCompositeOpsBenchmark::benchmarkAllCompositeOps_data()
+{
+    QTest::addColumn<QString>("colorModelId");
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<QString>("compositeOpId");
+
+    QList<const KoColorSpace*> colorSpaces;
+    colorSpaces << KoColorSpaceRegistry::instance()->rgb8();
+    colorSpaces << KoColorSpaceRegistry::instance()->rgb16();
+
+    Q_FOREACH (const KoColorSpace *cs, colorSpaces) {
+        Q_FOREACH (const KoCompositeOp *op, cs->compositeOps()) {
+            QTest::newRow(QString("%1 %2").arg(cs->id()).arg(op->id()).toLatin1())
+                << cs->colorModelId().id() << cs->colorDepthId().id() << op->id();
+        }
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkAllCompositeOps()
+{
+    QFETCH(QString, colorModelId);
+    QFETCH(QString, colorDepthId);
+    QFETCH(QString, compositeOpId);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(colorModelId, colorDepthId);
+    const KoCompositeOp *compositeOp = cs->compositeOp(compositeOpId);
+
+    // the blending modes have branches, so the data should not be uniform
+    qsrand(1);
+    for (int i = 0; i < TILE_WIDTH * TILE_HEIGHT * KoBgrU16Traits::pixelSize; i++) {
+        m_dstBuffer[i] = qrand() & 0xff;
+        m_srcBuffer[i] = qrand() & 0xff;
+    }
+
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK
+    }
+}
+
 
 QTEST_GUILESS_MAIN(KoCompositeOpsBenchmark)
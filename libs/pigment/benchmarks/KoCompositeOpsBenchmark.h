@@ -33,6 +33,9 @@ private Q_SLOTS:
     void benchmarkCompositeOver();
     void benchmarkCompositeAlphaDarken();
 
+    void benchmarkAllCompositeOps_data();
+    void benchmarkAllCompositeOps();
+
 private:
     quint8 * m_dstBuffer;
     quint8 * m_srcBuffer;
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoMixColorsOpBenchmark.h"
+
+#include <KoColorSpaceTraits.h>
+#include <KoMixColorsOpImpl.h>
+
+#include <QTest>
+#include <QVector>
+
+const int DAB_SIZE = 64;
+const int DABS_IN_ROW = 8;
+const int AREA_SIZE = DAB_SIZE * DABS_IN_ROW;
+
+enum MixMode {
+    ScalarPointers,
+    VectorizedPointers,
+    VectorizedArea,
+    VectorizedAreaMasked
+};
+
+Q_DECLARE_METATYPE(MixMode)
+
+template <class Traits>
+void benchmarkMixColorsImpl(MixMode mode)
+{
+    typedef typename Traits::channels_type channels_type;
+
+    KoMixColorsOpImpl<Traits, KoMixColorsScalarAccumulator<Traits>> scalarOp;
+    KoMixColorsOpImpl<Traits> vectorizedOp;
+
+    QVector<quint8> area(AREA_SIZE * AREA_SIZE * Traits::pixelSize);
+
+    qsrand(1);
+    for (int i = 0; i < AREA_SIZE * AREA_SIZE * (int)Traits::channels_nb; i++) {
+        reinterpret_cast<channels_type*>(area.data())[i] =
+            channels_type(KoColorSpaceMathsTraits<channels_type>::unitValue * (qrand() % 1000) / 999);
+    }
+
+    // a round dab, like the one used for sampling the color under the brush
+    QVector<quint8> mask(DAB_SIZE * DAB_SIZE);
+    const qreal radius = 0.5 * DAB_SIZE;
+    for (int y = 0; y < DAB_SIZE; y++) {
+        for (int x = 0; x < DAB_SIZE; x++) {
+            const qreal dx = x + 0.5 - radius;
+            const qreal dy = y + 0.5 - radius;
+            mask[y * DAB_SIZE + x] = dx * dx + dy * dy < radius * radius ? 255 : 0;
+        }
+    }
+
+    const int rowStride = AREA_SIZE * Traits::pixelSize;
+    QVector<const quint8*> pixelPtrs;
+    pixelPtrs.reserve(DAB_SIZE * DAB_SIZE);
+
+    quint8 result[Traits::pixelSize];
+
+    QBENCHMARK {
+        for (int dabY = 0; dabY < DABS_IN_ROW; dabY++) {
+            for (int dabX = 0; dabX < DABS_IN_ROW; dabX++) {
+                const quint8 *dabData =
+                    area.constData() + dabY * DAB_SIZE * rowStride + dabX * DAB_SIZE * Traits::pixelSize;
+
+                if (mode == VectorizedArea) {
+                    vectorizedOp.mixColors(dabData, rowStride, 0, 0, DAB_SIZE, DAB_SIZE, result);
+                } else if (mode == VectorizedAreaMasked) {
+                    vectorizedOp.mixColors(dabData, rowStride, mask.constData(), DAB_SIZE, DAB_SIZE, DAB_SIZE, result);
+                } else {
+                    // that is what the callers had to do before the area mixing was available
+                    pixelPtrs.clear();
+                    for (int y = 0; y < DAB_SIZE; y++) {
+                        for (int x = 0; x < DAB_SIZE; x++) {
+                            if (mask[y * DAB_SIZE + x]) {
+                                pixelPtrs << dabData + y * rowStride + x * Traits::pixelSize;
+                            }
+                        }
+                    }
+
+                    const KoMixColorsOp *op = mode == ScalarPointers ?
+                        static_cast<const KoMixColorsOp*>(&scalarOp) :
+                        static_cast<const KoMixColorsOp*>(&vectorizedOp);
+
+                    op->mixColors(pixelPtrs.constData(), pixelPtrs.size(), result);
+                }
+            }
+        }
+    }
+}
+
+void KoMixColorsOpBenchmark::benchmarkMixColors_data()
+{
+    QTest::addColumn<QString>("depth");
+    QTest::addColumn<MixMode>("mode");
+
+    QStringList depths;
+    depths << "U8" << "U16" << "F32";
+
+    Q_FOREACH (const QString &depth, depths) {
+        QTest::newRow(QString("%1 scalar pointers").arg(depth).toLatin1()) << depth << ScalarPointers;
+        QTest::newRow(QString("%1 vectorized pointers").arg(depth).toLatin1()) << depth << VectorizedPointers;
+        QTest::newRow(QString("%1 vectorized area").arg(depth).toLatin1()) << depth << VectorizedArea;
+        QTest::newRow(QString("%1 vectorized area masked").arg(depth).toLatin1()) << depth << VectorizedAreaMasked;
+    }
+}
+
+void KoMixColorsOpBenchmark::benchmarkMixColors()
+{
+    QFETCH(QString, depth);
+    QFETCH(MixMode, mode);
+
+    if (depth == "U8") {
+        benchmarkMixColorsImpl<KoBgrU8Traits>(mode);
+    } else if (depth == "U16") {
+        benchmarkMixColorsImpl<KoBgrU16Traits>(mode);
+    } else {
+        benchmarkMixColorsImpl<KoRgbF32Traits>(mode);
+    }
+}
+
+QTEST_GUILESS_MAIN(KoMixColorsOpBenchmark)
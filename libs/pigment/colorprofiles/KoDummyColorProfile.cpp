@@ -79,6 +79,10 @@ bool KoDummyColorProfile::hasTRC() const
 {
     return true;
 }
+bool KoDummyColorProfile::isMatrixShaper() const
+{
+    return false;
+}
 QVector<double> KoDummyColorProfile::getColorantsXYZ() const
 {
     QVector<double> d50Dummy(3);
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_OPTIMIZED_COMPOSITE_OP_ALPHA_DARKEN64_H
+#define __KO_OPTIMIZED_COMPOSITE_OP_ALPHA_DARKEN64_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+
+
+/**
+ * The compositor of the ALPHA DARKEN op for 8 byte colorspaces. The
+ * math is the same as in AlphaDarkenCompositor128, the channels are
+ * converted into normalized floats on load and back on store.
+ *
+ * \p channels_type is quint16 or half
+ */
+template<typename channels_type>
+struct AlphaDarkenCompositor64 {
+    struct OptionalParams {
+        OptionalParams(const KoCompositeOp::ParameterInfo& params)
+        : flow(params.flow)
+        , averageOpacity(*params.lastOpacity * params.flow)
+        , premultipliedOpacity(params.opacity * params.flow)
+        {
+        }
+        float flow;
+        float averageOpacity;
+        float premultipliedOpacity;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+        Vc::float_v src_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<channels_type>(src, src_c1, src_c2, src_c3, src_alpha);
+
+        Vc::float_v msk_norm_alpha;
+        if (haveMask) {
+            const Vc::float_v uint8Rec1(1.0f / 255.0f);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            msk_norm_alpha = mask_vec * uint8Rec1 * src_alpha;
+        }
+        else {
+            msk_norm_alpha = src_alpha;
+        }
+
+        // we don't use directly passed value
+        Q_UNUSED(opacity);
+
+        // instead we should use opacity premultiplied by flow
+        opacity = oparams.premultipliedOpacity;
+        Vc::float_v opacity_vec(oparams.premultipliedOpacity);
+
+        src_alpha = msk_norm_alpha * opacity_vec;
+
+        const Vc::float_v zeroValue(Vc::Zero);
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+        Vc::float_v dst_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<channels_type>(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+
+        Vc::float_m empty_dst_pixels_mask = dst_alpha == zeroValue;
+
+        if (!empty_dst_pixels_mask.isFull()) {
+            if (empty_dst_pixels_mask.isEmpty()) {
+                dst_c1 = (src_c1 - dst_c1) * src_alpha + dst_c1;
+                dst_c2 = (src_c2 - dst_c2) * src_alpha + dst_c2;
+                dst_c3 = (src_c3 - dst_c3) * src_alpha + dst_c3;
+            }
+            else {
+                dst_c1(empty_dst_pixels_mask) = src_c1;
+                dst_c2(empty_dst_pixels_mask) = src_c2;
+                dst_c3(empty_dst_pixels_mask) = src_c3;
+                Vc::float_m not_empty_dst_pixels_mask = !empty_dst_pixels_mask;
+                dst_c1(not_empty_dst_pixels_mask) = (src_c1 - dst_c1) * src_alpha + dst_c1;
+                dst_c2(not_empty_dst_pixels_mask) = (src_c2 - dst_c2) * src_alpha + dst_c2;
+                dst_c3(not_empty_dst_pixels_mask) = (src_c3 - dst_c3) * src_alpha + dst_c3;
+            }
+        }
+        else {
+            dst_c1 = src_c1;
+            dst_c2 = src_c2;
+            dst_c3 = src_c3;
+        }
+
+        Vc::float_v fullFlowAlpha(dst_alpha);
+
+        if (oparams.averageOpacity > opacity) {
+            Vc::float_v average_opacity_vec(oparams.averageOpacity);
+            Vc::float_m fullFlowAlpha_mask = average_opacity_vec > dst_alpha;
+            fullFlowAlpha(fullFlowAlpha_mask) = (average_opacity_vec - src_alpha) * (dst_alpha / average_opacity_vec) + src_alpha;
+        }
+        else {
+            Vc::float_m fullFlowAlpha_mask = opacity_vec > dst_alpha;
+            fullFlowAlpha(fullFlowAlpha_mask) = (opacity_vec - dst_alpha) * msk_norm_alpha + dst_alpha;
+        }
+
+        if (oparams.flow == 1.0) {
+            dst_alpha = fullFlowAlpha;
+        }
+        else {
+            Vc::float_v zeroFlowAlpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+            Vc::float_v flow_norm_vec(oparams.flow);
+            dst_alpha = (fullFlowAlpha - zeroFlowAlpha) * flow_norm_vec + zeroFlowAlpha;
+        }
+
+        KoStreamedMath<_impl>::template write_pixels_64<channels_type>(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+    }
+
+    /**
+     * Composes one pixel of the source into the destination
+     */
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        using namespace Arithmetic;
+        const qint32 alpha_pos = 3;
+
+        const channels_type *s = reinterpret_cast<const channels_type*>(src);
+        channels_type *d = reinterpret_cast<channels_type*>(dst);
+
+        float srcPixel[4];
+        float dstPixel[4];
+        KoStreamedMath<_impl>::channels_to_float(s, srcPixel, 4);
+        KoStreamedMath<_impl>::channels_to_float(d, dstPixel, 4);
+
+        float dstAlphaNorm = dstPixel[alpha_pos];
+
+        const float uint8Rec1 = 1.0f / 255.0f;
+        float mskAlphaNorm = haveMask ? float(*mask) * uint8Rec1 * srcPixel[alpha_pos] : srcPixel[alpha_pos];
+
+        Q_UNUSED(opacity);
+        opacity = oparams.premultipliedOpacity;
+
+        float srcAlphaNorm = mskAlphaNorm * opacity;
+
+        for (int i = 0; i < 3; i++) {
+            dstPixel[i] = dstAlphaNorm != 0.0f ?
+                lerp(dstPixel[i], srcPixel[i], srcAlphaNorm) : srcPixel[i];
+        }
+
+        float flow = oparams.flow;
+        float averageOpacity = oparams.averageOpacity;
+
+        float fullFlowAlpha;
+
+        if (averageOpacity > opacity) {
+            fullFlowAlpha = averageOpacity > dstAlphaNorm ? lerp(srcAlphaNorm, averageOpacity, dstAlphaNorm / averageOpacity) : dstAlphaNorm;
+        } else {
+            fullFlowAlpha = opacity > dstAlphaNorm ? lerp(dstAlphaNorm, opacity, mskAlphaNorm) : dstAlphaNorm;
+        }
+
+        if (flow == 1.0) {
+            dstPixel[alpha_pos] = fullFlowAlpha;
+        } else {
+            float zeroFlowAlpha = unionShapeOpacity(srcAlphaNorm, dstAlphaNorm);
+            dstPixel[alpha_pos] = lerp(zeroFlowAlpha, fullFlowAlpha, flow);
+        }
+
+        KoStreamedMath<_impl>::float_to_channels(dstPixel, d, 4);
+    }
+};
+
+/**
+ * An optimized version of a composite op for the use in 8 byte
+ * colorspaces (16-bit integer or half float channels) with alpha
+ * channel placed at the last position of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, typename channels_type>
+class KoOptimizedCompositeOpAlphaDarken64 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpAlphaDarken64(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_ALPHA_DARKEN, i18n("Alpha darken"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            KoStreamedMath<_impl>::template genericComposite64<true, true, AlphaDarkenCompositor64<channels_type> >(params);
+        } else {
+            KoStreamedMath<_impl>::template genericComposite64<false, true, AlphaDarkenCompositor64<channels_type> >(params);
+        }
+    }
+};
+
+#endif /* __KO_OPTIMIZED_COMPOSITE_OP_ALPHA_DARKEN64_H */
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_OPTIMIZED_COMPOSITE_OP_COPY64_H
+#define __KO_OPTIMIZED_COMPOSITE_OP_COPY64_H
+
+#include <string.h>
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+
+
+/**
+ * The compositor of the COPY op for 8 byte colorspaces. Follows the
+ * math of KoCompositeOpCopy2: the destination is replaced with the
+ * source, when the opacity (or the mask) is partial, the channels are
+ * blended in premultiplied form.
+ *
+ * \p channels_type is quint16 or half
+ */
+template<typename channels_type, bool alphaLocked, bool allChannelsFlag>
+struct CopyCompositor64 {
+    struct OptionalParams {
+        OptionalParams(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v blend(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+            blend *= KoStreamedMath<_impl>::fetch_mask_8(mask) * uint8MaxRec1;
+        }
+
+        if ((blend == zeroValue).isFull()) {
+            return;
+        }
+
+        // the pixels are just copied, no conversion is needed
+        if ((blend == oneValue).isFull()) {
+            memcpy(dst, src, 8 * Vc::float_v::size());
+            return;
+        }
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+        Vc::float_v src_alpha;
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+        Vc::float_v dst_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<channels_type>(src, src_c1, src_c2, src_c3, src_alpha);
+        KoStreamedMath<_impl>::template fetch_pixels_64<channels_type>(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+
+        const Vc::float_v new_alpha = (src_alpha - dst_alpha) * blend + dst_alpha;
+
+        /**
+         * The colors of the pixels with zero resulting alpha are
+         * undefined, such pixels are left untouched, the same happens
+         * to the pixels with zero opacity
+         */
+        const Vc::float_m keepDst = new_alpha == zeroValue || blend == zeroValue;
+        const Vc::float_m copySrc = blend == oneValue;
+        const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+        dst_c1 = Vc::iif(copySrc, src_c1, Vc::iif(keepDst, dst_c1, ((src_c1 * src_alpha - dst_c1 * dst_alpha) * blend + dst_c1 * dst_alpha) * new_alpha_rec));
+        dst_c2 = Vc::iif(copySrc, src_c2, Vc::iif(keepDst, dst_c2, ((src_c2 * src_alpha - dst_c2 * dst_alpha) * blend + dst_c2 * dst_alpha) * new_alpha_rec));
+        dst_c3 = Vc::iif(copySrc, src_c3, Vc::iif(keepDst, dst_c3, ((src_c3 * src_alpha - dst_c3 * dst_alpha) * blend + dst_c3 * dst_alpha) * new_alpha_rec));
+        dst_alpha = Vc::iif(copySrc, src_alpha, Vc::iif(keepDst, dst_alpha, new_alpha));
+
+        KoStreamedMath<_impl>::template write_pixels_64<channels_type>(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const channels_type *s = reinterpret_cast<const channels_type*>(src);
+        channels_type *d = reinterpret_cast<channels_type*>(dst);
+
+        float blend = opacity;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0f / 255.0f;
+            blend *= float(*mask) * uint8Rec1;
+        }
+
+        if (allChannelsFlag && !alphaLocked && blend == 1.0f) {
+            KoStreamedMathFunctions::copyPixel<8>(src, dst);
+            return;
+        }
+
+        float srcPixel[4];
+        float dstPixel[4];
+        KoStreamedMath<_impl>::channels_to_float(s, srcPixel, 4);
+        KoStreamedMath<_impl>::channels_to_float(d, dstPixel, 4);
+
+        if (!allChannelsFlag && dstPixel[alpha_pos] == 0.0f) {
+            KoStreamedMathFunctions::clearPixel<8>(dst);
+            dstPixel[0] = dstPixel[1] = dstPixel[2] = 0.0f;
+        }
+
+        const float srcAlpha = srcPixel[alpha_pos];
+        const float dstAlpha = dstPixel[alpha_pos];
+        float newAlpha = 0.0f;
+
+        if (blend == 1.0f) {
+            if (!alphaLocked || srcAlpha != 0.0f) {
+                for (int i = 0; i < 3; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        dstPixel[i] = srcPixel[i];
+                    }
+                }
+            }
+
+            newAlpha = srcAlpha;
+
+        } else if (blend == 0.0f) {
+
+            newAlpha = dstAlpha;
+
+        } else if (!alphaLocked || srcAlpha != 0.0f) {
+
+            newAlpha = (srcAlpha - dstAlpha) * blend + dstAlpha;
+
+            if (newAlpha != 0.0f) {
+                for (int i = 0; i < 3; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        const float dstMult = dstPixel[i] * dstAlpha;
+                        const float srcMult = srcPixel[i] * srcAlpha;
+                        dstPixel[i] = ((srcMult - dstMult) * blend + dstMult) / newAlpha;
+                    }
+                }
+            }
+        }
+
+        dstPixel[alpha_pos] = alphaLocked ? dstAlpha : newAlpha;
+
+        KoStreamedMath<_impl>::float_to_channels(dstPixel, d, 4);
+    }
+};
+
+/**
+ * An optimized version of KoCompositeOpCopy2 for the use in 8 byte
+ * colorspaces (16-bit integer or half float channels) with alpha
+ * channel placed at the last position of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, typename channels_type>
+class KoOptimizedCompositeOpCopy64 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpCopy64(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_COPY, i18n("Copy"), KoCompositeOp::categoryMisc()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite64<haveMask, false, CopyCompositor64<channels_type, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, CopyCompositor64<channels_type, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, CopyCompositor64<channels_type, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, CopyCompositor64<channels_type, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif /* __KO_OPTIMIZED_COMPOSITE_OP_COPY64_H */
@@ -44,3 +44,65 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpU16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpAlphaDarken64, quint16> >(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOpU16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpOver64, quint16> >(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createCopyOpU16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpCopy64, quint16> >(cs);
+}
+
+#ifdef HAVE_OPENEXR
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpAlphaDarken64, half> >(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOpF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpOver64, half> >(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createCopyOpF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpCopy64, half> >(cs);
+}
+
+#endif /* HAVE_OPENEXR */
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp32(const KoColorSpace *cs,
+                                                                const QString &id,
+                                                                const QString &description,
+                                                                const QString &category)
+{
+    KoOptimizedGenericOpInfo info;
+    info.colorSpace = cs;
+    info.id = id;
+    info.description = description;
+    info.category = category;
+
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch32>(info);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOpU16(const KoColorSpace *cs,
+                                                                 const QString &id,
+                                                                 const QString &description,
+                                                                 const QString &category)
+{
+    KoOptimizedGenericOpInfo info;
+    info.colorSpace = cs;
+    info.id = id;
+    info.description = description;
+    info.category = category;
+
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch64>(info);
+}
@@ -22,8 +22,11 @@
 
 #include "kritapigment_export.h"
 
+#include <KoConfig.h>
+
 class KoCompositeOp;
 class KoColorSpace;
+class QString;
 
 /**
  * The creation of the optimized composite ops is moved into a separate
@@ -44,6 +47,42 @@ public:
     static KoCompositeOp* createOverOp32(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOp128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+    /**
+     * The ops for 8 byte colorspaces: RGBA with 16-bit integer
+     * channels (BGR order) and with half float channels (RGB order)
+     */
+    static KoCompositeOp* createAlphaDarkenOpU16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpU16(const KoColorSpace *cs);
+    static KoCompositeOp* createCopyOpU16(const KoColorSpace *cs);
+
+#ifdef HAVE_OPENEXR
+    static KoCompositeOp* createAlphaDarkenOpF16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpF16(const KoColorSpace *cs);
+    static KoCompositeOp* createCopyOpF16(const KoColorSpace *cs);
+#endif
+
+    /**
+     * Creates a vectorized version of the generic composite op
+     * (KoCompositeOpGenericSC or KoCompositeOpGenericHSL) with \p id
+     * for 4 byte BGRA colorspaces.
+     *
+     * Returns null if the op with this id is not vectorized or the
+     * vectorization is not available.
+     */
+    static KoCompositeOp* createGenericOp32(const KoColorSpace *cs,
+                                            const QString &id,
+                                            const QString &description,
+                                            const QString &category);
+
+    /**
+     * The same as createGenericOp32(), but for 8 byte BGRA colorspaces
+     * with 16-bit integer channels
+     */
+    static KoCompositeOp* createGenericOpU16(const KoColorSpace *cs,
+                                             const QString &id,
+                                             const QString &description,
+                                             const QString &category);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
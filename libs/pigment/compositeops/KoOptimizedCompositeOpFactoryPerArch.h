@@ -23,6 +23,12 @@
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
 
+#include <QString>
+
+#include <KoConfig.h>
+#ifdef HAVE_OPENEXR
+#include <half.h>
+#endif
 
 class KoCompositeOp;
 class KoColorSpace;
@@ -40,6 +46,15 @@ class KoOptimizedCompositeOpAlphaDarken128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+template<Vc::Implementation _impl, typename channels_type>
+class KoOptimizedCompositeOpAlphaDarken64;
+
+template<Vc::Implementation _impl, typename channels_type>
+class KoOptimizedCompositeOpOver64;
+
+template<Vc::Implementation _impl, typename channels_type>
+class KoOptimizedCompositeOpCopy64;
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -50,5 +65,50 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+/**
+ * The ops for 8 byte colorspaces are shared between the 16-bit
+ * integer and the half float ones, so they are additionally
+ * parametrized with the type of the channel
+ */
+template<template<Vc::Implementation I, typename T> class CompositeOp, typename channels_type>
+struct KoOptimizedCompositeOpFactoryPerArch64
+{
+    typedef const KoColorSpace* ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
+
+/**
+ * The generic composite ops are selected by their id, the rest
+ * of the fields are passed to the constructor of the op
+ */
+struct KoOptimizedGenericOpInfo
+{
+    const KoColorSpace *colorSpace;
+    QString id;
+    QString description;
+    QString category;
+};
+
+struct KoOptimizedGenericCompositeOpFactoryPerArch32
+{
+    typedef const KoOptimizedGenericOpInfo& ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
+
+struct KoOptimizedGenericCompositeOpFactoryPerArch64
+{
+    typedef const KoOptimizedGenericOpInfo& ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
+
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
@@ -22,6 +22,7 @@
 #include "KoColorSpaceTraits.h"
 #include "KoCompositeOpAlphaDarken.h"
 #include "KoCompositeOpOver.h"
+#include "KoCompositeOpCopy2.h"
 
 
 template<>
@@ -55,3 +56,75 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoCompositeOpOver<KoRgbF32Traits>(param);
 }
+
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch32::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch32::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+
+    // the caller falls back to the generic ops
+    return 0;
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpAlphaDarken64, quint16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpAlphaDarken64, quint16>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpAlphaDarken<KoBgrU16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpOver64, quint16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpOver64, quint16>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpOver<KoBgrU16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpCopy64, quint16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpCopy64, quint16>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpCopy2<KoBgrU16Traits>(param);
+}
+
+#ifdef HAVE_OPENEXR
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpAlphaDarken64, half>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpAlphaDarken64, half>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpAlphaDarken<KoRgbF16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpOver64, half>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpOver64, half>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpOver<KoRgbF16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpCopy64, half>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch64<KoOptimizedCompositeOpCopy64, half>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpCopy2<KoRgbF16Traits>(param);
+}
+
+#endif /* HAVE_OPENEXR */
+
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch64::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch64::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+
+    // the caller falls back to the generic ops
+    return 0;
+}
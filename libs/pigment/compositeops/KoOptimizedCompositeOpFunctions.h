@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_OPTIMIZED_COMPOSITE_OP_FUNCTIONS_H
+#define __KO_OPTIMIZED_COMPOSITE_OP_FUNCTIONS_H
+
+#include <cmath>
+#include <limits>
+
+#include "KoStreamedMath.h"
+
+/**
+ * The blending functions of the optimized generic composite ops.
+ *
+ * Every function is a port of the corresponding cfXXX() function from
+ * KoCompositeOpFunctions.h. The functions work on the channel values
+ * normalized into [0.0...1.0] range and are written in a branch-free
+ * way, so the same code is instantiated both for a single pixel (T is
+ * float) and for a vector of pixels (T is Vc::float_v).
+ *
+ * All the classes are templated by the Vc implementation, even when
+ * they do not depend on it, to avoid ODR violations between the
+ * objects compiled for different architectures.
+ */
+
+template<Vc::Implementation _impl>
+struct OptiBlendMath {
+    static ALWAYS_INLINE float min(float a, float b) {
+        return qMin(a, b);
+    }
+
+    static ALWAYS_INLINE Vc::float_v min(Vc::float_v::AsArg a, Vc::float_v::AsArg b) {
+        return Vc::min(a, b);
+    }
+
+    static ALWAYS_INLINE float max(float a, float b) {
+        return qMax(a, b);
+    }
+
+    static ALWAYS_INLINE Vc::float_v max(Vc::float_v::AsArg a, Vc::float_v::AsArg b) {
+        return Vc::max(a, b);
+    }
+
+    static ALWAYS_INLINE float sqrt(float a) {
+        return std::sqrt(a);
+    }
+
+    static ALWAYS_INLINE Vc::float_v sqrt(Vc::float_v::AsArg a) {
+        return Vc::sqrt(a);
+    }
+
+    static ALWAYS_INLINE float floor(float a) {
+        return std::floor(a);
+    }
+
+    static ALWAYS_INLINE Vc::float_v floor(Vc::float_v::AsArg a) {
+        return Vc::floor(a);
+    }
+
+    static ALWAYS_INLINE float abs(float a) {
+        return std::abs(a);
+    }
+
+    static ALWAYS_INLINE Vc::float_v abs(Vc::float_v::AsArg a) {
+        return Vc::abs(a);
+    }
+
+    static ALWAYS_INLINE float select(bool condition, float a, float b) {
+        return condition ? a : b;
+    }
+
+    static ALWAYS_INLINE Vc::float_v select(const Vc::float_m &condition, Vc::float_v::AsArg a, Vc::float_v::AsArg b) {
+        return Vc::iif(condition, a, b);
+    }
+
+    template<class T>
+    static ALWAYS_INLINE T clampUnit(T a) {
+        return max(T(0.0f), min(a, T(1.0f)));
+    }
+
+    /**
+     * The equivalent of cfDivide(), which is used as a building
+     * block by a few other functions
+     */
+    template<class T>
+    static ALWAYS_INLINE T divide(T src, T dst) {
+        return select(src == T(0.0f),
+                      select(dst == T(0.0f), T(0.0f), T(1.0f)),
+                      min(dst / src, T(1.0f)));
+    }
+
+    /**
+     * The exact equivalents of UINT8_MULT(), UINT8_MULT3(), UINT8_DIVIDE()
+     * and UINT8_BLEND() for the integer values stored in floats. They let
+     * the optimized ops round the intermediate values the same way as the
+     * generic ops for 8-bit colorspaces do.
+     *
+     * All the intermediate values fit into the 24 bits of the mantissa and,
+     * except UINT8_DIVIDE(), are divided by the powers of two only, so the
+     * float math gives exactly the same results as the integer one.
+     */
+    template<class T>
+    static ALWAYS_INLINE T mulU8(T a, T b) {
+        const T c = a * b + T(128.0f);
+        return floor((floor(c * T(1.0f / 256.0f)) + c) * T(1.0f / 256.0f));
+    }
+
+    template<class T>
+    static ALWAYS_INLINE T mulU8(T a, T b, T c) {
+        const T t = a * b * c + T(32603.0f);
+        return floor((floor(t * T(1.0f / 128.0f)) + t) * T(1.0f / 65536.0f));
+    }
+
+    template<class T>
+    static ALWAYS_INLINE T divU8(T a, T b) {
+        return floor((a * T(255.0f) + floor(b * T(0.5f))) / b);
+    }
+
+    template<class T>
+    static ALWAYS_INLINE T lerpU8(T a, T b, T alpha) {
+        const T c = (b - a) * alpha + T(128.0f);
+        return floor((floor(c * T(1.0f / 256.0f)) + c) * T(1.0f / 256.0f)) + a;
+    }
+
+    /**
+     * Converts a value in [0.0...1.0] range into [0.0...255.0] one
+     * the way scale<quint8>() does
+     */
+    template<class T>
+    static ALWAYS_INLINE T scaleToU8(T a) {
+        return floor(clampUnit(a) * T(255.0f) + T(0.5f));
+    }
+};
+
+/**
+ * The base class of the functions processing the color
+ * channels independently. \p Blend should implement
+ * blend(src, dst) for a single channel.
+ */
+template<class Blend>
+struct OptiSeparableBlend {
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        dr = Blend::blend(sr, dr);
+        dg = Blend::blend(sg, dg);
+        db = Blend::blend(sb, db);
+    }
+};
+
+#define DECLARE_OPTI_SEPARABLE_BLEND(name)                              \
+    template<Vc::Implementation _impl>                                  \
+    struct name : OptiSeparableBlend<name<_impl> >                      \
+    {                                                                   \
+        typedef OptiBlendMath<_impl> M;                                 \
+        template<class T>                                               \
+        static ALWAYS_INLINE T blend(T src, T dst);                     \
+    };                                                                  \
+    template<Vc::Implementation _impl>                                  \
+    template<class T>                                                   \
+    ALWAYS_INLINE T name<_impl>::blend(T src, T dst)
+
+/***************** Arithmetic ***********************************/
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendMultiply) {
+    return src * dst;
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendDivide) {
+    return M::divide(src, dst);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendAddition) {
+    return M::min(src + dst, T(1.0f));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendSubtract) {
+    return M::max(dst - src, T(0.0f));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendInverseSubtract) {
+    return M::max(dst - (T(1.0f) - src), T(0.0f));
+}
+
+/***************** Mix ******************************************/
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendHardLight) {
+    const T src2 = src + src;
+
+    return M::select(src > T(0.5f),
+                     // screen(src*2.0 - 1.0, dst)
+                     (src2 - T(1.0f)) + dst - (src2 - T(1.0f)) * dst,
+                     // multiply(src*2.0, dst)
+                     src2 * dst);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendOverlay) {
+    return OptiBlendHardLight<_impl>::blend(dst, src);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendGrainMerge) {
+    return M::clampUnit(dst + src - T(0.5f));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendGrainExtract) {
+    return M::clampUnit(dst - src + T(0.5f));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendGeometricMean) {
+    return M::sqrt(src * dst);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendParallel) {
+    // 1 / (1/src + 1/dst) with the inverse of zero being unit
+    const T one(1.0f);
+    const T s = M::select(src != T(0.0f), one / src, one);
+    const T d = M::select(dst != T(0.0f), one / dst, one);
+
+    return M::clampUnit(T(2.0f) / (d + s));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendAllanon) {
+    return (src + dst) * T(0.5f);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendHardOverlay) {
+    return M::select(src > T(0.5f),
+                     M::divide(T(2.0f) - (src + src), dst),
+                     (src + src) * dst);
+}
+
+/***************** Light ****************************************/
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendScreen) {
+    return src + dst - src * dst;
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendColorDodge) {
+    const T invSrc = T(1.0f) - src;
+
+    return M::select(dst == T(0.0f), T(0.0f),
+                     M::select(invSrc < dst, T(1.0f),
+                               M::min(dst / invSrc, T(1.0f))));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendLighten) {
+    return M::max(src, dst);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendSoftLight) {
+    const T src2 = src + src;
+
+    return M::select(src > T(0.5f),
+                     dst + (src2 - T(1.0f)) * (M::sqrt(dst) - dst),
+                     dst - (T(1.0f) - src2) * dst * (T(1.0f) - dst));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendSoftLightSvg) {
+    const T src2 = src + src;
+    const T D = M::select(dst > T(0.25f),
+                          M::sqrt(dst),
+                          ((T(16.0f) * dst - T(12.0f)) * dst + T(4.0f)) * dst);
+
+    return M::select(src > T(0.5f),
+                     dst + (src2 - T(1.0f)) * (D - dst),
+                     dst - (T(1.0f) - src2) * dst * (T(1.0f) - dst));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendVividLight) {
+    const T one(1.0f);
+    const T zero(0.0f);
+
+    // color burn with the doubled source
+    const T burn = M::select(src == zero,
+                             M::select(dst == one, one, zero),
+                             M::clampUnit(one - (one - dst) / (src + src)));
+
+    // color dodge with the doubled source
+    const T dodge = M::select(src == one,
+                              M::select(dst == zero, zero, one),
+                              M::min(dst / ((one - src) + (one - src)), one));
+
+    return M::select(src < T(0.5f), burn, dodge);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendPinLight) {
+    const T src2 = src + src;
+    return M::max(src2 - T(1.0f), M::min(dst, src2));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendLinearLight) {
+    return M::clampUnit(src + src + dst - T(1.0f));
+}
+
+/***************** Dark *****************************************/
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendColorBurn) {
+    const T invDst = T(1.0f) - dst;
+
+    return M::select(dst == T(1.0f), T(1.0f),
+                     M::select(src < invDst, T(0.0f),
+                               T(1.0f) - M::min(invDst / src, T(1.0f))));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendHardMix) {
+    return M::select(dst > T(0.5f),
+                     OptiBlendColorDodge<_impl>::blend(src, dst),
+                     OptiBlendColorBurn<_impl>::blend(src, dst));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendLinearBurn) {
+    return M::max(src + dst - T(1.0f), T(0.0f));
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendDarken) {
+    return M::min(src, dst);
+}
+
+/***************** Negative *************************************/
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendDifference) {
+    return M::abs(src - dst);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendExclusion) {
+    return M::clampUnit(dst + src - T(2.0f) * src * dst);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendEquivalence) {
+    return M::abs(dst - src);
+}
+
+DECLARE_OPTI_SEPARABLE_BLEND(OptiBlendAdditiveSubtractive) {
+    return M::abs(M::sqrt(dst) - M::sqrt(src));
+}
+
+#undef DECLARE_OPTI_SEPARABLE_BLEND
+
+/***************** HSY ******************************************/
+
+/**
+ * A branch-free port of the HSY functions of KoColorSpaceMaths.h
+ */
+template<Vc::Implementation _impl>
+struct OptiHSY {
+    typedef OptiBlendMath<_impl> M;
+
+    template<class T>
+    static ALWAYS_INLINE T getLightness(T r, T g, T b) {
+        return T(0.299f) * r + T(0.587f) * g + T(0.114f) * b;
+    }
+
+    template<class T>
+    static ALWAYS_INLINE T getSaturation(T r, T g, T b) {
+        return M::max(r, M::max(g, b)) - M::min(r, M::min(g, b));
+    }
+
+    template<class T>
+    static ALWAYS_INLINE void addLightness(T &r, T &g, T &b, T light) {
+        r += light;
+        g += light;
+        b += light;
+
+        const T l = getLightness(r, g, b);
+        const T n = M::min(r, M::min(g, b));
+        const T x = M::max(r, M::max(g, b));
+
+        /**
+         * The values of the lanes with a false condition
+         * may become NaN, but they are dropped by select()
+         */
+        const T iln = T(1.0f) / (l - n);
+        const auto belowZero = n < T(0.0f);
+        r = M::select(belowZero, l + ((r - l) * l) * iln, r);
+        g = M::select(belowZero, l + ((g - l) * l) * iln, g);
+        b = M::select(belowZero, l + ((b - l) * l) * iln, b);
+
+        const T il = T(1.0f) - l;
+        const T ixl = T(1.0f) / (x - l);
+        const auto aboveUnit = x > T(1.0f) && (x - l) > T(std::numeric_limits<float>::epsilon());
+        r = M::select(aboveUnit, l + ((r - l) * il) * ixl, r);
+        g = M::select(aboveUnit, l + ((g - l) * il) * ixl, g);
+        b = M::select(aboveUnit, l + ((b - l) * il) * ixl, b);
+    }
+
+    template<class T>
+    static ALWAYS_INLINE void setLightness(T &r, T &g, T &b, T light) {
+        addLightness(r, g, b, light - getLightness(r, g, b));
+    }
+
+    /**
+     * Scales the channels in a way that the minimum becomes 0.0
+     * and the maximum becomes \p sat. That is exactly what the
+     * sorting version in KoColorSpaceMaths.h does.
+     */
+    template<class T>
+    static ALWAYS_INLINE void setSaturation(T &r, T &g, T &b, T sat) {
+        const T n = M::min(r, M::min(g, b));
+        const T chroma = M::max(r, M::max(g, b)) - n;
+        const auto hasChroma = chroma > T(0.0f);
+        const T scale = sat / chroma;
+
+        r = M::select(hasChroma, (r - n) * scale, T(0.0f));
+        g = M::select(hasChroma, (g - n) * scale, T(0.0f));
+        b = M::select(hasChroma, (b - n) * scale, T(0.0f));
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendColorHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        const T lum = HSY::getLightness(dr, dg, db);
+        dr = sr;
+        dg = sg;
+        db = sb;
+        HSY::setLightness(dr, dg, db, lum);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendHueHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        const T sat = HSY::getSaturation(dr, dg, db);
+        const T lum = HSY::getLightness(dr, dg, db);
+        dr = sr;
+        dg = sg;
+        db = sb;
+        HSY::setSaturation(dr, dg, db, sat);
+        HSY::setLightness(dr, dg, db, lum);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendSaturationHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        const T sat = HSY::getSaturation(sr, sg, sb);
+        const T light = HSY::getLightness(dr, dg, db);
+        HSY::setSaturation(dr, dg, db, sat);
+        HSY::setLightness(dr, dg, db, light);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendIncreaseSaturationHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        const T dstSat = HSY::getSaturation(dr, dg, db);
+        const T sat = (T(1.0f) - dstSat) * HSY::getSaturation(sr, sg, sb) + dstSat;
+        const T light = HSY::getLightness(dr, dg, db);
+        HSY::setSaturation(dr, dg, db, sat);
+        HSY::setLightness(dr, dg, db, light);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendDecreaseSaturationHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        const T sat = HSY::getSaturation(dr, dg, db) * HSY::getSaturation(sr, sg, sb);
+        const T light = HSY::getLightness(dr, dg, db);
+        HSY::setSaturation(dr, dg, db, sat);
+        HSY::setLightness(dr, dg, db, light);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendLuminosityHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        HSY::setLightness(dr, dg, db, HSY::getLightness(sr, sg, sb));
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendIncreaseLuminosityHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        HSY::addLightness(dr, dg, db, HSY::getLightness(sr, sg, sb));
+    }
+};
+
+template<Vc::Implementation _impl>
+struct OptiBlendDecreaseLuminosityHSY {
+    typedef OptiHSY<_impl> HSY;
+
+    template<class T>
+    static ALWAYS_INLINE void apply(T sr, T sg, T sb, T &dr, T &dg, T &db) {
+        HSY::addLightness(dr, dg, db, HSY::getLightness(sr, sg, sb) - T(1.0f));
+    }
+};
+
+#endif /* __KO_OPTIMIZED_COMPOSITE_OP_FUNCTIONS_H */
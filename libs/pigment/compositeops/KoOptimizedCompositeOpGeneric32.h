@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_OPTIMIZED_COMPOSITE_OP_GENERIC32_H
+#define __KO_OPTIMIZED_COMPOSITE_OP_GENERIC32_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoOptimizedCompositeOpFunctions.h"
+#include "KoOptimizedCompositeOpFactoryPerArch.h"
+
+
+/**
+ * The vectorized version of KoCompositeOpGenericSC and
+ * KoCompositeOpGenericHSL for 4 byte BGRA colorspaces.
+ *
+ * \p Blend is one of the OptiBlendXXX classes, which calculates the
+ * blended color of the source and destination channels. The color
+ * channels are passed to it in R, G, B order, the values are
+ * normalized into [0.0...1.0] range.
+ *
+ * The blended color is mixed with the source and destination using
+ * the same 8-bit rounding as the generic ops do (\see OptiBlendMath::mulU8),
+ * so the result doesn't depend on whether the op is vectorized or not.
+ * Rounding everything in float would be a bit more precise, but the generic
+ * op divides the color by the resulting alpha, so any difference in the
+ * rounding would be amplified up to 255 times on semi-transparent pixels.
+ */
+template<class Blend, bool alphaLocked, bool allChannelsFlag>
+struct GenericCompositor32 {
+    struct OptionalParams {
+        OptionalParams(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    /**
+     * Calculates the new value of a color channel. All the values
+     * are in [0.0...255.0] range, \p blended is the result of the
+     * blending function. The new alpha of the pixel is expected to
+     * be non-zero.
+     */
+    template<Vc::Implementation _impl, class T>
+    static ALWAYS_INLINE T composeChannel(T src, T srcAlpha, T dst, T dstAlpha, T blended, T newAlpha)
+    {
+        typedef OptiBlendMath<_impl> M;
+
+        if (alphaLocked) {
+            return M::lerpU8(dst, blended, srcAlpha);
+        }
+
+        const T unit(255.0f);
+        const T sum =
+            M::mulU8(unit - srcAlpha, dstAlpha, dst) +
+            M::mulU8(unit - dstAlpha, srcAlpha, src) +
+            M::mulU8(srcAlpha, dstAlpha, blended);
+
+        return M::min(M::divU8(sum, newAlpha), unit);
+    }
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        typedef OptiBlendMath<_impl> M;
+
+        const Vc::float_v uint8Max(255.0f);
+        const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+        const Vc::float_v zeroValue(Vc::Zero);
+
+        Vc::float_v src_alpha =
+            M::mulU8(KoStreamedMath<_impl>::template fetch_alpha_32<src_aligned>(src),
+                     haveMask ? KoStreamedMath<_impl>::fetch_mask_8(mask) : uint8Max,
+                     M::scaleToU8(Vc::float_v(opacity)));
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<true>(dst);
+
+        if (alphaLocked && (dst_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        KoStreamedMath<_impl>::template fetch_colors_32<src_aligned>(src, src_c1, src_c2, src_c3);
+        KoStreamedMath<_impl>::template fetch_colors_32<true>(dst, dst_c1, dst_c2, dst_c3);
+
+        const Vc::float_v norm_c1 = src_c1 * uint8MaxRec1;
+        const Vc::float_v norm_c2 = src_c2 * uint8MaxRec1;
+        const Vc::float_v norm_c3 = src_c3 * uint8MaxRec1;
+
+        // the red channel is stored in the third byte of the pixel
+        Vc::float_v res_c1 = dst_c1 * uint8MaxRec1;
+        Vc::float_v res_c2 = dst_c2 * uint8MaxRec1;
+        Vc::float_v res_c3 = dst_c3 * uint8MaxRec1;
+        Blend::apply(norm_c1, norm_c2, norm_c3, res_c1, res_c2, res_c3);
+
+        res_c1 = M::scaleToU8(res_c1);
+        res_c2 = M::scaleToU8(res_c2);
+        res_c3 = M::scaleToU8(res_c3);
+
+        const Vc::float_v new_alpha =
+            alphaLocked ? dst_alpha : src_alpha + dst_alpha - M::mulU8(src_alpha, dst_alpha);
+
+        /**
+         * The value of new_alpha can have *some* zero values,
+         * which will result in NaN values while division. Such
+         * pixels are left untouched.
+         */
+        const Vc::float_m untouched = new_alpha == zeroValue;
+
+        dst_c1 = Vc::iif(untouched, dst_c1, composeChannel<_impl>(src_c1, src_alpha, dst_c1, dst_alpha, res_c1, new_alpha));
+        dst_c2 = Vc::iif(untouched, dst_c2, composeChannel<_impl>(src_c2, src_alpha, dst_c2, dst_alpha, res_c2, new_alpha));
+        dst_c3 = Vc::iif(untouched, dst_c3, composeChannel<_impl>(src_c3, src_alpha, dst_c3, dst_alpha, res_c3, new_alpha));
+
+        KoStreamedMath<_impl>::write_channels_32(dst, new_alpha, dst_c1, dst_c2, dst_c3);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        typedef OptiBlendMath<_impl> M;
+
+        const qint32 alpha_pos = 3;
+        const float uint8Rec1 = 1.0f / 255.0f;
+
+        const float dstAlpha = dst[alpha_pos];
+
+        if (!allChannelsFlag && dstAlpha == 0.0f) {
+            KoStreamedMathFunctions::clearPixel<4>(dst);
+        }
+
+        const float srcAlpha =
+            M::mulU8(float(src[alpha_pos]),
+                     haveMask ? float(*mask) : 255.0f,
+                     M::scaleToU8(opacity));
+
+        if (srcAlpha == 0.0f || (alphaLocked && dstAlpha == 0.0f)) {
+            return;
+        }
+
+        const float newAlpha =
+            alphaLocked ? dstAlpha : srcAlpha + dstAlpha - M::mulU8(srcAlpha, dstAlpha);
+
+        float srcColor[3];
+        float dstColor[3];
+        float result[3];
+
+        for (int i = 0; i < 3; i++) {
+            srcColor[i] = src[i];
+            dstColor[i] = dst[i];
+            result[i] = dstColor[i] * uint8Rec1;
+        }
+
+        // the channels are stored in BGR order
+        Blend::apply(srcColor[2] * uint8Rec1, srcColor[1] * uint8Rec1, srcColor[0] * uint8Rec1,
+                     result[2], result[1], result[0]);
+
+        for (int i = 0; i < 3; i++) {
+            if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                dst[i] = quint8(composeChannel<_impl>(srcColor[i], srcAlpha,
+                                                      dstColor[i], dstAlpha,
+                                                      M::scaleToU8(result[i]),
+                                                      newAlpha));
+            }
+        }
+
+        dst[alpha_pos] = quint8(newAlpha);
+    }
+};
+
+/**
+ * An optimized version of the generic composite ops for the use in
+ * 4 byte BGRA colorspaces. The blending function is provided by \p Blend.
+ */
+template<Vc::Implementation _impl, class Blend>
+class KoOptimizedCompositeOpGeneric32 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric32(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite32<haveMask, false, GenericCompositor32<Blend, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32<haveMask, false, GenericCompositor32<Blend, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericCompositor32<Blend, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericCompositor32<Blend, true, false> >(params);
+            }
+        }
+    }
+};
+
+template<Vc::Implementation _impl, template<Vc::Implementation> class Blend>
+KoCompositeOp* createOptimizedCompositeOpGeneric32(const KoOptimizedGenericOpInfo &param)
+{
+    return new KoOptimizedCompositeOpGeneric32<_impl, Blend<_impl> >(param.colorSpace, param.id, param.description, param.category);
+}
+
+/**
+ * Creates an optimized version of the generic composite op with
+ * the id passed in \p param. Returns null if the op is not
+ * vectorized, then the caller should fall back to the generic op.
+ *
+ * Not all the modes are vectorized. The modes based on the
+ * transcendental functions (Arcus Tangent, Gamma Light/Dark) are
+ * too slow in the vectorized form. The results of the quadratic
+ * modes (Reflect, Glow, Freeze, Heat) and of Hard Mix (Photoshop)
+ * depend on the rounding of the integer math, so they are kept
+ * in the integer form to be consistent with the other color depths.
+ */
+template<Vc::Implementation _impl>
+KoCompositeOp* createOptimizedCompositeOpGeneric32(const KoOptimizedGenericOpInfo &param)
+{
+    const QString &id = param.id;
+
+    if (id == COMPOSITE_OVERLAY)                return createOptimizedCompositeOpGeneric32<_impl, OptiBlendOverlay>(param);
+    if (id == COMPOSITE_GRAIN_MERGE)            return createOptimizedCompositeOpGeneric32<_impl, OptiBlendGrainMerge>(param);
+    if (id == COMPOSITE_GRAIN_EXTRACT)          return createOptimizedCompositeOpGeneric32<_impl, OptiBlendGrainExtract>(param);
+    if (id == COMPOSITE_HARD_MIX)               return createOptimizedCompositeOpGeneric32<_impl, OptiBlendHardMix>(param);
+    if (id == COMPOSITE_GEOMETRIC_MEAN)         return createOptimizedCompositeOpGeneric32<_impl, OptiBlendGeometricMean>(param);
+    if (id == COMPOSITE_PARALLEL)               return createOptimizedCompositeOpGeneric32<_impl, OptiBlendParallel>(param);
+    if (id == COMPOSITE_ALLANON)                return createOptimizedCompositeOpGeneric32<_impl, OptiBlendAllanon>(param);
+    if (id == COMPOSITE_HARD_OVERLAY)           return createOptimizedCompositeOpGeneric32<_impl, OptiBlendHardOverlay>(param);
+
+    if (id == COMPOSITE_SCREEN)                 return createOptimizedCompositeOpGeneric32<_impl, OptiBlendScreen>(param);
+    if (id == COMPOSITE_DODGE)                  return createOptimizedCompositeOpGeneric32<_impl, OptiBlendColorDodge>(param);
+    if (id == COMPOSITE_LINEAR_DODGE)           return createOptimizedCompositeOpGeneric32<_impl, OptiBlendAddition>(param);
+    if (id == COMPOSITE_LIGHTEN)                return createOptimizedCompositeOpGeneric32<_impl, OptiBlendLighten>(param);
+    if (id == COMPOSITE_HARD_LIGHT)             return createOptimizedCompositeOpGeneric32<_impl, OptiBlendHardLight>(param);
+    if (id == COMPOSITE_SOFT_LIGHT_SVG)         return createOptimizedCompositeOpGeneric32<_impl, OptiBlendSoftLightSvg>(param);
+    if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP)   return createOptimizedCompositeOpGeneric32<_impl, OptiBlendSoftLight>(param);
+    if (id == COMPOSITE_VIVID_LIGHT)            return createOptimizedCompositeOpGeneric32<_impl, OptiBlendVividLight>(param);
+    if (id == COMPOSITE_PIN_LIGHT)              return createOptimizedCompositeOpGeneric32<_impl, OptiBlendPinLight>(param);
+    if (id == COMPOSITE_LINEAR_LIGHT)           return createOptimizedCompositeOpGeneric32<_impl, OptiBlendLinearLight>(param);
+
+    if (id == COMPOSITE_BURN)                   return createOptimizedCompositeOpGeneric32<_impl, OptiBlendColorBurn>(param);
+    if (id == COMPOSITE_LINEAR_BURN)            return createOptimizedCompositeOpGeneric32<_impl, OptiBlendLinearBurn>(param);
+    if (id == COMPOSITE_DARKEN)                 return createOptimizedCompositeOpGeneric32<_impl, OptiBlendDarken>(param);
+
+    if (id == COMPOSITE_ADD)                    return createOptimizedCompositeOpGeneric32<_impl, OptiBlendAddition>(param);
+    if (id == COMPOSITE_SUBTRACT)               return createOptimizedCompositeOpGeneric32<_impl, OptiBlendSubtract>(param);
+    if (id == COMPOSITE_INVERSE_SUBTRACT)       return createOptimizedCompositeOpGeneric32<_impl, OptiBlendInverseSubtract>(param);
+    if (id == COMPOSITE_MULT)                   return createOptimizedCompositeOpGeneric32<_impl, OptiBlendMultiply>(param);
+    if (id == COMPOSITE_DIVIDE)                 return createOptimizedCompositeOpGeneric32<_impl, OptiBlendDivide>(param);
+
+    if (id == COMPOSITE_DIFF)                   return createOptimizedCompositeOpGeneric32<_impl, OptiBlendDifference>(param);
+    if (id == COMPOSITE_EXCLUSION)              return createOptimizedCompositeOpGeneric32<_impl, OptiBlendExclusion>(param);
+    if (id == COMPOSITE_EQUIVALENCE)            return createOptimizedCompositeOpGeneric32<_impl, OptiBlendEquivalence>(param);
+    if (id == COMPOSITE_ADDITIVE_SUBTRACTIVE)   return createOptimizedCompositeOpGeneric32<_impl, OptiBlendAdditiveSubtractive>(param);
+
+    if (id == COMPOSITE_COLOR)                  return createOptimizedCompositeOpGeneric32<_impl, OptiBlendColorHSY>(param);
+    if (id == COMPOSITE_HUE)                    return createOptimizedCompositeOpGeneric32<_impl, OptiBlendHueHSY>(param);
+    if (id == COMPOSITE_SATURATION)             return createOptimizedCompositeOpGeneric32<_impl, OptiBlendSaturationHSY>(param);
+    if (id == COMPOSITE_INC_SATURATION)         return createOptimizedCompositeOpGeneric32<_impl, OptiBlendIncreaseSaturationHSY>(param);
+    if (id == COMPOSITE_DEC_SATURATION)         return createOptimizedCompositeOpGeneric32<_impl, OptiBlendDecreaseSaturationHSY>(param);
+    if (id == COMPOSITE_LUMINIZE)               return createOptimizedCompositeOpGeneric32<_impl, OptiBlendLuminosityHSY>(param);
+    if (id == COMPOSITE_INC_LUMINOSITY)         return createOptimizedCompositeOpGeneric32<_impl, OptiBlendIncreaseLuminosityHSY>(param);
+    if (id == COMPOSITE_DEC_LUMINOSITY)         return createOptimizedCompositeOpGeneric32<_impl, OptiBlendDecreaseLuminosityHSY>(param);
+
+    return 0;
+}
+
+#endif /* __KO_OPTIMIZED_COMPOSITE_OP_GENERIC32_H */
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_OPTIMIZED_COMPOSITE_OP_GENERIC64_H
+#define __KO_OPTIMIZED_COMPOSITE_OP_GENERIC64_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoOptimizedCompositeOpFunctions.h"
+#include "KoOptimizedCompositeOpFactoryPerArch.h"
+
+
+/**
+ * The vectorized version of KoCompositeOpGenericSC and
+ * KoCompositeOpGenericHSL for 8 byte BGRA colorspaces with 16-bit
+ * integer channels. Unlike GenericCompositor32, which reproduces the
+ * rounding of the 8-bit integer ops, all the math is done in float,
+ * so the results may differ from the generic ops by a few units.
+ *
+ * The half float colorspaces are not handled here: the blending
+ * functions of the generic ops don't clamp the HDR values, while
+ * the OptiBlendXXX classes work in [0.0...1.0] range only.
+ */
+template<class Blend, bool alphaLocked, bool allChannelsFlag>
+struct GenericCompositor64 {
+    struct OptionalParams {
+        OptionalParams(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        typedef OptiBlendMath<_impl> M;
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_b;
+        Vc::float_v src_g;
+        Vc::float_v src_r;
+        Vc::float_v src_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<quint16>(src, src_b, src_g, src_r, src_alpha);
+
+        src_alpha *= Vc::float_v(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+            src_alpha *= KoStreamedMath<_impl>::fetch_mask_8(mask) * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_b;
+        Vc::float_v dst_g;
+        Vc::float_v dst_r;
+        Vc::float_v dst_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<quint16>(dst, dst_b, dst_g, dst_r, dst_alpha);
+
+        if (alphaLocked && (dst_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v res_r = dst_r;
+        Vc::float_v res_g = dst_g;
+        Vc::float_v res_b = dst_b;
+        Blend::apply(src_r, src_g, src_b, res_r, res_g, res_b);
+
+        res_r = M::clampUnit(res_r);
+        res_g = M::clampUnit(res_g);
+        res_b = M::clampUnit(res_b);
+
+        Vc::float_v new_alpha;
+
+        if (alphaLocked) {
+            const Vc::float_m transparentDst = dst_alpha == zeroValue;
+            const Vc::float_v dst_blend = oneValue - src_alpha;
+
+            dst_r = Vc::iif(transparentDst, dst_r, res_r * src_alpha + dst_r * dst_blend);
+            dst_g = Vc::iif(transparentDst, dst_g, res_g * src_alpha + dst_g * dst_blend);
+            dst_b = Vc::iif(transparentDst, dst_b, res_b * src_alpha + dst_b * dst_blend);
+
+            new_alpha = dst_alpha;
+        } else {
+            new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+            /**
+             * The value of new_alpha can have *some* zero values,
+             * which will result in NaN values while division. Such
+             * pixels are left untouched.
+             */
+            const Vc::float_m transparentResult = new_alpha == zeroValue;
+            const Vc::float_v norm = oneValue / new_alpha;
+
+            const Vc::float_v dst_only = dst_alpha * (oneValue - src_alpha) * norm;
+            const Vc::float_v src_only = src_alpha * (oneValue - dst_alpha) * norm;
+            const Vc::float_v both = src_alpha * dst_alpha * norm;
+
+            dst_r = Vc::iif(transparentResult, dst_r, dst_r * dst_only + src_r * src_only + res_r * both);
+            dst_g = Vc::iif(transparentResult, dst_g, dst_g * dst_only + src_g * src_only + res_g * both);
+            dst_b = Vc::iif(transparentResult, dst_b, dst_b * dst_only + src_b * src_only + res_b * both);
+        }
+
+        KoStreamedMath<_impl>::template write_pixels_64<quint16>(dst, dst_b, dst_g, dst_r, new_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        typedef OptiBlendMath<_impl> M;
+
+        const qint32 alpha_pos = 3;
+
+        const quint16 *s = reinterpret_cast<const quint16*>(src);
+        quint16 *d = reinterpret_cast<quint16*>(dst);
+
+        float srcPixel[4];
+        float dstPixel[4];
+        KoStreamedMath<_impl>::channels_to_float(s, srcPixel, 4);
+        KoStreamedMath<_impl>::channels_to_float(d, dstPixel, 4);
+
+        const float dstAlpha = dstPixel[alpha_pos];
+
+        if (!allChannelsFlag && dstAlpha == 0.0f) {
+            KoStreamedMathFunctions::clearPixel<8>(dst);
+            dstPixel[0] = dstPixel[1] = dstPixel[2] = 0.0f;
+        }
+
+        float srcAlpha = srcPixel[alpha_pos] * opacity;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0f / 255.0f;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha == 0.0f || (alphaLocked && dstAlpha == 0.0f)) {
+            return;
+        }
+
+        float result[3];
+
+        for (int i = 0; i < 3; i++) {
+            result[i] = dstPixel[i];
+        }
+
+        // the channels are stored in BGR order
+        Blend::apply(srcPixel[2], srcPixel[1], srcPixel[0], result[2], result[1], result[0]);
+
+        if (alphaLocked) {
+            for (int i = 0; i < 3; i++) {
+                if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                    const float value = M::clampUnit(result[i]);
+                    dstPixel[i] += (value - dstPixel[i]) * srcAlpha;
+                }
+            }
+        } else {
+            const float newAlpha = srcAlpha + dstAlpha - srcAlpha * dstAlpha;
+            const float norm = 1.0f / newAlpha;
+
+            for (int i = 0; i < 3; i++) {
+                if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                    const float value =
+                        dstPixel[i] * dstAlpha * (1.0f - srcAlpha) +
+                        srcPixel[i] * srcAlpha * (1.0f - dstAlpha) +
+                        M::clampUnit(result[i]) * srcAlpha * dstAlpha;
+
+                    dstPixel[i] = value * norm;
+                }
+            }
+
+            dstPixel[alpha_pos] = newAlpha;
+        }
+
+        KoStreamedMath<_impl>::float_to_channels(dstPixel, d, 4);
+    }
+};
+
+/**
+ * An optimized version of the generic composite ops for the use in
+ * 8 byte BGRA colorspaces with 16-bit integer channels. The blending
+ * function is provided by \p Blend.
+ */
+template<Vc::Implementation _impl, class Blend>
+class KoOptimizedCompositeOpGeneric64 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric64(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite64<haveMask, false, GenericCompositor64<Blend, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64<haveMask, false, GenericCompositor64<Blend, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, GenericCompositor64<Blend, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, GenericCompositor64<Blend, true, false> >(params);
+            }
+        }
+    }
+};
+
+template<Vc::Implementation _impl, template<Vc::Implementation> class Blend>
+KoCompositeOp* createOptimizedCompositeOpGeneric64(const KoOptimizedGenericOpInfo &param)
+{
+    return new KoOptimizedCompositeOpGeneric64<_impl, Blend<_impl> >(param.colorSpace, param.id, param.description, param.category);
+}
+
+/**
+ * Creates an optimized version of the generic composite op with
+ * the id passed in \p param. Returns null if the op is not
+ * vectorized, then the caller should fall back to the generic op.
+ *
+ * The set of the vectorized modes is the same as in
+ * createOptimizedCompositeOpGeneric32()
+ */
+template<Vc::Implementation _impl>
+KoCompositeOp* createOptimizedCompositeOpGeneric64(const KoOptimizedGenericOpInfo &param)
+{
+    const QString &id = param.id;
+
+    if (id == COMPOSITE_OVERLAY)                return createOptimizedCompositeOpGeneric64<_impl, OptiBlendOverlay>(param);
+    if (id == COMPOSITE_GRAIN_MERGE)            return createOptimizedCompositeOpGeneric64<_impl, OptiBlendGrainMerge>(param);
+    if (id == COMPOSITE_GRAIN_EXTRACT)          return createOptimizedCompositeOpGeneric64<_impl, OptiBlendGrainExtract>(param);
+    if (id == COMPOSITE_HARD_MIX)               return createOptimizedCompositeOpGeneric64<_impl, OptiBlendHardMix>(param);
+    if (id == COMPOSITE_GEOMETRIC_MEAN)         return createOptimizedCompositeOpGeneric64<_impl, OptiBlendGeometricMean>(param);
+    if (id == COMPOSITE_PARALLEL)               return createOptimizedCompositeOpGeneric64<_impl, OptiBlendParallel>(param);
+    if (id == COMPOSITE_ALLANON)                return createOptimizedCompositeOpGeneric64<_impl, OptiBlendAllanon>(param);
+    if (id == COMPOSITE_HARD_OVERLAY)           return createOptimizedCompositeOpGeneric64<_impl, OptiBlendHardOverlay>(param);
+
+    if (id == COMPOSITE_SCREEN)                 return createOptimizedCompositeOpGeneric64<_impl, OptiBlendScreen>(param);
+    if (id == COMPOSITE_DODGE)                  return createOptimizedCompositeOpGeneric64<_impl, OptiBlendColorDodge>(param);
+    if (id == COMPOSITE_LINEAR_DODGE)           return createOptimizedCompositeOpGeneric64<_impl, OptiBlendAddition>(param);
+    if (id == COMPOSITE_LIGHTEN)                return createOptimizedCompositeOpGeneric64<_impl, OptiBlendLighten>(param);
+    if (id == COMPOSITE_HARD_LIGHT)             return createOptimizedCompositeOpGeneric64<_impl, OptiBlendHardLight>(param);
+    if (id == COMPOSITE_SOFT_LIGHT_SVG)         return createOptimizedCompositeOpGeneric64<_impl, OptiBlendSoftLightSvg>(param);
+    if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP)   return createOptimizedCompositeOpGeneric64<_impl, OptiBlendSoftLight>(param);
+    if (id == COMPOSITE_VIVID_LIGHT)            return createOptimizedCompositeOpGeneric64<_impl, OptiBlendVividLight>(param);
+    if (id == COMPOSITE_PIN_LIGHT)              return createOptimizedCompositeOpGeneric64<_impl, OptiBlendPinLight>(param);
+    if (id == COMPOSITE_LINEAR_LIGHT)           return createOptimizedCompositeOpGeneric64<_impl, OptiBlendLinearLight>(param);
+
+    if (id == COMPOSITE_BURN)                   return createOptimizedCompositeOpGeneric64<_impl, OptiBlendColorBurn>(param);
+    if (id == COMPOSITE_LINEAR_BURN)            return createOptimizedCompositeOpGeneric64<_impl, OptiBlendLinearBurn>(param);
+    if (id == COMPOSITE_DARKEN)                 return createOptimizedCompositeOpGeneric64<_impl, OptiBlendDarken>(param);
+
+    if (id == COMPOSITE_ADD)                    return createOptimizedCompositeOpGeneric64<_impl, OptiBlendAddition>(param);
+    if (id == COMPOSITE_SUBTRACT)               return createOptimizedCompositeOpGeneric64<_impl, OptiBlendSubtract>(param);
+    if (id == COMPOSITE_INVERSE_SUBTRACT)       return createOptimizedCompositeOpGeneric64<_impl, OptiBlendInverseSubtract>(param);
+    if (id == COMPOSITE_MULT)                   return createOptimizedCompositeOpGeneric64<_impl, OptiBlendMultiply>(param);
+    if (id == COMPOSITE_DIVIDE)                 return createOptimizedCompositeOpGeneric64<_impl, OptiBlendDivide>(param);
+
+    if (id == COMPOSITE_DIFF)                   return createOptimizedCompositeOpGeneric64<_impl, OptiBlendDifference>(param);
+    if (id == COMPOSITE_EXCLUSION)              return createOptimizedCompositeOpGeneric64<_impl, OptiBlendExclusion>(param);
+    if (id == COMPOSITE_EQUIVALENCE)            return createOptimizedCompositeOpGeneric64<_impl, OptiBlendEquivalence>(param);
+    if (id == COMPOSITE_ADDITIVE_SUBTRACTIVE)   return createOptimizedCompositeOpGeneric64<_impl, OptiBlendAdditiveSubtractive>(param);
+
+    if (id == COMPOSITE_COLOR)                  return createOptimizedCompositeOpGeneric64<_impl, OptiBlendColorHSY>(param);
+    if (id == COMPOSITE_HUE)                    return createOptimizedCompositeOpGeneric64<_impl, OptiBlendHueHSY>(param);
+    if (id == COMPOSITE_SATURATION)             return createOptimizedCompositeOpGeneric64<_impl, OptiBlendSaturationHSY>(param);
+    if (id == COMPOSITE_INC_SATURATION)         return createOptimizedCompositeOpGeneric64<_impl, OptiBlendIncreaseSaturationHSY>(param);
+    if (id == COMPOSITE_DEC_SATURATION)         return createOptimizedCompositeOpGeneric64<_impl, OptiBlendDecreaseSaturationHSY>(param);
+    if (id == COMPOSITE_LUMINIZE)               return createOptimizedCompositeOpGeneric64<_impl, OptiBlendLuminosityHSY>(param);
+    if (id == COMPOSITE_INC_LUMINOSITY)         return createOptimizedCompositeOpGeneric64<_impl, OptiBlendIncreaseLuminosityHSY>(param);
+    if (id == COMPOSITE_DEC_LUMINOSITY)         return createOptimizedCompositeOpGeneric64<_impl, OptiBlendDecreaseLuminosityHSY>(param);
+
+    return 0;
+}
+
+#endif /* __KO_OPTIMIZED_COMPOSITE_OP_GENERIC64_H */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_OPTIMIZED_COMPOSITE_OP_OVER64_H
+#define __KO_OPTIMIZED_COMPOSITE_OP_OVER64_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+
+
+/**
+ * The compositor of the OVER op for 8 byte colorspaces. The math
+ * is the same as in OverCompositor128, the channels are converted
+ * into normalized floats on load and back on store.
+ *
+ * \p channels_type is quint16 or half
+ */
+template<typename channels_type, bool alphaLocked, bool allChannelsFlag>
+struct OverCompositor64 {
+    struct OptionalParams {
+        OptionalParams(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+        Vc::float_v src_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<channels_type>(src, src_c1, src_c2, src_c3, src_alpha);
+
+        src_alpha *= Vc::float_v(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+            src_alpha *= KoStreamedMath<_impl>::fetch_mask_8(mask) * uint8MaxRec1;
+        }
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+        Vc::float_v dst_alpha;
+
+        KoStreamedMath<_impl>::template fetch_pixels_64<channels_type>(dst, dst_c1, dst_c2, dst_c3, dst_alpha);
+
+        Vc::float_v src_blend;
+        Vc::float_v new_alpha;
+
+        const Vc::float_v oneValue(Vc::One);
+        if ((dst_alpha == oneValue).isFull()) {
+            new_alpha = dst_alpha;
+            src_blend = src_alpha;
+        } else if ((dst_alpha == zeroValue).isFull()) {
+            new_alpha = src_alpha;
+            src_blend = oneValue;
+        } else {
+            /**
+             * The value of new_alpha can have *some* zero values,
+             * which will result in NaN values while division.
+             */
+            new_alpha = dst_alpha + (oneValue - dst_alpha) * src_alpha;
+            Vc::float_m zeroAlpha = (new_alpha == zeroValue);
+            src_blend = src_alpha / new_alpha;
+            src_blend.setZero(zeroAlpha);
+        }
+
+        if (!(src_blend == oneValue).isFull()) {
+            dst_c1 = src_blend * (src_c1 - dst_c1) + dst_c1;
+            dst_c2 = src_blend * (src_c2 - dst_c2) + dst_c2;
+            dst_c3 = src_blend * (src_c3 - dst_c3) + dst_c3;
+
+            KoStreamedMath<_impl>::template write_pixels_64<channels_type>(dst, dst_c1, dst_c2, dst_c3, new_alpha);
+        } else {
+            KoStreamedMath<_impl>::template write_pixels_64<channels_type>(dst, src_c1, src_c2, src_c3, new_alpha);
+        }
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const channels_type *s = reinterpret_cast<const channels_type*>(src);
+        channels_type *d = reinterpret_cast<channels_type*>(dst);
+
+        float srcPixel[4];
+        KoStreamedMath<_impl>::channels_to_float(s, srcPixel, 4);
+
+        float srcAlpha = srcPixel[alpha_pos] * opacity;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0f / 255.0f;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha == 0.0f) return;
+
+        float dstPixel[4];
+        KoStreamedMath<_impl>::channels_to_float(d, dstPixel, 4);
+
+        float dstAlpha = dstPixel[alpha_pos];
+        float srcBlendNorm;
+
+        if (dstAlpha == 1.0f) {
+            srcBlendNorm = srcAlpha;
+        } else if (dstAlpha == 0.0f) {
+            dstAlpha = srcAlpha;
+            srcBlendNorm = 1.0f;
+
+            if (!allChannelsFlag) {
+                dstPixel[0] = 0.0f;
+                dstPixel[1] = 0.0f;
+                dstPixel[2] = 0.0f;
+            }
+        } else {
+            dstAlpha += (1.0f - dstAlpha) * srcAlpha;
+            srcBlendNorm = srcAlpha / dstAlpha;
+        }
+
+        for (int i = 0; i < 3; i++) {
+            if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                if (srcBlendNorm == 1.0f) {
+                    dstPixel[i] = srcPixel[i];
+                } else if (srcBlendNorm != 0.0f) {
+                    dstPixel[i] = srcBlendNorm * (srcPixel[i] - dstPixel[i]) + dstPixel[i];
+                }
+            }
+        }
+
+        if (!alphaLocked) {
+            dstPixel[alpha_pos] = dstAlpha;
+        }
+
+        KoStreamedMath<_impl>::float_to_channels(dstPixel, d, 4);
+    }
+};
+
+/**
+ * An optimized version of a composite op for the use in 8 byte
+ * colorspaces (16-bit integer or half float channels) with alpha
+ * channel placed at the last position of the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, typename channels_type>
+class KoOptimizedCompositeOpOver64 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpOver64(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_OVER, i18n("Normal"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite64<haveMask, false, OverCompositor64<channels_type, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, OverCompositor64<channels_type, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, OverCompositor64<channels_type, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, OverCompositor64<channels_type, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif /* __KO_OPTIMIZED_COMPOSITE_OP_OVER64_H */
@@ -36,6 +36,15 @@
 #include <KoAlwaysInline.h>
 #include <iostream>
 
+#include <KoConfig.h>
+#ifdef HAVE_OPENEXR
+#include <half.h>
+#endif
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
 #define BLOCKDEBUG 0
 
 #if !defined _MSC_VER
@@ -96,6 +105,12 @@ template<bool useMask, bool useFlow, class Compositor>
     genericComposite_novector<useMask, useFlow, Compositor, 4>(params);
 }
 
+template<bool useMask, bool useFlow, class Compositor>
+    static void genericComposite64_novector(const KoCompositeOp::ParameterInfo& params)
+{
+    genericComposite_novector<useMask, useFlow, Compositor, 8>(params);
+}
+
 template<bool useMask, bool useFlow, class Compositor>
     static void genericComposite128_novector(const KoCompositeOp::ParameterInfo& params)
 {
@@ -208,6 +223,117 @@ static inline void write_channels_32(quint8 *data,
     (v1 | v3).store((quint32*)data, Vc::Aligned);
 }
 
+/**
+ * Converts \p size channels of a 16-bit integer colorspace into
+ * the floats normalized into [0.0...1.0] range
+ */
+static ALWAYS_INLINE void channels_to_float(const quint16 *src, float *dst, int size) {
+    const float uint16Rec1 = 1.0f / 65535.0f;
+
+    for (int i = 0; i < size; i++) {
+        dst[i] = float(src[i]) * uint16Rec1;
+    }
+}
+
+/**
+ * Converts \p size normalized floats back into the channels of
+ * a 16-bit integer colorspace. The values are clamped and rounded.
+ */
+static ALWAYS_INLINE void float_to_channels(const float *src, quint16 *dst, int size) {
+    for (int i = 0; i < size; i++) {
+        dst[i] = quint16(qBound(0.0f, src[i] * 65535.0f, 65535.0f) + 0.5f);
+    }
+}
+
+#ifdef HAVE_OPENEXR
+
+/**
+ * Converts \p size half-float channels into floats. The AVX2 version
+ * is built with F16C instructions, so the conversion is done in
+ * hardware, four channels at a time. The other versions use the
+ * lookup table of OpenEXR. \p size must be a multiple of 4.
+ */
+static ALWAYS_INLINE void channels_to_float(const half *src, float *dst, int size) {
+#ifdef __F16C__
+    for (int i = 0; i < size; i += 4) {
+        const __m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, _mm_cvtph_ps(value));
+    }
+#else
+    for (int i = 0; i < size; i++) {
+        dst[i] = float(src[i]);
+    }
+#endif
+}
+
+/**
+ * Converts \p size floats into half-float channels. The values
+ * are rounded to the nearest representable value and not clamped,
+ * so that HDR data is preserved. \p size must be a multiple of 4.
+ */
+static ALWAYS_INLINE void float_to_channels(const float *src, half *dst, int size) {
+#ifdef __F16C__
+    for (int i = 0; i < size; i += 4) {
+        const __m128i value = _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+#else
+    for (int i = 0; i < size; i++) {
+        dst[i] = half(src[i]);
+    }
+#endif
+}
+
+#endif /* HAVE_OPENEXR */
+
+struct FloatPixel {
+    float c1;
+    float c2;
+    float c3;
+    float alpha;
+};
+
+/**
+ * Get Vc::float_v::size() pixels of a 64-bit colorspace (4 channels,
+ * 16 bit per channel) unpacked into separate normalized float
+ * vectors. The alpha channel is considered to be the last one.
+ *
+ * \p channels_type is the type of the channel: quint16 or half.
+ * The pointer can have any alignment.
+ */
+template <typename channels_type>
+static inline void fetch_pixels_64(const quint8 *data,
+                                   Vc::float_v &c1,
+                                   Vc::float_v &c2,
+                                   Vc::float_v &c3,
+                                   Vc::float_v &alpha) {
+    Vc::Memory<Vc::float_v, 4 * Vc::float_v::Size> buf;
+    channels_to_float(reinterpret_cast<const channels_type*>(data), buf.entries(), 4 * Vc::float_v::Size);
+
+    const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+    Vc::InterleavedMemoryWrapper<FloatPixel, Vc::float_v> pixels(reinterpret_cast<FloatPixel*>(buf.entries()));
+    tie(c1, c2, c3, alpha) = pixels[indexes];
+}
+
+/**
+ * Pack normalized color and alpha values into Vc::float_v::size()
+ * pixels of a 64-bit colorspace. The reverse of fetch_pixels_64().
+ */
+template <typename channels_type>
+static inline void write_pixels_64(quint8 *data,
+                                   Vc::float_v::AsArg c1,
+                                   Vc::float_v::AsArg c2,
+                                   Vc::float_v::AsArg c3,
+                                   Vc::float_v::AsArg alpha) {
+    Vc::Memory<Vc::float_v, 4 * Vc::float_v::Size> buf;
+
+    const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+    Vc::InterleavedMemoryWrapper<FloatPixel, Vc::float_v> pixels(reinterpret_cast<FloatPixel*>(buf.entries()));
+    pixels[indexes] = tie(c1, c2, c3, alpha);
+
+    float_to_channels(buf.entries(), reinterpret_cast<channels_type*>(data), 4 * Vc::float_v::Size);
+}
+
 /**
  * Composes src pixels into dst pixles. Is optimized for 32-bit-per-pixel
  * colorspaces. Uses \p Compositor strategy parameter for doing actual
@@ -375,6 +501,12 @@ template<bool useMask, bool useFlow, class Compositor>
     genericComposite<useMask, useFlow, Compositor, 4>(params);
 }
 
+template<bool useMask, bool useFlow, class Compositor>
+    static void genericComposite64(const KoCompositeOp::ParameterInfo& params)
+{
+    genericComposite<useMask, useFlow, Compositor, 8>(params);
+}
+
 template<bool useMask, bool useFlow, class Compositor>
     static void genericComposite128(const KoCompositeOp::ParameterInfo& params)
 {
@@ -395,6 +527,13 @@ ALWAYS_INLINE void clearPixel<4>(quint8* dst)
     *d = 0;
 }
 
+template<>
+ALWAYS_INLINE void clearPixel<8>(quint8* dst)
+{
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = 0;
+}
+
 template<>
 ALWAYS_INLINE void clearPixel<16>(quint8* dst)
 {
@@ -414,6 +553,14 @@ ALWAYS_INLINE void copyPixel<4>(const quint8 *src, quint8* dst)
     *d = *s;
 }
 
+template<>
+ALWAYS_INLINE void copyPixel<8>(const quint8 *src, quint8* dst)
+{
+    const quint64 *s = reinterpret_cast<const quint64*>(src);
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = *s;
+}
+
 template<>
 ALWAYS_INLINE void copyPixel<16>(const quint8 *src, quint8* dst)
 {
@@ -88,9 +88,15 @@ createOptimizedClass(typename FactoryType::ParamType param)
      * We use SSE2, SSSE3, SSE4.1, AVX and AVX2.
      * The rest are integer and string instructions mostly.
      *
+     * The AVX2 version is also built with F16C for the half-float
+     * conversions, so it is used only when the CPU supports it,
+     * otherwise the AVX version is picked.
+     *
      * TODO: Add FMA3/4 when it is adopted by Vc
      */
-    if (Vc::isImplementationSupported(Vc::AVX2Impl)) {
+    if (Vc::isImplementationSupported(Vc::AVX2Impl) &&
+        (Vc::extraInstructionsSupported() & Vc::Float16cInstructions)) {
+
         return FactoryType::template create<Vc::AVX2Impl>(param);
     } else if (Vc::isImplementationSupported(Vc::AVXImpl)) {
         return FactoryType::template create<Vc::AVXImpl>(param);
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2019 Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "TestKoColorConversionCache.h"
+
+#include <QTest>
+#include <QThread>
+
+#include <KoColorConversionCache.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <sdk/tests/kistest.h>
+
+namespace {
+
+const KoColorConversionTransformation::Intent intent = KoColorConversionTransformation::internalRenderingIntent();
+const KoColorConversionTransformation::ConversionFlags flags = KoColorConversionTransformation::internalConversionFlags();
+
+KoColorConversionCache* cache()
+{
+    return KoColorSpaceRegistry::instance()->colorConversionCache();
+}
+
+class ConverterThread : public QThread
+{
+public:
+    ConverterThread(const KoColorSpace *src, const KoColorSpace *dst)
+        : m_src(src),
+          m_dst(dst)
+    {
+    }
+
+    void run() override {
+        KoCachedColorConversionTransformation cct = cache()->cachedConverter(m_src, m_dst, intent, flags);
+        transformation = cct.transformation();
+    }
+
+    const KoColorConversionTransformation *transformation = 0;
+
+private:
+    const KoColorSpace *m_src;
+    const KoColorSpace *m_dst;
+};
+
+}
+
+void TestKoColorConversionCache::testHitsAndMisses()
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16();
+
+    KoCachedColorConversionTransformation first = cache()->cachedConverter(rgb8, rgb16, intent, flags);
+
+    const KoColorConversionCache::Statistics before = cache()->statistics();
+
+    KoCachedColorConversionTransformation second = cache()->cachedConverter(rgb8, rgb16, intent, flags);
+
+    const KoColorConversionCache::Statistics after = cache()->statistics();
+
+    QCOMPARE(second.transformation(), first.transformation());
+    QCOMPARE(after.hits, before.hits + 1);
+    QCOMPARE(after.misses, before.misses);
+    QCOMPARE(after.creations, before.creations);
+
+    cache()->resetStatistics();
+    QCOMPARE(cache()->statistics().hits, qint64(0));
+    QVERIFY(cache()->statistics().numTransformations > 0);
+}
+
+void TestKoColorConversionCache::testSharedTransformation()
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16();
+
+    KoCachedColorConversionTransformation cct = cache()->cachedConverter(rgb8, rgb16, intent, flags);
+    QVERIFY(cct.transformation()->isThreadSafe());
+
+    const KoColorConversionCache::Statistics before = cache()->statistics();
+
+    ConverterThread thread(rgb8, rgb16);
+    thread.start();
+    thread.wait();
+
+    const KoColorConversionCache::Statistics after = cache()->statistics();
+
+    // the other thread reuses the same transformation without creating a new one
+    QCOMPARE(thread.transformation, cct.transformation());
+    QCOMPARE(after.misses, before.misses + 1);
+    QCOMPARE(after.creations, before.creations);
+}
+
+void TestKoColorConversionCache::testPerThreadTransformation()
+{
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+
+    KoCachedColorConversionTransformation cct = cache()->cachedConverter(alpha8, rgb8, intent, flags);
+    QVERIFY(!cct.transformation()->isThreadSafe());
+
+    const KoColorConversionCache::Statistics before = cache()->statistics();
+
+    ConverterThread thread(alpha8, rgb8);
+    thread.start();
+    thread.wait();
+
+    const KoColorConversionCache::Statistics after = cache()->statistics();
+
+    // the transformation is busy in this thread, so the other one gets its own copy
+    QVERIFY(thread.transformation);
+    QVERIFY(thread.transformation != cct.transformation());
+    QCOMPARE(after.creations, before.creations + 1);
+
+    // after the thread has exited its copy can be taken by someone else
+    ConverterThread thread2(alpha8, rgb8);
+    thread2.start();
+    thread2.wait();
+
+    QCOMPARE(cache()->statistics().creations, after.creations);
+}
+
+void TestKoColorConversionCache::testColorSpaceDestroyed()
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16();
+
+    {
+        KoCachedColorConversionTransformation cct = cache()->cachedConverter(rgb8, rgb16, intent, flags);
+        Q_UNUSED(cct);
+    }
+
+    const int numTransformations = cache()->statistics().numTransformations;
+
+    cache()->colorSpaceIsDestroyed(rgb16);
+
+    QVERIFY(cache()->statistics().numTransformations < numTransformations);
+
+    // the shard of this thread must have been cleaned as well
+    const KoColorConversionCache::Statistics before = cache()->statistics();
+    KoCachedColorConversionTransformation cct = cache()->cachedConverter(rgb8, rgb16, intent, flags);
+    const KoColorConversionCache::Statistics after = cache()->statistics();
+
+    QCOMPARE(after.hits, before.hits);
+    QCOMPARE(after.creations, before.creations + 1);
+}
+
+KISTEST_MAIN(TestKoColorConversionCache)
@@ -6,6 +6,7 @@
 #include <cfloat>
 
 #include <QTest>
+#include <QVector>
 
 template <class T>
 T mixOpExpectedAlpha(T alpha1, T alpha2, const qint16 *weights)
@@ -385,5 +386,135 @@ void TestKoColorSpaceAbstract::testMixColorsOpU8NoAlphaLinear()
     QCOMPARE(outputPixel[COLOR_CHANNEL_2], mixOpNoAlphaExpectedColor(pixel1[COLOR_CHANNEL_2], pixel2[COLOR_CHANNEL_2], weights));
 }
 
+void TestKoColorSpaceAbstract::testMixColorsOpArea()
+{
+    typedef KoColorSpaceTrait<quint8, 3, 2> U8ColorSpace;
+    KoMixColorsOpImpl<U8ColorSpace> op;
+
+    const int rows = 3;
+    const int cols = 4;
+    const int rowStride = (cols + 1) * U8ColorSpace::pixelSize;
+
+    quint8 pixels[rows * rowStride];
+    quint8 mask[rows * cols];
+
+    const quint8 *pixelPtrs[rows * cols];
+    qint16 weights[rows * cols];
+
+    qsrand(1);
+    for (int i = 0; i < rows * rowStride; i++) {
+        pixels[i] = qrand() & 0xff;
+    }
+
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            const int index = row * cols + col;
+            pixelPtrs[index] = pixels + row * rowStride + col * U8ColorSpace::pixelSize;
+
+            // the weights of the legacy call should sum up to 255
+            mask[index] = index < 3 ? 25 : 20;
+            weights[index] = mask[index];
+        }
+    }
+
+    quint8 expectedPixel[U8ColorSpace::pixelSize];
+    quint8 outputPixel[U8ColorSpace::pixelSize];
+
+    op.mixColors(pixelPtrs, weights, rows * cols, expectedPixel);
+    op.mixColors(pixels, rowStride, mask, cols, rows, cols, outputPixel);
+
+    QCOMPARE(outputPixel[0], expectedPixel[0]);
+    QCOMPARE(outputPixel[1], expectedPixel[1]);
+    QCOMPARE(outputPixel[2], expectedPixel[2]);
+
+    // the result is normalized by the sum of the mask
+    for (int i = 0; i < rows * cols; i++) {
+        mask[i] = 255;
+    }
+
+    op.mixColors(pixelPtrs, rows * cols, expectedPixel);
+    op.mixColors(pixels, rowStride, mask, cols, rows, cols, outputPixel);
+
+    QCOMPARE(outputPixel[0], expectedPixel[0]);
+    QCOMPARE(outputPixel[1], expectedPixel[1]);
+    QCOMPARE(outputPixel[2], expectedPixel[2]);
+
+    op.mixColors(pixels, rowStride, 0, 0, rows, cols, outputPixel);
+
+    QCOMPARE(outputPixel[0], expectedPixel[0]);
+    QCOMPARE(outputPixel[1], expectedPixel[1]);
+    QCOMPARE(outputPixel[2], expectedPixel[2]);
+
+    // fully transparent mask
+    memset(mask, 0, sizeof(mask));
+    op.mixColors(pixels, rowStride, mask, cols, rows, cols, outputPixel);
+
+    QCOMPARE(outputPixel[0], quint8(0));
+    QCOMPARE(outputPixel[1], quint8(0));
+    QCOMPARE(outputPixel[2], quint8(0));
+}
+
+template <class Traits>
+void testVectorizedMixColorsOp(typename Traits::channels_type maxValue)
+{
+    typedef typename Traits::channels_type channels_type;
+
+    KoMixColorsOpImpl<Traits> vectorizedOp;
+    KoMixColorsOpImpl<Traits, KoMixColorsScalarAccumulator<Traits>> scalarOp;
+
+    const int rows = 33;
+    const int cols = 47;
+    const int numPixels = rows * cols;
+
+    QVector<channels_type> pixels(numPixels * Traits::channels_nb);
+    QVector<quint8> mask(numPixels);
+    QVector<qint16> weights(numPixels);
+    QVector<const quint8*> pixelPtrs(numPixels);
+
+    qsrand(1);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = channels_type(maxValue * (qrand() % 1000) / 999);
+    }
+
+    for (int i = 0; i < numPixels; i++) {
+        mask[i] = qrand() & 0xff;
+        // negative weights are used by the scaling filters
+        weights[i] = qrand() % 600 - 200;
+        pixelPtrs[i] = reinterpret_cast<const quint8*>(pixels.constData() + i * Traits::channels_nb);
+    }
+
+    const quint8 *rawPixels = reinterpret_cast<const quint8*>(pixels.constData());
+    const int rowStride = cols * Traits::pixelSize;
+
+    channels_type expectedPixel[Traits::channels_nb];
+    channels_type outputPixel[Traits::channels_nb];
+
+    quint8 *expected = reinterpret_cast<quint8*>(expectedPixel);
+    quint8 *output = reinterpret_cast<quint8*>(outputPixel);
+
+    scalarOp.mixColors(pixelPtrs.constData(), weights.constData(), numPixels, expected);
+    vectorizedOp.mixColors(pixelPtrs.constData(), weights.constData(), numPixels, output);
+    QVERIFY(!memcmp(expectedPixel, outputPixel, Traits::pixelSize));
+
+    scalarOp.mixColors(rawPixels, numPixels, expected);
+    vectorizedOp.mixColors(rawPixels, numPixels, output);
+    QVERIFY(!memcmp(expectedPixel, outputPixel, Traits::pixelSize));
+
+    scalarOp.mixColors(rawPixels, rowStride, mask.constData(), cols, rows, cols, expected);
+    vectorizedOp.mixColors(rawPixels, rowStride, mask.constData(), cols, rows, cols, output);
+    QVERIFY(!memcmp(expectedPixel, outputPixel, Traits::pixelSize));
+
+    scalarOp.mixColors(rawPixels, rowStride, 0, 0, rows, cols, expected);
+    vectorizedOp.mixColors(rawPixels, rowStride, 0, 0, rows, cols, output);
+    QVERIFY(!memcmp(expectedPixel, outputPixel, Traits::pixelSize));
+}
+
+void TestKoColorSpaceAbstract::testMixColorsOpVectorized()
+{
+    testVectorizedMixColorsOp<KoBgrU8Traits>(255);
+    testVectorizedMixColorsOp<KoBgrU16Traits>(65535);
+    testVectorizedMixColorsOp<KoRgbF32Traits>(1.0f);
+}
+
 
 QTEST_GUILESS_MAIN(TestKoColorSpaceAbstract)
@@ -27,6 +27,15 @@ bool KisCanvasUpdatesCompressor::putUpdateInfo(KisUpdateInfoSP info)
     QMutexLocker l(&m_mutex);
     KisUpdateInfoList::iterator it = m_updatesList.begin();
 
+    /**
+     * A stroke usually produces a lot of small updates, which do not
+     * override anything, so the queue is scanned only when the new
+     * update touches the area of the queued ones
+     */
+    if (!m_queuedRegion.intersects(newUpdateRect)) {
+        it = m_updatesList.end();
+    }
+
     while (it != m_updatesList.end()) {
         if (levelOfDetail == (*it)->levelOfDetail() &&
             newUpdateRect.contains((*it)->dirtyImageRect())) {
@@ -43,6 +52,7 @@ bool KisCanvasUpdatesCompressor::putUpdateInfo(KisUpdateInfoSP info)
     }
 
     m_updatesList.append(info);
+    m_queuedRegion.addRect(newUpdateRect);
 
     return m_updatesList.size() <= 1;
 }
@@ -53,4 +63,5 @@ void KisCanvasUpdatesCompressor::takeUpdateInfo(KisUpdateInfoList &list)
 
     QMutexLocker l(&m_mutex);
     m_updatesList.swap(list);
+    m_queuedRegion.clear();
 }
@@ -24,6 +24,7 @@
 #include <QMutexLocker>
 
 #include "kis_update_info.h"
+#include "KisTileAlignedRegion.h"
 
 typedef QList<KisUpdateInfoSP> KisUpdateInfoList;
 
@@ -36,6 +37,13 @@ public:
 private:
     QMutex m_mutex;
     KisUpdateInfoList m_updatesList;
+
+    /**
+     * A superset of the dirty rects of the queued updates. The updates
+     * are never removed from it, so it is reset only when the queue
+     * is taken.
+     */
+    KisTileAlignedRegion m_queuedRegion;
 };
 
 #endif /* __KIS_CANVAS_UPDATES_COMPRESSOR_H */
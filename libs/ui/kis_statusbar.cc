@@ -262,11 +262,15 @@ void KisStatusBar::updateMemoryStatus()
                   "Image size:\t %1\n"
                   "  - layers:\t\t %2\n"
                   "  - projections:\t %3\n"
-                  "  - instant preview:\t %4\n",
+                  "  - instant preview:\t %4\n"
+                  "  - animation frames:\t %5\n"
+                  "  - onion skins:\t %6\n",
                   format.formatByteSize(stats.imageSize),
                   format.formatByteSize(stats.layersSize),
                   format.formatByteSize(stats.projectionsSize),
-                  format.formatByteSize(stats.lodSize));
+                  format.formatByteSize(stats.lodSize),
+                  format.formatByteSize(stats.framesSize),
+                  format.formatByteSize(stats.onionSkinsSize));
 
     const QString memoryStatsMsg =
             i18nc("tooltip on statusbar memory reporting button (total stats)",
@@ -274,6 +278,7 @@ void KisStatusBar::updateMemoryStatus()
                   "  image data:\t %3 / %4\n"
                   "  pool:\t\t %5 / %6\n"
                   "  undo data:\t %7\n"
+                  "  flat tiles saved:\t %9\n"
                   "\n"
                   "Swap used:\t %8",
                   format.formatByteSize(stats.totalMemorySize),
@@ -286,9 +291,20 @@ void KisStatusBar::updateMemoryStatus()
                   format.formatByteSize(stats.tilesPoolLimit),
 
                   format.formatByteSize(stats.historicalMemorySize),
-                  format.formatByteSize(stats.swapSize));
+                  format.formatByteSize(stats.swapSize),
 
-    QString longStats = imageStatsMsg + "\n" + memoryStatsMsg;
+                  format.formatByteSize(stats.uniformTilesReclaimedSize));
+
+    const QString historyStatsMsg =
+            i18nc("tooltip on statusbar memory reporting button (undo history stats)",
+                  "Compressed undo data:\t %1\n"
+                  "  - in swap:\t\t %2\n"
+                  "  - saved:\t\t %3",
+                  format.formatByteSize(stats.historyCompressedSize),
+                  format.formatByteSize(stats.historyCompressedSwapSize),
+                  format.formatByteSize(stats.historyCompressionSavedSize));
+
+    QString longStats = imageStatsMsg + "\n" + memoryStatsMsg + "\n\n" + historyStatsMsg;
 
     QString shortStats = format.formatByteSize(stats.imageSize);
     QIcon icon;
@@ -305,6 +321,18 @@ void KisStatusBar::updateMemoryStatus()
         longStats += suffix;
     }
 
+    if (stats.numLostHistoryTiles > 0) {
+        icon = KisIconUtils::loadIcon("dialog-warning");
+        QString suffix =
+                i18ncp("tooltip on statusbar memory reporting button",
+                       "\n\nWARNING:\t%1 tile of the undo history could not be restored\n"
+                       "\t\tand has been replaced with transparent pixels",
+                       "\n\nWARNING:\t%1 tiles of the undo history could not be restored\n"
+                       "\t\tand have been replaced with transparent pixels",
+                       stats.numLostHistoryTiles);
+        longStats += suffix;
+    }
+
     m_shortMemoryTag = shortStats;
     m_longMemoryTag = longStats;
     m_memoryStatusIcon = icon;
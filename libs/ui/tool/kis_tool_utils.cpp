@@ -22,7 +22,7 @@
 #include <KoMixColorsOp.h>
 #include <kis_group_layer.h>
 #include <kis_transaction.h>
-#include <kis_sequential_iterator.h>
+#include <kis_paint_device.h>
 #include <kis_properties_configuration.h>
 #include <kconfiggroup.h>
 #include <ksharedconfig.h>
@@ -47,25 +47,32 @@ namespace KisToolUtils {
 
         // Sampling radius.
         if (!pure && radius > 1) {
-            QVector<const quint8*> pixels;
             const int effectiveRadius = radius - 1;
 
             const QRect pickRect(pos.x() - effectiveRadius, pos.y() - effectiveRadius,
                                  2 * effectiveRadius + 1, 2 * effectiveRadius + 1);
-            KisSequentialConstIterator it(dev, pickRect);
+
+            const int pixelSize = cs->pixelSize();
+            QVector<quint8> pixels(pickRect.width() * pickRect.height() * pixelSize);
+            dev->readBytes(pixels.data(), pickRect);
+
+            // the pixels inside the circle are mixed with equal weights
+            QVector<quint8> mask(pickRect.width() * pickRect.height());
+            quint8 *maskPtr = mask.data();
 
             const int radiusSq = pow2(effectiveRadius);
 
-            while (it.nextPixel()) {
-                const QPoint realPos(it.x(),  it.y());
-                const QPoint pt = realPos - pos;
-                if (pow2(pt.x()) + pow2(pt.y()) < radiusSq) {
-                    pixels << it.oldRawData();
+            for (int y = pickRect.top(); y <= pickRect.bottom(); y++) {
+                for (int x = pickRect.left(); x <= pickRect.right(); x++) {
+                    const QPoint pt = QPoint(x, y) - pos;
+                    *maskPtr++ = pow2(pt.x()) + pow2(pt.y()) < radiusSq ? 255 : 0;
                 }
             }
 
-            const quint8 **cpixels = const_cast<const quint8**>(pixels.constData());
-            cs->mixColorsOp()->mixColors(cpixels, pixels.size(), pickedColor.data());
+            cs->mixColorsOp()->mixColors(pixels.constData(), pickRect.width() * pixelSize,
+                                         mask.constData(), pickRect.width(),
+                                         pickRect.height(), pickRect.width(),
+                                         pickedColor.data());
         } else {
             dev->pixel(pos.x(), pos.y(), &pickedColor);
         }
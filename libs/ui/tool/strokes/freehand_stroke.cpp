@@ -39,6 +39,7 @@
 #include <strokes/KisMaskedFreehandStrokePainter.h>
 
 #include "brushengine/kis_paintop_utils.h"
+#include "KisTileAlignedRegion.h"
 
 
 struct FreehandStrokeStrategy::Private
@@ -116,6 +117,8 @@ void FreehandStrokeStrategy::init()
     setSupportsWrapAroundMode(true);
     setSupportsMaskingBrush(true);
     setSupportsIndirectPainting(true);
+    setPriority(INTERACTIVE);
+    setAffectedNodes({m_d->resources->currentNode()});
     enableJob(KisSimpleStrokeStrategy::JOB_DOSTROKE);
 
     if (m_d->needsAsynchronousUpdates) {
@@ -323,7 +326,8 @@ void FreehandStrokeStrategy::issueSetDirtySignals()
         runnableJobsInterface()->addRunnableJobs(jobs);
 
     } else {
-        targetNode()->setDirty(dirtyRects);
+        // the rects of different painters may still overlap
+        targetNode()->setDirty(KisTileAlignedRegion(dirtyRects));
     }
 
     //KisUpdateTimeMonitor::instance()->reportJobFinished(data, dirtyRects);
@@ -85,6 +85,8 @@ KisFilterStrokeStrategy::KisFilterStrokeStrategy(KisFilterSP filter,
     m_d->levelOfDetail = 0;
 
     setSupportsWrapAroundMode(true);
+    setPriority(BACKGROUND);
+    setAffectedNodes({m_d->node});
     enableJob(KisSimpleStrokeStrategy::JOB_DOSTROKE);
 }
 
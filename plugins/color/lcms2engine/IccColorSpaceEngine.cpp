@@ -69,6 +69,16 @@ public:
 
 public:
 
+    /**
+     * lcms2 works on a local copy of the transform cache inside
+     * cmsDoTransform(), so one transform can be used by several
+     * threads at the same time
+     */
+    bool isThreadSafe() const override
+    {
+        return true;
+    }
+
     void transform(const quint8 *src, quint8 *dst, qint32 numPixels) const override
     {
         Q_ASSERT(m_transform);
@@ -199,6 +199,12 @@ bool IccColorProfile::hasTRC() const
         return d->shared->lcmsProfile->hasTRC();
     return false;
 }
+bool IccColorProfile::isMatrixShaper() const
+{
+    if (d->shared->lcmsProfile)
+        return d->shared->lcmsProfile->isMatrixShaper();
+    return false;
+}
 QVector <qreal> IccColorProfile::getColorantsXYZ() const
 {
     if (d->shared->lcmsProfile) {
@@ -319,6 +319,21 @@ bool LcmsColorProfileContainer::hasTRC() const
 {
     return d->hasTRC;
 }
+bool LcmsColorProfileContainer::isMatrixShaper() const
+{
+    if (!d->isMatrixShaper) return false;
+
+    // lcms prefers the lookup tables over the matrix when both are present
+    for (cmsUInt32Number intent = INTENT_PERCEPTUAL; intent <= INTENT_ABSOLUTE_COLORIMETRIC; intent++) {
+        if (cmsIsCLUT(d->profile, intent, LCMS_USED_AS_INPUT) ||
+            cmsIsCLUT(d->profile, intent, LCMS_USED_AS_OUTPUT)) {
+
+            return false;
+        }
+    }
+
+    return true;
+}
 QVector <double> LcmsColorProfileContainer::getColorantsXYZ() const
 {
     QVector <double> colorants(9);
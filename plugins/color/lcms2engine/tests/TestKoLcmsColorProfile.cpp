@@ -5,6 +5,8 @@
 #include <LcmsColorProfileContainer.h>
 
 #include <KoColor.h>
+#include <KoColorModelStandardIds.h>
+#include <KoFastColorConversionTransformation.h>
 
 #include <QTest>
 
@@ -101,4 +103,141 @@ void TestKoLcmsColorProfile::testProofingConversion()
     Q_ASSERT((dst[0] == alarm[0]) && (dst[1] == alarm[1]) && (dst[2] == alarm[2]));
 
 }
+
+void TestKoLcmsColorProfile::testFastDepthConversion()
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8("sRGB built-in");
+    const KoColorSpace *rgb16 = KoColorSpaceRegistry::instance()->rgb16("sRGB built-in");
+    QVERIFY(rgb8);
+    QVERIFY(rgb16);
+
+    QScopedPointer<KoColorConversionTransformation> transfo(
+        KoColorSpaceRegistry::instance()->createColorConverter(rgb8, rgb16,
+                                                               KoColorConversionTransformation::internalRenderingIntent(),
+                                                               KoColorConversionTransformation::internalConversionFlags()));
+
+    KoFastColorConversionTransformation *fastTransfo =
+        dynamic_cast<KoFastColorConversionTransformation*>(transfo.data());
+    QVERIFY(fastTransfo);
+    QCOMPARE(fastTransfo->conversionPath(), KoFastColorConversionTransformation::DepthScaling);
+
+    const int numPixels = 256;
+
+    QVector<quint8> src(numPixels * 4);
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = (i * 7) & 0xff;
+    }
+
+    QVector<quint16> dst(numPixels * 4);
+    transfo->transform(src.constData(), reinterpret_cast<quint8*>(dst.data()), numPixels);
+
+    for (int i = 0; i < src.size(); i++) {
+        QCOMPARE(int(dst[i]), int(src[i]) * 257);
+    }
+}
+
+namespace {
+
+/**
+ * Converts the same pixels with the fast transformation and with
+ * the unoptimized lcms pipeline and compares the results
+ */
+void checkFastToneCurveConversion(const KoColorSpace *srcColorSpace,
+                                  const KoColorSpace *dstColorSpace,
+                                  int tolerance)
+{
+    QScopedPointer<KoColorConversionTransformation> transfo(
+        KoColorSpaceRegistry::instance()->createColorConverter(srcColorSpace, dstColorSpace,
+                                                               KoColorConversionTransformation::IntentRelativeColorimetric,
+                                                               KoColorConversionTransformation::BlackpointCompensation));
+
+    KoFastColorConversionTransformation *fastTransfo =
+        dynamic_cast<KoFastColorConversionTransformation*>(transfo.data());
+    QVERIFY(fastTransfo);
+    QCOMPARE(fastTransfo->conversionPath(), KoFastColorConversionTransformation::ToneCurves);
+
+    const int numPixels = 4096;
+
+    QVector<quint16> src(numPixels * 4);
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = (i * 97) & 0xffff;
+    }
+
+    QVector<quint16> dst(numPixels * 4);
+    transfo->transform(reinterpret_cast<const quint8*>(src.constData()),
+                       reinterpret_cast<quint8*>(dst.data()), numPixels);
+
+    QVector<quint16> lcmsDst(numPixels * 4);
+
+    const QByteArray srcRawData = srcColorSpace->profile()->rawData();
+    const QByteArray dstRawData = dstColorSpace->profile()->rawData();
+    cmsHPROFILE srcProfile = cmsOpenProfileFromMem((void *)srcRawData.constData(), srcRawData.size());
+    cmsHPROFILE dstProfile = cmsOpenProfileFromMem((void *)dstRawData.constData(), dstRawData.size());
+
+    cmsHTRANSFORM tf = cmsCreateTransform(srcProfile,
+                                          TYPE_BGRA_16,
+                                          dstProfile,
+                                          TYPE_BGRA_16,
+                                          INTENT_RELATIVE_COLORIMETRIC,
+                                          cmsFLAGS_NOOPTIMIZE);
+
+    cmsDoTransform(tf, src.constData(), lcmsDst.data(), numPixels);
+
+    cmsDeleteTransform(tf);
+    cmsCloseProfile(dstProfile);
+    cmsCloseProfile(srcProfile);
+
+    for (int i = 0; i < dst.size(); i++) {
+        // lcms doesn't touch the alpha channel
+        if (i % 4 == 3) {
+            QCOMPARE(dst[i], src[i]);
+        } else if (qAbs(int(dst[i]) - int(lcmsDst[i])) > tolerance) {
+            QFAIL(qPrintable(QString("Fast conversion differs from lcms: channel %1, fast %2, lcms %3")
+                             .arg(i).arg(dst[i]).arg(lcmsDst[i])));
+        }
+    }
+}
+
+}
+
+void TestKoLcmsColorProfile::testFastToneCurveConversion()
+{
+    cmsCIExyY d65;
+    cmsWhitePointFromTemp(&d65, 6504);
+
+    cmsCIExyYTRIPLE rec709Primaries = {
+        {0.6400, 0.3300, 1.0},
+        {0.3000, 0.6000, 1.0},
+        {0.1500, 0.0600, 1.0}
+    };
+
+    cmsToneCurve *linearCurve = cmsBuildGamma(0, 1.0);
+    cmsToneCurve *curves[3] = {linearCurve, linearCurve, linearCurve};
+    cmsHPROFILE linearProfile = cmsCreateRGBProfile(&d65, &rec709Primaries, curves);
+    cmsFreeToneCurve(linearCurve);
+
+    cmsMLU *description = cmsMLUalloc(0, 1);
+    cmsMLUsetASCII(description, "en", "US", "sRGB linear built-in (test)");
+    cmsWriteTag(linearProfile, cmsSigProfileDescriptionTag, description);
+    cmsMLUfree(description);
+
+    KoColorProfile *profile = LcmsColorProfileContainer::createFromLcmsProfile(linearProfile);
+    KoColorSpaceRegistry::instance()->addProfile(profile);
+
+    const KoColorSpace *sRgb = KoColorSpaceRegistry::instance()->rgb16("sRGB built-in");
+    const KoColorSpace *linearRgb = KoColorSpaceRegistry::instance()->rgb16(profile);
+    QVERIFY(sRgb);
+    QVERIFY(linearRgb);
+
+    checkFastToneCurveConversion(sRgb, linearRgb, 4);
+
+    /**
+     * The other direction goes through the reversed sRGB curve,
+     * which is tabulated by lcms (cmsReverseToneCurve()). lcms itself
+     * uses the same reversed curve, but evaluates it in 16-bit
+     * precision, so a bit bigger difference is allowed.
+     */
+    checkFastToneCurveConversion(linearRgb, sRgb, 16);
+}
+
 QTEST_MAIN(TestKoLcmsColorProfile)
@@ -9,6 +9,8 @@ class TestKoLcmsColorProfile : public QObject
 private Q_SLOTS:
     void testConversion();
     void testProofingConversion();
+    void testFastDepthConversion();
+    void testFastToneCurveConversion();
 
 };
 
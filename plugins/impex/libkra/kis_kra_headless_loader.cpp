@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_kra_headless_loader.h"
+
+#include <QFile>
+#include <QScopedPointer>
+
+#include <klocalizedstring.h>
+
+#include <KoStore.h>
+#include <KoXmlReader.h>
+
+#include <kis_image.h>
+#include "kis_kra_loader.h"
+
+
+struct KisKraHeadlessLoader::Private
+{
+    QStringList errorMessages;
+    QStringList warningMessages;
+
+    bool loadAndParse(KoStore *store, const QString &filename, KoXmlDocument &xmldoc);
+};
+
+bool KisKraHeadlessLoader::Private::loadAndParse(KoStore *store, const QString &filename, KoXmlDocument &xmldoc)
+{
+    if (!store->open(filename)) {
+        errorMessages << i18n("Could not find %1", filename);
+        return false;
+    }
+
+    QString errorMsg;
+    int errorLine, errorColumn;
+    bool ok = xmldoc.setContent(store->device(), &errorMsg, &errorLine, &errorColumn);
+    store->close();
+
+    if (!ok) {
+        errorMessages << i18n("Parsing error in %1 at line %2, column %3\nError message: %4",
+                              filename, errorLine, errorColumn, errorMsg);
+        return false;
+    }
+
+    return true;
+}
+
+KisKraHeadlessLoader::KisKraHeadlessLoader()
+    : m_d(new Private)
+{
+}
+
+KisKraHeadlessLoader::~KisKraHeadlessLoader()
+{
+}
+
+KisImageSP KisKraHeadlessLoader::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_d->errorMessages = QStringList(i18n("Could not open %1", fileName));
+        m_d->warningMessages.clear();
+        return 0;
+    }
+
+    return load(&file, fileName);
+}
+
+KisImageSP KisKraHeadlessLoader::load(QIODevice *io, const QString &fileName)
+{
+    m_d->errorMessages.clear();
+    m_d->warningMessages.clear();
+
+    QScopedPointer<KoStore> store(KoStore::createStore(io, KoStore::Read, "", KoStore::Zip));
+
+    if (store->bad()) {
+        m_d->errorMessages << i18n("Not a valid Krita file");
+        return 0;
+    }
+
+    // Fallback to "old" file format (maindoc.xml)
+    if (!store->hasFile("root") && !store->hasFile("maindoc.xml")) {
+        m_d->errorMessages << i18n("Invalid document: no file 'maindoc.xml'.");
+        return 0;
+    }
+
+    KoXmlDocument doc;
+    if (!m_d->loadAndParse(store.data(), "root", doc)) {
+        return 0;
+    }
+
+    if (doc.doctype().name() != "DOC") {
+        m_d->errorMessages << i18n("The format is not supported or the file is corrupted");
+        return 0;
+    }
+
+    KoXmlElement root = doc.documentElement();
+    const int syntaxVersion = root.attribute("syntaxVersion", "3").toInt();
+    if (syntaxVersion > 2) {
+        m_d->errorMessages << i18n("The file is too new for this version of Krita (%1).", syntaxVersion);
+        return 0;
+    }
+
+    KisKraLoader loader(0, syntaxVersion);
+    KisImageSP image;
+
+    for (KoXmlNode node = root.firstChild(); !node.isNull(); node = node.nextSibling()) {
+        if (node.isElement() && node.nodeName() == "IMAGE") {
+            image = loader.loadXML(node.toElement());
+            break;
+        }
+    }
+
+    if (!image) {
+        m_d->errorMessages << (loader.errorMessages().isEmpty() ?
+                               QStringList(i18n("Unknown error.")) :
+                               loader.errorMessages());
+        return 0;
+    }
+
+    image->blockUpdates();
+    loader.loadBinaryData(store.data(), image, fileName, true);
+    image->unblockUpdates();
+
+    m_d->errorMessages = loader.errorMessages();
+    m_d->warningMessages = loader.warningMessages();
+
+    return m_d->errorMessages.isEmpty() ? image : KisImageSP();
+}
+
+QStringList KisKraHeadlessLoader::errorMessages() const
+{
+    return m_d->errorMessages;
+}
+
+QStringList KisKraHeadlessLoader::warningMessages() const
+{
+    return m_d->warningMessages;
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_KRA_HEADLESS_LOADER_H
+#define __KIS_KRA_HEADLESS_LOADER_H
+
+#include <QScopedPointer>
+#include <QStringList>
+
+#include <kis_types.h>
+#include "kritalibkra_export.h"
+
+class QIODevice;
+
+
+/**
+ * Loads the image of a .kra file without creating a KisDocument.
+ *
+ * Only the node graph with the pixel data is loaded. Everything that
+ * belongs to the document (the palettes, the grid, the guides, the
+ * assistants, the reference images and the audio track) is skipped.
+ * The loaded image has no undo store, so it can be processed with
+ * KisHeadlessImageProcessor without accumulating any history.
+ */
+class KRITALIBKRA_EXPORT KisKraHeadlessLoader
+{
+public:
+    KisKraHeadlessLoader();
+    ~KisKraHeadlessLoader();
+
+    /**
+     * Loads the image from \p fileName. Returns a null
+     * pointer if the file could not be loaded.
+     */
+    KisImageSP load(const QString &fileName);
+
+    /**
+     * Loads the image from \p io. The \p fileName is used
+     * only for resolving the paths of the file layers.
+     */
+    KisImageSP load(QIODevice *io, const QString &fileName = QString());
+
+    /// if empty, loading didn't fail...
+    QStringList errorMessages() const;
+
+    /// if not empty, loading didn't fail, but there are problems
+    QStringList warningMessages() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_KRA_HEADLESS_LOADER_H */
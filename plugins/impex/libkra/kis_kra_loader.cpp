@@ -320,7 +320,7 @@ KisImageSP KisKraLoader::loadXML(const KoXmlElement& element)
 
 
             if(e.tagName() == GLOBALASSISTANTSCOLOR) {
-                if (e.hasAttribute(SIMPLECOLORDATA)) {
+                if (m_d->document && e.hasAttribute(SIMPLECOLORDATA)) {
                     QString colorData = e.attribute(SIMPLECOLORDATA);
                     m_d->document->setAssistantsGlobalColor(KisDomUtils::qStringToQColor(colorData));
                 }
@@ -350,7 +350,12 @@ KisImageSP KisKraLoader::loadXML(const KoXmlElement& element)
     }
     KoXmlNode child;
 
-    for (child = element.lastChild(); !child.isNull(); child = child.previousSibling()) {
+    /**
+     * The grid, the guides, the assistants and the audio track belong
+     * to the document, so they are skipped when the image is loaded
+     * without it, e.g. by KisKraHeadlessLoader
+     */
+    for (child = element.lastChild(); m_d->document && !child.isNull(); child = child.previousSibling()) {
         KoXmlElement e = child.toElement();
         if (e.tagName() == "grid") {
             loadGrid(e);
@@ -431,7 +436,8 @@ void KisKraLoader::loadBinaryData(KoStore * store, KisImageSP image, const QStri
 
 
     // Load the layers data: if there is a profile associated with a layer it will be set now.
-    KisKraLoadVisitor visitor(image, store, m_d->document->shapeController(), m_d->layerFilenames, m_d->keyframeFilenames, m_d->imageName, m_d->syntaxVersion);
+    KoShapeControllerBase *shapeController = m_d->document ? m_d->document->shapeController() : 0;
+    KisKraLoadVisitor visitor(image, store, shapeController, m_d->layerFilenames, m_d->keyframeFilenames, m_d->imageName, m_d->syntaxVersion);
 
     if (external) {
         visitor.setExternalUri(uri);
@@ -501,7 +507,9 @@ void KisKraLoader::loadBinaryData(KoStore * store, KisImageSP image, const QStri
     if (m_d->document && m_d->document->documentInfo()->aboutInfo("comment").isNull())
         m_d->document->documentInfo()->setAboutInfo("comment", m_d->imageComment);
 
-    loadAssistants(store, uri, external);
+    if (m_d->document) {
+        loadAssistants(store, uri, external);
+    }
 }
 
 void KisKraLoader::loadPalettes(KoStore *store, KisDocument *doc)
@@ -717,8 +725,12 @@ KisNodeSP KisKraLoader::loadNode(const KoXmlElement& element, KisImageSP image)
         node = loadColorizeMask(image, element, colorSpace);
     else if (nodeType == FILE_LAYER)
         node = loadFileLayer(element, image, name, opacity);
-    else if (nodeType == REFERENCE_IMAGES_LAYER)
+    else if (nodeType == REFERENCE_IMAGES_LAYER) {
+        // the reference images are not a part of the projection,
+        // they are needed only when there is a document with a canvas
+        if (!m_d->document) return 0;
         node = loadReferenceImagesLayer(element, image);
+    }
     else {
         m_d->warningMessages << i18n("Layer %1 has an unsupported type: %2.", name, nodeType);
         return 0;
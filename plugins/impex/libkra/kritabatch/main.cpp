@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2019 Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+
+#include <klocalizedstring.h>
+
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <KisHeadlessImageProcessor.h>
+#include <filter/kis_filter.h>
+#include <filter/kis_filter_configuration.h>
+#include <filter/kis_filter_registry.h>
+
+#include "kis_kra_headless_loader.h"
+
+
+namespace {
+
+struct BatchOptions {
+    QString outputDir;
+    QByteArray format;
+    int quality = -1;
+    int numThreads = 0;
+    QStringList filters;
+    const KoColorSpace *colorSpace = 0;
+    QSize size;
+};
+
+void printMessages(const QString &fileName, const QStringList &messages)
+{
+    Q_FOREACH (const QString &message, messages) {
+        fprintf(stderr, "%s: %s\n", qPrintable(fileName), qPrintable(message));
+    }
+}
+
+bool processFile(const QString &fileName, const BatchOptions &options)
+{
+    KisKraHeadlessLoader loader;
+    KisImageSP image = loader.load(fileName);
+
+    printMessages(fileName, loader.warningMessages());
+
+    if (!image) {
+        printMessages(fileName, loader.errorMessages());
+        return false;
+    }
+
+    KisHeadlessImageProcessor processor(image, options.numThreads);
+
+    Q_FOREACH (const QString &filterId, options.filters) {
+        KisFilterSP filter = KisFilterRegistry::instance()->value(filterId);
+        processor.applyFilter(filter->defaultConfiguration());
+    }
+
+    if (options.colorSpace) {
+        processor.convertColorSpace(options.colorSpace);
+    }
+
+    if (options.size.isValid()) {
+        processor.scale(options.size);
+    }
+
+    const QFileInfo info(fileName);
+    const QString outputDir = !options.outputDir.isEmpty() ? options.outputDir : info.absolutePath();
+    const QString outputFileName =
+        QDir(outputDir).filePath(info.completeBaseName() + "." + QString::fromLatin1(options.format));
+
+    if (!processor.exportImage(outputFileName, options.format, options.quality)) {
+        printMessages(fileName, QStringList(processor.errorString()));
+        return false;
+    }
+
+    return true;
+}
+
+}
+
+extern "C" int main(int argc, char **argv)
+{
+    /**
+     * No windows are ever shown, but the vector layers
+     * still need the fonts of a QGuiApplication
+     */
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    KLocalizedString::setApplicationDomain("kritabatch");
+
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("kritabatch");
+    app.setOrganizationDomain("krita.org");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("kritabatch loads .kra files without the user interface, "
+                                     "processes them and exports the rendered images.");
+    parser.addHelpOption();
+
+    QCommandLineOption outputDirOption(QStringList() << "o" << "output-dir",
+                                       "The directory for the exported images (by default, the directory of the source file).", "dir");
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+                                    "The format of the exported images.", "format", "png");
+    QCommandLineOption qualityOption(QStringList() << "q" << "quality",
+                                     "The quality of the exported images (0-100), if supported by the format.", "quality", "-1");
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads",
+                                     "The number of the working threads (by default, the number of the cores).", "threads", "0");
+    QCommandLineOption filterOption("filter",
+                                    "Apply a filter with the default settings to all the paint layers. Can be repeated.", "id");
+    QCommandLineOption colorSpaceOption("colorspace",
+                                        "Convert the images to the color space, e.g. RGBA,U8 or GRAYA,U16,<profile>.", "model,depth[,profile]");
+    QCommandLineOption scaleOption("scale",
+                                   "Scale the images to the size, e.g. 1920x1080.", "WxH");
+
+    parser.addOption(outputDirOption);
+    parser.addOption(formatOption);
+    parser.addOption(qualityOption);
+    parser.addOption(threadsOption);
+    parser.addOption(filterOption);
+    parser.addOption(colorSpaceOption);
+    parser.addOption(scaleOption);
+    parser.addPositionalArgument("files", "The .kra files to process.", "[files...]");
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    BatchOptions options;
+    options.outputDir = parser.value(outputDirOption);
+    options.format = parser.value(formatOption).toLatin1();
+    options.quality = parser.value(qualityOption).toInt();
+    options.numThreads = parser.value(threadsOption).toInt();
+    options.filters = parser.values(filterOption);
+
+    Q_FOREACH (const QString &filterId, options.filters) {
+        if (!KisFilterRegistry::instance()->value(filterId)) {
+            fprintf(stderr, "Unknown filter: %s\n", qPrintable(filterId));
+            return 1;
+        }
+    }
+
+    if (parser.isSet(colorSpaceOption)) {
+        const QStringList parts = parser.value(colorSpaceOption).split(',');
+        if (parts.size() >= 2) {
+            options.colorSpace = parts.size() > 2 ?
+                KoColorSpaceRegistry::instance()->colorSpace(parts[0], parts[1], parts[2]) :
+                KoColorSpaceRegistry::instance()->colorSpace(parts[0], parts[1]);
+        }
+
+        if (!options.colorSpace) {
+            fprintf(stderr, "Unknown color space: %s\n", qPrintable(parser.value(colorSpaceOption)));
+            return 1;
+        }
+    }
+
+    if (parser.isSet(scaleOption)) {
+        const QStringList parts = parser.value(scaleOption).split('x');
+        if (parts.size() == 2) {
+            options.size = QSize(parts[0].toInt(), parts[1].toInt());
+        }
+
+        if (options.size.isEmpty()) {
+            fprintf(stderr, "Invalid size: %s\n", qPrintable(parser.value(scaleOption)));
+            return 1;
+        }
+    }
+
+    if (!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)) {
+        fprintf(stderr, "Could not create the output directory: %s\n", qPrintable(options.outputDir));
+        return 1;
+    }
+
+    int numFailed = 0;
+
+    Q_FOREACH (const QString &fileName, parser.positionalArguments()) {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (processFile(fileName, options)) {
+            fprintf(stdout, "%s: done in %lld ms\n", qPrintable(fileName), (long long)timer.elapsed());
+        } else {
+            numFailed++;
+        }
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
@@ -29,6 +29,8 @@
 #include "kis_image.h"
 #include "testutil.h"
 #include "KisPart.h"
+#include "KisHeadlessImageProcessor.h"
+#include "kis_kra_headless_loader.h"
 
 #include <filter/kis_filter_registry.h>
 #include <generator/kis_generator_registry.h>
@@ -69,6 +71,38 @@ void KisKraLoaderTest::testLoading()
     QCOMPARE((int) node->childCount(), 2);
 }
 
+void KisKraLoaderTest::testLoadingHeadless()
+{
+    const QString fileName = QString(FILES_DATA_DIR) + QDir::separator() + "load_test.kra";
+
+    KisKraHeadlessLoader loader;
+    KisImageSP image = loader.load(fileName);
+    QVERIFY(image);
+    QVERIFY(loader.errorMessages().isEmpty());
+
+    QCOMPARE(image->nlayers(), 12);
+    QCOMPARE(image->height(), 753);
+    QCOMPARE(image->width(), 1000);
+    QCOMPARE(image->colorSpace()->id(), KoColorSpaceRegistry::instance()->rgb8()->id());
+
+    KisNodeSP node = image->root()->firstChild();
+    QVERIFY(node);
+    QCOMPARE(node->name(), QString("Background"));
+    QVERIFY(node->inherits("KisPaintLayer"));
+
+    KisHeadlessImageProcessor processor(image, 2);
+    QCOMPARE(image->workingThreadsLimit(), 2);
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->loadNativeFormat(fileName);
+    doc->image()->waitForDone();
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::compareQImages(errorPoint,
+                                     doc->image()->convertToQImage(doc->image()->bounds(), 0),
+                                     processor.renderProjection()));
+}
+
 void testObligeSingleChildImpl(bool transpDefaultPixel)
 {
 
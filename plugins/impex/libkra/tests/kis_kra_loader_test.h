@@ -28,6 +28,7 @@ private Q_SLOTS:
      void initTestCase();
 
     void testLoading();
+    void testLoadingHeadless();
     void testObligeSingleChild();
     void testObligeSingleChildNonTranspPixel();
 